@@ -0,0 +1,68 @@
+import os
+import re
+import csv
+import json
+import time
+import subprocess
+
+# 实验参数: <replacer, cnt>，在HATtrick混合负载下比较不同置换策略的缓冲池命中率
+replacers = ["LRU", "CLOCK", "LRU-K", "2Q"]
+param_sets = [(replacer, cnt) for replacer in replacers for cnt in range(1, 3)]
+
+# 每组实验运行的时间(s)
+run_time = 300
+
+compute_server_config_file_path = "/root/SeamlessDB/src/config/compute_server_config.json"
+proxy_config_file_path = "/root/SeamlessDB/src/config/proxy_config.json"
+
+# 进入../build文件夹
+os.chdir("../build")
+
+def set_config(path, node, key, value):
+    with open(path) as f:
+        config = json.load(f)
+    config[node][key] = value
+    with open(path, "w") as f:
+        json.dump(config, f, indent=4)
+
+set_config(compute_server_config_file_path, "rw_node", "workload", "TAW")
+set_config(proxy_config_file_path, "rw_node", "workload", "TAW")
+
+results = []
+for replacer, cnt in param_sets:
+    print(f"Running experiment with replacer={replacer}, cnt={cnt}")
+    set_config(compute_server_config_file_path, "rw_node", "replacer", replacer)
+
+    # 运行 active rw 并保存输出
+    active_output = f"replacer_{replacer}_active_{cnt}.txt"
+    with open(active_output, "w") as active_file:
+        active_proc = subprocess.Popen(["./bin/rw_server", "active", "rw"], stdout=active_file)
+
+    time.sleep(15)
+
+    proxy_output = f"replacer_{replacer}_proxy_{cnt}.txt"
+    with open(proxy_output, "w") as proxy_file:
+        proxy_proc = subprocess.Popen(["./bin/proxy", "rw"], stdout=proxy_file, stderr=subprocess.STDOUT)
+
+    time.sleep(run_time)
+
+    # rw_server收到SIGINT之后输出吞吐量和缓冲池命中率
+    active_proc.send_signal(2)
+    time.sleep(5)
+    subprocess.run("ps -ef | grep rw_server | grep -v grep | awk '{print $2}' | xargs kill -9", shell=True)
+    subprocess.run("ps -ef | grep proxy | grep -v grep | awk '{print $2}' | xargs kill -9", shell=True)
+
+    with open(active_output) as f:
+        content = f.read()
+    commit_tput = re.search(r"commit_tput: ([\d.]+)", content)
+    hit_ratio = re.search(r"hit_ratio: ([\d.]+)", content)
+    results.append([replacer, cnt,
+                    commit_tput.group(1) if commit_tput else "",
+                    hit_ratio.group(1) if hit_ratio else ""])
+
+    time.sleep(5)
+
+with open("replacer_results.csv", "w", newline="") as f:
+    writer = csv.writer(f)
+    writer.writerow(["replacer", "cnt", "commit_tput", "hit_ratio"])
+    writer.writerows(results)
@@ -61,9 +61,10 @@ public:
     }
     void print_record() {}
     void get_random_condition(int SF, std::vector<Condition>& index_conds, std::vector<Condition> filter_conds, bool is_index_scan) {}
-    void generate_table_data(int SF, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int SF, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("customer");
         auto index_handle = sm_mgr->primary_index_.at("customer").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
 
         for(c_custkey = 1; c_custkey <= SF * 30000; c_custkey++) {
@@ -99,9 +100,10 @@ public:
 
             assert(offset == tab_meta.record_length_);
 
-            index_handle->insert_entry(record.raw_data_, record.record_, txn);
+            bulk_loader.append(record.raw_data_, record.record_);
         }
 
+        bulk_loader.finish();
     }
 };
 
@@ -149,9 +151,10 @@ public:
     }
     void print_record() {}
     void get_random_condition(int SF, std::vector<Condition>& index_conds, std::vector<Condition> filter_conds, bool is_index_scan) {}
-    void generate_table_data(int SF, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int SF, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("supplier");
         auto index_handle = sm_mgr->primary_index_.at("supplier").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
 
         for(s_suppkey = 1; s_suppkey <= SF * 2000; s_suppkey++) {
@@ -183,8 +186,9 @@ public:
 
             assert(offset == tab_meta.record_length_);
 
-            index_handle->insert_entry(record.raw_data_, record.record_, txn);
+            bulk_loader.append(record.raw_data_, record.record_);
         }
+        bulk_loader.finish();
     }
 };
 
@@ -259,9 +263,10 @@ public:
     }
     void print_record() {}
     void get_random_condition(int SF, std::vector<Condition>& index_conds, std::vector<Condition> filter_conds, bool is_index_scan) {}
-    void generate_table_data(int SF, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int SF, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("lineorder");
         auto index_handle = sm_mgr->primary_index_.at("lineorder").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
 
         // lo_datekey 从19920101到19981231, 一共有 2922 天
@@ -345,7 +350,7 @@ public:
                         memcpy(record.raw_data_ + offset, lo_shipmode, 10);
                         offset += 10;
                         assert(offset == tab_meta.record_length_);
-                        index_handle->insert_entry(record.raw_data_, record.record_, txn);
+                        bulk_loader.append(record.raw_data_, record.record_);
 
                         lo_linenumber++;
                         if(lo_linenumber > 4) {
@@ -412,6 +417,7 @@ public:
         //     index_handle->insert_entry(record.raw_data_, record.record_, txn);
         // }
 
+        bulk_loader.finish();
     }
 };
 
@@ -465,9 +471,10 @@ public:
     }
     void print_record();
     void get_random_condition(int SF, std::vector<Condition>& index_conds, std::vector<Condition> filter_conds, bool is_index_scan);
-    void generate_table_data(int SF, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int SF, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("part");
         auto index_handle = sm_mgr->primary_index_.at("part").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
 
         int total_records = (1 + static_cast<int>(std::log2(SF))) * 200000;
@@ -512,8 +519,9 @@ public:
 
             assert(offset == tab_meta.record_length_);
 
-            index_handle->insert_entry(record.raw_data_, record.record_, txn);
+            bulk_loader.append(record.raw_data_, record.record_);
         }
+        bulk_loader.finish();
     }
 };
 
@@ -586,9 +594,10 @@ public:
     }
     void print_record() {}
     void get_random_condition(int SF, std::vector<Condition>& index_conds, std::vector<Condition> filter_conds, bool is_index_scan) {}
-    void generate_table_data(int SF, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int SF, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("date");
         auto index_handle = sm_mgr->primary_index_.at("date").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
 
         // d_datekey 代表YYYYMMDD，从19920101开始，到19981231结束，共2922天
@@ -676,11 +685,12 @@ public:
                     offset += 1;
                     assert(offset == tab_meta.record_length_);
                     
-                    index_handle->insert_entry(record.raw_data_, record.record_, txn);
+                    bulk_loader.append(record.raw_data_, record.record_);
                 }
             }
         }
 
+        bulk_loader.finish();
     }
 };
 
@@ -713,7 +723,7 @@ public:
     }
     void print_record() {}
     void get_random_condition(int SF, std::vector<Condition>& index_conds, std::vector<Condition> filter_conds, bool is_index_scan) {}
-    void generate_table_data(int SF, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int SF, SmManager* sm_mgr, IxManager* ix_mgr) {
 
     }
 };
@@ -55,7 +55,7 @@ bool HATtrickWK::create_table() {
 #define hattrick_load_table_data(table_name) \
     { \
         HATtrick::table_name* table_name##_table = new HATtrick::table_name(); \
-        table_name##_table->generate_table_data(sf_, txn, sm_mgr_, ix_mgr_); \
+        table_name##_table->generate_table_data(sf_, sm_mgr_, ix_mgr_); \
         delete table_name##_table; \
     }
 
@@ -97,8 +97,6 @@ void HATtrickWK::load_meta() {
 }
 
 void HATtrickWK::load_data() {
-    Transaction* txn = new Transaction(0);
-
     std::cout << "begin load data\n";
 
     hattrick_load_table_data(Customer);
@@ -137,7 +135,6 @@ void HATtrickWK::load_data() {
     hattrick_reload_index(date);
     hattrick_reload_index(history);
     std::cout << "hattrick reload index done!\n";
-    delete txn;
 }
 
 void HATtrickWK::init_transaction(int thread_num) {
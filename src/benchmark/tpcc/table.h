@@ -49,10 +49,11 @@ public:
         w_id, w_name, w_street_1, w_street_2, w_city, w_state, w_zip, w_tax, w_ytd);
     }
 
-    void generate_table_data(int warehouse_num, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int warehouse_num, SmManager* sm_mgr, IxManager* ix_mgr) {
         w_ytd = 3000.5;
         auto tab_meta = sm_mgr->db_.get_table("warehouse");
         auto index_handle = sm_mgr->primary_index_.at("warehouse").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
 
         for(w_id = 1; w_id <= warehouse_num; ++w_id) {
@@ -100,8 +101,9 @@ public:
             off += sizeof(float);
 
             assert(off == tab_meta.record_length_);
-            index_handle->insert_entry(record.raw_data_, record.record_, txn);
+            bulk_loader.append(record.raw_data_, record.record_);
         }
+        bulk_loader.finish();
     }
 
     void generate_data_csv(std::string file_name) {
@@ -170,9 +172,10 @@ public:
         sm_mgr->create_table(table_name, col_defs, pkeys, nullptr);
     }
 
-    void generate_table_data(int warehouse_num, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int warehouse_num, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("district");
         auto index_handle = sm_mgr->primary_index_.at("district").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
 
         for(int w_id = 1; w_id <= warehouse_num; ++w_id) {
@@ -234,9 +237,10 @@ public:
                 memcpy(record.raw_data_ + off, &d_next_o_id, sizeof(int));
                 off += sizeof(int);
                 assert(off == tab_meta.record_length_);
-                index_handle->insert_entry(record.raw_data_, record.record_, txn);
+                bulk_loader.append(record.raw_data_, record.record_);
             }
         }
+        bulk_loader.finish();
     }
 
     void generate_data_csv(std::string file_name) {
@@ -335,9 +339,10 @@ public:
         sm_mgr->create_table(table_name, col_defs, pkeys, nullptr);
     }
 
-    void generate_table_data(int warehouse_num, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int warehouse_num, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("customer");
         auto index_handle = sm_mgr->primary_index_.at("customer").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
 
         for(int w_id = 1; w_id <= warehouse_num; ++w_id) {
@@ -464,10 +469,11 @@ public:
                     off += 51;
 
                     assert(off == tab_meta.record_length_);
-                    index_handle->insert_entry(record.raw_data_, record.record_, txn);
+                    bulk_loader.append(record.raw_data_, record.record_);
                 }
             }
         }
+        bulk_loader.finish();
     }
 
     void generate_data_csv(std::string file_name) {
@@ -567,9 +573,10 @@ public:
         sm_mgr->create_table(table_name, col_defs, pkeys, nullptr);
     }
 
-    void generate_table_data(int warehouse_num, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int warehouse_num, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("history");
         auto index_handle = sm_mgr->primary_index_.at("history").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
         h_id = 0;
 
@@ -626,10 +633,11 @@ public:
                     off += 25;
 
                     assert(off == tab_meta.record_length_);
-                    index_handle->insert_entry(record.raw_data_, record.record_, txn);
+                    bulk_loader.append(record.raw_data_, record.record_);
                 }
             }
         }
+        bulk_loader.finish();
     }
 
     void generate_data_csv(std::string file_name) {
@@ -686,9 +694,10 @@ public:
         sm_mgr->create_table(table_name, col_defs, pkeys, nullptr);
     }
 
-    void generate_table_data(int warehouse_num, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int warehouse_num, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("new_orders");
         auto index_handle = sm_mgr->primary_index_.at("new_orders").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
 
         for(int w_id = 1; w_id <= warehouse_num; ++w_id) {
@@ -712,10 +721,11 @@ public:
                     off += sizeof(int);
 
                     assert(off == tab_meta.record_length_);
-                    index_handle->insert_entry(record.raw_data_, record.record_, txn);
+                    bulk_loader.append(record.raw_data_, record.record_);
                 }
             }
         }
+        bulk_loader.finish();
     }
 
     void generate_data_csv(std::string file_name) {
@@ -778,9 +788,10 @@ public:
         sm_mgr->create_table(table_name, col_defs, pkeys, nullptr);
     }
 
-    void generate_table_data(int warehouse_num, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int warehouse_num, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("orders");
         auto index_handle = sm_mgr->primary_index_.at("orders").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
         
         for(int w_id = 1; w_id <= warehouse_num; ++w_id) {
@@ -844,11 +855,12 @@ public:
                     off += sizeof(int);
 
                     assert(off == tab_meta.record_length_);
-                    index_handle->insert_entry(record.raw_data_, record.record_, txn);
+                    bulk_loader.append(record.raw_data_, record.record_);
 
                 }
             }
         }
+        bulk_loader.finish();
     }
 
     void generate_data_csv(std::string file_name) {
@@ -939,9 +951,10 @@ public:
         sm_mgr->create_table(table_name, col_defs, pkeys, nullptr);
     }
 
-    void generate_table_data(int warehouse_num, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int warehouse_num, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("order_line");
         auto index_handle = sm_mgr->primary_index_.at("order_line").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
 
         for(int w_id = 1; w_id <= warehouse_num; ++w_id) {
@@ -1003,12 +1016,13 @@ public:
                         off += 25;
 
                         assert(off == tab_meta.record_length_);
-                        index_handle->insert_entry(record.raw_data_, record.record_, txn);
+                        bulk_loader.append(record.raw_data_, record.record_);
 
                     }
                 }
             }
         }
+        bulk_loader.finish();
     }
 
     void generate_data_csv(std::string file_name) {
@@ -1071,9 +1085,10 @@ public:
         sm_mgr->create_table(table_name, col_defs, pkeys, nullptr);
     }
 
-    void generate_table_data(int warehouse_num, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int warehouse_num, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("item");
         auto index_handle = sm_mgr->primary_index_.at("item").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
         
         for(i_id = 1; i_id <= MAXITEMS; ++i_id) {
@@ -1109,9 +1124,10 @@ public:
             off += 51;
 
             assert(off == tab_meta.record_length_);
-            index_handle->insert_entry(record.raw_data_, record.record_, txn);
+            bulk_loader.append(record.raw_data_, record.record_);
 
         }
+        bulk_loader.finish();
     }
 
     void generate_data_csv(std::string file_name) {
@@ -1189,9 +1205,10 @@ public:
         sm_mgr->create_table(table_name, col_defs, pkeys, nullptr);
     }
 
-    void generate_table_data(int warehouse_num, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int warehouse_num, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("stock");
         auto index_handle = sm_mgr->primary_index_.at("stock").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
 
         for(int w_id = 1; w_id <= warehouse_num; ++w_id) {
@@ -1287,10 +1304,11 @@ public:
                 off += 51;
 
                 assert(off == tab_meta.record_length_);
-                index_handle->insert_entry(record.raw_data_, record.record_, txn);
+                bulk_loader.append(record.raw_data_, record.record_);
 
             }
         }
+        bulk_loader.finish();
     }
 
     void generate_data_csv(std::string file_name) {
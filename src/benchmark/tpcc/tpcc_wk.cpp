@@ -89,7 +89,7 @@ void TPCCWK::load_meta() {
 
 #define load_table_data(table_name) \
     table_name* table_name##_tab = new table_name(); \
-    table_name##_tab->generate_table_data(warehouse_num_, txn, sm_mgr_, ix_mgr_);
+    table_name##_tab->generate_table_data(warehouse_num_, sm_mgr_, ix_mgr_);
 
 #define flush_index(table_name) \
     auto table_name##_tab_meta = sm_mgr_->db_.get_table(#table_name); \
@@ -102,8 +102,6 @@ void TPCCWK::load_meta() {
     sm_mgr_->primary_index_.emplace(#table_name, ix_mgr_->open_index(#table_name, table_name##_pindex.cols, table_name##_tab_meta));
 
 void TPCCWK::load_data() {
-    Transaction* txn = new Transaction(0);
-
     load_table_data(Warehouse);
     std::cout << "finish load warehouse\n";
     load_table_data(District);
@@ -144,8 +142,6 @@ void TPCCWK::load_data() {
     reload_index(order_line);
     reload_index(item);
     reload_index(stock);
-
-    delete txn;
 }
 
 void TPCCWK::init_transaction(int thread_num) {
@@ -81,9 +81,10 @@ public:
         std::cerr << "[Error]: Not Implemented! [Location]: " << __FILE__  << ":" << __LINE__ << std::endl;
     }
 
-    void generate_table_data(int sf, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int sf, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("region");
         auto index_handle = sm_mgr->primary_index_.at("region").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
 
         for(r_regionkey = 1; r_regionkey <= REGION_NUM; ++r_regionkey) {
@@ -108,8 +109,9 @@ public:
 
             assert(offset == tab_meta.record_length_);
 
-            index_handle->insert_entry(record.raw_data_, record.record_, txn);
+            bulk_loader.append(record.raw_data_, record.record_);
         }
+        bulk_loader.finish();
     }
 
     void generate_data_csv(std::string file_name) {
@@ -182,9 +184,10 @@ public:
         filter_conds.push_back(std::move(cond));
     }
 
-    void generate_table_data(int sf, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int sf, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("nation");
         auto index_handle = sm_mgr->primary_index_.at("nation").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
 
         // int nationkey_max = REGION_NUM * ONE_REGION_PER_NATION;
@@ -221,9 +224,10 @@ public:
                 /*
                     insert data
                 */
-                index_handle->insert_entry(record.raw_data_, record.record_, txn);
+                bulk_loader.append(record.raw_data_, record.record_);
             }
         }
+        bulk_loader.finish();
     }
 
     void generate_data_csv(std::string file_name) {
@@ -284,9 +288,10 @@ public:
         filter_conds.push_back(std::move(cond));
     }
 
-    void generate_table_data(int sf, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int sf, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("nation2");
         auto index_handle = sm_mgr->primary_index_.at("nation2").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
 
         // int nationkey_max = REGION_NUM * ONE_REGION_PER_NATION;
@@ -323,9 +328,10 @@ public:
                 /*
                     insert data
                 */
-                index_handle->insert_entry(record.raw_data_, record.record_, txn);
+                bulk_loader.append(record.raw_data_, record.record_);
             }
         }
+        bulk_loader.finish();
     }
 
     void generate_data_csv(std::string file_name) {
@@ -406,9 +412,10 @@ public:
         index_conds.push_back(std::move(cond));
     }
 
-    void generate_table_data(int SF, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int SF, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("part");
         auto index_handle = sm_mgr->primary_index_.at("part").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
 
         int p_partkey_max = SF * ONE_SF_PER_PART;
@@ -457,8 +464,9 @@ public:
             /*
                 insert data
             */
-            index_handle->insert_entry(record.raw_data_, record.record_, txn);
+            bulk_loader.append(record.raw_data_, record.record_);
         }
+        bulk_loader.finish();
     }
 
     void generate_data_csv(std::string file_name) {
@@ -553,9 +561,10 @@ public:
         index_conds.push_back(std::move(cond));
     }
 
-    void generate_table_data(int SF, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int SF, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("customer");
         auto index_handle = sm_mgr->primary_index_.at("customer").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
 
         /*
@@ -617,7 +626,7 @@ public:
                 /*
                     insert data
                 */
-                index_handle->insert_entry(record.raw_data_, record.record_, txn);
+                bulk_loader.append(record.raw_data_, record.record_);
                 c_custkey ++;
             }
 
@@ -674,6 +683,7 @@ public:
         //     */
         //     index_handle->insert_entry(record.raw_data_, record.record_, txn);
         // }
+        bulk_loader.finish();
     }
 
     void generate_data_csv(std::string file_name) {
@@ -788,9 +798,10 @@ public:
         index_conds.push_back(std::move(cond));
     }
 
-    void generate_table_data(int SF, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int SF, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("orders");
         auto index_handle = sm_mgr->primary_index_.at("orders").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
 
         /*
@@ -860,7 +871,7 @@ public:
                 /*
                     insert data
                 */
-                index_handle->insert_entry(record.raw_data_, record.record_, txn);
+                bulk_loader.append(record.raw_data_, record.record_);
 
                 o_orderkey ++;
             }
@@ -926,6 +937,7 @@ public:
         //     */
         //     index_handle->insert_entry(record.raw_data_, record.record_, txn);
         // }
+        bulk_loader.finish();
     }
 
     void generate_data_csv(std::string file_name) {
@@ -1010,9 +1022,10 @@ public:
         index_conds.push_back(std::move(cond));
     }
 
-    void generate_table_data(int SF, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int SF, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("supplier");
         auto index_handle = sm_mgr->primary_index_.at("supplier").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
 
         /*
@@ -1074,10 +1087,11 @@ public:
             /*
                 insert data
             */
-            index_handle->insert_entry(record.raw_data_, record.record_, txn);
+            bulk_loader.append(record.raw_data_, record.record_);
             s_suppkey ++;
             }
         }
+        bulk_loader.finish();
     }
 
     void generate_data_csv(std::string file_name) {
@@ -1159,9 +1173,10 @@ public:
         // filter_conds.push_back(std::move(cond2));
     }
 
-    void generate_table_data(int SF, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int SF, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("partsupp");
         auto index_handle = sm_mgr->primary_index_.at("partsupp").get();
+        IxBulkLoader bulk_loader(index_handle, false);
         Record record(tab_meta.record_length_);
 
         /*
@@ -1216,10 +1231,11 @@ public:
                 /*
                     insert data
                 */
-                index_handle->insert_entry(record.raw_data_, record.record_, txn);
+                bulk_loader.append(record.raw_data_, record.record_);
                 
             }
         }
+        bulk_loader.finish();
     }
 
     void generate_data_csv(std::string file_name) {
@@ -1366,9 +1382,10 @@ public:
         index_conds.push_back(std::move(cond2));
     }
 
-    void generate_table_data(int SF, Transaction* txn, SmManager* sm_mgr, IxManager* ix_mgr) {
+    void generate_table_data(int SF, SmManager* sm_mgr, IxManager* ix_mgr) {
         auto tab_meta = sm_mgr->db_.get_table("lineitem");
         auto index_handle = sm_mgr->primary_index_.at("lineitem").get();
+        IxBulkLoader bulk_loader(index_handle, true);
         Record record(tab_meta.record_length_);
 
         /*
@@ -1469,7 +1486,7 @@ public:
                 /*
                     insert data
                 */
-                index_handle->insert_entry(record.raw_data_, record.record_, txn);
+                bulk_loader.append(record.raw_data_, record.record_);
                 l_id ++;
 
                 l_linenumber ++;
@@ -1579,6 +1596,7 @@ public:
         //     }
         //     std::cout << "finish insert l_orderkey = " << l_orderkey << std::endl;
         // }
+        bulk_loader.finish();
     }
 
     void generate_data_csv(std::string file_name) {
@@ -65,7 +65,7 @@ bool TPCHWK::create_table() {
 */
 #define tpch_load_table_data(table_name) \
     TPCH_TABLE::table_name* table_name##_tab = new TPCH_TABLE::table_name(); \
-    table_name##_tab->generate_table_data(sf_, txn, sm_mgr_, ix_mgr_); \
+    table_name##_tab->generate_table_data(sf_, sm_mgr_, ix_mgr_); \
     delete table_name##_tab;
 
 #define tpch_flush_index(table_name) \
@@ -79,7 +79,6 @@ bool TPCHWK::create_table() {
     sm_mgr_->primary_index_.emplace(#table_name, ix_mgr_->open_index(#table_name, table_name##_pindex.cols, table_name##_tab_meta));
 
 void TPCHWK::load_data() {
-    Transaction* txn = new Transaction(0);
     /*
         load table data
     */
@@ -142,8 +141,6 @@ void TPCHWK::load_data() {
     tpch_reload_index(partsupp);
     tpch_reload_index(lineitem);
     std::cout << "tpch reload index done!\n";
-
-    delete txn;
 }
 
 #define load_index(table_name) \
@@ -33,7 +33,34 @@ static constexpr int PAGE_SIZE = 4096;                                        //
 static constexpr int LOG_BUFFER_SIZE = (1024 * PAGE_SIZE);                    // size of a log buffer in byte
 static constexpr int BUCKET_SIZE = 100;                                        // size of extendible hash bucket
 static constexpr int BUFFER_POOL_NUM = 128;
+static constexpr size_t BUFFER_POOL_MAX_SHARE = 4;                              // a buffer pool partition holds at most this many times its even share of the frames
+static constexpr double BUFFER_POOL_MIN_SHARE = 0.25;                           // a buffer pool partition does not lend frames once it holds less than this share of its even share
+static constexpr size_t BUFFER_POOL_LEND_TRIES = 4;                             // number of partitions asked to lend a frame before a partition evicts one of its own pages
+static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;                      // size of a huge page backing the buffer pool frame arena
+static constexpr int LOCK_TABLE_SHARD_NUM = 64;                                 // number of hash partitions of the lock table, each has its own latch
+static constexpr size_t LOCK_FREELIST_MAX_SIZE = 4096;                          // max number of cached Lock/LockRequestQueue objects per thread
 static constexpr int JOIN_BUFFER_SIZE = 256 * 1024;                             // default 256k
+static constexpr int IX_NEXT_LEAF_READ_RETRY = 16;                              // optimistic reads of a right sibling before giving up its first record_no
+static constexpr int IX_SCAN_READ_AHEAD_MIN = 4;                                // initial number of leaves prefetched by an index scan
+static constexpr int IX_SCAN_READ_AHEAD_MAX = 64;                               // max read-ahead window (leaves) of an index scan
+static constexpr double IX_BULK_LOAD_FILL_FACTOR = 0.9;                         // default fill factor of pages built by the bulk loader
+static constexpr size_t IX_BULK_LOAD_RUN_SIZE = 256 * 1024 * 1024;              // in-memory run size of the bulk loader's external sort, 256MB
+static constexpr int IX_BULK_LOAD_WRITE_BATCH = 64;                             // max number of contiguous pages written by one pwrite
+static constexpr double IX_APPEND_SPLIT_FILL_FACTOR = 0.9;                      // fill factor kept in the left node when the rightmost node splits on an append
+static constexpr double IX_COMPACT_TRIGGER_FACTOR = 0.6;                        // leaves filled less than this are refilled by the online compaction
+static constexpr double IX_COMPACT_FILL_FACTOR = 0.9;                           // fill factor of leaves rewritten by the online compaction
+static constexpr int IX_COMPACT_MAX_WINDOW = 16;                                // max number of adjacent leaves rewritten by one compaction
+static constexpr int IX_COMPACT_INTERVAL_MS = 1000;                             // interval of the background index compaction
+static constexpr int IX_COMPACT_MAX_NUM = 64;                                   // max number of compacted leaf groups per index in one round
+static constexpr int GROUP_COMMIT_WINDOW_US = 0;                                // default time the log shipper waits for more committers before shipping
+static constexpr int GROUP_COMMIT_MAX_SIZE = 32;                                // default number of queued committers that makes the log shipper ship without waiting
+static constexpr int LOG_SHIP_MAX_INFLIGHT = 4;                                 // max number of LogWrite batches in flight to the storage node
+static constexpr int LOG_SHIP_RETRY_INTERVAL_MS = 10;                           // interval before a failed LogWrite batch is resent
+static constexpr int LOG_REPLAY_WORKER_NUM = 8;                                 // default number of page-partitioned log replay workers on the storage node
+static constexpr int LOG_REPLAY_QUEUE_SIZE = 1024;                              // max number of queued logs per replay worker
+static constexpr int PAGE_FLUSH_INTERVAL_MS = 1000;                             // default interval of the storage node background page flusher
+static constexpr int PAGE_FLUSH_BATCH_SIZE = 256;                               // max number of dirty pages copied out and written in one flush batch
+static constexpr unsigned IO_URING_QUEUE_DEPTH = 256;                           // max number of in-flight disk requests per thread when io_uring is enabled
 
 using frame_id_t = int32_t;  // frame id type, 帧页ID, 页在BufferPool中的存储单元称为帧,一帧对应一页
 using page_id_t = int32_t;   // page id type , 页ID
@@ -79,8 +106,10 @@ const mr_id_t STATE_JOIN_BLOCK_BUF_ID   = 104;
 // log file
 static const std::string LOG_FILE_NAME = "db.log";
 
-// replacer
+// replacer, one of "LRU", "CLOCK", "LRU-K", "2Q"
 static const std::string REPLACER_TYPE = "LRU";
+static constexpr size_t LRU_K_REPLACER_K = 2;                                   // number of recent accesses tracked per frame by the LRU-K replacer
+static constexpr double TWO_QUEUE_A1_RATIO = 0.25;                              // share of the frames kept in the FIFO queue of first-time accesses by the 2Q replacer
 
 static const std::string DB_META_NAME = "db.meta";
 
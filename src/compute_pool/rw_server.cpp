@@ -53,6 +53,7 @@ int* abort_txns;
 int client_num;
 std::chrono::_V2::system_clock::time_point server_start_time;
 std::chrono::_V2::system_clock::time_point server_end_time;
+BufferPoolManager* buffer_pool_mgr = nullptr;    // 退出时统计缓冲池命中率
 
 static jmp_buf jmpbuf;
 bool should_exit = false;
@@ -77,6 +78,12 @@ void sigint_handler(int signo) {
     double abort_tput = (double)tot_abort_txn / ((double)tot_commit_txn / 1000.0);
 
     std::cout << "commit_tput: " << commit_tput << ", abort_tput: " << abort_tput << "\n";
+    if(buffer_pool_mgr != nullptr) {
+        size_t hits = 0, misses = 0;
+        buffer_pool_mgr->get_fetch_stats(&hits, &misses);
+        double hit_ratio = (hits + misses == 0) ? 0.0 : (double)hits / (double)(hits + misses);
+        std::cout << "buffer_pool_hits: " << hits << ", buffer_pool_misses: " << misses << ", hit_ratio: " << hit_ratio << "\n";
+    }
     RwServerDebug::getInstance()->DEBUG_PRINT("[commit_tput: " + std::to_string(commit_tput) + "][abort_tput: " + std::to_string(abort_tput) + "]");
 
     longjmp(jmpbuf, 1);
@@ -127,9 +134,9 @@ void sigint_handler(int signo) {
 //     }
 // }
 
-RWNode::RWNode(int local_rpc_port, std::string workload, int record_num, int thread_num, int buffer_pool_size, std::string config_path) 
+RWNode::RWNode(int local_rpc_port, std::string workload, int record_num, int thread_num, int buffer_pool_size, std::string replacer_type, std::string config_path) 
     : local_rpc_port_(local_rpc_port), workload_(workload), record_num_(record_num), thread_num_(thread_num),
-    buffer_pool_size_(buffer_pool_size), config_path_(config_path){
+    buffer_pool_size_(buffer_pool_size), replacer_type_(replacer_type), config_path_(config_path){
 
     // init page channel and log channel
     page_channel_ = new brpc::Channel();
@@ -168,7 +175,7 @@ RWNode::RWNode(int local_rpc_port, std::string workload, int record_num, int thr
     // create database components
     disk_mgr_ = new DiskManager();
     slice_mgr_ = new SliceMetaManager();
-    buffer_pool_mgr_ = new BufferPoolManager(NodeType::COMPUTE_NODE, buffer_pool_size_, page_channel_, disk_mgr_, slice_mgr_);
+    buffer_pool_mgr_ = new BufferPoolManager(NodeType::COMPUTE_NODE, buffer_pool_size_, page_channel_, disk_mgr_, slice_mgr_, replacer_type_);
     index_mgr_ = new IxManager(buffer_pool_mgr_, disk_mgr_);
     mvcc_mgr_ = new MultiVersionManager(disk_mgr_, buffer_pool_mgr_);
     sm_mgr_ = new SmManager(disk_mgr_, buffer_pool_mgr_, index_mgr_, mvcc_mgr_);
@@ -215,7 +222,7 @@ int get_connection_id(char* data) {
     return conn_id;
 }
 
-void replay_log_for_resumption(SmManager* sm_mgr) {
+void replay_log_for_resumption(SmManager* sm_mgr, LogManager* log_mgr) {
     ContextManager* state_mgr = ContextManager::get_instance();
     brpc::Channel* lsn_channel_ = new brpc::Channel();
     brpc::ChannelOptions options;
@@ -249,37 +256,65 @@ void replay_log_for_resumption(SmManager* sm_mgr) {
     int64_t tail = state_mgr->curr_log_tail_;
     // std::cout << "replay: head = " << head << ", tail = " << tail << "\n";
     RedoLogRecord* redo_log = nullptr;
+    // 状态节点中存储节点还没有持久化的日志需要重新发送给存储节点
+    int64_t unpersisted_head = tail;
+    bool found_unpersisted = false;
+    lsn_t max_lsn = persist_lsn;
+    // update/delete日志通过table_id定位索引
+    auto index_handles = sm_mgr->get_table_id_index_map();
     while(head != tail) {
+        int64_t log_head = head;
         redo_log = state_mgr->log_rdma_buffer_->read_log(head, persist_lsn);
         if(redo_log == nullptr) continue;
+        if(!found_unpersisted) {
+            unpersisted_head = log_head;
+            found_unpersisted = true;
+        }
+        max_lsn = std::max(max_lsn, redo_log->lsn_);
         switch(redo_log->log_type_) {
             case RedoLogType::UPDATE: {
                 UpdateRedoLogRecord* update_redo_log = static_cast<UpdateRedoLogRecord*>(redo_log);
-                std::string table_name = std::string(update_redo_log->table_name_, update_redo_log->table_name_size_);
-                auto index_handle = sm_mgr->primary_index_[table_name].get();
-                if(index_handle == nullptr) {
-                    throw RMDBError("table name " + std::string(update_redo_log->table_name_) + " not found!");
+                auto index_handle = index_handles.find(update_redo_log->table_id_);
+                if(index_handle == index_handles.end()) {
+                    throw RMDBError("table id " + std::to_string(update_redo_log->table_id_) + " not found!");
                 }
-                index_handle->update_record(update_redo_log->rid_, update_redo_log->new_value_.data, nullptr);
+                index_handle->second->replay_update_record(update_redo_log->rid_, update_redo_log->ranges_);
             } break;
             case RedoLogType::DELETE: {
                 DeleteRedoLogRecord* delete_redo_log = static_cast<DeleteRedoLogRecord*>(redo_log);
-                std::string table_name = std::string(delete_redo_log->table_name_, delete_redo_log->table_name_size_);
-                auto index_handle = sm_mgr->primary_index_[table_name].get();
-
-                index_handle->update_record(delete_redo_log->rid_, delete_redo_log->delete_value_.data, nullptr);
+                auto index_handle = index_handles.find(delete_redo_log->table_id_);
+                if(index_handle == index_handles.end()) {
+                    throw RMDBError("table id " + std::to_string(delete_redo_log->table_id_) + " not found!");
+                }
+                index_handle->second->delete_record(delete_redo_log->rid_, nullptr);
             } break;
             case RedoLogType::INSERT: {
                 InsertRedoLogRecord* insert_redo_log = static_cast<InsertRedoLogRecord*>(redo_log);
                 std::string table_name = std::string(insert_redo_log->table_name_, insert_redo_log->table_name_size_);
-                auto index_handle = sm_mgr->primary_index_[table_name].get();
+                auto index_handle = sm_mgr->get_index_handle(table_name);
 
                 index_handle->replay_insert_record(insert_redo_log->rid_, insert_redo_log->key_, insert_redo_log->insert_value_.data);
             } break;
+            case RedoLogType::PURGE: {
+                PurgeRedoLogRecord* purge_redo_log = static_cast<PurgeRedoLogRecord*>(redo_log);
+                std::string table_name = std::string(purge_redo_log->table_name_, purge_redo_log->table_name_size_);
+                auto index_handle = sm_mgr->get_index_handle(table_name);
+
+                index_handle->replay_delete_entry(purge_redo_log->key_);
+            } break;
+            case RedoLogType::COMPACT: {
+                CompactRedoLogRecord* compact_redo_log = static_cast<CompactRedoLogRecord*>(redo_log);
+                std::string table_name = std::string(compact_redo_log->table_name_, compact_redo_log->table_name_size_);
+                auto index_handle = sm_mgr->get_index_handle(table_name);
+
+                index_handle->replay_compact_leaf(compact_redo_log->page_no_);
+            } break;
             default:
             break;
         }
     }
+
+    log_mgr->recover_log_shipping(unpersisted_head, persist_lsn, max_lsn);
 }
 
 void client_handler(int* sock_fd, RWNode* node) {
@@ -389,7 +424,7 @@ void client_handler(int* sock_fd, RWNode* node) {
                 // recover_duration = std::chrono::duration_cast<std::chrono::microseconds>(recover_end - recover_start).count();
                 // std::cout << "recover_lock_table_time: " << recover_duration << "\n";
                 // std::cout << "finish recover lock_table\n";
-                replay_log_for_resumption(node->sm_mgr_);
+                replay_log_for_resumption(node->sm_mgr_, node->log_mgr_);
                 // recover_end = std::chrono::high_resolution_clock::now();
                 // recover_duration = std::chrono::duration_cast<std::chrono::microseconds>(recover_end - recover_start).count();
                 // std::cout << "recover_log_time: " << recover_duration << "\n";
@@ -717,6 +752,35 @@ void client_handler(int* sock_fd, RWNode* node) {
     pthread_exit(NULL);  // terminate calling thread!
 }
 
+/**
+ * @description: 后台压缩线程，每隔IX_COMPACT_INTERVAL_MS检查一次所有的聚簇索引和二级索引，重新填充删除之后过于稀疏的叶子
+ * 每一次修改了索引的压缩都生成一条COMPACT日志，存储层以相同的参数回放。
+ * 日志在被压缩的叶子释放写锁之前生成，因此与并发的INSERT/PURGE在日志中的顺序和它们在叶子上的顺序一致
+ */
+void RWNode::compact_indexes() {
+    Transaction txn(0);
+    while(!compact_stop_.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(IX_COMPACT_INTERVAL_MS));
+        bool compacted = false;
+        // name为日志中使用的名称：聚簇索引为表名，二级索引为索引文件名
+        auto compact = [&](const std::string& name, IxIndexHandle* index_handle) {
+            auto compacted_pages = index_handle->compact_leaves(&txn, IX_COMPACT_MAX_NUM, [&](page_id_t page_no) {
+                log_mgr_->make_compact_redolog(INVALID_TXN_ID, page_no, name);
+            });
+            compacted |= !compacted_pages.empty();
+        };
+        for(auto& [table_name, index_handle]: sm_mgr_->primary_index_) {
+            compact(table_name, index_handle.get());
+        }
+        for(auto& [index_name, index_handle]: sm_mgr_->ihs_) {
+            compact(index_name, index_handle.get());
+        }
+        if(compacted) {
+            log_mgr_->write_log_to_storage();
+        }
+    }
+}
+
 void RWNode::start_server() {
     // init buffer_mutex and sockfd_mutex
     buffer_mutex = (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t));
@@ -752,6 +816,7 @@ void RWNode::start_server() {
     }
 
     std::vector<std::thread> threads;
+    std::thread compact_thread(&RWNode::compact_indexes, this);
     
     server_start_time = std::chrono::high_resolution_clock::now();
 
@@ -785,6 +850,8 @@ void RWNode::start_server() {
     for(auto& t: threads) {
         t.join();
     }
+    compact_stop_.store(true);
+    compact_thread.join();
 
     // Clear
     // std::cout << " Try to close all client-connection.\n";
@@ -863,6 +930,11 @@ int main(int argc, char** argv) {
     state_theta_ = cJSON_GetObjectItem(node, "state_theta")->valuedouble;
     src_scale_factor_ = cJSON_GetObjectItem(node, "src_scale_factor")->valuedouble;
     int buffer_pool_size = cJSON_GetObjectItem(node, "buffer_pool_size")->valueint;
+    // 缓冲池的置换策略: LRU(默认), CLOCK, LRU-K, 2Q
+    std::string replacer_type = REPLACER_TYPE;
+    if(cJSON_GetObjectItem(node, "replacer") != nullptr) {
+        replacer_type = cJSON_GetObjectItem(node, "replacer")->valuestring;
+    }
     MB_ = cJSON_GetObjectItem(node, "MB")->valueint;
     RB_ = cJSON_GetObjectItem(node, "RB")->valueint;
     C_ = cJSON_GetObjectItem(node, "C")->valueint;
@@ -884,6 +956,38 @@ int main(int argc, char** argv) {
         cost_model_ = 2;
     }
     parallel_factor = cJSON_GetObjectItem(node, "parallel_factor")->valueint;
+    // 锁冲突时的处理策略: no_wait(默认，立即回滚), wait_die, wound_wait
+    LockWaitPolicy lock_wait_policy = LockWaitPolicy::NO_WAIT;
+    cJSON* lock_wait_policy_item = cJSON_GetObjectItem(node, "lock_wait_policy");
+    if(lock_wait_policy_item != nullptr) {
+        std::string lock_wait_policy_str = lock_wait_policy_item->valuestring;
+        if(lock_wait_policy_str.compare("wait_die") == 0) {
+            lock_wait_policy = LockWaitPolicy::WAIT_DIE;
+        }
+        else if(lock_wait_policy_str.compare("wound_wait") == 0) {
+            lock_wait_policy = LockWaitPolicy::WOUND_WAIT;
+        }
+    }
+    // group commit的batch window(微秒)和触发立即发送的等待事务数
+    int group_commit_window_us = GROUP_COMMIT_WINDOW_US;
+    int group_commit_max_size = GROUP_COMMIT_MAX_SIZE;
+    if(cJSON_GetObjectItem(node, "group_commit_window_us") != nullptr) {
+        group_commit_window_us = cJSON_GetObjectItem(node, "group_commit_window_us")->valueint;
+    }
+    if(cJSON_GetObjectItem(node, "group_commit_max_size") != nullptr) {
+        group_commit_max_size = cJSON_GetObjectItem(node, "group_commit_max_size")->valueint;
+    }
+    // 事务提交的确认时机: storage(默认，等待存储节点写入), state_pool(日志写入状态节点之后确认，需要打开state_open)
+    LogCommitMode commit_mode = LogCommitMode::STORAGE;
+    cJSON* commit_mode_item = cJSON_GetObjectItem(node, "commit_mode");
+    if(commit_mode_item != nullptr && std::string(commit_mode_item->valuestring).compare("state_pool") == 0) {
+        if(state_open_ == 1) {
+            commit_mode = LogCommitMode::STATE_POOL;
+        }
+        else {
+            std::cout << "commit_mode state_pool requires state_open, use storage commit mode\n";
+        }
+    }
 
     std::cout << "cost_model: " << cost_model_ << ", interval: " << interval_ << "\n";
     
@@ -902,10 +1006,14 @@ int main(int argc, char** argv) {
 
     std::cout << "node_id: " << node_id << ", rpc_port: " << local_rpc_port << ", workload: " << workload << ", record_num: " << record_num << "\n";
 
-    auto server = new RWNode(local_rpc_port, workload, record_num, thread_num, buffer_pool_size, config_path);
+    auto server = new RWNode(local_rpc_port, workload, record_num, thread_num, buffer_pool_size, replacer_type, config_path);
+    buffer_pool_mgr = server->buffer_pool_mgr_;
     server->thread_local_sql_size_ = sql_buf_size / thread_num;
     server->thread_local_plan_size_ = plan_buf_size / thread_num;
     server->thread_local_cursor_size_ = cursor_buf_size / thread_num;
+    server->lock_mgr_->set_wait_policy(lock_wait_policy);
+    server->log_mgr_->set_group_commit(group_commit_window_us, group_commit_max_size);
+    server->log_mgr_->set_commit_mode(commit_mode);
 
     signal(SIGINT, sigint_handler);
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <brpc/channel.h>
 
 #include "optimizer/optimizer.h"
@@ -16,11 +17,14 @@
 
 class RWNode {
 public:
-    RWNode(int local_rpc_port, std::string workload, int record_num, int thread_num, int buffer_pool_size, std::string config_path);
+    RWNode(int local_rpc_port, std::string workload, int record_num, int thread_num, int buffer_pool_size, std::string replacer_type, std::string config_path);
 
     ~RWNode() {}
     void start_server();
 
+    // 后台线程周期性地压缩各个聚簇索引中过于稀疏的叶子
+    void compact_indexes();
+
     DiskManager* disk_mgr_;                 // disk_manager is used to store intermediate results
     BufferPoolManager* buffer_pool_mgr_;
     IxManager* index_mgr_;
@@ -47,8 +51,10 @@ public:
     int thread_local_plan_size_;
     int thread_num_;
     int buffer_pool_size_;      // the max size count in bufferpool
+    std::string replacer_type_; // replacement policy of the bufferpool
     // int state_open_;
     std::string config_path_;
+    std::atomic<bool> compact_stop_{false};
 
     /*
         RDMA asyn write thread pool
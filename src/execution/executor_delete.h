@@ -13,13 +13,14 @@ class DeleteExecutor : public AbstractExecutor {
     IxIndexHandle* pindex_handle_;  // cluster index handle
     MultiVersionFileHandle *old_version_handle_; // old_version_handle
     std::vector<Rid> rids_;         // 需要删除的记录的位置
+    std::vector<std::string> pkeys_;    // 需要删除的记录的主键，执行时根据主键重新定位记录
     std::string tab_name_;          // 表名称
     SmManager *sm_manager_;
     int rid_index_;
 
    public:
     DeleteExecutor(SmManager *sm_manager, const std::string &tab_name, std::vector<Condition> conds,
-                   std::vector<Rid> rids, Context *context) {
+                   std::vector<Rid> rids, std::vector<std::string> pkeys, Context *context) {
         sm_manager_ = sm_manager;
         tab_name_ = tab_name;
         tab_ = sm_manager_->db_.get_table(tab_name);
@@ -27,13 +28,17 @@ class DeleteExecutor : public AbstractExecutor {
         pindex_handle_ = sm_manager->primary_index_.at(tab_name).get();
         old_version_handle_ = sm_manager->old_versions_.at(tab_name).get();
         conds_ = conds;
-        rids_ = rids;
+        rids_ = std::move(rids);
+        pkeys_ = std::move(pkeys);
         context_ = context;
         rid_index_ = 0;
 
-        // if(context != nullptr) {
-        //     context->lock_mgr_->lock_IX_on_table(context->txn_, fh_->GetFd());
-        // }
+        // 二级索引扫描依赖表上的S锁排除并发的写者，因此写操作需要先对表加IX锁
+        if(context != nullptr) {
+            Lock* lock = context->lock_mgr_->request_table_lock(tab_.table_id_, context->txn_, LockMode::LOCK_IX, context->coro_sched_->t_id_);
+            assert(lock != nullptr);
+            context->txn_->append_lock(lock);
+        }
     }
     void beginTuple() override {}
     void nextTuple() override {}
@@ -41,14 +46,30 @@ class DeleteExecutor : public AbstractExecutor {
     size_t tupleLen() const override { assert(0);  return -1;}
     bool is_end() const override { assert(0); return false; }
     
-    void set_rids(std::vector<Rid> rids){rids_ = rids;}
     std::unique_ptr<Record> Next() override {
         // Delete each rid from record file and index file
         int rid_tot_size = rids_.size();
         for(; rid_index_ < rid_tot_size; ++ rid_index_) {
             // auto rec = fh_->get_record(rid, context_);
             auto& rid = rids_[rid_index_];
-            auto record = pindex_handle_->get_record(rid, context_);
+            // 扫描之后插入、purge和压缩可能已经移动了这条记录，rid只用于校验record_no，在叶子的写锁下按照主键重新定位
+            std::unique_ptr<Record> record;
+            bool found = pindex_handle_->modify_record(pkeys_[rid_index_].data(), rid.record_no, [&](char* record_slot, const Rid& cur_rid) {
+                // 将delete标志置位，然后写回
+                RecordHdr *record_hdr = (RecordHdr*)record_slot;
+                record_hdr->is_deleted_ = true;
+                record_hdr->trx_id_ = context_->txn_->get_transaction_id();
+                record = std::make_unique<Record>(record_slot, tab_.record_length_ + sizeof(RecordHdr));
+
+                // 这里只设置删除标记，记录和它在二级索引中的key在事务提交时才被物理删除
+                // make delete redo log，在叶子释放写锁之前生成
+                if(context_ != nullptr) {
+                    context_->log_mgr_->make_delete_redolog(context_->txn_->get_transaction_id(), pindex_handle_->get_table_id(), cur_rid, true);
+                }
+            });
+            if(!found) {
+                throw InternalError("DeleteExecutor: record " + std::to_string(rid.record_no) + " no longer exists");
+            }
             // Delete from index file
             // for(auto& index: tab_.indexes_) {
             //     char* key = new char[index.col_tot_len];
@@ -68,24 +89,13 @@ class DeleteExecutor : public AbstractExecutor {
             // 将旧版本保存到old_version
             // Rid old_version_rid = old_version_handle_->insert_record(record->record_, context_);
 
-            // 将delete标志置位，然后写回
-            RecordHdr *record_hdr = (RecordHdr*)(record->record_);
-            record_hdr->is_deleted_ = true;
-            record_hdr->trx_id_ = context_->txn_->get_transaction_id();
-            record_hdr->rollback_file_id_ = old_version_handle_->GetFd();
+            // record_hdr->rollback_file_id_ = old_version_handle_->GetFd();
             // record_hdr->rollback_page_no_ = old_version_rid.page_no;
             // record_hdr->rollback_slot_no_ = old_version_rid.slot_no;
-            
-            pindex_handle_->update_record(rid, record->record_, context_);
-            // pindex_handle_->delete_record(rid, context_);
 
             if(context_ != nullptr) {
                 WriteRecord* write_record = new WriteRecord(WType::DELETE_TUPLE, tab_name_, record->raw_data_, tab_.get_primary_index_meta()->col_tot_len);
                 context_->txn_->append_write_record(write_record);
-
-                // make delete redo log
-                RmRecord delete_record(record->data_length_ + sizeof(RecordHdr), record->record_);
-                context_->log_mgr_->make_delete_redolog(context_->txn_->get_transaction_id(), delete_record, rid, tab_name_, true);
             }
 
             // record a delete operation into the transaction
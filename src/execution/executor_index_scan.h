@@ -22,6 +22,7 @@ static LockMode get_lock_mode_for_plan(PlanTag plan_tag) {
 }
 
 // primary索引上的用IndexScanExecutor
+// 指定了index_col_names时扫描对应的二级索引，二级索引记录中的主键用于回表得到完整的记录
 class IndexScanExecutor : public AbstractExecutor {
 
 friend class IndexScanOperatorState;
@@ -31,7 +32,8 @@ friend class IndexScanOperatorState;
     TabMeta tab_;                               // 表的元数据
     std::vector<Condition> index_conds_;              // 扫描条件
     // RmFileHandle *fh_;                          // 表的数据文件句柄
-    IxIndexHandle* pindex_handle_;              // 只考虑primary索引
+    IxIndexHandle* pindex_handle_;              // primary索引
+    IxIndexHandle* index_handle_;               // 扫描的索引，使用二级索引时为二级索引，否则与pindex_handle_相同
     MultiVersionFileHandle* old_version_handle_;    // old_version handle
     std::vector<ColMeta> cols_;                 // 需要读取的字段
     std::vector<size_t> sel_idxs_;
@@ -39,7 +41,13 @@ friend class IndexScanOperatorState;
     std::vector<Condition> filter_conds_;          // 扫描条件，和conds_字段相同
 
     // std::vector<std::string> index_col_names_;  // index scan涉及到的索引包含的字段
-    IndexMeta index_meta_;                      // index scan涉及到的索引元数据
+    IndexMeta index_meta_;                      // index scan涉及到的索引元数据，二级索引为二级索引字段+主键字段
+
+    bool is_secondary_ = false;                 // 是否通过二级索引扫描
+    bool secondary_end_ = false;                // 二级索引扫描已经越过了index_conds的范围
+    std::vector<ColMeta> index_key_cols_;       // 二级索引记录中的字段，用于判断二级索引记录是否满足index_conds
+    int pkey_offset_ = 0;                       // 主键在二级索引记录中的偏移
+    std::unique_ptr<Record> index_entry_;       // 二级索引扫描当前所在的记录
 
     Rid rid_;
     std::unique_ptr<IxScan> scan_;
@@ -59,7 +67,8 @@ friend class IndexScanOperatorState;
     IndexScanOperatorState *index_scan_op_ = nullptr;
 
    public:
-    IndexScanExecutor(SmManager *sm_manager, std::string tab_name, std::vector<TabCol> proj_cols, std::vector<Condition> filter_conds, std::vector<Condition> index_conds, Context *context, int sql_id, int operator_id)
+    IndexScanExecutor(SmManager *sm_manager, std::string tab_name, std::vector<TabCol> proj_cols, std::vector<Condition> filter_conds, std::vector<Condition> index_conds, Context *context, int sql_id, int operator_id,
+                      const std::vector<std::string>& index_col_names = std::vector<std::string>())
         : AbstractExecutor(sql_id, operator_id) {
         exec_type_ = ExecutionType::INDEX_SCAN;
         finished_begin_tuple_ = false;
@@ -82,6 +91,16 @@ friend class IndexScanOperatorState;
         
         pindex_handle_ = sm_manager->primary_index_.at(tab_name_).get();
         old_version_handle_ = sm_manager->old_versions_.at(tab_name_).get();
+        index_handle_ = pindex_handle_;
+        if(index_col_names.size() > 0) {
+            is_secondary_ = true;
+            auto& sindex_meta = *(tab_.get_index_meta(index_col_names));
+            index_meta_ = tab_.get_secondary_key_meta(sindex_meta);
+            index_key_cols_ = tab_.get_secondary_index_tab_meta(sindex_meta).cols_;
+            pkey_offset_ = sindex_meta.col_tot_len;
+            index_handle_ = sm_manager->get_index_handle(sm_manager->get_ix_manager()->get_index_name(tab_name_, index_col_names));
+            assert(index_handle_ != nullptr);
+        }
         // cols_ = tab_.cols_;
         
         size_t curr_offset = 0;
@@ -143,6 +162,12 @@ friend class IndexScanOperatorState;
                 assert(lock != nullptr);
                 context_->txn_->append_lock(lock);
             }
+            else if(is_secondary_ == true) {
+                // 记录锁和gap锁都加在主键索引上，二级索引扫描无法锁住扫描范围，因此对整张表加S锁(select)或X锁(update/delete)
+                lock = context_->lock_mgr_->request_table_lock(tab_.table_id_, context_->txn_, get_lock_mode_for_plan(context_->plan_tag_), context_->coro_sched_->t_id_);
+                assert(lock != nullptr);
+                context_->txn_->append_lock(lock);
+            }
             else {
                 switch(context_->plan_tag_) {
                     case T_Update:
@@ -232,9 +257,9 @@ NOTALBELOCK:
         char* max_key = new char[index_meta_.col_tot_len];
         int offset = 0;
         // lower 是第一条记录
-        auto lower = pindex_handle_->leaf_begin();
+        auto lower = index_handle_->leaf_begin();
         // upper 是最后一条记录的后面一条
-        auto upper = pindex_handle_->leaf_end();
+        auto upper = index_handle_->leaf_end();
         // 整张表的记录查询范围是[leaf_begin, leaf_end)
         // 一个字段可能存在一个或者两个condition，如果存在两个condition，必须都是非等值条件，不能存在等值条件
         int i = 0;
@@ -291,7 +316,7 @@ NOTALBELOCK:
                         setMinKey(min_key, left_off, remain_col.len, remain_col.type);
                         left_off += remain_col.len;
                     }
-                    lower = pindex_handle_->lower_bound(min_key);
+                    lower = index_handle_->lower_bound(min_key);
                 }
                 else if(left_cond->op == OP_GE) {
                     memcpy(min_key + left_off, left_cond->rhs_val.raw->data, col.len);
@@ -301,7 +326,7 @@ NOTALBELOCK:
                         setMinKey(min_key, left_off, remain_col.len, remain_col.type);
                         left_off += remain_col.len;
                     }
-                    lower = pindex_handle_->lower_bound(min_key);
+                    lower = index_handle_->lower_bound(min_key);
                 }
                 else {
                     // left_cond->op == OP_GT
@@ -312,7 +337,7 @@ NOTALBELOCK:
                         setMaxKey(min_key, left_off, remain_col.len, remain_col.type);
                         left_off += remain_col.len;
                     }
-                    lower = pindex_handle_->upper_bound(min_key);
+                    lower = index_handle_->upper_bound(min_key);
                 }
 
                 // 对right_cond进行处理
@@ -326,7 +351,7 @@ NOTALBELOCK:
                         setMaxKey(max_key, right_off, remain_col.len, remain_col.type);
                         right_off += remain_col.len;
                     }
-                    upper = pindex_handle_->upper_bound(max_key);
+                    upper = index_handle_->upper_bound(max_key);
                 }
                 else if(right_cond->op == OP_LE) {
                     memcpy(max_key + right_off, right_cond->rhs_val.raw->data, col.len);
@@ -336,7 +361,7 @@ NOTALBELOCK:
                         setMaxKey(max_key, right_off, remain_col.len, remain_col.type);
                         right_off += remain_col.len;
                     }
-                    upper = pindex_handle_->upper_bound(max_key);
+                    upper = index_handle_->upper_bound(max_key);
                 }
                 else {
                     // right_cond->op == OP_LT
@@ -347,7 +372,7 @@ NOTALBELOCK:
                         setMinKey(max_key, right_off, remain_col.len, remain_col.type);
                         right_off += remain_col.len;
                     }
-                    upper = pindex_handle_->lower_bound(max_key); 
+                    upper = index_handle_->lower_bound(max_key); 
                 }
                 
                 break;
@@ -365,8 +390,8 @@ NOTALBELOCK:
                 //             setMaxKey(max_key, offset, col.len, col.type);
                 //             offset += col.len;
                 //         }
-                //         lower = pindex_handle_->upper_bound(min_key);
-                //         upper = pindex_handle_->upper_bound(max_key);
+                //         lower = index_handle_->upper_bound(min_key);
+                //         upper = index_handle_->upper_bound(max_key);
                 //         // std::cout << "lower_rid: {page_no=" << lower.page_no << ", slot_no=" << lower.slot_no << "}\n";
                 //         // std::cout << "upper_rid: {page_no=" << upper.page_no << ", slot_no=" << upper.slot_no << "}\n";
                 //     } break;
@@ -382,8 +407,8 @@ NOTALBELOCK:
                 //             setMaxKey(max_key, offset, col.len, col.type);
                 //             offset += col.len;
                 //         }
-                //         lower = pindex_handle_->lower_bound(min_key);
-                //         upper = pindex_handle_->upper_bound(max_key);
+                //         lower = index_handle_->lower_bound(min_key);
+                //         upper = index_handle_->upper_bound(max_key);
                 //     } break;
                 //     case OP_LT: {
                 //         // min_key: the remained cols and the current col must be min_val
@@ -397,8 +422,8 @@ NOTALBELOCK:
                 //             setMinKey(max_key, offset, col.len, col.type);
                 //             offset += col.len;
                 //         }
-                //         lower = pindex_handle_->lower_bound(min_key);
-                //         upper = pindex_handle_->lower_bound(max_key);
+                //         lower = index_handle_->lower_bound(min_key);
+                //         upper = index_handle_->lower_bound(max_key);
                 //     } break;
                 //     case OP_LE: {
                 //         // min_key: the remained cols and the current col must be min_val
@@ -412,8 +437,8 @@ NOTALBELOCK:
                 //             setMaxKey(max_key, offset, col.len, col.type);
                 //             offset += col.len;
                 //         }
-                //         lower = pindex_handle_->lower_bound(min_key);
-                //         upper = pindex_handle_->upper_bound(max_key);
+                //         lower = index_handle_->lower_bound(min_key);
+                //         upper = index_handle_->upper_bound(max_key);
                 //     } break;
                 //     default:
                 //         std::cout << "Invalid operator type.\n";
@@ -435,8 +460,8 @@ NOTALBELOCK:
                 setMaxKey(max_key, offset, col.len, col.type);
                 offset += col.len;
             }
-            lower = pindex_handle_->lower_bound(min_key);
-            upper = pindex_handle_->upper_bound(max_key);
+            lower = index_handle_->lower_bound(min_key);
+            upper = index_handle_->upper_bound(max_key);
         }
 
         delete[] min_key;
@@ -451,6 +476,14 @@ NOTALBELOCK:
         std::cout << "lower_rid: {page_no=" << lower_rid_.page_no << ", slot_no=" << lower_rid_.slot_no << ", record_no" << lower_rid_.record_no << "}\n";
         std::cout << "upper_rid: {page_no=" << upper_rid_.page_no << ", slot_no=" << upper_rid_.slot_no << ", record_no" << upper_rid_.record_no << "}\n";
 
+        if(is_secondary_) {
+            // 二级索引中记录的record_no与key的顺序无关，不能用upper作为扫描的终点，扫描到第一条不满足index_conds的记录为止
+            scan_ = std::make_unique<IxScan>(index_handle_, lower, secondary_scan_end());
+            find_next_secondary_record();
+            finished_begin_tuple_ = true;
+            return;
+        }
+
         scan_ = std::make_unique<IxScan>(pindex_handle_, lower, upper);
 
         // Get the first record
@@ -552,29 +585,23 @@ NOLOCK1:
 
             // if (eval_conds(cols_, index_conds_, rec.get()) && rec->is_deleted() == false) {
             //     current_record_ = std::move(rec);
-            auto rec = pindex_handle_->get_record(rid_, context_);
+            Record* rec = scan_current_record();
+            if(rec == nullptr) {
+                continue;
+            }
+            bool is_match = rec->is_deleted() == false && eval_conds(tab_cols_, filter_conds_, rec);
 
-            if (rec->is_deleted() == false && eval_conds(tab_cols_, filter_conds_, rec.get())) {
-                if(node_type_ == 0 && min_lock_ == false) {
-                    lock = lock_mgr->request_record_lock(tab_.table_id_, rid_, txn, RECORD_LOCK_ORDINARY, get_lock_mode_for_plan(context_->plan_tag_), context_->coro_sched_->t_id_);
-                    assert(lock != nullptr);
-                    txn->append_lock(lock);
-                }
-                else {
-                    min_lock_ = false;
+            // 满足条件的记录按照plan的模式加锁，不满足条件的记录加S锁；第一条记录已经在上面加过锁
+            if(node_type_ == 0 && min_lock_ == false) {
+                if(!lock_current_record(is_match ? get_lock_mode_for_plan(context_->plan_tag_) : LOCK_S, is_match)) {
+                    continue;
                 }
-                current_record_ = std::move(rec);
-                break;
             }
-            else if(node_type_ == 0) {
-                if(min_lock_ == false) {
-                    lock = lock_mgr->request_record_lock(tab_.table_id_, rid_, txn, RECORD_LOCK_ORDINARY, LOCK_S, context_->coro_sched_->t_id_);
-                    assert(lock != nullptr);
-                    txn->append_lock(lock);
-                }
-                else {
-                    min_lock_ = false;
-                }
+            else {
+                min_lock_ = false;
+            }
+            if(is_match) {
+                break;
             }
 
             scan_->next();
@@ -582,6 +609,80 @@ NOLOCK1:
         finished_begin_tuple_ = true;
     }
 
+    /**
+     * @description: 把scan_当前所在的记录拷贝到current_record_中。游标在两次访问之间不持有叶子的读锁，
+     *              记录可能被其他线程修改或者移动，不能直接引用叶子中的记录
+     * @return {Record*} 游标已经到达末尾时返回nullptr
+     */
+    Record* scan_current_record() {
+        int data_len = scan_->record_len() - sizeof(RecordHdr);
+        if(current_record_ == nullptr || !current_record_->allocated_ || current_record_->data_length_ != data_len) {
+            current_record_ = std::make_unique<Record>(data_len);
+        }
+        if(!scan_->copy_record(current_record_.get())) {
+            return nullptr;
+        }
+        return current_record_.get();
+    }
+
+    /**
+     * @description: 给scan_当前所在的记录rid_加锁。锁等待期间其他事务可能修改这条记录，purge和压缩也可能移动它，
+     *              因此加锁之后重新拷贝记录，并更新rid_中的位置
+     * @return {bool} 记录已经被物理删除，或者它是否满足filter_conds发生了变化时返回false，调用者从游标当前的位置重新检查
+     * @param {LockMode} lock_mode 锁的模式
+     * @param {bool} is_match 加锁之前记录是否满足filter_conds
+     */
+    bool lock_current_record(LockMode lock_mode, bool is_match) {
+        assert(context_ != nullptr);
+        Lock* lock = context_->lock_mgr_->request_record_lock(tab_.table_id_, rid_, context_->txn_, RECORD_LOCK_ORDINARY, lock_mode, context_->coro_sched_->t_id_);
+        assert(lock != nullptr);
+        context_->txn_->append_lock(lock);
+
+        Record* rec = scan_current_record();
+        if(rec == nullptr || scan_->rid().record_no != rid_.record_no) {
+            return false;
+        }
+        rid_ = scan_->rid();
+        return is_match == (rec->is_deleted() == false && eval_conds(tab_.cols_, filter_conds_, rec));
+    }
+
+    // 二级索引扫描的终点为最后一个叶子的末尾，record_no设置为最大值，使IxScan只根据位置判断是否结束
+    Rid secondary_scan_end() {
+        Rid end = index_handle_->leaf_end();
+        end.record_no = INT32_MAX;
+        return end;
+    }
+
+    /**
+     * @description: 从scan_当前所在的二级索引记录开始，找到第一条回表之后满足filter_conds的记录
+     * 二级索引扫描不加记录锁，构造函数中的表锁保证了扫描期间其他事务不会修改这张表
+     */
+    void find_next_secondary_record() {
+        if(index_entry_ == nullptr) {
+            index_entry_ = std::make_unique<Record>();
+        }
+        auto& tab_cols_ = tab_.cols_;
+        for(; !scan_->is_end(); scan_->next()) {
+            scan_->get_record_view(index_entry_.get());
+            if(!eval_conds(index_key_cols_, index_conds_, index_entry_.get())) {
+                secondary_end_ = true;
+                return;
+            }
+            // 二级索引记录中二级索引字段之后的部分为主键
+            const char* pkey = index_entry_->raw_data_ + pkey_offset_;
+            Rid prid;
+            auto record = pindex_handle_->get_record(pkey, &prid);
+            if(record == nullptr) {
+                continue;
+            }
+            if(record->is_deleted() == false && eval_conds(tab_cols_, filter_conds_, record.get())) {
+                rid_ = prid;
+                current_record_ = std::move(record);
+                return;
+            }
+        }
+    }
+
     bool check_match_for_key(const std::vector<ColMeta> &rec_cols, const Condition &cond, const Record *rec) {
         auto lhs_col = get_col(rec_cols, cond.lhs_col);
         char *lhs = rec->raw_data_ + lhs_col->offset;
@@ -619,12 +720,17 @@ NOLOCK1:
         //     std::cout << "IndexScan Current location: " << rid_.page_no << ", " << rid_.slot_no << std::endl;
         //     load_from_state_ = false;
         // }
+        if(is_secondary_) {
+            scan_->next();
+            find_next_secondary_record();
+            return;
+        }
         if(scan_->rid().record_no == upper_rid_.record_no) {
             std::cout << "IndexScan: reach the end of the scan\n";
         }
-        Lock* lock = nullptr;
         auto& tab_cols_ = tab_.cols_;
-        for (scan_->next(); !scan_->is_end(); scan_->next()) {
+        scan_->next();
+        while (!scan_->is_end()) {
             rid_ = scan_->rid();
             // auto [is_visible, rec] = mvcc_get_record(rid_);
             // 如果不可见
@@ -633,28 +739,25 @@ NOLOCK1:
             // }
             // if (eval_conds(cols_, index_conds_, rec.get())&& rec->is_deleted() == false) {
             //     current_record_ = std::move(rec);
-            auto rec = pindex_handle_->get_record(rid_, context_);
-
-            if (rec->is_deleted() == false && eval_conds(tab_cols_, filter_conds_, rec.get())) {
-                if(node_type_ == 0) {
-                    assert(context_ != nullptr);
-                    lock = context_->lock_mgr_->request_record_lock(tab_.table_id_, rid_, context_->txn_, RECORD_LOCK_ORDINARY, get_lock_mode_for_plan(context_->plan_tag_), context_->coro_sched_->t_id_);
-                    assert(lock != nullptr);
-                    context_->txn_->append_lock(lock);
+            Record* rec = scan_current_record();
+            if(rec == nullptr) {
+                continue;
+            }
+            bool is_match = rec->is_deleted() == false && eval_conds(tab_cols_, filter_conds_, rec);
+
+            if(node_type_ == 0) {
+                if(!lock_current_record(is_match ? get_lock_mode_for_plan(context_->plan_tag_) : LOCK_S, is_match)) {
+                    continue;
                 }
-                current_record_ = std::move(rec);
-                break;
             }
-            else if(node_type_ == 0) {
-                assert(context_ != nullptr);
-                lock = context_->lock_mgr_->request_record_lock(tab_.table_id_, rid_, context_->txn_, RECORD_LOCK_ORDINARY, LOCK_S, context_->coro_sched_->t_id_);
-                assert(lock != nullptr);
-                context_->txn_->append_lock(lock);
+            if(is_match) {
+                break;
             }
+            scan_->next();
         }
     }
 
-    bool is_end() const override { return scan_->is_end(); }
+    bool is_end() const override { return secondary_end_ || scan_->is_end(); }
 
     size_t tupleLen() const override { return len_; }
 
@@ -800,8 +903,15 @@ NOLOCK1:
             lower_rid_ = index_scan_op_->lower_rid_;
             upper_rid_ = index_scan_op_->upper_rid_;
 
-            scan_ = std::make_unique<IxScan>(pindex_handle_, rid_, upper_rid_);
             current_record_ = pindex_handle_->get_record(rid_, context_);
+            if(is_secondary_) {
+                // 状态中保存的是主键索引中的位置，根据当前记录重新构造二级索引的key来定位二级索引扫描的位置
+                std::vector<char> key(index_meta_.col_tot_len);
+                SmManager::make_secondary_key(index_meta_, current_record_->raw_data_, key.data());
+                scan_ = std::make_unique<IxScan>(index_handle_, index_handle_->lower_bound(key.data()), secondary_scan_end());
+            } else {
+                scan_ = std::make_unique<IxScan>(pindex_handle_, rid_, upper_rid_);
+            }
         } else {
             load_from_state_ = false;
             index_scan_op_ = nullptr;
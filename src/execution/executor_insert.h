@@ -30,9 +30,12 @@ class InsertExecutor : public AbstractExecutor {
         old_version_handle_ = sm_manager->old_versions_.at(tab_name).get();
         context_ = context;
 
-        // if(context != nullptr) {
-        //     context->lock_mgr_->lock_IX_on_table(context->txn_, fh_->GetFd());
-        // }
+        // 二级索引扫描依赖表上的S锁排除并发的写者，因此写操作需要先对表加IX锁
+        if(context != nullptr) {
+            Lock* lock = context->lock_mgr_->request_table_lock(tab_.table_id_, context->txn_, LockMode::LOCK_IX, context->coro_sched_->t_id_);
+            assert(lock != nullptr);
+            context->txn_->append_lock(lock);
+        }
     };
 
     void beginTuple() override {}
@@ -88,7 +91,11 @@ class InsertExecutor : public AbstractExecutor {
         }
 
         // Insert into record file
-        rid_ = pindex_handle_->insert_record(pkey, record.record_, context_);
+        // redo日志在叶子释放写锁之前生成，使日志的顺序与叶子上修改(包括压缩)的顺序一致
+        rid_ = pindex_handle_->insert_record(pkey, record.record_, context_, [&](const Rid& rid) {
+            RmRecord insert_record(record.data_length_ + sizeof(RecordHdr), record.record_);
+            context_->log_mgr_->make_insert_redolog(context_->txn_->get_transaction_id(), pkey, pindex.col_tot_len, insert_record, rid, tab_name_, true);
+        });
 
         // InsertLogRecord* insert_log = new InsertLogRecord(context_->txn_->get_transaction_id(),
                     // rec, rid_, tab_name_);
@@ -99,28 +106,12 @@ class InsertExecutor : public AbstractExecutor {
         if(context_ != nullptr) {
             WriteRecord *write_record = new WriteRecord(WType::INSERT_TUPLE, tab_name_, pkey, pindex.col_tot_len);
             context_->txn_->append_write_record(write_record);
-
-            // make insert redo log
-            RmRecord insert_record(record.data_length_ + sizeof(RecordHdr), record.record_);
-            context_->log_mgr_->make_insert_redolog(context_->txn_->get_transaction_id(), pkey, pindex.col_tot_len, insert_record, rid_, tab_name_, true);
-            
         }
 
         delete[] pkey;
         
-        // Insert into index
-        // for(size_t i = 1; i < tab_.indexes_.size(); ++i) {
-        //     auto& index = tab_.indexes_[i];
-        //     auto ih = sm_manager_->ihs_.at(sm_manager_->get_ix_manager()->get_index_name(tab_name_, index.cols)).get();
-        //     char* key = new char[index.col_tot_len];
-        //     int offset = 0;
-        //     for(size_t i = 0; i < index.col_num; ++i) {
-        //         memcpy(key + offset, insert_record.raw_data_ + index.cols[i].offset, index.cols[i].len);
-        //         offset += index.cols[i].len;
-        //     }
-        //     ih->insert_entry(key, rid_, context_->txn_);
-        //     delete key;
-        // }
+        // Insert into secondary indexes
+        sm_manager_->maintain_secondary_indexes(tab_name_, nullptr, record.raw_data_, context_);
         return nullptr;
     }
     Rid &rid() override { return rid_; }
@@ -19,6 +19,7 @@ class SeqScanExecutor : public AbstractExecutor {
     Rid rid_;
     // std::unique_ptr<RecScan> scan_;     // table_iterator
     std::unique_ptr<IxScan> scan_;
+    Record scan_record_;                // 引用scan_当前所在的记录，不拥有数据
 
     SmManager *sm_manager_;
 
@@ -38,8 +39,10 @@ class SeqScanExecutor : public AbstractExecutor {
 
         fed_conds_ = conds_;
 
+        // 全表扫描不加记录锁，update/delete的全表扫描需要对表加X锁，与二级索引扫描一样排除其他事务的读写
         if(context_ != nullptr) {
-            Lock* lock = context_->lock_mgr_->request_table_lock(tab.table_id_, context_->txn_, LockMode::LOCK_S, context_->coro_sched_->t_id_);
+            LockMode lock_mode = (context_->plan_tag_ == T_Update || context_->plan_tag_ == T_Delete) ? LockMode::LOCK_X : LockMode::LOCK_S;
+            Lock* lock = context_->lock_mgr_->request_table_lock(tab.table_id_, context_->txn_, lock_mode, context_->coro_sched_->t_id_);
             assert(lock != nullptr);
             context_->txn_->append_lock(lock);
         }
@@ -99,8 +102,8 @@ class SeqScanExecutor : public AbstractExecutor {
         while(!scan_->is_end()) {
             rid_ = scan_->rid();
             // std::cout << "SeqScan, rid: {page_no=" << rid_.page_no << ", slot_no=" << rid_.slot_no << "}\n";
-            auto record = pindex_handle_->get_record(scan_->rid(), context_);
-            if(eval_conds(cols_, fed_conds_, record.get()) && record->is_deleted() == false) {
+            scan_->get_record_view(&scan_record_);
+            if(eval_conds(cols_, fed_conds_, &scan_record_) && scan_record_.is_deleted() == false) {
                 break;
             }
             scan_->next();
@@ -120,8 +123,8 @@ class SeqScanExecutor : public AbstractExecutor {
 
         for(scan_->next(); !scan_->is_end(); scan_->next()) {
             rid_ = scan_->rid();
-            auto record = pindex_handle_->get_record(rid_, context_);
-            if(eval_conds(cols_, fed_conds_, record.get()) && record->is_deleted() == false) {
+            scan_->get_record_view(&scan_record_);
+            if(eval_conds(cols_, fed_conds_, &scan_record_) && scan_record_.is_deleted() == false) {
                 break;
             }
         }
@@ -135,7 +138,9 @@ class SeqScanExecutor : public AbstractExecutor {
 
     std::unique_ptr<Record> Next() override {
         assert(!is_end());
-        return pindex_handle_->get_record(rid_, context_);
+        // scan_record_引用的是缓冲池中的页面，返回给上层的记录需要拷贝一份
+        scan_->get_record_view(&scan_record_);
+        return std::make_unique<Record>(scan_record_);
     }
 
     Rid &rid() override { return rid_; }
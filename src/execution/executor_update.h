@@ -13,6 +13,7 @@ class UpdateExecutor : public AbstractExecutor {
     IxIndexHandle* pindex_handle_;
     MultiVersionFileHandle *old_version_handle_;    // old_version_handle
     std::vector<Rid> rids_;
+    std::vector<std::string> pkeys_;                // rids_中每条记录的主键，执行时根据主键重新定位记录
     std::string tab_name_;
     std::vector<SetClause> set_clauses_;
     SmManager *sm_manager_;
@@ -20,7 +21,7 @@ class UpdateExecutor : public AbstractExecutor {
 
    public:
     UpdateExecutor(SmManager *sm_manager, const std::string &tab_name, std::vector<SetClause> set_clauses,
-                   std::vector<Condition> conds, std::vector<Rid> rids, Context *context) {
+                   std::vector<Condition> conds, std::vector<Rid> rids, std::vector<std::string> pkeys, Context *context) {
         sm_manager_ = sm_manager;
         tab_name_ = tab_name;
         set_clauses_ = set_clauses;
@@ -29,13 +30,17 @@ class UpdateExecutor : public AbstractExecutor {
         pindex_handle_ = sm_manager->primary_index_.at(tab_name).get();
         old_version_handle_ = sm_manager->old_versions_.at(tab_name).get();
         conds_ = conds;
-        rids_ = rids;
+        rids_ = std::move(rids);
+        pkeys_ = std::move(pkeys);
         context_ = context;
         rid_index_ = 0;
 
-        // if(context != nullptr) {
-        //     context->lock_mgr_->lock_IX_on_table(context->txn_, fh_->GetFd());
-        // }
+        // 二级索引扫描依赖表上的S锁排除并发的写者，因此写操作需要先对表加IX锁
+        if(context != nullptr) {
+            Lock* lock = context->lock_mgr_->request_table_lock(tab_.table_id_, context->txn_, LockMode::LOCK_IX, context->coro_sched_->t_id_);
+            assert(lock != nullptr);
+            context->txn_->append_lock(lock);
+        }
     }
     void beginTuple() override {}
     void nextTuple() override {}
@@ -46,42 +51,48 @@ class UpdateExecutor : public AbstractExecutor {
         int rid_tot_size = rids_.size();
         for (; rid_index_ < rid_tot_size; ++rid_index_) {
             auto& rid = rids_[rid_index_];
-            // auto rec = fh_->get_record(rid, context_);
-            auto record = pindex_handle_->get_record(rid, context_);
-            // record a update operation into the transaction
-            Record origin_record(record->record_, record->data_length_ + sizeof(RecordHdr));
+            // 扫描之后插入、purge和压缩可能已经移动了这条记录，rid只用于校验record_no，在叶子的写锁下按照主键重新定位
+            std::unique_ptr<Record> origin_record;
+            std::unique_ptr<Record> record;
+            bool found = pindex_handle_->modify_record(pkeys_[rid_index_].data(), rid.record_no, [&](char* record_slot, const Rid& cur_rid) {
+                // record a update operation into the transaction
+                origin_record = std::make_unique<Record>(record_slot, tab_.record_length_ + sizeof(RecordHdr));
+                record = std::make_unique<Record>(*origin_record);
+
+                // store old version data
+                // Rid old_version_rid = old_version_handle_->insert_record(origin_record.record_, context_);
 
-            // store old version data
-            // Rid old_version_rid = old_version_handle_->insert_record(origin_record.record_, context_);
+                // Update record in record file
+                for (auto &set_clause : set_clauses_) {
+                    auto lhs_col = tab_.get_col(set_clause.lhs.col_name);
+                    memcpy(record->raw_data_ + lhs_col->offset, set_clause.rhs.raw->data, lhs_col->len);
+                }
+                // update record header
+                // RecordHdr *record_hdr = (RecordHdr*)(record->record_);
+                // record_hdr->trx_id_ = context_->txn_->get_transaction_id();
+                // record_hdr->rollback_file_id_ = old_version_handle_->GetFd();
+                // record_hdr->rollback_page_no_ = old_version_rid.page_no;
+                // record_hdr->rollback_slot_no_ = old_version_rid.slot_no;
+                memcpy(record_slot + sizeof(RecordHdr), record->raw_data_, record->data_length_);
 
-            // Update record in record file
-            for (auto &set_clause : set_clauses_) {
-                auto lhs_col = tab_.get_col(set_clause.lhs.col_name);
-                memcpy(record->raw_data_ + lhs_col->offset, set_clause.rhs.raw->data, lhs_col->len);
+                // make redo log and sent to storage node
+                // 日志在叶子释放写锁之前生成，其中的Rid是修改时记录所在的位置
+                if(context_ != nullptr) {
+                    context_->log_mgr_->make_update_redolog(context_->txn_->get_transaction_id(), pindex_handle_->get_table_id(), cur_rid,
+                                                            origin_record->raw_data_, record->raw_data_, tab_.cols_, true);
+                }
+            });
+            if(!found) {
+                throw InternalError("UpdateExecutor: record " + std::to_string(rid.record_no) + " no longer exists");
             }
-            // update record header
-            RecordHdr *record_hdr = (RecordHdr*)(record->record_);
-            // record_hdr->trx_id_ = context_->txn_->get_transaction_id();
-            // record_hdr->rollback_file_id_ = old_version_handle_->GetFd();
-            // record_hdr->rollback_page_no_ = old_version_rid.page_no;
-            // record_hdr->rollback_slot_no_ = old_version_rid.slot_no;
-            
-            pindex_handle_->update_record(rid, record->raw_data_, context_);
+
+            // 二级索引字段发生变化时，删除旧的key并插入新的key
+            sm_manager_->maintain_secondary_indexes(tab_name_, origin_record->raw_data_, record->raw_data_, context_);
             
             if(context_ != nullptr) {
-                WriteRecord* write_record = new WriteRecord(WType::UPDATE_TUPLE, tab_name_, record->raw_data_, pindex->col_tot_len, origin_record);
+                WriteRecord* write_record = new WriteRecord(WType::UPDATE_TUPLE, tab_name_, record->raw_data_, pindex->col_tot_len, *origin_record);
                 context_->txn_->append_write_record(write_record);
             }
-
-            // make redo log and sent to storage node
-            if(context_ != nullptr) {
-                RmRecord old_record(origin_record.data_length_ + sizeof(RecordHdr), origin_record.record_);
-                RmRecord new_record(record->data_length_ + sizeof(RecordHdr), record->record_);
-                // std::unique_ptr<UpdateRedoLogRecord> update_log = std::make_unique<UpdateRedoLogRecord>(context_->txn_->get_transaction_id(), old_record, new_record, rid, tab_name_);
-                // use rpc to sent to storage node
-                // context_->log_mgr_->write_log_to_storage(std::move(update_log));
-                context_->log_mgr_->make_update_redolog(context_->txn_->get_transaction_id(), old_record, new_record, rid, tab_name_, true);
-            } 
         }
         return nullptr;
     }
@@ -0,0 +1,324 @@
+#include "ix_bulk_loader.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <queue>
+
+IxBulkLoader::IxBulkLoader(IxIndexHandle* ih, bool input_sorted, double fill_factor)
+    : ih_(ih), input_sorted_(input_sorted) {
+    IxFileHdr* file_hdr = ih_->file_hdr_;
+    if (fill_factor <= 0 || fill_factor > 1) {
+        throw InternalError("IxBulkLoader: fill factor must be in (0, 1]");
+    }
+    // 批量导入从空树开始，第一个叶子复用create_index时创建的空根结点
+    if (file_hdr->root_page_ != IX_INIT_ROOT_PAGE || file_hdr->num_pages_ != IX_INIT_NUM_PAGES ||
+        file_hdr->next_record_no_ != 0) {
+        throw InternalError("IxBulkLoader: bulk load requires an empty index");
+    }
+    // 页面直接写入文件，buffer pool中缓存的空根结点需要失效
+    if (!ih_->buffer_pool_manager_->delete_page(PageId{ih_->table_meta_.table_id_, IX_INIT_ROOT_PAGE})) {
+        throw InternalError("IxBulkLoader: the root page of the index is in use");
+    }
+    if (ih_->disk_manager_->get_fd2pageno(ih_->fd_) < file_hdr->num_pages_) {
+        ih_->disk_manager_->set_fd2pageno(ih_->fd_, file_hdr->num_pages_);
+    }
+
+    leaf_capacity_ = std::clamp(static_cast<int>(fill_factor * file_hdr->max_number_of_records_), 1,
+                                file_hdr->max_number_of_records_);
+    internal_capacity_ = std::clamp(static_cast<int>(fill_factor * file_hdr->btree_order_), 2, file_hdr->btree_order_);
+    entry_len_ = file_hdr->col_tot_len_ + file_hdr->record_len_;
+    run_capacity_ = std::max<size_t>(1, IX_BULK_LOAD_RUN_SIZE / entry_len_);
+}
+
+IxBulkLoader::~IxBulkLoader() {
+    // finish()没有正常结束时清理临时文件
+    for (auto& path : run_files_) {
+        std::remove(path.c_str());
+    }
+}
+
+void IxBulkLoader::append(const char* raw_key, const char* record) {
+    assert(!finished_);
+    char key[IX_MAX_COL_LEN];
+    ih_->file_hdr_->encode_key(raw_key, key);
+    if (input_sorted_) {
+        add_to_leaf(key, record);
+        return;
+    }
+    if (run_buf_.empty()) {
+        run_buf_.reserve(run_capacity_ * entry_len_);
+    }
+    run_buf_.insert(run_buf_.end(), key, key + ih_->file_hdr_->col_tot_len_);
+    run_buf_.insert(run_buf_.end(), record, record + ih_->file_hdr_->record_len_);
+    if (run_buf_.size() / entry_len_ >= run_capacity_) {
+        spill_run();
+    }
+}
+
+void IxBulkLoader::finish() {
+    assert(!finished_);
+    finished_ = true;
+
+    if (!input_sorted_) {
+        if (run_files_.empty()) {
+            // 所有数据都在内存中，不需要归并
+            int key_len = ih_->file_hdr_->col_tot_len_;
+            for (uint32_t idx : sort_run()) {
+                const char* entry = run_buf_.data() + (size_t)idx * entry_len_;
+                add_to_leaf(entry, entry + key_len);
+            }
+        } else {
+            if (!run_buf_.empty()) spill_run();
+            merge_runs();
+        }
+        std::vector<char>().swap(run_buf_);
+    }
+
+    if (record_num_ == 0) return;
+
+    finish_levels();
+    flush_write_batch();
+
+    // 更新文件头，并写入buffer pool中的文件头页面
+    IxFileHdr* file_hdr = ih_->file_hdr_;
+    file_hdr->first_leaf_ = IX_INIT_ROOT_PAGE;
+    file_hdr->last_leaf_ = last_leaf_;
+    PageId hdr_page_id{ih_->table_meta_.table_id_, IX_FILE_HDR_PAGE};
+    Page* hdr_page = ih_->buffer_pool_manager_->fetch_page(hdr_page_id);
+    if (hdr_page == nullptr) {
+        throw InternalError("IxBulkLoader: failed to fetch the file header");
+    }
+    file_hdr->serialize(hdr_page->get_data());
+    ih_->buffer_pool_manager_->unpin_page(hdr_page_id, true);
+
+    if (duplicate_num_ > 0) {
+        std::cout << "IxBulkLoader: skip " << duplicate_num_ << " records with duplicate keys\n";
+    }
+}
+
+/**
+ * @description: 对当前内存中的run按照key进行稳定排序
+ * @return {std::vector<uint32_t>} 排序后条目在run_buf_中的下标
+ */
+std::vector<uint32_t> IxBulkLoader::sort_run() {
+    std::vector<uint32_t> order(run_buf_.size() / entry_len_);
+    std::iota(order.begin(), order.end(), 0);
+    const char* base = run_buf_.data();
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return compare_key(base + (size_t)a * entry_len_, base + (size_t)b * entry_len_) < 0;
+    });
+    return order;
+}
+
+void IxBulkLoader::spill_run() {
+    std::string path = ih_->disk_manager_->get_file_name(ih_->fd_) + ".run" + std::to_string(run_files_.size());
+    run_files_.push_back(path);
+
+    std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    for (uint32_t idx : sort_run()) {
+        out.write(run_buf_.data() + (size_t)idx * entry_len_, entry_len_);
+    }
+    if (!out.good()) {
+        throw InternalError("IxBulkLoader: failed to write sort run " + path);
+    }
+    run_buf_.clear();
+}
+
+// 多路归并所有溢出到磁盘的run，key相同时先输出编号小(即先append)的run中的记录
+void IxBulkLoader::merge_runs() {
+    struct RunReader {
+        std::ifstream in_;
+        std::vector<char> buf_;
+        size_t num_ = 0;
+        size_t pos_ = 0;
+    };
+    size_t run_num = run_files_.size();
+    size_t block_entries = std::max<size_t>(1, IX_BULK_LOAD_RUN_SIZE / run_num / entry_len_ / 2);
+    std::vector<RunReader> readers(run_num);
+
+    auto refill = [&](RunReader& reader) {
+        reader.in_.read(reader.buf_.data(), block_entries * entry_len_);
+        reader.num_ = reader.in_.gcount() / entry_len_;
+        reader.pos_ = 0;
+        return reader.num_ > 0;
+    };
+    auto current = [&](size_t run) { return readers[run].buf_.data() + readers[run].pos_ * entry_len_; };
+    auto greater = [&](size_t a, size_t b) {
+        int res = compare_key(current(a), current(b));
+        return res > 0 || (res == 0 && a > b);
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(greater);
+
+    for (size_t i = 0; i < run_num; ++i) {
+        readers[i].in_.open(run_files_[i], std::ios::in | std::ios::binary);
+        readers[i].buf_.resize(block_entries * entry_len_);
+        if (refill(readers[i])) heap.push(i);
+    }
+
+    int key_len = ih_->file_hdr_->col_tot_len_;
+    while (!heap.empty()) {
+        size_t run = heap.top();
+        heap.pop();
+        add_to_leaf(current(run), current(run) + key_len);
+        RunReader& reader = readers[run];
+        if (++reader.pos_ < reader.num_ || refill(reader)) heap.push(run);
+    }
+
+    readers.clear();
+    for (auto& path : run_files_) {
+        std::remove(path.c_str());
+    }
+    run_files_.clear();
+}
+
+// 将一条记录追加到当前叶子的末尾，叶子中的记录和page directory都是按照key顺序连续存放的
+void IxBulkLoader::add_to_leaf(const char* key, const char* record) {
+    IxFileHdr* file_hdr = ih_->file_hdr_;
+    if (!last_key_.empty()) {
+        int res = compare_key(key, last_key_.data());
+        if (res < 0) {
+            throw InternalError("IxBulkLoader: the input records are not sorted by key");
+        }
+        if (res == 0) {
+            duplicate_num_++;
+            return;
+        }
+    } else {
+        last_key_.resize(file_hdr->col_tot_len_);
+    }
+    memcpy(last_key_.data(), key, file_hdr->col_tot_len_);
+
+    if (levels_.empty()) levels_.emplace_back();
+    if (levels_[0].open_ != nullptr &&
+        reinterpret_cast<IxPageHdr*>(levels_[0].open_->get_data())->tot_num_records_ >= leaf_capacity_) {
+        complete_node(0);
+    }
+    if (levels_[0].open_ == nullptr) open_node(0);
+
+    IxNodeHandle leaf(file_hdr, levels_[0].open_.get());
+    int pos = leaf.page_hdr_->tot_num_records_;
+    int32_t offset = leaf.page_hdr_->free_space_offset_;
+    char* slot = leaf.records_ + offset;
+    memcpy(slot, record, file_hdr->record_len_);
+    *(int32_t*)(slot + RECHDR_OFF_NEXT_RECORD_OFFSET) = INVALID_OFFSET;
+    *(int32_t*)(slot + RECHDR_RECORD_NO_LOCATION) = file_hdr->next_record_no_++;
+    if (pos > 0) {
+        *(int32_t*)leaf.leaf_get_record_at(pos - 1) = offset;
+    }
+
+    char* dir_entry = leaf.leaf_get_directory_entry_at(pos);
+    memcpy(dir_entry, key, file_hdr->col_tot_len_);
+    *(int32_t*)(dir_entry + file_hdr->col_tot_len_) = offset;
+
+    leaf.page_hdr_->free_space_offset_ += file_hdr->record_len_;
+    leaf.page_hdr_->tot_num_records_++;
+    record_num_++;
+}
+
+/**
+ * @description: 将孩子结点插入到level层当前结点的末尾
+ * @return {page_id_t} 孩子结点的父结点
+ * @param {int} level 父结点所在的层
+ * @param {char*} key 孩子结点的第一个key
+ * @param {page_id_t} child 孩子结点的页面号
+ */
+page_id_t IxBulkLoader::add_to_internal(int level, const char* key, page_id_t child) {
+    if ((int)levels_.size() <= level) levels_.emplace_back();
+    if (levels_[level].open_ != nullptr &&
+        reinterpret_cast<IxPageHdr*>(levels_[level].open_->get_data())->num_key_ >= internal_capacity_) {
+        complete_node(level);
+    }
+    if (levels_[level].open_ == nullptr) open_node(level);
+
+    IxNodeHandle node(ih_->file_hdr_, levels_[level].open_.get());
+    node.internal_insert_pairs(node.internal_get_key_num(), key, (const char*)&child, 1);
+    return levels_[level].open_page_no_;
+}
+
+void IxBulkLoader::open_node(int level) {
+    IxBulkLevel& lvl = levels_[level];
+    page_id_t page_no;
+    if (level == 0 && lvl.node_num_ == 0) {
+        page_no = IX_INIT_ROOT_PAGE;
+    } else {
+        page_no = ih_->disk_manager_->allocate_page(ih_->fd_);
+        ih_->file_hdr_->num_pages_++;
+    }
+
+    lvl.open_ = Page::alloc_standalone();
+    lvl.open_page_no_ = page_no;
+    lvl.node_num_++;
+    auto phdr = reinterpret_cast<IxPageHdr*>(lvl.open_->get_data());
+    *phdr = {
+        .parent_ = IX_NO_PAGE,
+        .num_key_ = 0,
+        .num_records_ = 0,
+        .tot_num_records_ = 0,
+        .free_space_offset_ = 0,
+        .first_deleted_offset_ = INVALID_OFFSET,
+        .is_leaf_ = (level == 0),
+        .prev_page_ = lvl.pending_page_no_,
+        .next_page_ = IX_NO_PAGE,
+    };
+    if (lvl.pending_ != nullptr) {
+        reinterpret_cast<IxPageHdr*>(lvl.pending_->get_data())->next_page_ = page_no;
+    }
+    if (level == 0) last_leaf_ = page_no;
+}
+
+// 当前结点已经填满，上一个填满的结点此时可以确定其父结点并写回，当前结点成为新的pending结点
+void IxBulkLoader::complete_node(int level) {
+    if (levels_[level].pending_ != nullptr) push_pending(level);
+    IxBulkLevel& lvl = levels_[level];
+    lvl.pending_ = std::move(lvl.open_);
+    lvl.pending_page_no_ = lvl.open_page_no_;
+    lvl.open_page_no_ = IX_NO_PAGE;
+}
+
+void IxBulkLoader::push_pending(int level) {
+    IxNodeHandle node(ih_->file_hdr_, levels_[level].pending_.get());
+    page_id_t parent = add_to_internal(level + 1, node.get_key_at(0), levels_[level].pending_page_no_);
+    // add_to_internal可能会扩展levels_，需要重新获取
+    IxBulkLevel& lvl = levels_[level];
+    node.set_parent_page_no(parent);
+    write_node(lvl.pending_.get(), lvl.pending_page_no_);
+    lvl.pending_.reset();
+}
+
+// 自底向上结束每一层，只有一个结点的层即为根结点所在的层
+void IxBulkLoader::finish_levels() {
+    for (size_t level = 0; level < levels_.size(); ++level) {
+        if (levels_[level].open_ != nullptr) complete_node(level);
+        if (levels_[level].node_num_ == 1) {
+            IxBulkLevel& lvl = levels_[level];
+            write_node(lvl.pending_.get(), lvl.pending_page_no_);
+            ih_->update_root_page_no(lvl.pending_page_no_);
+            lvl.pending_.reset();
+            break;
+        }
+        push_pending(level);
+    }
+}
+
+// 页面号连续的页面合并成一次写
+void IxBulkLoader::write_node(Page* page, page_id_t page_no) {
+    if (write_page_num_ > 0 &&
+        (page_no != write_first_page_ + write_page_num_ || write_page_num_ >= IX_BULK_LOAD_WRITE_BATCH)) {
+        flush_write_batch();
+    }
+    if (write_page_num_ == 0) {
+        write_buf_.resize((size_t)IX_BULK_LOAD_WRITE_BATCH * PAGE_SIZE);
+        write_first_page_ = page_no;
+    }
+    memcpy(write_buf_.data() + (size_t)write_page_num_ * PAGE_SIZE, page->get_data(), PAGE_SIZE);
+    write_page_num_++;
+}
+
+void IxBulkLoader::flush_write_batch() {
+    if (write_page_num_ == 0) return;
+    ih_->disk_manager_->write_page(ih_->fd_, write_first_page_, write_buf_.data(), write_page_num_ * PAGE_SIZE);
+    write_page_num_ = 0;
+    write_first_page_ = IX_NO_PAGE;
+}
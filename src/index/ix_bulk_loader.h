@@ -0,0 +1,95 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ix_defs.h"
+#include "ix_index_handle.h"
+
+/**
+ * 自底向上构建B+树的批量导入器，只能用于空索引，导入期间不能有其它线程访问该索引
+ * 使用方式: 构造 -> 多次append() -> finish()
+ * 叶子按照fill_factor顺序填满后直接写入索引文件，不经过buffer pool，内部结点随着叶子的生成逐层自底向上构建
+ * 如果输入不是按照key有序的(input_sorted=false)，则先在内存中对每个run排序，run超过IX_BULK_LOAD_RUN_SIZE时
+ * 溢出到临时文件，finish()时再进行多路归并；重复的key只保留第一次append的记录，与insert_entry的行为一致
+ */
+class IxBulkLoader {
+    // 每一层正在构建的结点，levels_[0]为叶子层
+    // 一个结点被填满之后不会立刻写回，而是作为pending_等待同层下一个结点被填满，
+    // 这样在写回之前可以确定它的next_page_，以及它是否是这一层唯一的结点(即根结点)
+    struct IxBulkLevel {
+        std::unique_ptr<Page> open_;            // 正在填充的结点
+        page_id_t open_page_no_ = IX_NO_PAGE;
+        std::unique_ptr<Page> pending_;         // 已经填满、但还没有插入父结点的结点
+        page_id_t pending_page_no_ = IX_NO_PAGE;
+        int node_num_ = 0;                      // 这一层已经创建的结点个数
+    };
+
+   public:
+    IxBulkLoader(IxIndexHandle* ih, bool input_sorted, double fill_factor = IX_BULK_LOAD_FILL_FACTOR);
+
+    ~IxBulkLoader();
+
+    IxBulkLoader(const IxBulkLoader&) = delete;
+    IxBulkLoader& operator=(const IxBulkLoader&) = delete;
+
+    // key为原始的字段值，长度为col_tot_len_，record的长度为record_len_(包括RecordHdr)
+    void append(const char* key, const char* record);
+
+    void finish();
+
+    size_t get_record_num() { return record_num_; }
+
+   private:
+    // run和叶子中保存的都是规范化的key
+    int compare_key(const char* a, const char* b) {
+        return ix_key_compare(a, b, ih_->file_hdr_->col_tot_len_);
+    }
+
+    // external sort
+    std::vector<uint32_t> sort_run();
+
+    void spill_run();
+
+    void merge_runs();
+
+    // tree building
+    void add_to_leaf(const char* key, const char* record);
+
+    page_id_t add_to_internal(int level, const char* key, page_id_t child);
+
+    void open_node(int level);
+
+    void complete_node(int level);
+
+    void push_pending(int level);
+
+    void finish_levels();
+
+    // sequential writing
+    void write_node(Page* page, page_id_t page_no);
+
+    void flush_write_batch();
+
+    IxIndexHandle* ih_;
+    bool input_sorted_;
+    bool finished_ = false;
+    int leaf_capacity_;                 // 每个叶子最多填充的记录数
+    int internal_capacity_;             // 每个内部结点最多填充的孩子数
+    int entry_len_;                     // run中每个条目的长度: key + record
+
+    std::vector<char> run_buf_;         // 当前内存中的run
+    size_t run_capacity_;               // 一个run最多容纳的条目个数
+    std::vector<std::string> run_files_;    // 已经溢出到磁盘的run
+
+    std::vector<IxBulkLevel> levels_;
+    std::vector<char> last_key_;        // 上一条导入的key，用于检查有序和去重
+    page_id_t last_leaf_ = IX_NO_PAGE;
+    size_t record_num_ = 0;
+    size_t duplicate_num_ = 0;
+
+    std::vector<char> write_buf_;       // 连续页面的写缓冲，一次pwrite写回
+    page_id_t write_first_page_ = IX_NO_PAGE;
+    int write_page_num_ = 0;
+};
@@ -12,6 +12,32 @@ constexpr int IX_INIT_ROOT_PAGE = 1;
 constexpr int IX_INIT_NUM_PAGES = 2;
 constexpr int IX_MAX_COL_LEN = 512;
 
+/**
+ * 索引中的key(叶子的page directory和内部结点的keys)以规范化的格式存储，key之间直接用memcmp按字节比较，
+ * 不需要按照字段类型逐个比较：
+ * TYPE_INT: 翻转符号位之后按大端序存储
+ * TYPE_FLOAT: 非负数翻转符号位，负数所有位取反，之后按大端序存储
+ * TYPE_STRING: 定长字符串，原样存储
+ * 规范化之后key的长度不变，记录中保存的仍然是原始的字段值
+ */
+static inline void ix_encode_int(const char *src, char *dest) {
+    uint32_t bits = *(const uint32_t *)src ^ 0x80000000u;
+    bits = __builtin_bswap32(bits);
+    memcpy(dest, &bits, sizeof(uint32_t));
+}
+
+static inline void ix_encode_float(const char *src, char *dest) {
+    float f = *(const float *)src;
+    if (f == 0.0f) f = 0.0f;    // -0.0和0.0编码相同
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(uint32_t));
+    bits = (bits & 0x80000000u) ? ~bits : (bits ^ 0x80000000u);
+    bits = __builtin_bswap32(bits);
+    memcpy(dest, &bits, sizeof(uint32_t));
+}
+
+static inline int ix_key_compare(const char *a, const char *b, int key_len) { return memcmp(a, b, key_len); }
+
 class IxFileHdr {
 public: 
     int num_pages_;                     // 磁盘文件中页面的数量
@@ -43,6 +69,33 @@ public:
                     std::cout << "second\n";
                 } 
 
+    /**
+     * @description: 将原始的索引字段值编码为规范化的key
+     * @param {char*} src 原始的字段值，长度为col_tot_len_
+     * @param {char*} dest 规范化的key，长度为col_tot_len_
+     */
+    void encode_key(const char* src, char* dest) const {
+        int offset = 0;
+        for(int i = 0; i < col_num_; ++i) {
+            switch (col_types_[i]) {
+                case TYPE_INT:
+                    assert(col_lens_[i] == sizeof(int));
+                    ix_encode_int(src + offset, dest + offset);
+                    break;
+                case TYPE_FLOAT:
+                    assert(col_lens_[i] == sizeof(float));
+                    ix_encode_float(src + offset, dest + offset);
+                    break;
+                case TYPE_STRING:
+                    memcpy(dest + offset, src + offset, col_lens_[i]);
+                    break;
+                default:
+                    throw InternalError("Unexpected data type");
+            }
+            offset += col_lens_[i];
+        }
+    }
+
     void update_tot_len() {
         tot_len_ = 0;
         tot_len_ += sizeof(page_id_t) * 3 + sizeof(int) * 8 + sizeof(int32_t);
@@ -1,5 +1,8 @@
 #include "ix_index_handle.h"
 
+#include <algorithm>
+#include <thread>
+
 #include "ix_scan.h"
 
 IxIndexHandle::IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager, int fd, const TabMeta& table_meta)
@@ -11,6 +14,9 @@ IxIndexHandle::IxIndexHandle(DiskManager *disk_manager, BufferPoolManager *buffe
     // disk_manager_->read_page(fd, IX_FILE_HDR_PAGE, buf, PAGE_SIZE);
     PageId pageid = PageId{table_meta.table_id_, IX_FILE_HDR_PAGE};
     Page* page = buffer_pool_manager_->fetch_page(pageid);
+    if (page == nullptr) {
+        throw InternalError("IxIndexHandle: failed to fetch the file header of table " + std::to_string(table_meta.table_id_));
+    }
     // file_hdr_= IxFileHdr();
     file_hdr_ = new IxFileHdr();
     file_hdr_->deserialize(page->get_data());
@@ -31,8 +37,9 @@ std::unique_ptr<Record> IxIndexHandle::get_record(const Rid& rid, Context* conte
     return record;
 }
 
-Rid IxIndexHandle::insert_record(const char *key, char* record, Context* context) {
-    return insert_entry(key, record, context->txn_);
+Rid IxIndexHandle::insert_record(const char *key, char* record, Context* context,
+                                 const std::function<void(const Rid&)> &on_insert) {
+    return insert_entry(key, record, context->txn_, on_insert);
 }
 
 // rid, key, record, leaf_node
@@ -45,39 +52,172 @@ void IxIndexHandle::replay_insert_record(Rid rid, const char *key, char *record,
     }
 }
 
-void IxIndexHandle::delete_record(const Rid& rid, Context* context) {
+void IxIndexHandle::replay_update_record(const Rid& rid, const std::vector<std::pair<int, std::string>>& ranges) {
     IxNodeHandle* node = fetch_node(rid.page_no);
-    char* record_slot = node->leaf_get_record_at(rid.slot_no);
-    *(bool*)(record_slot + RECHDR_OFF_DELETE_MARK) = true;
+    char* raw_data = node->leaf_get_record_at(rid.slot_no) + sizeof(RecordHdr);
+    for(auto& range: ranges) {
+        memcpy(raw_data + range.first, range.second.data(), range.second.size());
+    }
 
+    buffer_pool_manager_->unpin_page(node->get_page_id(), true);
     delete node;
-    // make delete redo log
-    // redo_log_manager->make_delete_log(rid, )
 }
 
-void IxIndexHandle::rollback_delete_record(const Rid& rid, Context* context) {
+void IxIndexHandle::delete_record(const Rid& rid, Context* context) {
     IxNodeHandle* node = fetch_node(rid.page_no);
     char* record_slot = node->leaf_get_record_at(rid.slot_no);
-    *(bool*)(record_slot + RECHDR_OFF_DELETE_MARK) = false;
-    
+    *(bool*)(record_slot + RECHDR_OFF_DELETE_MARK) = true;
+    if(context != nullptr && context->txn_ != nullptr) {
+        *(txn_id_t*)(record_slot + RECHDR_OFF_TXN_ID) = context->txn_->get_transaction_id();
+    }
+
+    buffer_pool_manager_->unpin_page(node->get_page_id(), true);
     delete node;
 }
 
-void IxIndexHandle::update_record(const Rid& rid, char* raw_data, Context* context) {
-    IxNodeHandle* node = fetch_node(rid.page_no);
-    char* record_slot = node->leaf_get_record_at(rid.slot_no);
-    // update record hdr and raw_data
-    // memcpy(record_slot, raw_data, file_hdr_->record_len_);
-    memcpy(record_slot + sizeof(RecordHdr), raw_data, file_hdr_->record_len_ - sizeof(RecordHdr));
-    // make redo log
-    // redo_log_manager_->make_update_log(rid, std::string(raw_data, file_hdr_->record_len_))
-    // memcpy(record_slot + sizeof(RecordHdr), raw_data, file_hdr_->record_len_ - sizeof(RecordHdr));
+/**
+ * @description: 找到主键对应的记录所在的叶子。乐观查找到达的叶子经过了父结点版本号的校验，不会是已经被合并掉的结点
+ * @return {IxNodeHandle*} 加锁并pin住的叶子，记录不存在时返回nullptr
+ * @param {char*} raw_key 原始的主键字段值
+ * @param {Operation} operation FIND对叶子加读锁，UPDATE加写锁
+ * @param {Rid*} rid 返回记录当前的位置
+ */
+IxNodeHandle *IxIndexHandle::find_record_leaf(const char *raw_key, Operation operation, Rid *rid) {
+    char key[IX_MAX_COL_LEN];
+    file_hdr_->encode_key(raw_key, key);
+
+    IxNodeHandle *leaf = find_leaf_page_optimistic(key, operation);
+    int pos = leaf->leaf_directory_lower_bound(key);
+    if (pos < leaf->leaf_get_tot_record_num() && ix_key_compare(leaf->get_key_at(pos), key, file_hdr_->col_tot_len_) == 0) {
+        *rid = {.page_no = leaf->get_page_no(), .slot_no = pos, .record_no = leaf->leaf_get_record_no_at(pos)};
+        return leaf;
+    }
 
-    delete node;
+    if (operation == Operation::FIND) {
+        leaf->page_->RUnlatch();
+    } else {
+        leaf->page_->WUnlatch();
+    }
+    release_optimistic_node(leaf);
+    return nullptr;
+}
+
+std::unique_ptr<Record> IxIndexHandle::get_record(const char *key, Rid *rid) {
+    IxNodeHandle *leaf = find_record_leaf(key, Operation::FIND, rid);
+    if (leaf == nullptr) {
+        return nullptr;
+    }
+    auto record = std::make_unique<Record>(leaf->leaf_get_record_at(rid->slot_no), file_hdr_->record_len_);
+    leaf->page_->RUnlatch();
+    release_optimistic_node(leaf);
+    return record;
+}
+
+/**
+ * @description: 在记录所在叶子的写锁下修改记录。压缩等操作的日志同样在叶子的写锁下生成，
+ *              因此op中生成的日志与叶子上修改的顺序一致，日志中的Rid就是修改时记录所在的位置
+ * @return {bool} 记录不存在或者record_no不一致时返回false，此时不调用op
+ * @param {char*} key 原始的主键字段值
+ * @param {int32_t} record_no 语句读到的记录的record_no，为-1时不校验
+ * @param {function} op 参数为记录在叶子中的地址(包括RecordHdr)和记录当前的Rid
+ */
+bool IxIndexHandle::modify_record(const char *key, int32_t record_no, const std::function<void(char *, const Rid &)> &op) {
+    Rid rid;
+    IxNodeHandle *leaf = find_record_leaf(key, Operation::UPDATE, &rid);
+    if (leaf == nullptr) {
+        return false;
+    }
+    bool found = record_no == -1 || rid.record_no == record_no;
+    if (found) {
+        op(leaf->leaf_get_record_at(rid.slot_no), rid);
+    }
+    leaf->page_->WUnlatch();
+    buffer_pool_manager_->unpin_page(leaf->get_page_id(), found);
+    delete leaf;
+    return found;
+}
+
+/**
+ * @brief 乐观锁耦合：不对内部结点加锁，只记录版本号，读取孩子指针后校验版本号，校验失败则从根结点重新开始。
+ * 只有到达叶结点时才对其加锁(FIND加读锁，INSERT/DELETE加写锁)，加锁之后再校验一次父结点的版本号。
+ *
+ * @return 加锁并pin住的叶结点。对于写操作，如果叶结点不安全(需要分裂或者需要修改父结点)，则返回nullptr，
+ * 调用者需要退回到find_leaf_page中的悲观加锁协议
+ */
+IxNodeHandle *IxIndexHandle::find_leaf_page_optimistic(const char *key, Operation operation, bool find_first) {
+    auto latch_leaf = [operation](IxNodeHandle *leaf) {
+        if (operation == Operation::FIND) leaf->page_->RLatch();
+        else leaf->page_->WLatch();
+    };
+    auto unlatch_leaf = [operation](IxNodeHandle *leaf) {
+        if (operation == Operation::FIND) leaf->page_->RUnlatch();
+        else leaf->page_->WUnlatch();
+    };
+
+    while (true) {
+        page_id_t root_page_no = file_hdr_->root_page_;
+        IxNodeHandle *node = fetch_node(root_page_no);
+        uint64_t version = 0;
+        bool restart = false;
+
+        if (node->is_leaf_page()) {
+            // 根结点即叶结点，直接加锁，加锁后根结点没有发生变化则查找成功
+            latch_leaf(node);
+            if (root_page_no != file_hdr_->root_page_) {
+                unlatch_leaf(node);
+                restart = true;
+            }
+        } else if (!node->page_->optimistic_read(&version) || root_page_no != file_hdr_->root_page_) {
+            restart = true;
+        }
+
+        // Travel through inner nodes
+        while (!restart && !node->is_leaf_page()) {
+            page_id_t child_page_no = find_first ? node->internal_child_page_at(0) : node->internal_lookup(key);
+            // 读取到的孩子指针可能是不一致的数据，使用之前必须校验
+            if (!node->page_->validate(version)) {
+                restart = true;
+                break;
+            }
+            IxNodeHandle *child = fetch_node(child_page_no);
+            uint64_t child_version = 0;
+            if (child->is_leaf_page()) {
+                latch_leaf(child);
+                if (!node->page_->validate(version)) {
+                    unlatch_leaf(child);
+                    release_optimistic_node(child);
+                    restart = true;
+                    break;
+                }
+            } else if (!child->page_->optimistic_read(&child_version) || !node->page_->validate(version)) {
+                release_optimistic_node(child);
+                restart = true;
+                break;
+            }
+            release_optimistic_node(node);
+            node = child;
+            version = child_version;
+        }
+
+        if (restart) {
+            release_optimistic_node(node);
+            std::this_thread::yield();
+            continue;
+        }
+
+        if (operation != Operation::FIND && !is_safe(node, operation, find_first ? nullptr : key)) {
+            unlatch_leaf(node);
+            release_optimistic_node(node);
+            return nullptr;
+        }
+        return node;
+    }
 }
 
 /**
  * @brief Travel through inner nodes until find the leaf page which store the target key
+ * 先尝试乐观锁耦合，读操作和不会引起分裂的写操作只会对叶结点加锁；
+ * 写操作的叶结点不安全时，才使用root_latch_和蟹形协议自顶向下对可能被修改的结点加写锁
  *
  * @return [leaf node] and [root_is_latched]
  * @note need to Unlatch and unpin the leaf node outside!
@@ -86,10 +226,13 @@ void IxIndexHandle::update_record(const Rid& rid, char* raw_data, Context* conte
 std::pair<IxNodeHandle *, bool> IxIndexHandle::find_leaf_page(const char *key, Operation operation,
                                                             Transaction *transaction, bool find_first) {
     // printf("Enter find_leaf_page\n");
+    IxNodeHandle *leaf = find_leaf_page_optimistic(key, operation, find_first);
+    if (leaf != nullptr) {
+        return std::make_pair(leaf, false);
+    }
+    assert(operation != Operation::FIND);
+    const char *safe_key = find_first ? nullptr : key;
 
-    /**
-     * TODO: 并发改成蟹形协议
-    */
     // root latch是mutex类型的锁(互斥锁)，它只能由一个线程来获取(lock)
     // 如果其他线程已经获取占用，本线程就获取不到，本线程的该函数就会阻塞在这个位置，直到其他线程释放(unlcok)锁
     root_latch_.lock();  // 获取mutex锁
@@ -99,16 +242,10 @@ std::pair<IxNodeHandle *, bool> IxIndexHandle::find_leaf_page(const char *key, O
     Page *page = node->page_;
     // std::cout << "find_leaf_page: " << "root_page.page_no: " << page->get_page_id().page_no << "\n";
 
-    if (operation == Operation::FIND) {  // 读操作不需要对根结点上锁
-        page->RLatch();
+    page->WLatch();
+    if (is_safe(node, operation, safe_key)) {
         root_is_latched = false;
         root_latch_.unlock();
-    } else {
-        page->WLatch();
-        if (is_safe(node, operation)) {
-            root_is_latched = false;
-            root_latch_.unlock();
-        }
     }
 
     // Travel through inner nodes
@@ -124,21 +261,15 @@ std::pair<IxNodeHandle *, bool> IxIndexHandle::find_leaf_page(const char *key, O
         IxNodeHandle *child_node = fetch_node(child_page_no);  // pin the child node
         Page *child_page = child_node->page_;
 
-        if (operation == Operation::FIND) {
-            child_page->RLatch();
-            page->RUnlatch();
-            buffer_pool_manager_->unpin_page(page->get_page_id(), false);  // unpin old parent page
-        } else {
-            child_page->WLatch();
-            transaction->append_index_latch_page_set(page);
-            // child node is safe, release all locks on ancestors(NOT including child_page)
-            if (is_safe(child_node, operation)) {
-                if (root_is_latched) {
-                    root_is_latched = false;
-                    root_latch_.unlock();
-                }
-                unlock_unpin_pages(transaction);
+        child_page->WLatch();
+        transaction->append_index_latch_page_set(page);
+        // child node is safe, release all locks on ancestors(NOT including child_page)
+        if (is_safe(child_node, operation, safe_key)) {
+            if (root_is_latched) {
+                root_is_latched = false;
+                root_latch_.unlock();
             }
+            unlock_unpin_pages(transaction);
         }
         
         delete node;
@@ -166,7 +297,7 @@ std::pair<IxNodeHandle *, bool> IxIndexHandle::find_leaf_page(const char *key, O
  * @note need to unpin the new node outside
  * 注意：本函数执行完毕后，原node和new node都需要在函数外面进行unpin
  */
-IxNodeHandle *IxIndexHandle::split(IxNodeHandle *node) {
+IxNodeHandle *IxIndexHandle::split(IxNodeHandle *node, bool append) {
     // Allocate brother node
     IxNodeHandle *bro = create_node();  // node分裂产生的右兄弟结点
     // printf("split bro=%d\n", bro->get_page_no());
@@ -195,22 +326,28 @@ IxNodeHandle *IxIndexHandle::split(IxNodeHandle *node) {
      * TODO: the split of leaf page is different from the internal page
     */
     if(node->is_leaf_page()) {
-        // split at middle position
+        // split at middle position, or keep the left node nearly full when appending at the right edge
         int split_idx = node->leaf_get_min_size();
+        if (append) {
+            split_idx = std::max(split_idx, std::min(node->leaf_get_tot_record_num() - 1,
+                                                     static_cast<int>(node->leaf_get_max_size() * IX_APPEND_SPLIT_FILL_FACTOR)));
+        }
         int num_transfer = node->leaf_get_tot_record_num() - split_idx;
         // insert [split_idx, tot_num_record) into bro_leaf (both record data and page directory)
         bro->leaf_insert_continous_records(0, node->records_, node->leaf_get_directory_entry_at(split_idx), num_transfer);
         assert(bro->leaf_get_tot_record_num() == num_transfer);
 
-        // update current node's record num
-        node->page_hdr_->tot_num_records_ = split_idx;
-        // update current node's first_deleted_offset
-        node->page_hdr_->first_deleted_offset_ = *(int32_t*)(node->leaf_get_directory_entry_at(split_idx) + file_hdr_->col_tot_len_);
+        // the transferred slots become the deleted slots of current node, the last kept record has no next record in this page
+        node->leaf_remove_records(split_idx, num_transfer);
     }
     else {
         // split at middle position
         // split_idx是左区间的num_key(长度)，左区间范围[0, split_idx)
         int split_idx = node->internal_get_min_size();
+        if (append) {
+            split_idx = std::max(split_idx, std::min(node->internal_get_key_num() - 1,
+                                                     static_cast<int>(node->internal_get_max_size() * IX_APPEND_SPLIT_FILL_FACTOR)));
+        }
         // num_transfer是右区间的num_key(长度)，右区间范围[split_idx, num_key)
         int num_transfer = node->internal_get_key_num() - split_idx;
 
@@ -249,7 +386,7 @@ IxNodeHandle *IxIndexHandle::split(IxNodeHandle *node) {
  * into account. Remember to deal with split recursively if necessary.
  */
 void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const char *key, IxNodeHandle *new_node,
-                                     Transaction *transaction) {
+                                     Transaction *transaction, bool append) {
     if (old_node->is_root_page()) {
         // If current page is root node, allocate new root
         IxNodeHandle *root = create_node();
@@ -319,8 +456,10 @@ void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const char *key,
     }
 
     // 父节点已满，继续分裂，递归插入
-    IxNodeHandle *new_parent = split(parent);
-    insert_into_parent(parent, new_parent->internal_key_at(0), new_parent, transaction);
+    // 新的孩子追加在最右侧父结点的末尾时，父结点同样按追加的方式分裂
+    append = append && child_idx + 1 == parent->internal_get_key_num() - 1;
+    IxNodeHandle *new_parent = split(parent, append);
+    insert_into_parent(parent, new_parent->internal_key_at(0), new_parent, transaction, append);
 
     buffer_pool_manager_->unpin_page(parent->get_page_id(), true);
     buffer_pool_manager_->unpin_page(new_parent->get_page_id(), true);
@@ -337,17 +476,27 @@ void IxIndexHandle::insert_into_parent(IxNodeHandle *old_node, const char *key,
  * @param transaction
  * @return page_id_t 插入到的叶结点的page_no
  */
-Rid IxIndexHandle::insert_entry(const char* key, const char* record_value, Transaction *transaction) {
+Rid IxIndexHandle::insert_entry(const char* raw_key, const char* record_value, Transaction *transaction,
+                                const std::function<void(const Rid&)> &on_insert) {
     // std::scoped_lock lock{root_latch_};
+    char key[IX_MAX_COL_LEN];
+    file_hdr_->encode_key(raw_key, key);
     if (is_empty()) {
         // LOG_WARN("Tree is empty when insert entry\n");
         // start_new_tree(key, value);
         // return -1;
     }
 
+    // 追加插入时直接写入缓存的最右叶子，否则从根结点开始查找
     // find the leaf page that the key-value has to be inserted
-    auto [leaf_node, root_is_latched] = find_leaf_page(key, Operation::INSERT, transaction, false);
+    IxNodeHandle *leaf_node = find_append_leaf_page(key);
+    bool root_is_latched = false;
+    if (leaf_node == nullptr) {
+        std::tie(leaf_node, root_is_latched) = find_leaf_page(key, Operation::INSERT, transaction, false);
+    }
     Page *leaf_page = leaf_node->page_;
+    // 最右叶子上的追加插入：分裂时左结点保持接近满
+    bool append = leaf_node->get_next_page() == IX_NO_PAGE;
 
     // printf("insert_entry: find leaf node=%d\n", leaf_node->get_page_no());
 
@@ -356,8 +505,7 @@ Rid IxIndexHandle::insert_entry(const char* key, const char* record_value, Trans
     int insert_index = leaf_node->leaf_insert_key_record(key, record_value);
 
     int new_size = leaf_node->leaf_get_tot_record_num();
-
-    maintain_parent(leaf_node);  // NOTE THIS!
+    append = append && insert_index == new_size - 1;
 
     // 不允许重复的key
     if (new_size == origin_size) {
@@ -372,19 +520,33 @@ Rid IxIndexHandle::insert_entry(const char* key, const char* record_value, Trans
         return Rid{.page_no = INVALID_PAGE_ID, .slot_no = -1, .record_no = -1};
     }
 
+    // 只有插入到第一个位置才可能需要降低父结点的key，此时is_safe保证了父结点已经加了写锁
+    if (insert_index == 0) {
+        maintain_parent(leaf_node);  // NOTE THIS!
+    }
+
     if (new_size < leaf_node->leaf_get_max_size()) {
-        int record_no = leaf_node->leaf_get_record_no_at(insert_index);
+        Rid rid{.page_no = leaf_node->get_page_no(), .slot_no = insert_index,
+                .record_no = leaf_node->leaf_get_record_no_at(insert_index)};
+        last_insert_leaf_.store(rid.page_no, std::memory_order_relaxed);
         if(root_is_latched)  {
             root_latch_.unlock();
         }
         unlock_unpin_pages(transaction);  // 此函数中会释放叶子的所有现在被锁住的祖先（不包括叶子）
+        if (on_insert) {
+            on_insert(rid);
+        }
         leaf_page->WUnlatch();
         buffer_pool_manager_->unpin_page(leaf_page->get_page_id(), true);  // unpin leaf page
+        delete leaf_node;
         // return true;
-        return Rid{.page_no = leaf_node->get_page_no(), .slot_no = insert_index, .record_no = record_no};
+        return rid;
     }
 
-    IxNodeHandle *new_leaf_node = split(leaf_node);  // pin new leaf node
+    IxNodeHandle *new_leaf_node = split(leaf_node, append);  // pin new leaf node
+    // 新的叶子在insert_into_parent之后才能被其他线程找到，在此之前加写锁，
+    // 保证插入的记录在on_insert生成日志之前不会被删除或压缩移动
+    new_leaf_node->page_->WLatch();
 
     // printf("3 new_leaf_node=%d size=%d\n", new_leaf_node->get_page_no(), new_leaf_node->get_size());
 
@@ -394,7 +556,7 @@ Rid IxIndexHandle::insert_entry(const char* key, const char* record_value, Trans
     }
 
     insert_into_parent(leaf_node, new_leaf_node->leaf_get_directory_entry_at(0), new_leaf_node,
-                     transaction);  // 此函数内将会W Unlatch除叶结点外的结点
+                     transaction, append);  // 此函数内将会W Unlatch除叶结点外的结点
 
     Rid rid;
     int lower_id = new_leaf_node->leaf_directory_lower_bound(key);
@@ -409,8 +571,13 @@ Rid IxIndexHandle::insert_entry(const char* key, const char* record_value, Trans
         rid.slot_no = insert_index;
         rid.record_no = leaf_node->leaf_get_record_no_at(insert_index);
     }
+    last_insert_leaf_.store(rid.page_no, std::memory_order_relaxed);
+    if (on_insert) {
+        on_insert(rid);
+    }
 
     // 必须unpin，InsertIntoParent函数里面并不会unpin old node和new node
+    new_leaf_node->page_->WUnlatch();
     leaf_page->WUnlatch();
     buffer_pool_manager_->unpin_page(leaf_node->get_page_id(), true);
     buffer_pool_manager_->unpin_page(new_leaf_node->get_page_id(), true);
@@ -432,36 +599,40 @@ Rid IxIndexHandle::insert_entry(const char* key, const char* record_value, Trans
  * @param key
  * @return 返回第一个大于/等于目标元素的Rid
  */
-Rid IxIndexHandle::lower_bound(const char *key) {
+Rid IxIndexHandle::lower_bound(const char *raw_key) {
+    char key[IX_MAX_COL_LEN];
+    file_hdr_->encode_key(raw_key, key);
     // int int_key = *(int *)key;
     // printf("my_lower_bound key=%d\n", int_key);
     // std::cout << "lower_bound: key=" << *(int*)key << ", index's total page number: " << file_hdr_->num_pages_ << ", root_page: " << file_hdr_->root_page_ << "\n";
 
-    IxNodeHandle *node = find_leaf_page(key, Operation::FIND, nullptr, false).first;
-    int key_idx = node->leaf_directory_lower_bound(key);
-    // int32_t offset = *(int32_t*)(node->leaf_get_directory_entry_at(key_idx) + file_hdr_->col_tot_len_);
-
-    Rid iid;
-    if(key_idx == node->leaf_get_tot_record_num()) {
-        page_id_t next_page_id = node->get_next_page();
-        if(next_page_id == -1) iid = leaf_end();
+    while (true) {
+        IxNodeHandle *node = find_leaf_page(key, Operation::FIND, nullptr, false).first;
+        int key_idx = node->leaf_directory_lower_bound(key);
+        // int32_t offset = *(int32_t*)(node->leaf_get_directory_entry_at(key_idx) + file_hdr_->col_tot_len_);
+
+        Rid iid;
+        bool success = true;
+        if(key_idx == node->leaf_get_tot_record_num()) {
+            page_id_t next_page_id = node->get_next_page();
+            if(next_page_id == -1) iid = leaf_end();
+            else {
+                iid = {.page_no = next_page_id, .slot_no = 0, .record_no = -1};
+                success = read_next_leaf_first_record_no(node, &iid.record_no);
+            }
+        }
         else {
-            IxNodeHandle* next_node = fetch_node(next_page_id);
-            iid = {.page_no = next_page_id, .slot_no = 0, .record_no = next_node->leaf_get_record_no_at(0)};
-            buffer_pool_manager_->unpin_page(next_node->get_page_id(), false);
-            delete next_node;
+            iid = {.page_no = node->get_page_no(), .slot_no = key_idx, .record_no = node->leaf_get_record_no_at(key_idx)};
         }
-    }
-    else {
-        iid = {.page_no = node->get_page_no(), .slot_no = key_idx, .record_no = node->leaf_get_record_no_at(key_idx)};
-    }
 
-    // unlatch and unpin leaf node
-    node->page_->RUnlatch();
-    buffer_pool_manager_->unpin_page(node->get_page_id(), false);
-    delete node;
+        // unlatch and unpin leaf node
+        node->page_->RUnlatch();
+        buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+        delete node;
 
-    return iid;
+        // 右兄弟一直被写者持有时放开叶子的锁，重新查找
+        if (success) return iid;
+    }
 }
 
 // 这里有点类似CMU中的FindLeafPageByOperation，其调用了internal page的Lookup函数，得到upper_bound的下标-1
@@ -473,36 +644,40 @@ Rid IxIndexHandle::lower_bound(const char *key) {
  * @param key
  * @return 返回第一个大于目标元素的Rid
  */
-Rid IxIndexHandle::upper_bound(const char *key) {
+Rid IxIndexHandle::upper_bound(const char *raw_key) {
+    char key[IX_MAX_COL_LEN];
+    file_hdr_->encode_key(raw_key, key);
     // int int_key = *(int *)key;
     // printf("my_upper_bound key=%d\n", int_key);
 
-    IxNodeHandle *node = find_leaf_page(key, Operation::FIND, nullptr, false).first;
-    int key_idx = node->leaf_directory_upper_bound(key);
-    // int32_t offset = *(int32_t*)(node->leaf_get_directory_entry_at(key_idx) + file_hdr_->col_tot_len_);
-
-    Rid iid;
-    if (key_idx == node->leaf_get_tot_record_num()) {
-        // 这种情况无法根据iid找到rid，即后续无法调用ih->get_rid(iid)
-        // iid = leaf_end();
-        page_id_t next_page_id = node->get_next_page();
-        if(next_page_id == -1) iid = leaf_end();
-        else {
-            IxNodeHandle* next_node = fetch_node(next_page_id);
-            iid = {.page_no = next_page_id, .slot_no = 0, .record_no = next_node->leaf_get_record_no_at(0)};
-            buffer_pool_manager_->unpin_page(next_node->get_page_id(), false);
-            delete next_node;
+    while (true) {
+        IxNodeHandle *node = find_leaf_page(key, Operation::FIND, nullptr, false).first;
+        int key_idx = node->leaf_directory_upper_bound(key);
+        // int32_t offset = *(int32_t*)(node->leaf_get_directory_entry_at(key_idx) + file_hdr_->col_tot_len_);
+
+        Rid iid;
+        bool success = true;
+        if (key_idx == node->leaf_get_tot_record_num()) {
+            // 这种情况无法根据iid找到rid，即后续无法调用ih->get_rid(iid)
+            // iid = leaf_end();
+            page_id_t next_page_id = node->get_next_page();
+            if(next_page_id == -1) iid = leaf_end();
+            else {
+                iid = {.page_no = next_page_id, .slot_no = 0, .record_no = -1};
+                success = read_next_leaf_first_record_no(node, &iid.record_no);
+            }
+        } else {
+            iid = {.page_no = node->get_page_no(), .slot_no = key_idx, .record_no = node->leaf_get_record_no_at(key_idx)};
         }
-    } else {
-        iid = {.page_no = node->get_page_no(), .slot_no = key_idx, .record_no = node->leaf_get_record_no_at(key_idx)};
-    }
 
-    // unlatch and unpin leaf node
-    node->page_->RUnlatch();
-    buffer_pool_manager_->unpin_page(node->get_page_id(), false);
-    delete node;
+        // unlatch and unpin leaf node
+        node->page_->RUnlatch();
+        buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+        delete node;
 
-    return iid;
+        // 右兄弟一直被写者持有时放开叶子的锁，重新查找
+        if (success) return iid;
+    }
 }
 
 Rid IxIndexHandle::leaf_end() const {
@@ -531,6 +706,10 @@ IxNodeHandle *IxIndexHandle::fetch_node(int page_no) const {
     // 统计fetch paeg的时间
     // auto start = std::chrono::high_resolution_clock::now();
     Page *page = buffer_pool_manager_->fetch_page(PageId{table_meta_.table_id_, page_no});
+    // rpc失败或者没有空闲的帧时fetch_page返回nullptr
+    if (page == nullptr) {
+        throw InternalError("IxIndexHandle::fetch_node: failed to fetch page " + std::to_string(page_no) + " of table " + std::to_string(table_meta_.table_id_));
+    }
     // auto end = std::chrono::high_resolution_clock::now();
     // auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
     // std::cout << "fetch_page time: " << duration.count() << "us\n";
@@ -547,6 +726,9 @@ IxNodeHandle *IxIndexHandle::create_node() {
     PageId new_page_id = {.table_id = table_meta_.table_id_, .page_no = INVALID_PAGE_ID};
     // 从3开始分配page_no，第一次分配之后，new_page_id.page_no=3，file_hdr_.num_pages=4
     Page *page = buffer_pool_manager_->new_page(&new_page_id);
+    if (page == nullptr) {
+        throw InternalError("IxIndexHandle::create_node: no free frame for table " + std::to_string(table_meta_.table_id_));
+    }
     // printf("IxIndexHandle::create_node_handle file_hdr_.num_pages=%d\n", file_hdr_.num_pages);
     // assert(new_page_id.page_no == file_hdr_.num_pages - 1);
     // file_hdr_.num_pages = new_page_id.page_no + 1;
@@ -556,7 +738,9 @@ IxNodeHandle *IxIndexHandle::create_node() {
     return node;
 }
 
-// 这里从node开始更新其父节点的第一个key，一直向上更新直到根节点
+// 插入的key小于node的第一个key之后，从node开始降低父结点中指向它的key，直到该key不是父结点的第一个key为止
+// 父结点的key只需要不大于孩子结点中的所有key(物理删除不会提高它)，因此只在孩子的第一个key更小时才修改，
+// 被修改的父结点在查找时一定已经加了写锁(见is_safe)
 void IxIndexHandle::maintain_parent(IxNodeHandle *node) {
     IxNodeHandle *curr = node;
     while (curr->get_parent_page_no() != IX_NO_PAGE) {
@@ -566,17 +750,66 @@ void IxIndexHandle::maintain_parent(IxNodeHandle *node) {
         char *parent_key = parent->internal_key_at(rank);
         // char *child_max_key = curr.get_key(curr.page_hdr->num_key - 1);
         char *child_first_key = curr->get_key_at(0);
-        if (memcmp(parent_key, child_first_key, file_hdr_->col_tot_len_) == 0) {
-            buffer_pool_manager_->unpin_page(parent->get_page_id(), true);
+        if (ix_key_compare(child_first_key, parent_key, file_hdr_->col_tot_len_) >= 0) {
+            buffer_pool_manager_->unpin_page(parent->get_page_id(), false);
             delete parent;
             break;
         }
         memcpy(parent_key, child_first_key, file_hdr_->col_tot_len_);  // 修改了parent node
+        // curr在下一轮循环中还要使用，因此parent要等到向上移动一层之后再释放
+        if (curr != node) {
+            buffer_pool_manager_->unpin_page(curr->get_page_id(), true);
+            delete curr;
+        }
         curr = parent;
+        if (rank != 0) {
+            break;
+        }
+    }
+    if (curr != node) {
+        buffer_pool_manager_->unpin_page(curr->get_page_id(), true);
+        delete curr;
+    }
+}
 
-        buffer_pool_manager_->unpin_page(parent->get_page_id(), true);
-        delete parent;
+// unpin并释放乐观遍历过程中获取的结点
+void IxIndexHandle::release_optimistic_node(IxNodeHandle *node) {
+    buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+    delete node;
+}
+
+/**
+ * @brief 读取leaf的右兄弟中第一条记录的record_no，调用者持有leaf的锁
+ * 持有leaf的锁时右兄弟不会被合并掉，但是可能同时被分裂，或者插入、删除第一条记录。
+ * 重分配和合并会在持有右边结点的写锁时再锁左兄弟，因此这里不能等待右兄弟的锁，而是用版本号校验读到的值，
+ * 读取期间数据可能不一致，使用记录的偏移之前需要检查范围
+ *
+ * @return 右兄弟连续IX_NEXT_LEAF_READ_RETRY次被写者持有时返回false，调用者需要放开leaf的锁之后重试
+ */
+bool IxIndexHandle::read_next_leaf_first_record_no(IxNodeHandle *leaf, int32_t *record_no) {
+    IxNodeHandle *next_node = fetch_node(leaf->get_next_page());
+    bool success = false;
+    for (int i = 0; i < IX_NEXT_LEAF_READ_RETRY && !success; ++i) {
+        uint64_t version;
+        if (!next_node->page_->optimistic_read(&version)) {
+            std::this_thread::yield();
+            continue;
+        }
+        int32_t value = -1;
+        if (next_node->page_hdr_->tot_num_records_ > 0) {
+            int32_t offset = *(int32_t *)(next_node->leaf_get_directory_entry_at(0) + file_hdr_->col_tot_len_);
+            if (offset < 0 || offset + RECHDR_RECORD_NO_LOCATION + sizeof(int32_t) > PAGE_SIZE - sizeof(IxPageHdr)) {
+                continue;
+            }
+            value = *(int32_t *)(next_node->records_ + offset + RECHDR_RECORD_NO_LOCATION);
+        }
+        if (next_node->page_->validate(version)) {
+            *record_no = value;
+            success = true;
+        }
     }
+    release_optimistic_node(next_node);
+    return success;
 }
 
 void IxIndexHandle::release_node_handle(IxNodeHandle &node) {
@@ -639,7 +872,24 @@ void IxIndexHandle::unlock_unpin_pages(Transaction *transaction) {
  * @return true
  * @return false
  */
-bool IxIndexHandle::is_safe(IxNodeHandle *node, Operation op) {
+bool IxIndexHandle::is_safe(IxNodeHandle *node, Operation op, const char *key) {
+    // 原地修改记录不改变树的结构
+    if (op == Operation::UPDATE) {
+        return true;
+    }
+
+    // 压缩时需要修改叶结点的父结点，但不会让父结点的孩子数少于min size，也不会修改父结点的第一个key
+    if (op == Operation::COMPACT) {
+        return !node->is_leaf_page();
+    }
+
+    // 插入的key小于结点的第一个key时，maintain_parent需要修改父结点，此时父结点也必须被锁住
+    if (op == Operation::INSERT && key != nullptr && !node->is_root_page()) {
+        if (node->get_size() == 0 || ix_key_compare(key, node->get_key_at(0), file_hdr_->col_tot_len_) < 0) {
+            return false;
+        }
+    }
+
     if (node->is_root_page()) {
         return (op == Operation::INSERT && node->get_size() + 1 < node->get_max_size()) ||
                (op == Operation::DELETE && node->get_size() - 1 >= 2);
@@ -685,6 +935,32 @@ bool IxIndexHandle::is_safe(IxNodeHandle *node, Operation op) {
 //     return true;
 // }
 
+/**
+ * @description: 追加插入的快速路径，跳过从根结点开始的查找
+ * 缓存的叶子只是一个提示，加写锁之后需要重新校验：它仍然是最右侧的叶子(last_leaf_只会在持有该叶子写锁时被修改)，
+ * key大于叶子中的最大key，并且插入之后不需要分裂，也不需要修改父结点
+ * @return {IxNodeHandle*} 加了写锁的叶子，校验失败时返回nullptr
+ * @param {char} *key 规范化的key
+ */
+IxNodeHandle *IxIndexHandle::find_append_leaf_page(const char *key) {
+    page_id_t page_no = last_insert_leaf_.load(std::memory_order_relaxed);
+    if (page_no == IX_NO_PAGE || page_no != file_hdr_->last_leaf_) {
+        return nullptr;
+    }
+
+    IxNodeHandle *leaf = fetch_node(page_no);
+    leaf->page_->WLatch();
+    int size = leaf->leaf_get_tot_record_num();
+    if (page_no == file_hdr_->last_leaf_ && leaf->is_leaf_page() && leaf->get_next_page() == IX_NO_PAGE && size > 0 &&
+        ix_key_compare(key, leaf->get_key_at(size - 1), file_hdr_->col_tot_len_) > 0 &&
+        is_safe(leaf, Operation::INSERT, key)) {
+        return leaf;
+    }
+    leaf->page_->WUnlatch();
+    release_optimistic_node(leaf);
+    return nullptr;
+}
+
 /**
  * @brief only used in get_value()
  *
@@ -694,357 +970,370 @@ bool IxIndexHandle::is_safe(IxNodeHandle *node, Operation op) {
 //     return FindLeafPageByOperation(key, Operation::FIND, transaction).first;
 // }
 
-// // TODO!!! 删掉value这个在CMU的删除逻辑中无意义的参数（只要删除一个key及其对应value）
-// /**
-//  * @brief
-//  *
-//  * @param key
-//  * @param value
-//  * @param transaction
-//  */
-// void IxIndexHandle::delete_entry(const char *key, const Rid &value, Transaction *transaction) {
-//     // 这里初始化的时候root page是等于2的，只有把root page也删掉，才认为它为空？
-//     if (is_empty()) {
-//         return;
-//     }
-
-//     // printf("delete_entry: delete key=%d\n", *(int *)key);
-
-//     auto [leaf_node, root_is_latched] = find_leaf_page(key, Operation::DELETE, transaction);
-
-//     Page *leaf_page = leaf_node->page;
-//     int old_size = leaf_node->get_size();
-//     int new_size = leaf_node->remove(key);  // 在leaf中删除key和value（如果不存在该key，则size不变）
-
-//     maintain_parent(leaf_node);  // NOTE THIS!
-
-//     // 1 删除失败
-//     if (new_size == old_size) {
-//         if (root_is_latched) {
-//             root_latch_.unlock();
-//         }
-//         unlock_unpin_pages(transaction);
-
-//         leaf_page->WUnlatch();
-//         buffer_pool_manager_->unpin_page(leaf_page->get_page_id(), false);  // unpin leaf page
-
-//         return;
-//     }
-
-//     // 2 删除成功，然后调用CoalesceOrRedistribute
-//     bool *pointer_root_is_latched = new bool(root_is_latched);
-
-//     bool leaf_should_delete = coalesce_or_redistribute(leaf_node, transaction, pointer_root_is_latched);
-//     // NOTE: unlock and unpin are finished in coalesce_or_redistribute()
-//     // NOTE: root node must be unlocked in coalesce_or_redistribute()
-//     assert((*pointer_root_is_latched) == false);
+/**
+ * @brief 物理删除key对应的记录(purge)
+ * 删除之后如果叶结点的记录数小于min size，则与兄弟结点重分配或者合并，并递归地维护父结点
+ * 调用者需要保证被删除的记录不会再被其他事务访问(删除它的事务已经提交，或者插入它的事务已经回滚)
+ * 注意：删除叶结点的第一条记录时不会修改父结点的key，父结点的key只需要不大于孩子结点中的所有key即可
+ *
+ * @param raw_key 原始的字段值
+ * @param next_record_no 返回key顺序上被删除记录的下一条记录的record_no，没有下一条记录时返回next_record_no_(与leaf_end一致)
+ * @param on_delete 删除成功时在释放写锁之前调用：之后修改这些结点的操作一定在它之后生成日志，存储层按相同的顺序回放
+ * @return 被删除记录的Rid，key不存在时page_no为INVALID_PAGE_ID
+ */
+Rid IxIndexHandle::delete_entry(const char *raw_key, Transaction *transaction, int32_t *next_record_no,
+                                const std::function<void()> &on_delete) {
+    char key[IX_MAX_COL_LEN];
+    file_hdr_->encode_key(raw_key, key);
 
-//     delete pointer_root_is_latched;
+    auto [leaf_node, root_is_latched] = find_leaf_page(key, Operation::DELETE, transaction, false);
+    Page *leaf_page = leaf_node->page_;
 
-//     leaf_page->WUnlatch();
-//     buffer_pool_manager_->unpin_page(leaf_page->get_page_id(), true);  // unpin leaf page
+    Rid rid = {.page_no = INVALID_PAGE_ID, .slot_no = -1, .record_no = -1};
+    bool next_record_pending = false;
+    int pos = leaf_node->leaf_directory_lower_bound(key);
+    bool found = pos < leaf_node->leaf_get_tot_record_num() &&
+                 ix_key_compare(leaf_node->get_key_at(pos), key, file_hdr_->col_tot_len_) == 0;
+    if (found) {
+        rid = {.page_no = leaf_node->get_page_no(), .slot_no = pos, .record_no = leaf_node->leaf_get_record_no_at(pos)};
+        if (next_record_no != nullptr) {
+            if (pos + 1 < leaf_node->leaf_get_tot_record_num()) {
+                *next_record_no = leaf_node->leaf_get_record_no_at(pos + 1);
+            } else if (leaf_node->get_next_page() != IX_NO_PAGE) {
+                if (!read_next_leaf_first_record_no(leaf_node, next_record_no)) {
+                    // 右兄弟一直被写者持有，放开所有锁之后再查找被删除记录的下一条记录
+                    next_record_pending = true;
+                }
+            } else {
+                *next_record_no = file_hdr_->next_record_no_;
+            }
+        }
 
-//     // assert(transaction->get_deleted_page_set() != nullptr);
+        leaf_node->leaf_remove_records(pos, 1);
+        coalesce_or_redistribute(leaf_node, transaction, &root_is_latched);
+        if (on_delete) on_delete();
+    }
 
-//     if (leaf_should_delete) {
-//         transaction->append_index_deleted_page(leaf_page);
-//     }
+    if (root_is_latched) {
+        root_latch_.unlock();
+    }
+    unlock_unpin_pages(transaction);
+    leaf_page->WUnlatch();
+    buffer_pool_manager_->unpin_page(leaf_page->get_page_id(), found);
+    delete leaf_node;
+    // 被合并掉的结点在所有锁释放之后才处理
+    delete_pages(transaction);
+    if (next_record_pending) {
+        *next_record_no = upper_bound(raw_key).record_no;
+    }
+    return rid;
+}
 
-//     // NOTE: ensure deleted pages have been unpined
-//     // 删除并清空deleted page set
-//     if (transaction != nullptr) {
-//         for (Page *page : *transaction->get_index_deleted_page_set()) {
-//             buffer_pool_manager_->delete_page(page->get_page_id());
-//         }
-//         transaction->get_index_deleted_page_set()->clear();
-//     }
-//     // printf("\n");
-// }
+/**
+ * @brief 删除之后node的size小于min size时，与兄弟结点重分配或者合并
+ * 优先选择左兄弟，node是父结点的第一个孩子时选择右兄弟；两者的size之和不小于max size时重分配，否则合并
+ * 调用前node已经加了写锁，并且node不安全，所以查找时父结点一定已经加上了写锁，兄弟结点在这里加写锁
+ *
+ * @return node是否需要被删除(node作为右结点被合并到了左兄弟中，或者node是被替换的根结点)
+ * @note 被删除的结点会加入transaction的index_deleted_page_set，由调用者在释放锁之后删除
+ */
+bool IxIndexHandle::coalesce_or_redistribute(IxNodeHandle *node, Transaction *transaction, bool *root_is_latched) {
+    if (node->is_root_page()) {
+        return adjust_root(node, transaction);
+    }
+    if (node->get_size() >= node->get_min_size()) {
+        return false;
+    }
 
-// /**
-//  * @brief User needs to first find the sibling of input page. If sibling's size + input
-//  * page's size >= 2 * page's minsize, then redistribute. Otherwise, merge(coalesce).
-//  *
-//  * @return true means target leaf page(or its sibling) should be deleted, false means no deletion happens
-//  */
-// bool IxIndexHandle::coalesce_or_redistribute(IxNodeHandle *node, Transaction *transaction, bool *root_is_latched) {
-//     if (node->is_root_page()) {
-//         bool root_should_delete = adjust_root(node);
-
-//         // 疑问：此处必须要有？
-//         if (*root_is_latched) {
-//             *root_is_latched = false;
-//             root_latch_.unlock();
-//         }
-
-//         unlock_pages(transaction);
-
-//         return root_should_delete;  // NOTE: size of root page can be less than min size
-//     }
+    IxNodeHandle *parent = fetch_node(node->get_parent_page_no());
+    int index = parent->internal_find_child(node);
+    IxNodeHandle *neighbor_node = fetch_node(parent->internal_child_page_at(index == 0 ? 1 : index - 1));
+    neighbor_node->page_->WLatch();
 
-//     // 不需要合并或者重分配，直接返回false
-//     if (node->get_size() >= node->get_min_size()) {
-//         // 注意：此处不用root_latch_.unlock()
-//         unlock_pages(transaction);
-//         return false;
-//     }
+    bool node_should_delete = false;
+    if (node->get_size() + neighbor_node->get_size() >= node->get_max_size()) {
+        redistribute(neighbor_node, node, parent, index);
+    } else if (index == 0) {
+        coalesce(node, neighbor_node, parent, 1, transaction, root_is_latched);
+    } else {
+        coalesce(neighbor_node, node, parent, index, transaction, root_is_latched);
+        node_should_delete = true;
+    }
 
-//     // 需要合并或者重分配
-//     // 先获取node的parent page
-//     IxNodeHandle *parent = fetch_node(node->get_parent_page_no());
-//     Page *parent_page = parent->page;
-//     // printf("parent=%d\n", parent->get_page_no());
-
-//     // 获得node在parent的孩子指针(value)的index
-//     int index = parent->find_child(node);
-//     // 寻找兄弟结点，尽量找到前一个结点(前驱结点)
-//     page_id_t sibling_page_no = parent->value_at(index == 0 ? 1 : index - 1);
-//     IxNodeHandle *sibling_node = fetch_node(sibling_page_no);
-//     Page *sibling_page = sibling_node->page;
-
-//     sibling_page->WLatch();  // 记得要锁住兄弟结点
-
-//     // 1 redistribute 当kv总和能支撑两个Node，那么重新分配即可，不必删除node
-//     if (node->get_size() + sibling_node->get_size() >= node->get_min_size() * 2) {
-//         if (*root_is_latched) {
-//             *root_is_latched = false;
-//             root_latch_.unlock();
-//         }
-
-//         // printf("redistribute: node=%d sibling_node=%d\n", node->get_page_no(), sibling_node->get_page_no());
-//         redistribute(sibling_node, node, parent, index);  // 无返回值
-//         assert(sibling_node->get_size() >= sibling_node->get_min_size() && node->get_size() >= node->get_min_size());
-
-//         // printf("after node=%d redistribute:\n", node->get_page_no());
-//         // for (int i = 0; i < node->get_size(); i++) {
-//         //     printf("i=%d node->key(i)=%d\n", i, node->key_at(i));
-//         // }
-//         // for (int i = 0; i < sibling_node->get_size(); i++) {
-//         //     printf("i=%d sibling_node->key(i)=%d\n", i, sibling_node->key_at(i));
-//         // }
-//         // for (int i = 0; i < parent->get_size(); i++) {
-//         //     printf("i=%d parent->key(i)=%d\n", i, parent->key_at(i));
-//         // }
-//         // printf("\n");
-
-//         unlock_pages(transaction);
-//         buffer_pool_manager_->unpin_page(parent_page->get_page_id(), true);
-
-//         sibling_page->WUnlatch();
-//         buffer_pool_manager_->unpin_page(sibling_page->get_page_id(), true);
-
-//         return false;  // node不必被删除
-//     }
+    neighbor_node->page_->WUnlatch();
+    buffer_pool_manager_->unpin_page(neighbor_node->get_page_id(), true);
+    buffer_pool_manager_->unpin_page(parent->get_page_id(), true);
+    delete neighbor_node;
+    delete parent;
+    return node_should_delete;
+}
 
-//     // 2 coalesce 当sibling和node只能凑成一个Node，那么合并两个结点，将右边的结点合并到左边的结点
-//     // Coalesce函数继续递归调用CoalesceOrRedistribute
-//     // printf("coalesce: node=%d sibling_node=%d\n", node->get_page_no(), sibling_node->get_page_no());
-//     bool parent_should_delete =
-//         coalesce(&sibling_node, &node, &parent, index, transaction, root_is_latched);  // 返回parent是否需要被删除
-//     // 若index=0，则node在左边，所以要把右边的sibling_node合并到左边的node，将会删除sibling_node
-//     // 若index>0，则node在右边，所以要把右边的node合并到左边的sibling_node，将会删除node
-//     assert((index == 0 && sibling_node->get_size() == 0) || (index > 0 && node->get_size() == 0));
-//     // printf("after node=%d coalesce:\n", node->get_page_no());
-//     // for (int i = 0; i < node->get_size(); i++) {
-//     //     printf("i=%d node->key(i)=%d\n", i, node->key_at(i));
-//     // }
-//     // for (int i = 0; i < sibling_node->get_size(); i++) {
-//     //     printf("i=%d sibling_node->key(i)=%d\n", i, sibling_node->key_at(i));
-//     // }
-//     // for (int i = 0; i < parent->get_size(); i++) {
-//     //     printf("i=%d parent->key(i)=%d\n", i, parent->key_at(i));
-//     // }
-//     // printf("\n");
-
-//     assert((*root_is_latched) == false);
-
-//     if (parent_should_delete) {
-//         transaction->append_index_deleted_page(parent_page);
-//     }
+/**
+ * @brief 删除之后调整根结点
+ * case 1: 根结点是内部结点，且只剩下一个孩子，则把这个孩子作为新的根结点，旧的根结点被删除
+ * case 2: 根结点是叶结点，即使所有记录都被删除也保留，和新建的索引一致
+ *
+ * @return 旧的根结点是否需要被删除
+ */
+bool IxIndexHandle::adjust_root(IxNodeHandle *old_root_node, Transaction *transaction) {
+    if (old_root_node->is_leaf_page() || old_root_node->get_size() > 1) {
+        return false;
+    }
 
-//     // NOTE: parent unlock is finished in coalesce
-//     buffer_pool_manager_->unpin_page(parent_page->get_page_id(), true);
+    page_id_t child_page_no = old_root_node->internal_child_page_at(0);
+    IxNodeHandle *child = fetch_node(child_page_no);
+    child->set_parent_page_no(IX_NO_PAGE);
+    buffer_pool_manager_->unpin_page(child->get_page_id(), true);
+    delete child;
 
-//     sibling_page->WUnlatch();
-//     buffer_pool_manager_->unpin_page(sibling_page->get_page_id(), true);
+    // 旧的根结点持有写锁，乐观遍历在校验版本号时会发现根结点发生了变化
+    update_root_page_no(child_page_no);
+    transaction->append_index_deleted_page(old_root_node->page_);
+    return true;
+}
 
-//     // printf("coalesce_or_redistribute out!!\n");
+/**
+ * @brief 重分配node和neighbor_node的键值对，使两者的size大致相等，并更新父结点中右边结点的key
+ *
+ * @param index node在parent中的rank，index>0时neighbor_node是node的左兄弟，index=0时是右兄弟
+ */
+void IxIndexHandle::redistribute(IxNodeHandle *neighbor_node, IxNodeHandle *node, IxNodeHandle *parent, int index) {
+    int move_num = (neighbor_node->get_size() - node->get_size()) / 2;
+    if (index > 0) {
+        // neighbor_node的最后move_num个键值对移动到node的开头
+        int src_pos = neighbor_node->get_size() - move_num;
+        if (node->is_leaf_page()) {
+            node->leaf_move_records_from(0, neighbor_node, src_pos, move_num);
+        } else {
+            node->internal_insert_pairs(0, neighbor_node->internal_key_at(src_pos),
+                                        neighbor_node->internal_value_at(src_pos), move_num);
+            neighbor_node->internal_erase_pairs(src_pos, move_num);
+            for (int i = 0; i < move_num; i++) {
+                maintain_child(node, i);
+            }
+        }
+        parent->internal_set_key_at(index, node->get_key_at(0));
+    } else {
+        // neighbor_node的前move_num个键值对移动到node的末尾
+        int pos = node->get_size();
+        if (node->is_leaf_page()) {
+            node->leaf_move_records_from(pos, neighbor_node, 0, move_num);
+        } else {
+            node->internal_insert_pairs(pos, neighbor_node->internal_key_at(0), neighbor_node->internal_value_at(0),
+                                        move_num);
+            neighbor_node->internal_erase_pairs(0, move_num);
+            for (int i = pos; i < node->get_size(); i++) {
+                maintain_child(node, i);
+            }
+        }
+        parent->internal_set_key_at(1, neighbor_node->get_key_at(0));
+    }
+}
 
-//     return true;  // node需要被删除
-// }
+/**
+ * @brief 把right_node合并到left_node中，然后递归地维护父结点
+ *
+ * @param right_index right_node在parent中的rank，left_node是它的左兄弟
+ * @return parent是否需要被删除
+ */
+bool IxIndexHandle::coalesce(IxNodeHandle *left_node, IxNodeHandle *right_node, IxNodeHandle *parent,
+                             int right_index, Transaction *transaction, bool *root_is_latched) {
+    merge_nodes(left_node, right_node, parent, right_index, transaction);
+    return coalesce_or_redistribute(parent, transaction, root_is_latched);
+}
 
-// /**
-//  * @brief Update root page if necessary
-//  *
-//  * @note size of root page can be less than min size and this method is only called within coalesceOrRedistribute()
-//  * method
-//  * case 1: when you delete the last element in root page, but root page still as one last child
-//  * case 2: when you delete the last element in whole b+ tree
-//  * @return true means root page should be deleted, false means no deletion happend
-//  */
-// bool IxIndexHandle::adjust_root(IxNodeHandle *old_root_node) {
-//     // Case 1: old_root_node是内部结点，且大小为1。表示内部结点其实已经没有key了，所以要把它的孩子更新成新的根结点
-//     // old_root_node (internal node) has only one size
-//     if (!old_root_node->is_leaf_page() && old_root_node->get_size() == 1) {
-//         // get child page as new root page
-//         IxNodeHandle *internal_node = old_root_node;
-//         page_id_t child_page_no = internal_node->remove_and_return_only_child();
-
-//         // NOTE: don't need to unpin old_root_node, this operation will be done in coalesce_or_redistribute function
-
-//         // update root page
-//         update_root_page_no(child_page_no);
-
-//         // update parent page of new root node
-//         IxNodeHandle *new_root_node = fetch_node(file_hdr_->root_page_);
-//         Page *new_root_page = new_root_node->page;
-//         new_root_node->set_parent_page_no(IX_NO_PAGE);
-
-//         buffer_pool_manager_->unpin_page(new_root_page->get_page_id(), true);
-
-//         // NOTE THIS!
-//         release_node_handle(*old_root_node);  // DEBUG
-
-//         return true;
-//     }
-//     // 注意：这种case 2的情况，redbase没有考虑（只考虑了case 1），因为redbase不让产生空树
-//     // Case 2: old_root_node是叶结点，且大小为0。直接更新root page
-//     // all elements deleted from the B+ tree
-//     if (old_root_node->is_leaf_page() && old_root_node->get_size() == 0) {
-//         // NOTE: don't need to unpin old_root_node, this operation will be done in Remove function
-//         // assert(false);  // 测试时，暂时禁止空树的情况
+/**
+ * @brief 把right_node的所有键值对追加到left_node的末尾，从父结点和兄弟链表中删除right_node
+ * 叶结点的内容不会被清空，但是不能依赖它：pin住right_node的扫描会发现叶子的版本号变化，根据当前的key从根结点重新定位(见IxScan::locate)
+ */
+void IxIndexHandle::merge_nodes(IxNodeHandle *left_node, IxNodeHandle *right_node, IxNodeHandle *parent,
+                                int right_index, Transaction *transaction) {
+    if (left_node->is_leaf_page()) {
+        left_node->leaf_copy_records_from(left_node->get_size(), right_node, 0, right_node->get_size());
+        if (file_hdr_->last_leaf_ == right_node->get_page_no()) {
+            file_hdr_->last_leaf_ = left_node->get_page_no();
+        }
+    } else {
+        int pos = left_node->get_size();
+        left_node->internal_insert_pairs(pos, right_node->internal_key_at(0), right_node->internal_value_at(0),
+                                         right_node->get_size());
+        for (int i = pos; i < left_node->get_size(); i++) {
+            maintain_child(left_node, i);
+        }
+    }
+    unlink_node(right_node, left_node);
+    parent->internal_erase_pairs(right_index, 1);
+    transaction->append_index_deleted_page(right_node->page_);
+}
 
-//         // update root page
-//         // update_root_page_no(INVALID_PAGE_ID);
+// 从同一层的双向链表中删除node，与split一样，右边结点的prev_page_不加锁修改
+void IxIndexHandle::unlink_node(IxNodeHandle *node, IxNodeHandle *prev_node) {
+    prev_node->set_next_page(node->get_next_page());
+    if (node->get_next_page() != IX_NO_PAGE) {
+        IxNodeHandle *next = fetch_node(node->get_next_page());
+        next->set_prev_page(prev_node->get_page_no());
+        buffer_pool_manager_->unpin_page(next->get_page_id(), true);
+        delete next;
+    }
+}
 
-//         // NOTE THIS!
-//         // release_node_handle(*old_root_node);  // DEBUG
-//         // file_hdr_->num_pages++;
+// 被合并掉的结点不从buffer pool中删除，而是和普通页面一样由替换策略淘汰(脏页会被写回)：
+// 乐观遍历和IxScan可能已经读到了指向它的页号但还没有pin住，删除之后再fetch会从磁盘读取一个从未写入的页面。
+// 读到被合并掉的结点之后，父结点或者叶子的版本号校验会失败，从而重新查找
+// 页号不会被回收，file_hdr_->num_pages_也不减少
+void IxIndexHandle::delete_pages(Transaction *transaction) {
+    transaction->get_index_deleted_page_set()->clear();
+}
 
-//         // return true;
-//         return false;
-//     }
-//     // 否则不需要有page被删除，直接返回false
-//     return false;
-// }
+/**
+ * @brief 在线压缩：把从page_no开始、同一个父结点下的至多IX_COMPACT_MAX_WINDOW个叶子重新填充
+ * 每个叶子依次从右边的叶子的开头移动记录，直到达到fill factor，最后变空的叶子从父结点和叶子链表中删除；
+ * 最后一个非空的叶子如果少于min size，则与左兄弟合并或者重分配
+ * 只有能够减少叶子个数时才会修改索引。父结点的孩子数不会少于min size，父结点的第一个key也不会改变，
+ * 因此只需要对父结点加写锁，窗口中的叶子按照从左到右的顺序加写锁
+ *
+ * @param next_page_no 返回下一个需要检查的叶子
+ * @param on_compact 修改了索引时在释放写锁之前调用，参数为page_no
+ * @return 是否修改了索引
+ */
+bool IxIndexHandle::compact_leaf(page_id_t page_no, Transaction *transaction, page_id_t *next_page_no,
+                                 const std::function<void(page_id_t)> &on_compact) {
+    int max_num = file_hdr_->max_number_of_records_;
+    int fill_num = std::max(1, (int)(max_num * IX_COMPACT_FILL_FACTOR));
+    int trigger_num = (int)(max_num * IX_COMPACT_TRIGGER_FACTOR);
+
+    // 先不加写锁检查一次，跳过不需要压缩的叶子
+    char key[IX_MAX_COL_LEN];
+    IxNodeHandle *node = fetch_node(page_no);
+    node->page_->RLatch();
+    bool need_compact = node->is_leaf_page() && !node->is_root_page() && node->get_size() > 0 &&
+                        node->get_size() < trigger_num;
+    if (need_compact) {
+        memcpy(key, node->get_key_at(0), file_hdr_->col_tot_len_);
+    }
+    if (next_page_no != nullptr) {
+        *next_page_no = node->is_leaf_page() ? node->get_next_page() : IX_NO_PAGE;
+    }
+    node->page_->RUnlatch();
+    release_optimistic_node(node);
+    if (!need_compact) {
+        return false;
+    }
 
-// /**
-//  * @brief redistribute key & value pairs from one page to its sibling page. If index == 0, move sibling page's first key
-//  * & value pair into end of input "node", otherwise move sibling page's last key & value pair into head of input "node".
-//  *
-//  * @param neighbor_node sibling page of input "node"
-//  * @param node input from method coalesceOrRedistribute()
-//  * @param parent the parent of "node" and "neighbor_node"
-//  * @param index node在parent中的rid_idx
-//  * @note node是之前刚被删除过一个key的结点
-//  * index=0，则neighbor是node后继结点，表示：node(left)      neighbor(right)
-//  * index>0，则neighbor是node前驱结点，表示：neighbor(left)  node(right)
-//  * 注意更新parent结点的相关kv对
-//  */
-// void IxIndexHandle::redistribute(IxNodeHandle *neighbor_node, IxNodeHandle *node, IxNodeHandle *parent, int index) {
-//     if (index > 0) {
-//         // case 1: neighbor_node(left) and node(right)
-
-//         // 1.1 set node's first key to parent's index key
-//         // 注意这里只处理内部结点，因为内部结点的第一个key是无效的（叶子结点第一个key有效）
-//         // 注意：这里必须要写
-//         if (!node->is_leaf_page()) {
-//             node->set_key(0, parent->get_key(index));
-//         }
-
-//         // 1.2 move neighbor's last to node's front
-//         node->insert_pair(0, neighbor_node->get_key(neighbor_node->get_size() - 1),
-//                           *neighbor_node->get_rid(neighbor_node->get_size() - 1));
-//         neighbor_node->erase_pair(neighbor_node->get_size() - 1);
-
-//         // 1.3 set parent's index key to node's "new" first key
-//         parent->set_key(index, node->get_key(0));
-
-//         // 1.4 maintain child when node is internal page
-//         maintain_child(node, 0);
-//     } else if (index == 0) {
-//         // case 2: node(left) and neighbor_node(right)
-
-//         // 2.1 set neighbor's first key to parent's second key
-//         // 疑问：这里是不是可以不写？？
-//         if (!node->is_leaf_page()) {
-//             // assert(neighbor_node->get_key(0) == parent->get_key(1));  // DEBUG：这样就能测试要不要写了
-//             neighbor_node->set_key(0, parent->get_key(1));
-//         }
-
-//         // 2.2 move neighbor's first to node's end
-//         node->insert_pair(node->get_size(), neighbor_node->get_key(0), *neighbor_node->get_rid(0));
-//         neighbor_node->erase_pair(0);
-
-//         // 2.3 set parent's second key to neighbor's "new" first key
-//         parent->set_key(1, neighbor_node->get_key(0));
-
-//         // 2.4 maintain child when node is internal page
-//         maintain_child(node, node->get_size() - 1);
-//     }
-//     buffer_pool_manager_->unpin_page(parent->page->get_page_id(), true);
-// }
+    // COMPACT操作中叶结点总是不安全的，因此父结点会保留写锁
+    auto [leaf_node, root_is_latched] = find_leaf_page(key, Operation::COMPACT, transaction, false);
+    bool modified = false;
+    if (leaf_node->get_page_no() == page_no && !leaf_node->is_root_page()) {
+        IxNodeHandle *parent = fetch_node(leaf_node->get_parent_page_no());
+        int first = parent->internal_find_child(leaf_node);
+        int parent_min_size = parent->is_root_page() ? 2 : parent->get_min_size();
+
+        std::vector<IxNodeHandle *> leaves{leaf_node};
+        for (int i = first + 1; i < parent->get_size() && (int)leaves.size() < IX_COMPACT_MAX_WINDOW; i++) {
+            IxNodeHandle *right_node = fetch_node(parent->internal_child_page_at(i));
+            right_node->page_->WLatch();
+            leaves.push_back(right_node);
+        }
 
-// /**
-//  * @brief 合并(coalesce)函数是将node和其直接前驱进行合并，也就是和它左边的neighbor_node进行合并；
-//  * 假设node一定在右边。如果上层传入的index=0，说明node在左边，那么交换node和neighbor_node，保证node在右边；合并到左结点，实际上就是删除了右结点；
-//  * Move all the key & value pairs from one page to its sibling page, and notify buffer pool manager to delete this page.
-//  * Parent page must be adjusted to take info of deletion into account. Remember to deal with coalesce or redistribute
-//  * recursively if necessary.
-//  *
-//  * @param neighbor_node sibling page of input "node" (neighbor_node是node的前结点)
-//  * @param node input from method coalesceOrRedistribute() (node结点是需要被删除的)
-//  * @param parent parent page of input "node"
-//  * @param index node在parent中的rid_idx
-//  * @return true means parent node should be deleted, false means no deletion happend
-//  * @note Assume that *neighbor_node is the left sibling of *node (neighbor -> node)
-//  */
-// bool IxIndexHandle::coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node, IxNodeHandle **parent, int index,
-//                              Transaction *transaction, bool *root_is_latched) {
-//     // key_index表示 交换后的 node在parent中的rid_idx
-//     // 若index=0，说明node为neighbor前驱，要保证neighbor为node的前驱，则交换变量neighbor和node，且key_index=1
-//     // printf("coalesce index=%d\n", index);
-//     int key_index = index;
-//     if (index == 0) {
-//         // 保证neighbor_node为node的前驱
-//         std::swap(neighbor_node, node);  // 注意这里不要写成**node，否则调用此函数的传入参数**node也变了
-//         key_index = 1;
-//     }
+        // 先计算每个叶子压缩之后的记录数，如果不能减少叶子个数，或者父结点的孩子数会少于min size，则缩小窗口
+        std::vector<int> sizes;
+        int window = leaves.size();
+        int keep_num = window;
+        for (; window >= 2; window--) {
+            sizes.assign(window, 0);
+            for (int i = 0; i < window; i++) sizes[i] = leaves[i]->get_size();
+            for (int i = 0, j = 1; i < window; i++) {
+                for (j = std::max(j, i + 1); sizes[i] < fill_num && j < window; ) {
+                    int num = std::min(fill_num - sizes[i], sizes[j]);
+                    sizes[i] += num;
+                    sizes[j] -= num;
+                    if (sizes[j] == 0) j++;
+                }
+            }
+            keep_num = 0;
+            while (keep_num < window && sizes[keep_num] > 0) keep_num++;
+            if (keep_num > 1 && sizes[keep_num - 1] < leaves[0]->get_min_size() &&
+                sizes[keep_num - 2] + sizes[keep_num - 1] <= max_num) {
+                keep_num--;
+            }
+            if (keep_num < window && parent->get_size() - (window - keep_num) >= parent_min_size) {
+                break;
+            }
+        }
 
-//     // Maintain leaf list
-//     if ((*node)->is_leaf_page()) {
-//         erase_leaf(*node);
-//     }
-//     // Update global last leaf
-//     if (file_hdr_->last_leaf_ == (*node)->get_page_no()) {
-//         file_hdr_->last_leaf_ = (*neighbor_node)->get_page_no();
-//     }
+        if (window >= 2) {
+            modified = true;
+            // 按照计算的顺序移动记录
+            for (int i = 0, j = 1; i < keep_num; i++) {
+                for (j = std::max(j, i + 1); leaves[i]->get_size() < fill_num && j < window; ) {
+                    int num = std::min(fill_num - leaves[i]->get_size(), leaves[j]->get_size());
+                    leaves[i]->leaf_move_records_from(leaves[i]->get_size(), leaves[j], 0, num);
+                    if (leaves[j]->get_size() == 0) j++;
+                }
+            }
+            // 剩下的记录全部合并到最后一个保留的叶子中，变空的叶子从父结点中删除
+            for (int i = keep_num; i < window; i++) {
+                merge_nodes(leaves[keep_num - 1], leaves[i], parent, first + keep_num, transaction);
+            }
+            IxNodeHandle *last_node = leaves[keep_num - 1];
+            if (keep_num > 1 && last_node->get_size() < last_node->get_min_size()) {
+                redistribute(leaves[keep_num - 2], last_node, parent, first + keep_num - 1);
+            }
+            for (int i = 1; i < keep_num; i++) {
+                parent->internal_set_key_at(first + i, leaves[i]->get_key_at(0));
+            }
+            if (on_compact) on_compact(page_no);
+        }
 
-//     // 将当前node的第0个key 赋值为 父结点中下标为key_index的key
-//     // 这里应该是必须要写，因为相当于删除了第0个key
-//     // printf("node=%d (*parent)->get_key(key_index)=%d\n", (*node)->get_page_no(), *(int
-//     // *)(*parent)->get_key(key_index));
-//     if (!(*node)->is_leaf_page()) {
-//         (*node)->set_key(0, (*parent)->get_key(key_index));
-//     }
+        if (next_page_no != nullptr) {
+            *next_page_no = leaves[window >= 2 ? keep_num - 1 : 0]->get_next_page();
+        }
+        for (int i = 1; i < (int)leaves.size(); i++) {
+            leaves[i]->page_->WUnlatch();
+            buffer_pool_manager_->unpin_page(leaves[i]->get_page_id(), modified);
+            delete leaves[i];
+        }
+        buffer_pool_manager_->unpin_page(parent->get_page_id(), modified);
+        delete parent;
+    }
 
-//     // Move all pairs from node to neighbor_node
-//     int node_size = (*node)->get_size();
-//     for (int i = 0; i < node_size; i++) {
-//         (*neighbor_node)->insert_pair((*neighbor_node)->get_size(), (*node)->get_key(0), *(*node)->get_rid(0));
-//         maintain_child(*neighbor_node, (*neighbor_node)->get_size() - 1);
-//         (*node)->erase_pair(0);
-//     }
+    if (root_is_latched) {
+        root_latch_.unlock();
+    }
+    unlock_unpin_pages(transaction);
+    leaf_node->page_->WUnlatch();
+    buffer_pool_manager_->unpin_page(leaf_node->get_page_id(), modified);
+    delete leaf_node;
+    delete_pages(transaction);
+    return modified;
+}
 
-//     // Free node
-//     release_node_handle(**node);
+std::vector<page_id_t> IxIndexHandle::compact_leaves(Transaction *transaction, int max_compact_num,
+                                                     const std::function<void(page_id_t)> &on_compact) {
+    std::vector<page_id_t> compacted_pages;
+    page_id_t page_no = file_hdr_->first_leaf_;
+    while (page_no != IX_NO_PAGE && (int)compacted_pages.size() < max_compact_num) {
+        page_id_t next_page_no = IX_NO_PAGE;
+        if (compact_leaf(page_no, transaction, &next_page_no, on_compact)) {
+            compacted_pages.push_back(page_no);
+        }
+        page_no = next_page_no;
+    }
+    return compacted_pages;
+}
 
-//     // 删除node在parent中的kv信息
-//     (*parent)->erase_pair(key_index);  // 注意，是key_index，不是index
+void IxIndexHandle::replay_delete_entry(const char *key) {
+    auto txn_empty = std::make_unique<Transaction>(0);
+    Rid rid = delete_entry(key, txn_empty.get());
+    if (rid.page_no == INVALID_PAGE_ID) {
+        std::cout << "Error: replay delete key is not found!\n";
+    }
+}
 
-//     // 因为parent中删除了kv对，所以递归调用CoalesceOrRedistribute函数判断parent结点是否需要被删除
-//     return coalesce_or_redistribute(*parent, transaction, root_is_latched);
-// }
+void IxIndexHandle::replay_compact_leaf(page_id_t page_no) {
+    auto txn_empty = std::make_unique<Transaction>(0);
+    compact_leaf(page_no, txn_empty.get());
+}
 
 // 注意：不能把iid的作用删掉！iid和rid存的不是一个东西，rid是上层传过来的记录位置，iid是索引内部生成的索引槽位置
 // 这里把iid转换成了rid，即iid的slot_no作为node的rid_idx(key_idx)
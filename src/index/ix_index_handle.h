@@ -1,23 +1,29 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
+
 #include "record/record.h"
 #include "common/context.h"
 #include "ix_node_handle.h"
 #include "transaction/transaction.h"
 #include "multi_version/multi_version_manager.h"
 
-enum class Operation { FIND = 0, INSERT, DELETE };  // 三种操作：查找、插入、删除
+enum class Operation { FIND = 0, INSERT, DELETE, COMPACT, UPDATE };  // 查找、插入、删除、合并相邻叶子、原地修改记录
 
 static const bool binary_search = false;
 
 
 /**
  * the internal pages of the index are always in memory
+ * insert_entry/lower_bound/upper_bound等对外接口传入的是原始的字段值，在入口处编码为规范化的key(见IxFileHdr::encode_key)，
+ * find_leaf_page等内部函数以及IxNodeHandle中使用的都是规范化的key
  * */ 
 class IxIndexHandle {
     friend class IxScan;
     // friend class My_IxScan;  // TEST
     friend class IxManager;
+    friend class IxBulkLoader;
 
    private:
     DiskManager *disk_manager_;
@@ -25,6 +31,7 @@ class IxIndexHandle {
     int fd_;                
     IxFileHdr* file_hdr_;  // 存了root_page，但其初始化为2（第0页存FILE_HDR_PAGE，第1页存LEAF_HEADER_PAGE）
     std::mutex root_latch_;
+    std::atomic<page_id_t> last_insert_leaf_{IX_NO_PAGE};  // 上一次插入所在的叶子，用于追加插入的快速路径
     TabMeta table_meta_;                       // used for table scan and record operations
 
    public:
@@ -37,44 +44,82 @@ class IxIndexHandle {
     // for test
     int32_t get_next_record_no() { return file_hdr_->next_record_no_; }
 
+    // buffer pool中使用的PageId::table_id
+    int get_table_id() const { return table_meta_.table_id_; }
+
     // used for scan
     std::unique_ptr<Record> get_record(const Rid& rid, Context* context);
 
+    // 插入、purge、分裂和压缩都会移动叶子中的记录，语句中保存的Rid可能已经失效，以下接口按照主键重新定位记录
+    // 在叶子的读锁下拷贝主键对应的记录，rid返回记录当前的位置，记录不存在时返回nullptr
+    std::unique_ptr<Record> get_record(const char* key, Rid* rid);
+
+    // 在主键对应记录所在叶子的写锁下调用op，参数为记录在叶子中的地址和记录当前的Rid，日志需要在op中生成
+    // record_no不为-1时要求记录的record_no与之一致，记录不存在时返回false
+    bool modify_record(const char* key, int32_t record_no, const std::function<void(char*, const Rid&)> &op);
+
     // used for insert
-    Rid insert_record(const char* key, char* record, Context* context);
+    // on_insert在插入成功之后、插入的叶子释放写锁之前调用，用于生成日志
+    Rid insert_record(const char* key, char* record, Context* context,
+                      const std::function<void(const Rid&)> &on_insert = nullptr);
 
     // used for log replay 
     // 日志回放是串行执行，这里我就不加锁了context设置为nullptr
     void replay_insert_record(Rid rid, const char *key, char *record, Context *context = nullptr);
 
-    void delete_record(const Rid& rid, Context* context);
+    void replay_delete_entry(const char *key);
 
-    void rollback_delete_record(const Rid& rid, Context* context);
+    void replay_compact_leaf(page_id_t page_no);
 
-    void update_record(const Rid& rid, char* raw_data, Context* context);
+    // 按照物理日志中修改的字段更新记录，ranges: 字段在记录数据部分中的偏移 -> 新的取值
+    void replay_update_record(const Rid& rid, const std::vector<std::pair<int, std::string>>& ranges);
+
+    void delete_record(const Rid& rid, Context* context);
     
     // for search
     std::pair<IxNodeHandle *, bool> find_leaf_page(const char *key, Operation operation, Transaction *transaction,
                                                  bool find_first = false);
 
+    IxNodeHandle *find_leaf_page_optimistic(const char *key, Operation operation, bool find_first = false);
+
     // for insert
-    Rid insert_entry(const char* key, const char* record_value, Transaction *transaction);
+    // key已经存在时返回的page_no为INVALID_PAGE_ID，此时不调用on_insert
+    // on_insert在插入成功之后、插入的叶子释放写锁之前调用，日志的顺序与叶子上的修改顺序一致
+    Rid insert_entry(const char* key, const char* record_value, Transaction *transaction,
+                     const std::function<void(const Rid&)> &on_insert = nullptr);
 
-    IxNodeHandle *split(IxNodeHandle *node);
+    // append为true表示node是最右侧的结点且新插入的key位于末尾，此时左结点保留IX_APPEND_SPLIT_FILL_FACTOR的数据
+    IxNodeHandle *split(IxNodeHandle *node, bool append = false);
 
-    void insert_into_parent(IxNodeHandle *old_node, const char *key, IxNodeHandle *new_node, Transaction *transaction);
+    void insert_into_parent(IxNodeHandle *old_node, const char *key, IxNodeHandle *new_node, Transaction *transaction,
+                            bool append = false);
 
     // for delete
-    // void delete_entry(const char *key, const Rid &value, Transaction *transaction);
+    // 物理删除key对应的记录，返回被删除记录的Rid，key不存在时返回的page_no为INVALID_PAGE_ID
+    // next_record_no返回被删除记录的下一条记录的record_no，用于锁的继承
+    // on_delete在删除成功之后、被修改的结点释放写锁之前调用，用于生成日志
+    Rid delete_entry(const char *key, Transaction *transaction, int32_t *next_record_no = nullptr,
+                     const std::function<void()> &on_delete = nullptr);
+
+    bool coalesce_or_redistribute(IxNodeHandle *node, Transaction *transaction, bool *root_is_latched);
+
+    bool adjust_root(IxNodeHandle *old_root_node, Transaction *transaction);
 
-    // bool coalesce_or_redistribute(IxNodeHandle *node, Transaction *transaction = nullptr,
-    //                             bool *root_is_latched = nullptr);
-    // bool adjust_root(IxNodeHandle *old_root_node);
+    void redistribute(IxNodeHandle *neighbor_node, IxNodeHandle *node, IxNodeHandle *parent, int index);
 
-    // void redistribute(IxNodeHandle *neighbor_node, IxNodeHandle *node, IxNodeHandle *parent, int index);
+    bool coalesce(IxNodeHandle *left_node, IxNodeHandle *right_node, IxNodeHandle *parent, int right_index,
+                  Transaction *transaction, bool *root_is_latched);
 
-    // bool coalesce(IxNodeHandle **neighbor_node, IxNodeHandle **node, IxNodeHandle **parent, int index,
-    //               Transaction *transaction, bool *root_is_latched);
+    // for online compaction
+    // 从page_no开始，把同一个父结点下过于稀疏的叶子按照IX_COMPACT_FILL_FACTOR重新填充，必要时合并相邻叶子
+    // next_page_no返回下一个需要检查的叶子，on_compact在修改之后、叶子和父结点释放写锁之前调用
+    bool compact_leaf(page_id_t page_no, Transaction *transaction, page_id_t *next_page_no = nullptr,
+                      const std::function<void(page_id_t)> &on_compact = nullptr);
+
+    // 遍历所有叶子进行压缩，返回发生了修改的compact_leaf的起始页面，最多max_compact_num个
+    // on_compact在每次修改的叶子释放写锁之前调用，用于生成日志
+    std::vector<page_id_t> compact_leaves(Transaction *transaction, int max_compact_num,
+                                          const std::function<void(page_id_t)> &on_compact = nullptr);
 
     // used for execution
     Rid lower_bound(const char *key);
@@ -104,7 +149,18 @@ class IxIndexHandle {
 
     void unlock_unpin_pages(Transaction *transaction);
 
-    bool is_safe(IxNodeHandle *node, Operation op);
+    bool is_safe(IxNodeHandle *node, Operation op, const char *key = nullptr);
+
+    // 追加插入的快速路径：key大于缓存的最右叶子的最大key且插入后不需要分裂时，返回加了写锁的该叶子，否则返回nullptr
+    IxNodeHandle *find_append_leaf_page(const char *key);
+
+    void release_optimistic_node(IxNodeHandle *node);
+
+    // 持有leaf的锁时读取右兄弟第一条记录的record_no，不等待右兄弟的锁，右兄弟一直被写者持有时返回false
+    bool read_next_leaf_first_record_no(IxNodeHandle *leaf, int32_t *record_no);
+
+    // 找到主键对应的记录所在的叶子(FIND加读锁，UPDATE加写锁)，记录不存在时释放叶子并返回nullptr
+    IxNodeHandle *find_record_leaf(const char *raw_key, Operation operation, Rid *rid);
 
     // for get/create node
     IxNodeHandle *fetch_node(int page_no) const;
@@ -114,10 +170,15 @@ class IxIndexHandle {
     // for maintain data structure
     void maintain_parent(IxNodeHandle *node);
 
-    // void erase_leaf(IxNodeHandle *leaf);
-
     void release_node_handle(IxNodeHandle &node);
 
+    void merge_nodes(IxNodeHandle *left_node, IxNodeHandle *right_node, IxNodeHandle *parent, int right_index,
+                     Transaction *transaction);
+
+    void unlink_node(IxNodeHandle *node, IxNodeHandle *prev_node);
+
+    void delete_pages(Transaction *transaction);
+
     void maintain_child(IxNodeHandle *node, int child_idx);
 
     // for index test
@@ -48,7 +48,14 @@ class IxManager {
     }
 
     void create_index(const std::string &filename, const std::vector<ColMeta>& index_cols, const TabMeta& table_meta) {
-        std::string ix_name = get_index_name(filename, index_cols);
+        create_index_file(get_index_name(filename, index_cols), index_cols, table_meta);
+    }
+
+    /**
+     * @description: 创建名为ix_name的索引文件，key由key_cols组成，叶子中记录的长度为table_meta.record_length_ + sizeof(RecordHdr)
+     * 二级索引的文件名只包含二级索引字段，而key还包含主键字段，因此需要单独指定文件名
+     */
+    void create_index_file(const std::string &ix_name, const std::vector<ColMeta>& key_cols, const TabMeta& table_meta) {
         // Create index file
         disk_manager_->create_file(ix_name);
         // Open index file
@@ -60,8 +67,8 @@ class IxManager {
         // but we reserve one slot for convenient inserting and deleting, i.e.
         // |page_hdr| + (|attr| + |rid|) * (n + 1) <= PAGE_SIZE
         int col_tot_len = 0;
-        int col_num = index_cols.size();
-        for(auto& col: index_cols) {
+        int col_num = key_cols.size();
+        for(auto& col: key_cols) {
             col_tot_len += col.len;
         }
         if (col_tot_len > IX_MAX_COL_LEN) {
@@ -82,8 +89,8 @@ class IxManager {
                                 col_num, col_tot_len, btree_order, (btree_order + 1) * col_tot_len, record_len,
                                 max_number_of_records, IX_INIT_ROOT_PAGE, IX_INIT_ROOT_PAGE, 0);
         for(int i = 0; i < col_num; ++i) {
-            fhdr->col_types_.push_back(index_cols[i].type);
-            fhdr->col_lens_.push_back(index_cols[i].len);
+            fhdr->col_types_.push_back(key_cols[i].type);
+            fhdr->col_lens_.push_back(key_cols[i].len);
         }
         fhdr->update_tot_len();
         
@@ -149,7 +156,11 @@ class IxManager {
     }
 
     std::unique_ptr<IxIndexHandle> open_index(const std::string &filename, const std::vector<std::string>& index_cols, const TabMeta& table_meta) {
-        std::string ix_name = get_index_name(filename, index_cols);
+        return open_index_file(get_index_name(filename, index_cols), table_meta);
+    }
+
+    // 打开名为ix_name的索引文件，文件使用table_meta.table_id_作为PageId中的table_id
+    std::unique_ptr<IxIndexHandle> open_index_file(const std::string &ix_name, const TabMeta& table_meta) {
         int fd = disk_manager_->open_file(ix_name);
         disk_manager_->set_table_fd(table_meta.table_id_, fd);
         // std::cout << "set table " << table_meta.table_id_ << "'s fd as " << fd << "\n";
@@ -160,6 +171,9 @@ class IxManager {
     void close_index(const IxIndexHandle *ih) {
         // 由于在更新file_hdr的时候直接更新的数据结构，没有更新页面，所以要最后把数据结构写到页面中
         Page* page = buffer_pool_manager_->fetch_page(PageId{.table_id = ih->table_meta_.table_id_, .page_no = IX_FILE_HDR_PAGE});
+        if (page == nullptr) {
+            throw InternalError("IxManager::close_index: failed to fetch the file header");
+        }
         ih->file_hdr_->serialize(page->get_data());
         buffer_pool_manager_->unpin_page(PageId{.table_id = ih->table_meta_.table_id_, .page_no = IX_FILE_HDR_PAGE}, true);
 
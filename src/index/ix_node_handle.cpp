@@ -14,7 +14,7 @@ int IxNodeHandle::internal_upper_bound(const char *target) {
     while (low < high) {
         int mid = (low + high) / 2;
         char *key_addr = internal_key_at(mid);
-        if (ix_compare(target, key_addr, file_hdr_->col_types_, file_hdr_->col_lens_) < 0) {
+        if (ix_key_compare(target, key_addr, file_hdr_->col_tot_len_) < 0) {
             high = mid;
         } else {
             low = mid + 1;
@@ -28,7 +28,7 @@ int IxNodeHandle::internal_lower_bound(const char *target) {
     while (low < high) {
         int mid = (low + high) / 2;
         char *key_addr = internal_key_at(mid);
-        if (ix_compare(target, key_addr, file_hdr_->col_types_, file_hdr_->col_lens_) <= 0) {
+        if (ix_key_compare(target, key_addr, file_hdr_->col_tot_len_) <= 0) {
             // target<=key_addr，说明key_addr还需要变小
             high = mid;
         } else {
@@ -66,6 +66,21 @@ void IxNodeHandle::internal_insert_pairs(int pos, const char* key, const char* c
     page_hdr_->num_key_ += n;
 }
 
+/**
+ * @brief 删除[pos,pos+n)位置上的key和孩子指针
+ */
+void IxNodeHandle::internal_erase_pairs(int pos, int n) {
+    assert(pos >= 0 && pos + n <= page_hdr_->num_key_);
+
+    char *key_slot = internal_key_at(pos);
+    memmove(key_slot, key_slot + n * file_hdr_->col_tot_len_, (page_hdr_->num_key_ - pos - n) * file_hdr_->col_tot_len_);
+
+    char* child_slot = internal_value_at(pos);
+    memmove(child_slot, child_slot + n * sizeof(page_id_t), (page_hdr_->num_key_ - pos - n) * sizeof(page_id_t));
+
+    page_hdr_->num_key_ -= n;
+}
+
 // 此函数由parent调用，寻找child，返回child在parent中的rid_idx∈[0,page_hdr->num_key)
 int IxNodeHandle::internal_find_child(IxNodeHandle *child) {
     // printf("node=%d  child=%d\n", get_page_no(), child->get_page_no());
@@ -145,11 +160,12 @@ void IxNodeHandle::leaf_insert_continous_records(int pos, const char* extern_pag
         */
         to_insert_record = extern_page_record + *(int32_t*) to_insert_record;
     }
+    // the free space starts after the last inserted record
+    page_hdr_->free_space_offset_ += file_hdr_->record_len_;
 
     if(page_hdr_->tot_num_records_ - pos > 0) {
-        // update the next_record_offset of the last inserted record
-        // *(int32_t*)prev_record = *(int32_t*)(directory_slot + directory_size + file_hdr_->col_tot_len_);
-        *(int32_t*)prev_record = *(int32_t*)(directory_slot + file_hdr_->col_tot_len_);
+        // update the next_record_offset of the last inserted record, directory_slot points to the last inserted entry
+        *(int32_t*)prev_record = *(int32_t*)(directory_slot + directory_size + file_hdr_->col_tot_len_);
     }
     else {
         // the last record, set the next_record_offset to -1
@@ -159,12 +175,71 @@ void IxNodeHandle::leaf_insert_continous_records(int pos, const char* extern_pag
     page_hdr_->tot_num_records_ += record_number;
 }
 
+void IxNodeHandle::leaf_copy_records_from(int pos, IxNodeHandle* src, int src_pos, int record_number) {
+    if(record_number == 0) return;
+    // leaf_insert_continous_records writes the records into the free space continously
+    if(page_hdr_->first_deleted_offset_ != INVALID_OFFSET || page_hdr_->free_space_offset_ == INVALID_OFFSET ||
+        page_hdr_->free_space_offset_ + record_number * file_hdr_->record_len_ > (file_hdr_->max_number_of_records_ + 1) * file_hdr_->record_len_) {
+        leaf_compact();
+    }
+    leaf_insert_continous_records(pos, src->records_, src->leaf_get_directory_entry_at(src_pos), record_number);
+}
+
+void IxNodeHandle::leaf_move_records_from(int pos, IxNodeHandle* src, int src_pos, int record_number) {
+    leaf_copy_records_from(pos, src, src_pos, record_number);
+    src->leaf_remove_records(src_pos, record_number);
+}
+
+void IxNodeHandle::leaf_remove_records(int pos, int record_number) {
+    assert(pos >= 0 && pos + record_number <= page_hdr_->tot_num_records_);
+    if(record_number == 0) return;
+
+    int directory_size = file_hdr_->col_tot_len_ + sizeof(int32_t);
+    // the record after the removed records, its offset will be the next_record_offset of the record at pos-1
+    int32_t next_record_offset = INVALID_OFFSET;
+    if(pos + record_number < page_hdr_->tot_num_records_) {
+        next_record_offset = *(int32_t*)(leaf_get_directory_entry_at(pos + record_number) + file_hdr_->col_tot_len_);
+    }
+    if(pos > 0) {
+        int32_t prev_record_offset = *(int32_t*)(leaf_get_directory_entry_at(pos - 1) + file_hdr_->col_tot_len_);
+        *(int32_t*)(records_ + prev_record_offset) = next_record_offset;
+    }
+
+    // push the slots of removed records to the deleted slots
+    for(int i = pos; i < pos + record_number; ++i) {
+        int32_t offset = *(int32_t*)(leaf_get_directory_entry_at(i) + file_hdr_->col_tot_len_);
+        *(int32_t*)(records_ + offset) = page_hdr_->first_deleted_offset_;
+        page_hdr_->first_deleted_offset_ = offset;
+    }
+
+    char* directory_slot = leaf_get_directory_entry_at(pos);
+    memmove(directory_slot, directory_slot + record_number * directory_size, (page_hdr_->tot_num_records_ - pos - record_number) * directory_size);
+    page_hdr_->tot_num_records_ -= record_number;
+}
+
+void IxNodeHandle::leaf_compact() {
+    int tot_num = page_hdr_->tot_num_records_;
+    int record_len = file_hdr_->record_len_;
+    std::vector<char> buf(tot_num * record_len);
+    for(int i = 0; i < tot_num; ++i) {
+        int32_t* offset = (int32_t*)(leaf_get_directory_entry_at(i) + file_hdr_->col_tot_len_);
+        memcpy(buf.data() + i * record_len, records_ + *offset, record_len);
+        *offset = i * record_len;
+    }
+    memcpy(records_, buf.data(), tot_num * record_len);
+    for(int i = 0; i < tot_num; ++i) {
+        *(int32_t*)(records_ + i * record_len) = (i == tot_num - 1) ? INVALID_OFFSET : (i + 1) * record_len;
+    }
+    page_hdr_->free_space_offset_ = tot_num * record_len;
+    page_hdr_->first_deleted_offset_ = INVALID_OFFSET;
+}
+
 int IxNodeHandle::leaf_directory_lower_bound(const char* target) {
     int low = 0, high = page_hdr_->tot_num_records_;
     while(low < high) {
         int mid = (low + high) >> 1;
         char* dir_entry_addr = leaf_get_directory_entry_at(mid);
-        if(ix_compare(target, dir_entry_addr, file_hdr_->col_types_, file_hdr_->col_lens_) <= 0) {
+        if(ix_key_compare(target, dir_entry_addr, file_hdr_->col_tot_len_) <= 0) {
             high = mid;
         }
         else {
@@ -179,7 +254,7 @@ int IxNodeHandle::leaf_directory_upper_bound(const char* target) {
     while(low < high) {
         int mid = (low + high) >> 1;
         char* dir_entry_addr = leaf_get_directory_entry_at(mid);
-        if(ix_compare(target, dir_entry_addr, file_hdr_->col_types_, file_hdr_->col_lens_) < 0) {
+        if(ix_key_compare(target, dir_entry_addr, file_hdr_->col_tot_len_) < 0) {
             high = mid;
         }
         else {
@@ -203,7 +278,7 @@ int IxNodeHandle::leaf_insert_key_record(const char* key, const char* record_val
     */
     // 插入的key已经存在
     if(insert_index < page_hdr_->tot_num_records_ &&
-        ix_compare(insert_dir_entry_slot, key, file_hdr_->col_types_, file_hdr_->col_lens_) == 0) {
+        ix_key_compare(insert_dir_entry_slot, key, file_hdr_->col_tot_len_) == 0) {
         // if()
         std::cout << "Error: the key has already existed in the leaf node!\n";
         // assert(0);
@@ -240,6 +315,9 @@ int IxNodeHandle::leaf_insert_key_record(const char* key, const char* record_val
         int32_t next_record_offset = *(int32_t*)(leaf_get_directory_entry_at(insert_index + 1) + file_hdr_->col_tot_len_);
         *(int32_t*)record_insert_slot = next_record_offset;
     }
+    else {
+        *(int32_t*)record_insert_slot = INVALID_OFFSET;
+    }
 
     // update current record's record_no_
     *(int32_t*)(record_insert_slot + RECHDR_RECORD_NO_LOCATION) = file_hdr_->next_record_no_ ++;
@@ -15,9 +15,6 @@ static int ix_compare(const char *a, const char *b, ColType type, int col_len) {
             return (fa < fb) ? -1 : ((fa > fb) ? 1 : 0);
         }
         case TYPE_STRING: {
-            std::string a_str(a, col_len);
-            std::string b_str(b, col_len);
-            // std::cout << "ix_compare: a_str: " << a_str << ", b_str: "  << b_str << "\n";
             return memcmp(a, b, col_len);
         }
         default:
@@ -59,6 +56,7 @@ static int ix_compare(const char *a, const char *b, ColType type, int col_len) {
 class IxNodeHandle {
     friend class IxIndexHandle;
     friend class IxScan;
+    friend class IxBulkLoader;
 
    private:
     IxFileHdr* file_hdr_;         // the pointer to the index file's header, which is always in cache
@@ -187,6 +185,8 @@ public:
 
     void internal_insert_pairs(int pos, const char* key, const char* children, int n);
 
+    void internal_erase_pairs(int pos, int n);
+
     int internal_find_child(IxNodeHandle *child);
 
     /**
@@ -217,8 +217,10 @@ public:
      * The free_space_offset in page header is initiated as sizeof(IxPageHdr).
      * The first_deleted_offset in page header is initiated as INVALID_OFFSET.
      * When a split operation is required, the first_deleted_offset will point to the first
-     * record that moves to another page. When a record is inserted to the first_deleted_offset, then
-     * the first_deleted_offset will point to the next_record_offset of the first deleted record.
+     * record that moves to another page. When a record is removed from the page, its slot is pushed to
+     * the front of the deleted slots. The deleted slots are linked by their next_record_offset, 
+     * when a record is inserted to the first_deleted_offset, then the first_deleted_offset will point to
+     * the next_record_offset of the first deleted record.
     */
     void leaf_update_insert_offset() {
         if(page_hdr_->first_deleted_offset_ == INVALID_OFFSET) {
@@ -227,7 +229,7 @@ public:
             // puts("get insert offset from free space");
         }
         else {
-            int32_t next_delete_offset = page_hdr_->first_deleted_offset_;
+            int32_t next_delete_offset = *(int32_t*)(records_ + page_hdr_->first_deleted_offset_);
             page_hdr_->first_deleted_offset_ = next_delete_offset;
             // puts("get insert offset from deleted space");
         }
@@ -236,6 +238,18 @@ public:
     // used for LeafPage's split operation, insert multiple continous records
     void leaf_insert_continous_records(int pos, const char* extern_page_record, const char* begin_directory, int record_number);
 
+    // used for merge, copy the records [src_pos, src_pos + record_number) of src to the pos slot of this page, src is not modified
+    void leaf_copy_records_from(int pos, IxNodeHandle* src, int src_pos, int record_number);
+
+    // used for merge and redistribute, move the records [src_pos, src_pos + record_number) of src to the pos slot of this page
+    void leaf_move_records_from(int pos, IxNodeHandle* src, int src_pos, int record_number);
+
+    // remove the records [pos, pos + record_number) from the page, their slots are pushed to the deleted slots
+    void leaf_remove_records(int pos, int record_number);
+
+    // rewrite the records in the order of page_directory, and make the free space continous
+    void leaf_compact();
+
     // used for leaf page to find the specific record
     char* leaf_get_record_at(int i) {
         // std::cout << "leaf_get_record_at: " << i << "\n";
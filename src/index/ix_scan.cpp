@@ -1,5 +1,6 @@
 #include "ix_scan.h"
 
+#include <algorithm>
 #include <cstdlib> // for abort
 
 
@@ -16,48 +17,262 @@
     } while (false)
 
 /**
- * @brief 
- * @todo 加上读锁（需要使用缓冲池得到page）
+ * @description: 游标移动到下一条记录。只把rid_移动到key_之后的位置，是否进入下一个叶子以及叶子被修改之后的重新定位由locate完成。
+ *              调用者看到的是上一次校验时的key_，即使它已经被物理删除，也要移动到它之后的记录，因此这里不重新校验
  */
 void IxScan::next() {
-    // assert(!is_end());
-    IxNodeHandle *node = ih_->fetch_node(rid_.page_no);
-    // if(node->get_next_page() - node->get_page_no() <= 0) {
-    //     if(!(node->get_page_no() == node->file_hdr_->last_leaf_ && node->get_next_page() == IX_NO_PAGE)) {
-    //         std::string str = "Invalid next_page value: node->get_page_no(): " + std::to_string(node->get_page_no()) + ", node->get_next_page(): " + std::to_string(node->get_next_page()) + '\n';
-    //         std::cout << str;
-    //         assert(0);
-    //     }
-    // }
-    // if(node->get_prev_page() - node->get_page_no() >= 0) {
-    //     std::string str = "Invalid prev_page value: node->get_page_no(): " + std::to_string(node->get_page_no()) + ", node->get_prev_page(): " + std::to_string(node->get_prev_page()) + '\n';
-    //     std::cout << str;
-    //     assert(0);
-    // }
-    // assert(node->get_page_no() == rid_.page_no);
-    // assert(node->is_leaf_page());
-    // used for test
-    // assert(rid_.slot_no < node->get_size());
-    // ASSERT(rid_.slot_no < node->get_size(), "rid_.slot_no: " + std::to_string(rid_.slot_no) + ", node->get_size(): " + std::to_string(node->get_size()) + ", node->page_id: " << std::to_string(node->get_page_id().page_no));
-    // increment slot no
-    rid_.slot_no++;
-    if (rid_.page_no != ih_->file_hdr_->last_leaf_ && rid_.slot_no == node->get_size()) {
-        // go to next leaf
-        rid_.slot_no = 0;
-        // std::cout << "Page1 [" << rid_.page_no<< "] is full, go to next page [" << node->get_page_no() << "].\n";
-        rid_.page_no = node->get_next_page();
-        // std::cout << "Page2 [" << node->get_page_no() << "] is full, go to next page [" << rid_.page_no << "].\n";
-    }
-    ih_->buffer_pool_manager_->unpin_page(node->get_page_id(), false);
+    if (!has_key_ || past_key_) {
+        locate();
+    }
+    if (!at_end_) {
+        rid_.slot_no++;
+        past_key_ = true;
+    }
+}
+
+/**
+ * @description: 把范围扫描的终点end_转换为key。end_位于叶子末尾时，终点是下一个叶子的第一条记录；
+ *              end_之后没有记录时(leaf_end)不设置终点，扫描到最后一个叶子的末尾
+ */
+void IxScan::init_end_key() {
+    page_id_t page_no = end_.page_no;
+    int slot_no = end_.slot_no;
+    while (page_no != IX_NO_PAGE && !has_end_key_) {
+        IxNodeHandle* node = ih_->fetch_node(page_no);
+        node->page_->RLatch();
+        if (slot_no < node->get_size()) {
+            memcpy(end_key_, node->get_key_at(slot_no), ih_->file_hdr_->col_tot_len_);
+            has_end_key_ = true;
+        }
+        page_no = node->get_next_page();
+        slot_no = 0;
+        node->page_->RUnlatch();
+        ih_->release_optimistic_node(node);
+    }
+}
+
+/**
+ * @description: 校验游标的位置，使rid_指向一条记录或者最后一个叶子的末尾，并更新key_和rid_.record_no。
+ *              叶子的版本号与上一次校验时相同说明其中的记录没有被移动过，否则根据key_从根结点重新定位
+ */
+void IxScan::locate() {
+    // 上一次校验之后游标没有移动，叶子也没有被修改，不需要加锁
+    if (leaf_pinned_ && has_key_ && !past_key_ && leaf_.get_page_no() == rid_.page_no) {
+        uint64_t version;
+        if (leaf_.page_->optimistic_read(&version) && version == leaf_version_) {
+            return;
+        }
+    }
+
+    IxNodeHandle* leaf = fetch_leaf();
+    leaf->page_->RLatch();
+    while (true) {
+        uint64_t version;
+        leaf->page_->optimistic_read(&version);
+        if (has_key_ && version != leaf_version_) {
+            leaf->page_->RUnlatch();
+            leaf = seek();
+            continue;
+        }
+        leaf_version_ = version;
+        at_end_ = false;
+        if (rid_.slot_no < leaf->get_size()) {
+            memcpy(key_, leaf->get_key_at(rid_.slot_no), ih_->file_hdr_->col_tot_len_);
+            has_key_ = true;
+            past_key_ = false;
+            rid_.record_no = leaf->leaf_get_record_no_at(rid_.slot_no);
+            break;
+        }
+        if (leaf->get_next_page() == IX_NO_PAGE) {
+            rid_.slot_no = leaf->get_size();
+            rid_.record_no = ih_->file_hdr_->next_record_no_;
+            at_end_ = true;
+            break;
+        }
+        leaf = next_leaf(leaf);
+    }
+    leaf->page_->RUnlatch();
+}
+
+/**
+ * @description: 拷贝游标当前所在的记录。locate之后到加读锁之前叶子可能又被修改，此时重新定位
+ * @return {bool} 游标到达最后一个叶子的末尾时返回false
+ * @param {Record*} rec 拷贝的目标
+ */
+bool IxScan::copy_record(Record* rec) {
+    while (true) {
+        locate();
+        if (at_end_) {
+            return false;
+        }
+        leaf_.page_->RLatch();
+        uint64_t version;
+        leaf_.page_->optimistic_read(&version);
+        if (version == leaf_version_) {
+            memcpy(rec->record_, leaf_.leaf_get_record_at(rid_.slot_no), record_len());
+            leaf_.page_->RUnlatch();
+            return true;
+        }
+        leaf_.page_->RUnlatch();
+    }
+}
+
+/**
+ * @description: 游标所在的叶子被修改之后，根据key_从根结点重新定位：
+ *              past_key_为true时定位到第一个大于key_的记录，否则定位到第一个不小于key_的记录(key_被物理删除时即为它的下一条记录)
+ * @return {IxNodeHandle*} 游标新的叶子，返回时持有读锁
+ */
+IxNodeHandle* IxScan::seek() {
+    release_leaf();
+    IxNodeHandle* node = ih_->find_leaf_page(key_, Operation::FIND, nullptr, false).first;
+    leaf_ = IxNodeHandle(ih_->file_hdr_, node->page_);
+    leaf_pinned_ = true;
     delete node;
-    node = nullptr;
-    rid_.record_no ++;
-
-    /**
-     * @TEST: 判断rid_.record_no是否和对应位置上的record_no相等
-     */
-    // node = ih_->fetch_node(rid_.page_no);
-    // if(rid_.record_no != node->leaf_get_record_no_at(rid_.slot_no)) {
-        // std::cerr << "rid_.record_no: " << rid_.record_no << ", node->leaf_get_record_no_at(rid_.slot_no): " << node->leaf_get_record_no_at(rid_.slot_no) << std::endl;
-    // }
+    rid_.page_no = leaf_.get_page_no();
+    rid_.slot_no = past_key_ ? leaf_.leaf_directory_upper_bound(key_) : leaf_.leaf_directory_lower_bound(key_);
+    leaf_.page_->optimistic_read(&leaf_version_);
+    return &leaf_;
+}
+
+/**
+ * @description: 游标位于leaf的末尾时进入下一个叶子的第一条记录。游标不能同时持有两个叶子的读锁(写者可能先锁右边的叶子)，
+ *              因此在leaf的读锁下pin住下一个叶子(pin住的页面不会被合并删除)，放开leaf的读锁之后再读锁下一个叶子，
+ *              并校验leaf的版本号没有变化：两个叶子之间移动记录需要同时持有它们的写锁，
+ *              所以此时下一个叶子的第一条记录就是key_之后的记录。leaf被修改过时留在leaf上，由locate重新定位
+ * @return {IxNodeHandle*} 游标所在的叶子，返回时持有读锁
+ * @param {IxNodeHandle*} leaf 游标当前所在的叶子，调用时持有读锁
+ */
+IxNodeHandle* IxScan::next_leaf(IxNodeHandle* leaf) {
+    page_id_t next_page_no = leaf->get_next_page();
+    // 范围扫描的终点在leaf中时不需要预读
+    bool need_read_ahead = read_ahead_ && (!has_end_key_ || leaf->get_size() == 0 ||
+        ix_key_compare(leaf->get_key_at(leaf->get_size() - 1), end_key_, ih_->file_hdr_->col_tot_len_) < 0);
+    Page* page = ih_->buffer_pool_manager_->fetch_page(PageId{ih_->table_meta_.table_id_, next_page_no}, access_);
+    leaf->page_->RUnlatch();
+    if (page == nullptr) {
+        throw InternalError("IxScan: failed to fetch leaf " + std::to_string(next_page_no));
+    }
+
+    page->RLatch();
+    if (!leaf->page_->validate(leaf_version_)) {
+        page->RUnlatch();
+        ih_->buffer_pool_manager_->unpin_page(page->get_page_id(), false);
+        leaf->page_->RLatch();
+        return leaf;
+    }
+    uint64_t version;
+    page->optimistic_read(&version);
+    page->RUnlatch();
+
+    if (need_read_ahead) {
+        read_ahead(leaf);
+    }
+    release_leaf();
+    leaf_ = IxNodeHandle(ih_->file_hdr_, page);
+    leaf_pinned_ = true;
+    rid_.page_no = next_page_no;
+    rid_.slot_no = 0;
+    leaf_version_ = version;
+    leaf_.page_->RLatch();
+    return &leaf_;
+}
+
+/**
+ * @description: 获取游标当前所在的叶子，如果该叶子还没有被pin，则从缓冲池中获取并pin住，直到游标离开该叶子
+ * @return {IxNodeHandle*} 游标所在的叶子
+ */
+IxNodeHandle* IxScan::fetch_leaf() {
+    if (leaf_pinned_ && leaf_.get_page_no() == rid_.page_no) {
+        return &leaf_;
+    }
+    release_leaf();
+    Page* page = ih_->buffer_pool_manager_->fetch_page(PageId{ih_->table_meta_.table_id_, rid_.page_no}, access_);
+    if (page == nullptr) {
+        throw InternalError("IxScan: failed to fetch leaf " + std::to_string(rid_.page_no));
+    }
+    leaf_ = IxNodeHandle(ih_->file_hdr_, page);
+    leaf_pinned_ = true;
+    return &leaf_;
+}
+
+void IxScan::release_leaf() {
+    if (leaf_pinned_) {
+        ih_->buffer_pool_manager_->unpin_page(leaf_.get_page_id(), false);
+        leaf_pinned_ = false;
+    }
+}
+
+/**
+ * @description: 游标从leaf移动到下一个叶子时调用。叶子之间只有next_page链接，因此通过父节点(以及父节点的右兄弟)
+ *              的孩子指针找到leaf之后的若干个叶子，在一次rpc中批量预读到缓冲池中。
+ *              当游标进入预读窗口的后半部分时发起下一次预读，每次游标按顺序消耗了预读的叶子，预读窗口就翻倍，
+ *              直到IX_SCAN_READ_AHEAD_MAX，因此短扫描只会预读少量页面，而长扫描会逐渐增大每次rpc的页面数量。
+ * @param {IxNodeHandle*} leaf 游标当前所在的叶子，调用者持有其pin
+ */
+void IxScan::read_ahead(IxNodeHandle* leaf) {
+    bool next_prefetched = prefetched_ahead_ > 0;
+    if (next_prefetched) {
+        // 游标进入了一个已经预读的叶子
+        prefetched_ahead_--;
+    }
+    if (prefetched_ahead_ > read_ahead_window_ / 2) {
+        return;
+    }
+    if (next_prefetched) {
+        read_ahead_window_ = std::min(read_ahead_window_ * 2, IX_SCAN_READ_AHEAD_MAX);
+    }
+    if (leaf->is_root_page()) {
+        return;
+    }
+
+    // leaf之后的第pos个叶子，第1个即游标将要进入的叶子，预读[first_pos, last_pos]范围内的叶子
+    int first_pos = next_prefetched ? prefetched_ahead_ + 2 : 1;
+    int last_pos = read_ahead_window_ + 1;
+    int pos = 0;
+    std::vector<PageId> page_ids;
+
+    IxNodeHandle* parent = ih_->fetch_node(leaf->get_parent_page_no());
+    parent->page_->RLatch();
+    int child_idx = 0;
+    while (child_idx < parent->internal_get_key_num() && parent->internal_child_page_at(child_idx) != leaf->get_page_no()) {
+        child_idx++;
+    }
+    if (child_idx == parent->internal_get_key_num()) {
+        // leaf已经被分裂到了其他父节点，本次不预读
+        parent->page_->RUnlatch();
+        ih_->buffer_pool_manager_->unpin_page(parent->get_page_id(), false);
+        delete parent;
+        return;
+    }
+
+    while (pos < last_pos) {
+        child_idx++;
+        if (child_idx >= parent->internal_get_key_num()) {
+            // 当前父节点的孩子已经遍历完，转到父节点的右兄弟
+            page_id_t next_parent = parent->get_next_page();
+            parent->page_->RUnlatch();
+            ih_->buffer_pool_manager_->unpin_page(parent->get_page_id(), false);
+            delete parent;
+            parent = nullptr;
+            if (next_parent == IX_NO_PAGE) break;
+            parent = ih_->fetch_node(next_parent);
+            parent->page_->RLatch();
+            child_idx = -1;
+            continue;
+        }
+        page_id_t page_no = parent->internal_child_page_at(child_idx);
+        pos++;
+        if (pos >= first_pos) {
+            page_ids.push_back(PageId{ih_->table_meta_.table_id_, page_no});
+        }
+        if (page_no == end_.page_no || page_no == ih_->file_hdr_->last_leaf_) break;
+    }
+    if (parent != nullptr) {
+        parent->page_->RUnlatch();
+        ih_->buffer_pool_manager_->unpin_page(parent->get_page_id(), false);
+        delete parent;
+    }
+
+    ih_->buffer_pool_manager_->prefetch_pages(page_ids);
+    prefetched_ahead_ = std::max(pos - 1, 0);
 }
@@ -7,31 +7,91 @@
 
 // 用于遍历叶子结点
 // 用于直接遍历叶子结点，而不用findleafpage来得到叶子结点
-// TODO：对page遍历时，要加上对读锁
+// 游标所在的叶子只会被pin一次，在游标离开该叶子(或IxScan析构)时才unpin，记录通过record()直接从页面中读取，不需要拷贝
+// 游标在两次访问之间不持有叶子的读锁，其他线程的插入、物理删除、重分配、合并和压缩都可能移动叶子中的记录，
+// 因此游标保存当前记录的key和校验位置时叶子的版本号，叶子的版本号变化之后根据key重新定位
 class IxScan {
-    const IxIndexHandle *ih_;
+    IxIndexHandle *ih_;
     Rid rid_;  // 初始为lower（用于遍历的指针）
     Rid end_;  // 初始为upper
     // BufferPoolManager *bpm_;
 
+    IxNodeHandle leaf_;             // 游标当前所在的叶子
+    bool leaf_pinned_ = false;      // leaf_是否被当前游标pin住
+
+    char key_[IX_MAX_COL_LEN];      // 游标最近一次校验时所在记录的规范化key
+    bool has_key_ = false;          // 为false时rid_还没有指向过任何记录，直接信任rid_
+    bool past_key_ = false;         // 调用next()之后为true，rid_应当指向第一个大于key_的记录
+    bool at_end_ = false;           // rid_位于最后一个叶子的末尾
+    uint64_t leaf_version_ = 0;     // 最近一次校验rid_时leaf_的版本号
+
+    // 范围扫描的终点保存为规范化的key(不包含)，end_处的槽位在扫描期间可能失效；为false时扫描到最后一个叶子的末尾
+    char end_key_[IX_MAX_COL_LEN];
+    bool has_end_key_ = false;
+
+    // 沿叶子链表的预读，只在计算节点生效
+    bool read_ahead_;
+    int read_ahead_window_ = IX_SCAN_READ_AHEAD_MIN;    // 当前的预读窗口(叶子个数)，随着扫描的推进而增大
+    int prefetched_ahead_ = 0;                          // 已经预读但游标还没有到达的叶子个数
+
+    // 全表扫描读入的叶子在unpin之后由replacer优先淘汰，避免扫描大表时把热点页面挤出缓冲池
+    AccessType access_ = AccessType::NORMAL;
+
 public:
     // used for sequential scan, the iid_ is initiated as leaf_begin, and the end_ is initiated as leaf_end
-    IxScan(const IxIndexHandle* ih) : ih_(ih) {
+    IxScan(IxIndexHandle* ih, bool read_ahead = true) : ih_(ih), read_ahead_(read_ahead), access_(AccessType::SCAN) {
         rid_ = ih->leaf_begin();
         end_ = ih->leaf_end();
     }
-    IxScan(const IxIndexHandle *ih, const Rid &lower, const Rid &upper)
-        : ih_(ih), rid_(lower), end_(upper) {}
+    IxScan(IxIndexHandle *ih, const Rid &lower, const Rid &upper, bool read_ahead = true)
+        : ih_(ih), rid_(lower), end_(upper), read_ahead_(read_ahead) {
+        init_end_key();
+    }
+
+    // 游标持有叶子的pin，不允许拷贝
+    IxScan(const IxScan&) = delete;
+    IxScan& operator=(const IxScan&) = delete;
+
+    ~IxScan() { release_leaf(); }
 
     void next();
 
-    bool is_end() { 
-        if((rid_.page_no == end_.page_no && rid_.slot_no == end_.slot_no) || (rid_.record_no >= end_.record_no)) return true;
-        return false;
-     }
+    // 游标当前指向的记录(包括RecordHdr)，返回的指针在游标离开当前叶子之前有效
+    char* record() {
+        locate();
+        return leaf_.leaf_get_record_at(rid_.slot_no);
+    }
+
+    int record_len() const { return ih_->file_hdr_->record_len_; }
+
+    // 将rec指向游标当前所在的记录，不拷贝数据
+    void get_record_view(Record* rec) { rec->set_view(record(), record_len()); }
+
+    // 在叶子的读锁下把游标当前所在的记录拷贝到rec中，rec需要已经分配了record_len()大小的空间，游标到达末尾时返回false
+    bool copy_record(Record* rec);
+
+    bool is_end() {
+        locate();
+        return at_end_ || (has_end_key_ && ix_key_compare(key_, end_key_, ih_->file_hdr_->col_tot_len_) >= 0);
+    }
 
     // Rid rid() const override;
 
     const Rid &rid() const { return rid_; }
     const Rid& end() const { return end_; }
+
+private:
+    void init_end_key();
+
+    void locate();
+
+    IxNodeHandle* seek();
+
+    IxNodeHandle* next_leaf(IxNodeHandle* leaf);
+
+    IxNodeHandle* fetch_leaf();
+
+    void release_leaf();
+
+    void read_ahead(IxNodeHandle* leaf);
 };
\ No newline at end of file
@@ -153,6 +153,7 @@ MultiVersionPageHandle MultiVersionFileHandle::fetch_page_handle(int page_no) co
     // TODO: throw exception
     if (page_no >= file_hdr_.num_pages) throw PageNotExistError(disk_manager_->get_file_name(fd_), page_no);
     Page *page = buffer_pool_manager_->fetch_page(PageId{fd_, page_no});  // bpm->fetch_page
+    if (page == nullptr) throw InternalError("MultiVersionFileHandle::fetch_page_handle: failed to fetch page " + std::to_string(page_no));
     MultiVersionPageHandle page_handle(&file_hdr_, page);
     return page_handle;
 }
@@ -170,6 +171,7 @@ MultiVersionPageHandle MultiVersionFileHandle::create_new_page_handle() {
     // Page *page = buffer_pool_manager_->create_page(fd_, file_hdr_.num_pages);  // bpm->create_page
     PageId new_page_id = {.table_id = fd_, .page_no = INVALID_PAGE_ID};
     Page *page = buffer_pool_manager_->new_page(&new_page_id);  // 此处NewPage会调用disk_manager的AllocatePage()
+    if (page == nullptr) throw InternalError("MultiVersionFileHandle::create_new_page_handle: no free frame");
     // printf("MultiVersionFileHandle::create_page_handle fd=%d page_no=%d\n", fd_, new_page_id.page_no);
     assert(new_page_id.page_no != INVALID_PAGE_ID && new_page_id.page_no != MULTI_FILE_HDR_PAGE);
 
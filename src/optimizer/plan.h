@@ -33,7 +33,8 @@ public:
 class ScanPlan : public Plan
 {
     public:
-        ScanPlan(PlanTag tag, int sql_id, int plan_id, SmManager *sm_manager, std::string tab_name, std::vector<Condition> filter_conds, std::vector<Condition> index_conds, std::vector<TabCol> proj_cols) :
+        ScanPlan(PlanTag tag, int sql_id, int plan_id, SmManager *sm_manager, std::string tab_name, std::vector<Condition> filter_conds, std::vector<Condition> index_conds, std::vector<TabCol> proj_cols,
+                 std::vector<std::string> index_col_names = std::vector<std::string>()) :
             Plan(sql_id, plan_id)
         {
             Plan::tag = tag;
@@ -44,6 +45,7 @@ class ScanPlan : public Plan
             len_ = cols_.back().offset + cols_.back().len;
             index_conds_ = std::move(index_conds);
             proj_cols_ = std::move(proj_cols);
+            index_col_names_ = std::move(index_col_names);
         }
         ~ScanPlan(){}
 
@@ -53,7 +55,12 @@ class ScanPlan : public Plan
                 std::cout << "IndexScan: ";
             else
                 std::cout << "SeqScan: ";
-            std::cout << tab_name_ << ", conds: ";
+            std::cout << tab_name_;
+            if(!index_col_names_.empty()) {
+                std::cout << ", secondary index:";
+                for(const auto& col_name: index_col_names_) std::cout << " " << col_name;
+            }
+            std::cout << ", conds: ";
             for(const auto& cond: index_conds_) {
                 std::cout << cond.lhs_col.col_name << CompOpString[cond.op] << cond.rhs_val.int_val << ", ";
             }
@@ -104,6 +111,17 @@ class ScanPlan : public Plan
             offset += sizeof(int);
             for(auto& index_cond: index_conds_) index_cond.serialize(dest, offset);
 
+            int index_col_num = index_col_names_.size();
+            memcpy(dest + offset, &index_col_num, sizeof(int));
+            offset += sizeof(int);
+            for(auto& col_name: index_col_names_) {
+                int col_name_size = col_name.length();
+                memcpy(dest + offset, &col_name_size, sizeof(int));
+                offset += sizeof(int);
+                memcpy(dest + offset, col_name.c_str(), col_name_size);
+                offset += col_name_size;
+            }
+
             memcpy(dest, &offset, sizeof(int));
             return offset;
         }
@@ -157,7 +175,17 @@ class ScanPlan : public Plan
                 index_conds_.push_back(std::move(cond));
             }
 
-            return std::make_shared<ScanPlan>(tag, sql_id, plan_id, sm_manager, tab_name_, filter_conds_, index_conds_, std::vector<TabCol>());
+            int index_col_num = *reinterpret_cast<const int*>(src + offset);
+            offset += sizeof(int);
+            std::vector<std::string> index_col_names_;
+            for(int i = 0; i < index_col_num; ++i) {
+                int col_name_size = *reinterpret_cast<const int*>(src + offset);
+                offset += sizeof(int);
+                index_col_names_.emplace_back(src + offset, col_name_size);
+                offset += col_name_size;
+            }
+
+            return std::make_shared<ScanPlan>(tag, sql_id, plan_id, sm_manager, tab_name_, filter_conds_, index_conds_, std::vector<TabCol>(), index_col_names_);
         }
 
         // 以下变量同ScanExecutor中的变量
@@ -167,6 +195,7 @@ class ScanPlan : public Plan
         size_t len_;                               
         std::vector<Condition> index_conds_;
         std::vector<TabCol> proj_cols_;
+        std::vector<std::string> index_col_names_;  // 使用的二级索引包含的字段，为空时使用主键索引
 };
 
 class JoinPlan : public Plan
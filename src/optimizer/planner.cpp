@@ -70,19 +70,42 @@ void Planner::get_proj_cols(std::shared_ptr<Query> query, const std::string& tab
     filter_conds: 非索引列的条件
 */
 bool Planner::check_primary_index_match(std::string tab_name, std::vector<Condition> curr_conds, std::vector<Condition>& index_conds, std::vector<Condition>& filter_conds) {
-    // 当前函数保证了返回的iindex_conds中谓词条件的顺序和主键中的顺序一致
+    TabMeta& tab = sm_manager_->db_.get_table(tab_name);
+    return check_index_match(*(tab.get_primary_index_meta()), curr_conds, index_conds, filter_conds);
+}
+
+/*
+    在表的二级索引中选择匹配条件最多的索引，index_col_names返回该索引包含的字段
+*/
+bool Planner::check_secondary_index_match(std::string tab_name, std::vector<Condition> curr_conds, std::vector<Condition>& index_conds, std::vector<Condition>& filter_conds, std::vector<std::string>& index_col_names) {
     index_conds.clear();
     filter_conds.clear();
+    index_col_names.clear();
     TabMeta& tab = sm_manager_->db_.get_table(tab_name);
-    IndexMeta pindex_meta = *(tab.get_primary_index_meta());
+    std::vector<Condition> curr_index_conds;
+    std::vector<Condition> curr_filter_conds;
+    for(size_t i = 1; i < tab.indexes_.size(); ++i) {
+        if(check_index_match(tab.indexes_[i], curr_conds, curr_index_conds, curr_filter_conds) == false) continue;
+        if(curr_index_conds.size() <= index_conds.size()) continue;
+        index_conds = std::move(curr_index_conds);
+        filter_conds = std::move(curr_filter_conds);
+        index_col_names.clear();
+        for(auto& col: tab.indexes_[i].cols) index_col_names.emplace_back(col.name);
+    }
+    return index_conds.size() > 0;
+}
+
+bool Planner::check_index_match(const IndexMeta& index_meta, std::vector<Condition> curr_conds, std::vector<Condition>& index_conds, std::vector<Condition>& filter_conds) {
+    // 当前函数保证了返回的index_conds中谓词条件的顺序和索引字段的顺序一致
+    index_conds.clear();
+    filter_conds.clear();
     std::vector<std::string> index_cols;
     bool is_op_eq = true;
-    bool find_col = false;
 
-    for(auto& index_col: pindex_meta.cols) {
-        
+    for(auto& index_col: index_meta.cols) {
+        bool find_col = false;
         for(size_t i = 0; i < curr_conds.size(); ++i) {
-            if(curr_conds[i].lhs_col.col_name.compare(index_col.name) == 0) {
+            if(curr_conds[i].is_rhs_val && curr_conds[i].op != OP_NE && curr_conds[i].lhs_col.col_name.compare(index_col.name) == 0) {
                 find_col = true;
                 index_conds.emplace_back(curr_conds[i]);
                 if(curr_conds[i].op != OP_EQ) is_op_eq = false;
@@ -90,7 +113,7 @@ bool Planner::check_primary_index_match(std::string tab_name, std::vector<Condit
         }
 
         if(find_col == false) {
-            return false;
+            break;
         }
 
         index_cols.emplace_back(index_col.name);
@@ -104,7 +127,7 @@ bool Planner::check_primary_index_match(std::string tab_name, std::vector<Condit
     for(auto cond: curr_conds) {
         is_in_index = false;
         for(auto& index_col: index_cols) {
-            if(index_col.compare(cond.lhs_col.col_name) == 0) {
+            if(cond.is_rhs_val && cond.op != OP_NE && index_col.compare(cond.lhs_col.col_name) == 0) {
                 is_in_index = true;
                 break;
             }
@@ -254,6 +277,10 @@ std::shared_ptr<GatherPlan> Planner::convert_scan_to_parallel_scan(std::shared_p
     if(scan_plan->index_conds_.size() == 0) {
         return nullptr;
     }
+    // 二级索引扫描需要回表，不按照主键范围划分
+    if(scan_plan->index_col_names_.size() > 0) {
+        return nullptr;
+    }
 
 std::cout << "ConvertScanToParallelScan" << std::endl;
     // 按照index_conds来进行scan range的划分
@@ -443,9 +470,14 @@ std::shared_ptr<Plan> Planner::make_one_rel(std::shared_ptr<Query> query, Contex
         // int index_no = get_indexNo(tables[i], curr_conds);
         std::vector<Condition> index_conds;
         std::vector<Condition> filter_conds;
+        std::vector<std::string> index_col_names;
         bool primary_index_match = check_primary_index_match(tables[i], curr_conds, index_conds, filter_conds);
 
-        if (primary_index_match == false) {  // 该表没有索引
+        if (primary_index_match == false && check_secondary_index_match(tables[i], curr_conds, index_conds, filter_conds, index_col_names)) {
+            // 主键索引无法使用，通过二级索引找到主键之后再回表
+            table_scan_executors[i] =
+                std::make_shared<ScanPlan>(T_IndexScan, current_sql_id_, current_plan_id_++, sm_manager_, tables[i], filter_conds, index_conds, proj_cols, index_col_names);
+        } else if (primary_index_match == false) {  // 该表没有索引
             index_conds.clear();
             filter_conds.clear();
             table_scan_executors[i] = 
@@ -611,9 +643,13 @@ std::shared_ptr<Plan> Planner::do_planner(std::shared_ptr<Query> query, Context
         std::vector<TabCol> proj_cols;
         get_proj_cols(query, x->tab_name, proj_cols);
         // bool index_exist = get_index_cols(x->tab_name, query->conds, index_col_names);
+        std::vector<std::string> index_col_names;
         bool primary_index_match = check_primary_index_match(x->tab_name, query->conds, index_conds, filter_conds);
         
-        if (primary_index_match == false) {  // 该表没有索引
+        if (primary_index_match == false && check_secondary_index_match(x->tab_name, query->conds, index_conds, filter_conds, index_col_names)) {
+            table_scan_executors =
+                std::make_shared<ScanPlan>(T_IndexScan, current_sql_id_, current_plan_id_++, sm_manager_, x->tab_name, filter_conds, index_conds, proj_cols, index_col_names);
+        } else if (primary_index_match == false) {  // 该表没有索引
             index_conds.clear();
             filter_conds.clear();
             table_scan_executors = 
@@ -638,9 +674,13 @@ std::shared_ptr<Plan> Planner::do_planner(std::shared_ptr<Query> query, Context
         std::vector<TabCol> proj_cols;
         get_proj_cols(query, x->tab_name, proj_cols);
         // bool index_exist = get_index_cols(x->tab_name, query->conds, index_col_names);
+        std::vector<std::string> index_col_names;
         bool primary_index_match = check_primary_index_match(x->tab_name, query->conds, index_conds, filter_conds);
         
-        if (primary_index_match == false) {  // 该表没有索引
+        if (primary_index_match == false && check_secondary_index_match(x->tab_name, query->conds, index_conds, filter_conds, index_col_names)) {
+            table_scan_executors =
+                std::make_shared<ScanPlan>(T_IndexScan, current_sql_id_, current_plan_id_++, sm_manager_, x->tab_name, filter_conds, index_conds, proj_cols, index_col_names);
+        } else if (primary_index_match == false) {  // 该表没有索引
             index_conds.clear();
             filter_conds.clear();
             table_scan_executors = 
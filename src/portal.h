@@ -72,23 +72,21 @@ class Portal
                 {
                     std::shared_ptr<AbstractExecutor> scan= convert_plan_executor(x->subplan_, context);
                     std::vector<Rid> rids;
-                    for (scan->beginTuple(); !scan->is_end(); scan->nextTuple()) {
-                        rids.push_back(scan->rid());
-                    }
+                    std::vector<std::string> pkeys;
+                    collect_target_records(scan, x->tab_name_, &rids, &pkeys);
                     std::shared_ptr<AbstractExecutor> root =std::make_shared<UpdateExecutor>(sm_manager_, 
-                                                            x->tab_name_, x->set_clauses_, x->conds_, rids, context);
+                                                            x->tab_name_, x->set_clauses_, x->conds_, std::move(rids), std::move(pkeys), context);
                     return std::make_shared<PortalStmt>(PORTAL_DML_WITHOUT_SELECT, std::vector<TabCol>(), std::move(root), plan);
                 }
                 case T_Delete:
                 {
                     std::shared_ptr<AbstractExecutor> scan= convert_plan_executor(x->subplan_, context);
                     std::vector<Rid> rids;
-                    for (scan->beginTuple(); !scan->is_end(); scan->nextTuple()) {
-                        rids.push_back(scan->rid());
-                    }
+                    std::vector<std::string> pkeys;
+                    collect_target_records(scan, x->tab_name_, &rids, &pkeys);
 
                     std::shared_ptr<AbstractExecutor> root =
-                        std::make_shared<DeleteExecutor>(sm_manager_, x->tab_name_, x->conds_, rids, context);
+                        std::make_shared<DeleteExecutor>(sm_manager_, x->tab_name_, x->conds_, std::move(rids), std::move(pkeys), context);
 
                     return std::make_shared<PortalStmt>(PORTAL_DML_WITHOUT_SELECT, std::vector<TabCol>(), std::move(root), plan);
                 }
@@ -179,6 +177,28 @@ class Portal
     // 清空资源
     void drop(){}
 
+    /**
+     * @description: 收集update/delete需要修改的记录。语句执行之前记录可能被插入、purge或者压缩移动，
+     *              Rid只用于校验record_no，执行时根据主键重新定位记录
+     */
+    void collect_target_records(std::shared_ptr<AbstractExecutor>& scan, const std::string& tab_name,
+                                std::vector<Rid>* rids, std::vector<std::string>* pkeys) {
+        TabMeta& tab = sm_manager_->db_.get_table(tab_name);
+        std::vector<ColMeta> key_cols;
+        for(auto& col: tab.get_primary_index_meta()->cols) {
+            key_cols.push_back(scan->get_col_offset(TabCol{tab_name, col.name}));
+        }
+        for (scan->beginTuple(); !scan->is_end(); scan->nextTuple()) {
+            rids->push_back(scan->rid());
+            auto record = scan->Next();
+            std::string pkey;
+            for(auto& col: key_cols) {
+                pkey.append(record->raw_data_ + col.offset, col.len);
+            }
+            pkeys->push_back(std::move(pkey));
+        }
+    }
+
 
     std::shared_ptr<AbstractExecutor> convert_plan_executor(std::shared_ptr<Plan> plan, Context *context)
     {
@@ -190,7 +210,7 @@ class Portal
                 return std::make_shared<SeqScanExecutor>(sm_manager_, x->tab_name_, x->filter_conds_, context);
             }
             else {
-                return std::make_shared<IndexScanExecutor>(sm_manager_, x->tab_name_, x->proj_cols_, x->filter_conds_, x->index_conds_, context, x->sql_id_, x->plan_id_);
+                return std::make_shared<IndexScanExecutor>(sm_manager_, x->tab_name_, x->proj_cols_, x->filter_conds_, x->index_conds_, context, x->sql_id_, x->plan_id_, x->index_col_names_);
             } 
         } else if(auto x = std::dynamic_pointer_cast<JoinPlan>(plan)) {
             std::shared_ptr<AbstractExecutor> left = convert_plan_executor(x->left_, context);
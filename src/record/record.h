@@ -75,6 +75,21 @@ public:
         record_hdr_->record_no_ = INVALID_SLOT_NO;
     }
 
+    /**
+     * @description: 不拷贝数据，直接引用record_slot处的记录，调用者需要保证记录所在的页面在使用期间一直被pin住
+     * @param {char*} record_slot 记录的起始地址(包括RecordHdr)
+     * @param {int} record_tot_len 记录的总长度(包括RecordHdr)
+     */
+    void set_view(char* record_slot, int record_tot_len) {
+        if(allocated_) {
+            delete[] record_;
+            allocated_ = false;
+        }
+        data_length_ = record_tot_len - sizeof(RecordHdr);
+        record_ = record_slot;
+        raw_data_ = record_ + sizeof(RecordHdr);
+    }
+
     bool is_deleted() const {
         return *(bool*)(record_ + RECHDR_OFF_DELETE_MARK);
     }
@@ -1,3 +1,5 @@
+#include <brpc/callback.h>
+
 #include <cstring>
 #include "log_manager.h"
 #include "state/state_manager.h"
@@ -5,18 +7,36 @@
 
 /**
  * @description: 添加日志记录到日志缓冲区中，并返回日志记录号
+ *              缓冲区的剩余空间不足时，请求log shipper发送已经写入的日志，阻塞直到on_batch_shipped释放出足够的空间，
+ *              不能覆盖还没有被存储节点写入的日志
  * @param {LogRecord*} log_record 要写入缓冲区的日志记录
  * @return {lsn_t} 返回该日志的日志记录号
  */
 lsn_t LogManager::add_log_to_buffer(std::unique_ptr<RedoLogRecord> redo_log) {
     std::unique_lock<std::mutex> lock(latch_);
-    
-    // if(log_buffer_->is_full(redo_log->log_tot_len_)) {
-    //     // 如果剩余空间无法写入新增log，则需要把日志缓冲区刷入磁盘中
-    //     lock.unlock();
-    //     write_log_to_storage();
-    //     lock.lock();
-    // }
+    assert(redo_log->log_tot_len_ < log_buffer_->buf_size_);
+
+    // 写满时至少保留一个字节，否则head_ == tail_无法与空缓冲区区分
+    auto has_space = [&]() {
+        int64_t curr_tail;
+        int64_t free_size;
+        log_buffer_->get_curr_tail_free_size_(curr_tail, free_size);
+        return free_size > redo_log->log_tot_len_;
+    };
+    while(!has_space()) {
+        // log shipper需要持有flush_latch_再获取latch_，因此先放开latch_
+        lsn_t last_lsn = global_lsn_.load() - 1;
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> flush_lock(flush_latch_);
+            if(request_lsn_ < last_lsn) {
+                request_lsn_ = last_lsn;
+            }
+        }
+        ship_cv_.notify_one();
+        lock.lock();
+        space_cv_.wait(lock, [&]() { return has_space() || global_lsn_.load() - 1 != last_lsn; });
+    }
 
     redo_log->lsn_ = global_lsn_ ++;
     // redo_log->serialize(log_buffer_->buffer_ + log_buffer_->offset_);
@@ -27,56 +47,233 @@ lsn_t LogManager::add_log_to_buffer(std::unique_ptr<RedoLogRecord> redo_log) {
 }
 
 
-void LogManager::write_log_to_storage() {
-    std::unique_lock<std::mutex> lock(latch_);
-    // init brpc
-    storage_service::StorageService_Stub stub(log_channel_);
-    storage_service::LogWriteRequest request;
-    storage_service::LogWriteResponse* response = new storage_service::LogWriteResponse;
-    brpc::Controller* cntl = new brpc::Controller;
+// 日志缓冲区由LogManager管理，attachment引用缓冲区时不需要释放
+static void keep_log_buffer(void*) {}
+
+/* 一次LogWrite发送的日志，对应日志缓冲区中的[head_, tail_) */
+struct LogShipBatch {
+    int64_t head_;
+    int64_t tail_;
+    int64_t size_;
+    lsn_t last_lsn_;                // batch中最后一条日志的lsn
+    bool finished_ = false;         // 存储节点已经写入
+    bool failed_ = false;           // 发送失败，等待log shipper重新发送
+    brpc::Controller cntl_;
+    storage_service::LogWriteRequest request_;
+    storage_service::LogWriteResponse response_;
+};
 
-    // char *log_data = new char[log_buffer_->offset_];
+LogManager::LogManager(brpc::Channel* log_channel, RDMACircularBuffer* log_buffer): log_channel_(log_channel) {
+    log_buffer_ = log_buffer;
     int64_t curr_head;
     int64_t curr_tail;
     log_buffer_->get_curr_head_tail(curr_head, curr_tail);
-    int64_t curr_size = (curr_tail - curr_head + log_buffer_->buf_size_) % log_buffer_->buf_size_;
-    if(curr_size == 0) return;
-    request.set_log(std::move(log_buffer_->get_range_string(curr_head, curr_tail, curr_size)));
-    // switch (redo_log->log_type_)
-    // {
-    //     case RedoLogType::UPDATE: {
-    //         auto update_log = reinterpret_cast<UpdateRedoLogRecord *>(redo_log.get());
-    //         update_log->serialize(log_data);
-    //         break;
-    //     }
-    //     case RedoLogType::DELETE: {
-    //         auto delete_log = reinterpret_cast<DeleteRedoLogRecord *>(redo_log.get());
-    //         delete_log->serialize(log_data);
-    //         break;
-    //     }
-    //     case RedoLogType::INSERT: {
-    //         auto insert_log = reinterpret_cast<InsertRedoLogRecord *>(redo_log.get());
-    //         insert_log->serialize(log_data);
-    //         break;
-    //     }
-    //     default: {
-    //         std::cout << "Haven't implemented!\n";
-    //         break;
-    //     }
-    // }
-    // request.set_log(std::string(log_data, redo_log->log_tot_len_));
-
-    // std::cout << "try to send log to storage by brpc\n";
-    stub.LogWrite(cntl, &request, response, NULL);
-    log_buffer_->release(curr_head, curr_tail, curr_size);
-
-    // StateManager::get_instance()->update_log_state_head();
-    // std::cout << "successfully send log to storage\n";
+    ship_tail_ = curr_tail;
+    ship_thread_ = std::thread(&LogManager::ship_log, this);
+}
+
+LogManager::~LogManager() {
+    {
+        std::lock_guard<std::mutex> lock(flush_latch_);
+        ship_stop_ = true;
+    }
+    ship_cv_.notify_one();
+    ship_thread_.join();
+
+    // 等待发送中的batch返回，失败的batch不再重新发送
+    std::unique_lock<std::mutex> lock(flush_latch_);
+    flush_cv_.wait(lock, [&]() {
+        for(auto batch: inflight_batches_) {
+            if(!batch->failed_ && !batch->finished_) return false;
+        }
+        return true;
+    });
+    for(auto batch: inflight_batches_) {
+        delete batch;
+    }
+    inflight_batches_.clear();
+}
+
+/**
+ * @description: 把日志缓冲区中已经写入的日志全部发送到存储节点
+ */
+void LogManager::write_log_to_storage() {
+    flush_to_lsn(global_lsn_.load() - 1);
 }
 
+/**
+ * @description: group commit，阻塞直到lsn之前(包括lsn)的日志都已经持久化到存储节点
+ * 提交的事务只登记自己需要的lsn并等待persist_lsn_，日志由log shipper线程发送，多个事务的日志在同一个batch中发送
+ * STATE_POOL模式下只等待日志写入状态节点，不等待存储节点
+ * @param {lsn_t} lsn 需要持久化的最后一条日志
+ */
+void LogManager::flush_to_lsn(lsn_t lsn) {
+    if(commit_mode_ == LogCommitMode::STATE_POOL) {
+        ContextManager::get_instance()->wait_logs_durable();
+        {
+            std::lock_guard<std::mutex> lock(flush_latch_);
+            if(request_lsn_ < lsn) {
+                request_lsn_ = lsn;
+            }
+        }
+        ship_cv_.notify_one();
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(flush_latch_);
+    if(persist_lsn_ >= lsn) {
+        return;
+    }
+    if(request_lsn_ < lsn) {
+        request_lsn_ = lsn;
+    }
+    waiting_num_++;
+    ship_cv_.notify_one();
+    flush_cv_.wait(lock, [&]() { return persist_lsn_ >= lsn; });
+    waiting_num_--;
+}
+
+/**
+ * @description: log shipper线程，把[ship_tail_, 缓冲区tail)中的日志作为一个batch异步发送
+ * 多个batch可以同时在发送中，存储节点可能乱序返回，persist_lsn_只越过从头开始连续完成的batch(见on_batch_shipped)
+ * 发送失败的batch优先重新发送，保证persist_lsn_之前的日志在存储节点上没有空洞
+ */
+void LogManager::ship_log() {
+    std::unique_lock<std::mutex> lock(flush_latch_);
+    while(true) {
+        LogShipBatch* failed_batch = nullptr;
+        for(auto batch: inflight_batches_) {
+            if(batch->failed_) {
+                failed_batch = batch;
+                break;
+            }
+        }
+        if(failed_batch != nullptr && !ship_stop_) {
+            ship_cv_.wait_for(lock, std::chrono::milliseconds(LOG_SHIP_RETRY_INTERVAL_MS));
+            failed_batch->failed_ = false;
+            lock.unlock();
+            send_batch(failed_batch);
+            lock.lock();
+            continue;
+        }
+
+        if(ship_stop_) {
+            break;
+        }
+        if(request_lsn_ <= ship_lsn_ || (int)inflight_batches_.size() >= LOG_SHIP_MAX_INFLIGHT) {
+            ship_cv_.wait(lock);
+            continue;
+        }
 
-void LogManager::make_update_redolog(txn_id_t txn_id, RmRecord &old_record, RmRecord &new_record, Rid rid, std::string tab_name, bool is_persist) {
-    auto update_redolog = std::make_unique<UpdateRedoLogRecord>(txn_id, old_record, new_record, rid, tab_name);
+        // batch window: 等待更多的事务提交，使它们的日志在同一个batch中发送
+        if(group_commit_window_us_ > 0 && waiting_num_ < group_commit_max_size_) {
+            ship_cv_.wait_for(lock, std::chrono::microseconds(group_commit_window_us_),
+                              [&]() { return ship_stop_ || waiting_num_ >= group_commit_max_size_; });
+        }
+
+        LogShipBatch* batch = new LogShipBatch();
+        {
+            // add_log_to_buffer持有latch_分配lsn并写入缓冲区，因此tail之前的日志都已经完整写入，最后一条的lsn为global_lsn_-1
+            std::lock_guard<std::mutex> buffer_lock(latch_);
+            int64_t curr_head;
+            log_buffer_->get_curr_head_tail(curr_head, batch->tail_);
+            batch->last_lsn_ = global_lsn_.load() - 1;
+        }
+        batch->head_ = ship_tail_;
+        batch->size_ = (batch->tail_ - batch->head_ + log_buffer_->buf_size_) % log_buffer_->buf_size_;
+        ship_tail_ = batch->tail_;
+        ship_lsn_ = batch->last_lsn_;
+        if(batch->size_ == 0) {
+            delete batch;
+            continue;
+        }
+        inflight_batches_.push_back(batch);
+
+        // [head_, tail_)在batch完成之前不会被释放，发送期间不需要持有latch
+        lock.unlock();
+        send_batch(batch);
+        lock.lock();
+    }
+}
+
+/**
+ * @description: 计算节点故障恢复时，日志缓冲区从状态节点中恢复(ContextManager::fetch_log_states)，
+ * 把log shipping的状态对齐到恢复之后的缓冲区，并重新发送存储节点还没有的日志
+ * @param {int64_t} unpersisted_head 第一条存储节点还没有的日志在缓冲区中的位置，没有这样的日志时为缓冲区的tail
+ * @param {lsn_t} persist_lsn 存储节点已经持久化的lsn
+ * @param {lsn_t} max_lsn 缓冲区中最大的lsn
+ */
+void LogManager::recover_log_shipping(int64_t unpersisted_head, lsn_t persist_lsn, lsn_t max_lsn) {
+    {
+        std::lock_guard<std::mutex> lock(flush_latch_);
+        assert(inflight_batches_.empty());
+        int64_t curr_head;
+        int64_t curr_tail;
+        log_buffer_->get_curr_head_tail(curr_head, curr_tail);
+        // 已经持久化的日志直接释放
+        if(unpersisted_head != curr_head) {
+            log_buffer_->release(curr_head, unpersisted_head, (unpersisted_head - curr_head + log_buffer_->buf_size_) % log_buffer_->buf_size_);
+        }
+        ship_tail_ = unpersisted_head;
+        persist_lsn_ = std::max(persist_lsn, persist_lsn_);
+        ship_lsn_ = persist_lsn_;
+        // 新的日志的lsn接在恢复的日志之后
+        global_lsn_ = std::max(max_lsn, persist_lsn_) + 1;
+        request_lsn_ = std::max(request_lsn_, max_lsn);
+    }
+    ship_cv_.notify_one();
+}
+
+void LogManager::send_batch(LogShipBatch* batch) {
+    batch->cntl_.Reset();
+    batch->response_.Clear();
+    // 日志以attachment的形式发送，直接引用缓冲区中的[head_, tail_)，不拷贝到request中
+    butil::IOBuf& attachment = batch->cntl_.request_attachment();
+    int64_t size1 = std::min(batch->size_, log_buffer_->buf_size_ - batch->head_);
+    attachment.append_user_data(log_buffer_->buffer_ + batch->head_, size1, keep_log_buffer);
+    if(size1 < batch->size_) {
+        attachment.append_user_data(log_buffer_->buffer_, batch->size_ - size1, keep_log_buffer);
+    }
+    storage_service::StorageService_Stub stub(log_channel_);
+    stub.LogWrite(&batch->cntl_, &batch->request_, &batch->response_, brpc::NewCallback(this, &LogManager::on_batch_shipped, batch));
+}
+
+void LogManager::on_batch_shipped(LogShipBatch* batch) {
+    std::lock_guard<std::mutex> lock(flush_latch_);
+    if(batch->cntl_.Failed()) {
+        LOG(ERROR) << "Fail to write log to storage, last lsn: " << batch->last_lsn_ << ", error: " << batch->cntl_.ErrorText();
+        batch->failed_ = true;
+        ship_cv_.notify_one();
+        if(ship_stop_) {
+            flush_cv_.notify_all();
+        }
+        return;
+    }
+
+    batch->finished_ = true;
+    bool advanced = false;
+    while(!inflight_batches_.empty() && inflight_batches_.front()->finished_) {
+        LogShipBatch* finished_batch = inflight_batches_.front();
+        inflight_batches_.pop_front();
+        log_buffer_->release(finished_batch->head_, finished_batch->tail_, finished_batch->size_);
+        persist_lsn_ = finished_batch->last_lsn_;
+        delete finished_batch;
+        advanced = true;
+    }
+    if(advanced) {
+        // 等待缓冲区空间的线程在latch_下检查剩余空间，获取一次latch_保证唤醒不会丢失
+        { std::lock_guard<std::mutex> buffer_lock(latch_); }
+        space_cv_.notify_all();
+    }
+    if(advanced || ship_stop_) {
+        flush_cv_.notify_all();
+        ship_cv_.notify_one();
+    }
+}
+
+
+void LogManager::make_update_redolog(txn_id_t txn_id, int table_id, Rid rid, const char *old_raw, const char *new_raw, const std::vector<ColMeta> &cols, bool is_persist) {
+    auto update_redolog = std::make_unique<UpdateRedoLogRecord>(txn_id, table_id, rid, old_raw, new_raw, cols);
     // update_redolog->lsn_ = global_lsn_++;
     update_redolog->is_persisit_ = is_persist;
 
@@ -84,8 +281,8 @@ void LogManager::make_update_redolog(txn_id_t txn_id, RmRecord &old_record, RmRe
     add_log_to_buffer(std::move(update_redolog));
 }
 
-void LogManager::make_delete_redolog(txn_id_t txn_id, RmRecord &delete_record, Rid rid, std::string table_name, bool is_persist) {
-    auto delete_redolog = std::make_unique<DeleteRedoLogRecord>(txn_id, delete_record, rid, table_name);
+void LogManager::make_delete_redolog(txn_id_t txn_id, int table_id, Rid rid, bool is_persist) {
+    auto delete_redolog = std::make_unique<DeleteRedoLogRecord>(txn_id, table_id, rid);
     // delete_redolog->lsn_ = global_lsn_++;
     delete_redolog->is_persisit_ = is_persist;
 
@@ -99,3 +296,17 @@ void LogManager::make_insert_redolog(txn_id_t txn_id, char *key, int key_size, R
 
     add_log_to_buffer(std::move(insert_redolog));
 }
+
+void LogManager::make_purge_redolog(txn_id_t txn_id, const char *key, int key_size, std::string tab_name, bool is_persist) {
+    auto purge_redolog = std::make_unique<PurgeRedoLogRecord>(txn_id, key, key_size, tab_name);
+    purge_redolog->is_persisit_ = is_persist;
+
+    add_log_to_buffer(std::move(purge_redolog));
+}
+
+void LogManager::make_compact_redolog(txn_id_t txn_id, page_id_t page_no, std::string tab_name, bool is_persist) {
+    auto compact_redolog = std::make_unique<CompactRedoLogRecord>(txn_id, page_no, tab_name);
+    compact_redolog->is_persisit_ = is_persist;
+
+    add_log_to_buffer(std::move(compact_redolog));
+}
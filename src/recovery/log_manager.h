@@ -2,7 +2,10 @@
 
 #include <brpc/channel.h>
 
+#include <condition_variable>
+#include <deque>
 #include <mutex>
+#include <thread>
 #include <vector>
 
 #include "state/allocator/buffer_allocator.h"
@@ -30,31 +33,92 @@
 //     int offset_;    // 写入log的offset
 // };
 
+struct LogShipBatch;
+
+/**
+ * @description: 事务提交的确认时机
+ * STORAGE: commit日志被存储节点写入之后确认
+ * STATE_POOL: commit日志被写入状态节点的日志区域之后确认，日志由log shipper异步发送到存储节点，
+ *             计算节点故障之后由replay_log_for_resumption把状态节点中存储节点还没有的日志重新发送
+ */
+enum class LogCommitMode {
+    STORAGE,
+    STATE_POOL
+};
+
 /* 日志管理器，负责把日志写入日志缓冲区，以及把日志缓冲区中的内容写入磁盘中 */
 class LogManager {
 public:
-    LogManager(brpc::Channel* log_channel, RDMACircularBuffer* log_buffer): log_channel_(log_channel) {
-        log_buffer_ = log_buffer;
-    }
+    LogManager(brpc::Channel* log_channel, RDMACircularBuffer* log_buffer);
+
+    ~LogManager();
     
     lsn_t add_log_to_buffer(std::unique_ptr<RedoLogRecord> redo_log);
 
     RDMACircularBuffer* get_log_buffer() { return log_buffer_; }
 
+    // group commit参数：log shipper最多等待window_us微秒，等待提交的事务达到max_size时立即发送
+    void set_group_commit(int window_us, int max_size) {
+        group_commit_window_us_ = window_us;
+        group_commit_max_size_ = max_size;
+    }
+
+    void set_commit_mode(LogCommitMode commit_mode) { commit_mode_ = commit_mode; }
+
+    LogCommitMode get_commit_mode() { return commit_mode_; }
+
+    void recover_log_shipping(int64_t unpersisted_head, lsn_t persist_lsn, lsn_t max_lsn);
+
+    lsn_t get_persist_lsn() {
+        std::lock_guard<std::mutex> lock(flush_latch_);
+        return persist_lsn_;
+    }
+
     // make redo log
-    void make_update_redolog(txn_id_t txn_id, RmRecord &old_record, RmRecord &new_record, Rid rid, std::string tab_name, bool is_persist = false);
+    // old_raw/new_raw为记录的数据部分(不包括RecordHdr)，日志中只记录cols中取值发生变化的字段
+    void make_update_redolog(txn_id_t txn_id, int table_id, Rid rid, const char *old_raw, const char *new_raw, const std::vector<ColMeta> &cols, bool is_persist = false);
 
-    void make_delete_redolog(txn_id_t txn_id, RmRecord &delete_record, Rid rid, std::string tab_name, bool is_persist = false);
+    void make_delete_redolog(txn_id_t txn_id, int table_id, Rid rid, bool is_persist = false);
 
     void make_insert_redolog(txn_id_t txn_id, char *key, int key_size, RmRecord &insert_record ,Rid rid, std::string tab_name, bool is_persist = false);
 
+    void make_purge_redolog(txn_id_t txn_id, const char *key, int key_size, std::string tab_name, bool is_persist = false);
+
+    void make_compact_redolog(txn_id_t txn_id, page_id_t page_no, std::string tab_name, bool is_persist = false);
+
     void write_log_to_storage();
 
+    void flush_to_lsn(lsn_t lsn);
+
 private:    
+    // log shipper线程：把日志缓冲区中新的日志切分成batch，异步发送，最多LOG_SHIP_MAX_INFLIGHT个batch同时在发送中
+    void ship_log();
+
+    void send_batch(LogShipBatch* batch);
+
+    // LogWrite的回调，在brpc线程中执行
+    void on_batch_shipped(LogShipBatch* batch);
+
     std::atomic<lsn_t>      global_lsn_{0};  // 全局lsn，递增，用于为每条记录分发lsn
     std::mutex              latch_;          // 用于对log_buffer_的互斥访问
+    std::condition_variable space_cv_;       // 与latch_一起使用，on_batch_shipped释放缓冲区空间之后唤醒add_log_to_buffer
     RDMACircularBuffer*     log_buffer_;     // 日志缓冲区
-    lsn_t                   persist_lsn_;    // 记录已经持久化到磁盘中的最后一条日志的日志号
+    lsn_t                   persist_lsn_ = INVALID_LSN;    // 记录已经持久化到磁盘中的最后一条日志的日志号
+
+    // group commit: 提交的事务只等待persist_lsn_越过自己的commit lsn，日志由log shipper线程统一发送
+    std::mutex              flush_latch_;    // 保护persist_lsn_以及下面log shipping的状态
+    std::condition_variable flush_cv_;       // persist_lsn_前进之后唤醒等待的事务
+    std::condition_variable ship_cv_;        // 唤醒log shipper
+    lsn_t                   request_lsn_ = INVALID_LSN;    // 等待持久化的最大lsn
+    lsn_t                   ship_lsn_ = INVALID_LSN;       // 已经交给LogWrite发送的最大lsn
+    int64_t                 ship_tail_;                    // 下一个batch在日志缓冲区中的起始位置
+    std::deque<LogShipBatch*> inflight_batches_;           // 发送中的batch，按照lsn排序
+    int                     waiting_num_ = 0;
+    bool                    ship_stop_ = false;
+    std::thread             ship_thread_;
+    int                     group_commit_window_us_ = GROUP_COMMIT_WINDOW_US;
+    int                     group_commit_max_size_ = GROUP_COMMIT_MAX_SIZE;
+    LogCommitMode           commit_mode_ = LogCommitMode::STORAGE;
     brpc::Channel*          log_channel_;
     DiskManager*            disk_manager_;
 }; 
@@ -1,11 +1,13 @@
 #pragma once
 
 #include <iostream>
+#include <vector>
 #include "common/config.h"
 #include "record/record.h"
 #include "storage/disk_manager.h"
 #include "record/rm_defs.h"
 #include "common/macro.h"
+#include "system/sm_meta.h"
 #include "redolog_defs.h"
 
 /* 日志记录对应操作的类型 */
@@ -16,7 +18,9 @@ enum RedoLogType: int {
     BEGIN,
     COMMIT,
     ABORT,
-    SPLIT
+    SPLIT,
+    PURGE,
+    COMPACT
 };
 static std::string RedoLogTypeStr[] = {
     "UPDATE",
@@ -25,7 +29,9 @@ static std::string RedoLogTypeStr[] = {
     "BEGIN",
     "COMMIT",
     "ABORT",
-    "SPLIT"
+    "SPLIT",
+    "PURGE",
+    "COMPACT"
 };
 
 // redo log
@@ -127,7 +133,8 @@ public:
 // update redo log
 
 /**
- * TODO: update操作的日志记录
+ * update操作的物理日志：通过(table_id, rid)直接定位到记录所在的page和slot，
+ * 只记录取值发生变化的字段，相邻的字段合并为一个range，range的offset是字段在记录数据部分(不包括RecordHdr)中的偏移
 */
 class UpdateRedoLogRecord: public RedoLogRecord {
 public:
@@ -137,83 +144,87 @@ public:
         log_tot_len_ = REDO_LOG_DATA_OFFSET;
         log_tid_ = INVALID_TXN_ID;
         prev_lsn_ = INVALID_LSN;
-        table_name_ = nullptr;
+        table_id_ = -1;
         is_persisit_ = false;
     }
-    UpdateRedoLogRecord(txn_id_t txn_id, RmRecord& old_value, RmRecord& new_value, Rid& rid, std::string table_name)
+    UpdateRedoLogRecord(txn_id_t txn_id, int table_id, Rid& rid, const char* old_raw, const char* new_raw, const std::vector<ColMeta>& cols)
         : UpdateRedoLogRecord() {
         log_tid_ = txn_id;
-        old_value_ = old_value;
-        new_value_ = new_value;
-        log_tot_len_ += sizeof(int) * 2;
-        log_tot_len_ += old_value_.size + new_value_.size;
+        table_id_ = table_id;
+        log_tot_len_ += sizeof(int);
         rid_ = rid;
         log_tot_len_ += sizeof(Rid);
-        table_name_size_ = table_name.length();
-        log_tot_len_ += sizeof(size_t);
-        table_name_ = new char[table_name_size_];
-        memcpy(table_name_, table_name.c_str(), table_name_size_);
-        log_tot_len_ += table_name_size_;
-    }
-
-    ~UpdateRedoLogRecord() override {
-        if(table_name_ != nullptr) {
-            delete[] table_name_;
+        for(auto& col: cols) {
+            if(memcmp(old_raw + col.offset, new_raw + col.offset, col.len) == 0) continue;
+            if(!ranges_.empty() && ranges_.back().first + (int)ranges_.back().second.size() == col.offset) {
+                ranges_.back().second.append(new_raw + col.offset, col.len);
+            } else {
+                ranges_.emplace_back(col.offset, std::string(new_raw + col.offset, col.len));
+            }
+        }
+        log_tot_len_ += sizeof(int);
+        for(auto& range: ranges_) {
+            log_tot_len_ += sizeof(int) * 2 + range.second.size();
         }
     }
 
+    ~UpdateRedoLogRecord() override {}
+
     void serialize(char* dest) const override {
         RedoLogRecord::serialize(dest);
         int offset = REDO_LOG_DATA_OFFSET;
-        memcpy(dest + offset, &old_value_.size, sizeof(int));
+        memcpy(dest + offset, &table_id_, sizeof(int));
         offset += sizeof(int);
-        memcpy(dest + offset, old_value_.data, old_value_.size);
-        offset += old_value_.size;
-        memcpy(dest + offset, &new_value_.size, sizeof(int));
-        offset += sizeof(int);
-        memcpy(dest + offset, new_value_.data, new_value_.size);
-        offset += new_value_.size;
         memcpy(dest + offset, &rid_, sizeof(Rid));
         offset += sizeof(Rid);
-        memcpy(dest + offset, &table_name_size_, sizeof(size_t));
-        offset += sizeof(size_t);
-        memcpy(dest + offset, table_name_, table_name_size_);
+        int range_num = ranges_.size();
+        memcpy(dest + offset, &range_num, sizeof(int));
+        offset += sizeof(int);
+        for(auto& range: ranges_) {
+            int range_len = range.second.size();
+            memcpy(dest + offset, &range.first, sizeof(int));
+            offset += sizeof(int);
+            memcpy(dest + offset, &range_len, sizeof(int));
+            offset += sizeof(int);
+            memcpy(dest + offset, range.second.data(), range_len);
+            offset += range_len;
+        }
     }
     void deserialize(const char* src) override {
         RedoLogRecord::deserialize(src);
-        // printf("finish deserialize log header\n");
-        old_value_.Deserialize(src + REDO_LOG_DATA_OFFSET);
-        // printf("finish deserialze old value\n");
-        int offset = REDO_LOG_DATA_OFFSET + old_value_.size + sizeof(int);
-        new_value_.Deserialize(src + offset);
-        // printf("finish deserialze new value\n");
-        offset += sizeof(int) + new_value_.size;
+        int offset = REDO_LOG_DATA_OFFSET;
+        table_id_ = *reinterpret_cast<const int*>(src + offset);
+        offset += sizeof(int);
         rid_ = *reinterpret_cast<const Rid*>(src + offset);
-        // printf("finish deserialze rid\n");
         offset += sizeof(Rid);
-        table_name_size_ = *reinterpret_cast<const size_t*>(src + offset);
-        offset += sizeof(size_t);
-        table_name_ = new char[table_name_size_];
-        memcpy(table_name_, src + offset, table_name_size_);
+        int range_num = *reinterpret_cast<const int*>(src + offset);
+        offset += sizeof(int);
+        ranges_.clear();
+        ranges_.reserve(range_num);
+        for(int i = 0; i < range_num; ++i) {
+            int range_offset = *reinterpret_cast<const int*>(src + offset);
+            offset += sizeof(int);
+            int range_len = *reinterpret_cast<const int*>(src + offset);
+            offset += sizeof(int);
+            ranges_.emplace_back(range_offset, std::string(src + offset, range_len));
+            offset += range_len;
+        }
     }
     void format_print() override {
         RedoLogRecord::format_print(); 
-        // printf("old_value: %s\n", old_value_.data);
-        printf("old_value: "); print_char_array(old_value_.data, old_value_.size);
-        printf("new_value: "); print_char_array(new_value_.data, new_value_.size);
-        printf("update rid: %d, %d\n", rid_.page_no, rid_.slot_no);
-        printf("table name: %s\n", table_name_);
+        printf("update rid: %d, %d, table_id: %d\n", rid_.page_no, rid_.slot_no, table_id_);
+        for(auto& range: ranges_) {
+            printf("range offset: %d, value: ", range.first); print_char_array(range.second.data(), (int)range.second.size());
+        }
     }
 
-    RmRecord old_value_;
-    RmRecord new_value_;
+    int table_id_;                                      // 记录所在的索引，即PageId中的table_id
     Rid rid_;
-    char* table_name_;
-    size_t table_name_size_;
+    std::vector<std::pair<int, std::string>> ranges_;   // 修改的字段: 偏移量 -> 新的取值
 };
 
 /**
- * TODO: delete操作的日志记录
+ * delete操作的物理日志：只设置记录的删除标记，通过(table_id, rid)直接定位到记录
 */
 class DeleteRedoLogRecord: public RedoLogRecord {
 public:
@@ -223,65 +234,41 @@ public:
         log_tot_len_ = REDO_LOG_DATA_OFFSET;
         log_tid_ = INVALID_TXN_ID;
         prev_lsn_ = INVALID_LSN;
-        table_name_ = nullptr;
+        table_id_ = -1;
         is_persisit_ = false;
     }
-    DeleteRedoLogRecord(txn_id_t txn_id, RmRecord& delete_value, Rid& rid, std::string table_name)
+    DeleteRedoLogRecord(txn_id_t txn_id, int table_id, Rid& rid)
         : DeleteRedoLogRecord() {
         log_tid_ = txn_id;
-        delete_value_ = delete_value;
+        table_id_ = table_id;
         log_tot_len_ += sizeof(int);
-        log_tot_len_ += delete_value_.size;
         rid_ = rid;
         log_tot_len_ += sizeof(Rid);
-        table_name_size_ = table_name.length();
-        log_tot_len_ += sizeof(size_t);
-        table_name_ = new char[table_name_size_];
-        memcpy(table_name_, table_name.c_str(), table_name_size_);
-        log_tot_len_ += table_name_size_;
     }
 
-    ~DeleteRedoLogRecord() override {
-        if(table_name_ != nullptr) {
-            delete[] table_name_;
-        }
-    }
+    ~DeleteRedoLogRecord() override {}
 
     void serialize(char* dest) const override {
         RedoLogRecord::serialize(dest);
         int offset = REDO_LOG_DATA_OFFSET;
-        memcpy(dest + offset, &delete_value_.size, sizeof(int));
+        memcpy(dest + offset, &table_id_, sizeof(int));
         offset += sizeof(int);
-        memcpy(dest + offset, delete_value_.data, delete_value_.size);
-        offset += delete_value_.size;
         memcpy(dest + offset, &rid_, sizeof(Rid));
-        offset += sizeof(Rid);
-        memcpy(dest + offset, &table_name_size_, sizeof(size_t));
-        offset += sizeof(size_t);
-        memcpy(dest + offset, table_name_, table_name_size_);
     }
     void deserialize(const char* src) override {
         RedoLogRecord::deserialize(src);
-        delete_value_.Deserialize(src + REDO_LOG_DATA_OFFSET);
-        int offset = REDO_LOG_DATA_OFFSET + delete_value_.size + sizeof(int);
+        int offset = REDO_LOG_DATA_OFFSET;
+        table_id_ = *reinterpret_cast<const int*>(src + offset);
+        offset += sizeof(int);
         rid_ = *reinterpret_cast<const Rid*>(src + offset);
-        offset += sizeof(Rid);
-        table_name_size_ = *reinterpret_cast<const size_t*>(src + offset);
-        offset += sizeof(size_t);
-        table_name_ = new char[table_name_size_];
-        memcpy(table_name_, src + offset, table_name_size_);
     }
     void format_print() override {
         RedoLogRecord::format_print();
-        printf("delete_value: %s\n", delete_value_.data);
-        printf("delete rid: %d, %d\n", rid_.page_no, rid_.slot_no);
-        printf("table name: %s\n", table_name_);
+        printf("delete rid: %d, %d, table_id: %d\n", rid_.page_no, rid_.slot_no, table_id_);
     }
 
-    RmRecord delete_value_;
+    int table_id_;
     Rid rid_;
-    char* table_name_;
-    size_t table_name_size_;
 };
 
 // insert redo log
@@ -388,6 +375,151 @@ public:
     size_t table_name_size_;    // 表名称的大小
 };
 
+// purge: 从聚簇索引中物理删除一条已经标记删除的记录(或者回滚一条插入的记录)，回放时按照key删除
+class PurgeRedoLogRecord: public RedoLogRecord {
+public:
+    PurgeRedoLogRecord() {
+        log_type_ = RedoLogType::PURGE;
+        lsn_ = INVALID_LSN;
+        log_tot_len_ = REDO_LOG_DATA_OFFSET;
+        log_tid_ = INVALID_TXN_ID;
+        prev_lsn_ = INVALID_LSN;
+        key_ = nullptr;
+        table_name_ = nullptr;
+        is_persisit_ = false;
+    }
+
+    PurgeRedoLogRecord(txn_id_t txn_id, const char *key, int key_size, std::string table_name)
+        : PurgeRedoLogRecord() {
+        log_tid_ = txn_id;
+
+        // key
+        key_ = new char[key_size];
+        key_size_ = key_size;
+        memcpy(key_, key, key_size);
+        log_tot_len_ += sizeof(size_t);
+        log_tot_len_ += key_size;
+
+        // table name
+        table_name_size_ = table_name.length();
+        table_name_ = new char[table_name_size_];
+        memcpy(table_name_, table_name.c_str(), table_name_size_);
+        log_tot_len_ += sizeof(size_t);
+        log_tot_len_ += table_name_size_;
+    }
+
+    ~PurgeRedoLogRecord() override {
+        if(key_ != nullptr) {
+            delete[] key_;
+        }
+        if(table_name_ != nullptr) {
+            delete[] table_name_;
+        }
+    }
+
+    void serialize(char* dest) const override {
+        RedoLogRecord::serialize(dest);
+        int offset = REDO_LOG_DATA_OFFSET;
+        memcpy(dest + offset, &key_size_, sizeof(size_t));
+        offset += sizeof(size_t);
+        memcpy(dest + offset, key_, key_size_);
+        offset += key_size_;
+        memcpy(dest + offset, &table_name_size_, sizeof(size_t));
+        offset += sizeof(size_t);
+        memcpy(dest + offset, table_name_, table_name_size_);
+    }
+
+    void deserialize(const char* src) override {
+        RedoLogRecord::deserialize(src);
+        int offset = REDO_LOG_DATA_OFFSET;
+        key_size_ = *reinterpret_cast<const size_t *>(src + offset);
+        offset += sizeof(size_t);
+        key_ = new char[key_size_];
+        memcpy(key_, src + offset, key_size_);
+        offset += key_size_;
+        table_name_size_ = *reinterpret_cast<const size_t*>(src + offset);
+        offset += sizeof(size_t);
+        table_name_ = new char[table_name_size_];
+        memcpy(table_name_, src + offset, table_name_size_);
+    }
+
+    void format_print() override {
+        printf("purge record\n");
+        RedoLogRecord::format_print();
+        printf("table name: %s\n", table_name_);
+    }
+
+    char *key_;                 // 被删除记录的key
+    size_t key_size_;
+    char* table_name_;
+    size_t table_name_size_;
+};
+
+// compact: 后台压缩线程对从page_no开始的一组叶子进行了重新填充，回放时以相同的参数重新执行一次压缩
+class CompactRedoLogRecord: public RedoLogRecord {
+public:
+    CompactRedoLogRecord() {
+        log_type_ = RedoLogType::COMPACT;
+        lsn_ = INVALID_LSN;
+        log_tot_len_ = REDO_LOG_DATA_OFFSET;
+        log_tid_ = INVALID_TXN_ID;
+        prev_lsn_ = INVALID_LSN;
+        table_name_ = nullptr;
+        is_persisit_ = false;
+    }
+
+    CompactRedoLogRecord(txn_id_t txn_id, page_id_t page_no, std::string table_name)
+        : CompactRedoLogRecord() {
+        log_tid_ = txn_id;
+
+        page_no_ = page_no;
+        log_tot_len_ += sizeof(page_id_t);
+
+        table_name_size_ = table_name.length();
+        table_name_ = new char[table_name_size_];
+        memcpy(table_name_, table_name.c_str(), table_name_size_);
+        log_tot_len_ += sizeof(size_t);
+        log_tot_len_ += table_name_size_;
+    }
+
+    ~CompactRedoLogRecord() override {
+        if(table_name_ != nullptr) {
+            delete[] table_name_;
+        }
+    }
+
+    void serialize(char* dest) const override {
+        RedoLogRecord::serialize(dest);
+        int offset = REDO_LOG_DATA_OFFSET;
+        memcpy(dest + offset, &page_no_, sizeof(page_id_t));
+        offset += sizeof(page_id_t);
+        memcpy(dest + offset, &table_name_size_, sizeof(size_t));
+        offset += sizeof(size_t);
+        memcpy(dest + offset, table_name_, table_name_size_);
+    }
+
+    void deserialize(const char* src) override {
+        RedoLogRecord::deserialize(src);
+        int offset = REDO_LOG_DATA_OFFSET;
+        page_no_ = *reinterpret_cast<const page_id_t*>(src + offset);
+        offset += sizeof(page_id_t);
+        table_name_size_ = *reinterpret_cast<const size_t*>(src + offset);
+        offset += sizeof(size_t);
+        table_name_ = new char[table_name_size_];
+        memcpy(table_name_, src + offset, table_name_size_);
+    }
+
+    void format_print() override {
+        printf("compact leaves\n");
+        RedoLogRecord::format_print();
+        printf("page_no: %d, table name: %s\n", page_no_, table_name_);
+    }
+
+    page_id_t page_no_;         // 压缩的第一个叶子
+    char* table_name_;
+    size_t table_name_size_;
+};
+
 // class InsertWithoutSplitRedologRecord : public RedoLogRecord {
 // public:
 //     InsertWithoutSplitRedoLogRecord() {
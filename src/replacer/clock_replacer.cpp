@@ -1,10 +1,8 @@
 
 #include "replacer/clock_replacer.h"
 
-#include <algorithm>
-
 ClockReplacer::ClockReplacer(size_t num_pages)
-    : circular_{num_pages, ClockReplacer::Status::EMPTY_OR_PINNED}, hand_{0}, capacity_{num_pages} {
+    : circular_{num_pages, ClockReplacer::Status::EMPTY_OR_PINNED}, hand_{0}, capacity_{num_pages}, scan_iters_(num_pages) {
     // 成员初始化列表语法
     circular_.reserve(num_pages);
 }
@@ -14,59 +12,39 @@ ClockReplacer::~ClockReplacer() = default;
 /**
  * @description: 尝试使用clock策略从buffer pool获得一个可用的frame
  * @return {return} 获取到了可用的frame则返回true，否则返回false
- * @param {frame_id_t*} frame_id 若获得了可用的frame，则存储可用的frame的id；否则其值为nullptr
+ * @param {frame_id_t*} frame_id 若获得了可用的frame，则存储可用的frame的id
  */
 bool ClockReplacer::victim(frame_id_t* frame_id) {
     const std::lock_guard<mutex_t> guard(mutex_);
-    size_t unEMPTY_OR_PINNED_count = 0;
-
-    frame_id_t victim_frame_id = 0;
-
-    // scan frame in the buffer pool
-    for (size_t i = 0, idx = (hand_ + i) % capacity_; i < capacity_ + 1; i++, idx = (hand_ + i) % capacity_) {
-        // The frame ref = '1' (ACCESSED) , some thread used it not so long ago
+    // all frame condition EMPTY_OR_PINNED, have not storage page
+    if (size_ == 0) {
+        return false;
+    }
+    // 只被扫描访问过的frame先于指针淘汰
+    if (!scan_list_.empty()) {
+        frame_id_t idx = scan_list_.front();
+        scan_list_.pop_front();
+        circular_[idx] = ClockReplacer::Status::EMPTY_OR_PINNED;
+        size_--;
+        *frame_id = idx;
+        return true;
+    }
+    // 指针扫过ACCESSED的帧时将其置为UNTOUCHED，最多转两圈一定能找到UNTOUCHED的帧
+    while (true) {
+        frame_id_t idx = hand_;
+        hand_ = (hand_ + 1) % capacity_;
         if (circular_[idx] == ClockReplacer::Status::ACCESSED) {
-            unEMPTY_OR_PINNED_count++;
             // make the frame ref = '0' , means this frame can be victim in the next scan
             circular_[idx] = ClockReplacer::Status::UNTOUCHED;
         } else if (circular_[idx] == ClockReplacer::Status::UNTOUCHED) {
-            unEMPTY_OR_PINNED_count++;
-
-            if (victim_frame_id == 0) {
-                victim_frame_id = idx;
-            }
-
-            // victim_frame_id = victim_frame_id != 0 ? victim_frame_id : idx;
-        }
-    }
-
-    // 0U or 0u means unsigned int 0
-    // all frame condition EMPTY_OR_PINNED, have not storage page
-    if (unEMPTY_OR_PINNED_count == 0U) {
-        frame_id = nullptr;
-        return false;
-    }
-
-    // all not EMPTY_OR_PINNED frame just changed from ACCESSED to UNTOUCHED in the above scan
-    // scan again
-    if (victim_frame_id == 0) {
-        for (size_t i = 1, idx = (hand_ + i) % capacity_; i < capacity_ + 1; i++, idx = (hand_ + i) % capacity_) {
-            if (circular_[idx] == ClockReplacer::Status::UNTOUCHED) {
-                victim_frame_id = idx;
-                break;
-            }
+            // because this frame is victim , the page storage in the frame will write back to disk
+            // now this frame can be seen as EMPTY_OR_PINNED
+            circular_[idx] = ClockReplacer::Status::EMPTY_OR_PINNED;
+            size_--;
+            *frame_id = idx;
+            return true;
         }
     }
-
-    *frame_id = victim_frame_id;
-    hand_ = victim_frame_id;  // update scan starter
-
-    // circular_[victim_frame_id] = ClockReplacer::Status::EMPTY_OR_PINNED; // still works..
-    // because this frame is victim , the page storage in the frame will write back to disk
-    // now this frame can be seen as EMPTY_OR_PINNED
-    circular_[victim_frame_id % capacity_] = ClockReplacer::Status::EMPTY_OR_PINNED;
-
-    return false;
 }
 
 /**
@@ -75,6 +53,12 @@ bool ClockReplacer::victim(frame_id_t* frame_id) {
  */
 void ClockReplacer::pin(frame_id_t frame_id) {
     const std::lock_guard<mutex_t> guard(mutex_);
+    if (circular_[frame_id % capacity_] == ClockReplacer::Status::SCANNED) {
+        scan_list_.erase(scan_iters_[frame_id % capacity_]);
+    }
+    if (circular_[frame_id % capacity_] != ClockReplacer::Status::EMPTY_OR_PINNED) {
+        size_--;
+    }
     circular_[frame_id % capacity_] = ClockReplacer::Status::EMPTY_OR_PINNED;
 }
 
@@ -84,20 +68,33 @@ void ClockReplacer::pin(frame_id_t frame_id) {
  */
 void ClockReplacer::unpin(frame_id_t frame_id) {
     const std::lock_guard<mutex_t> guard(mutex_);
+    if (circular_[frame_id % capacity_] == ClockReplacer::Status::SCANNED) {
+        scan_list_.erase(scan_iters_[frame_id % capacity_]);
+    }
+    if (circular_[frame_id % capacity_] == ClockReplacer::Status::EMPTY_OR_PINNED) {
+        size_++;
+    }
     circular_[frame_id % capacity_] = ClockReplacer::Status::ACCESSED;
 }
 
 /**
- * @description: 正在被使用的frame的数量
- * @return {size_t} 正在被使用的frame的数量
+ * @description: 取消固定只被顺序扫描访问过的frame，不设置访问位，将其加入scan_list_，下一次victim时优先淘汰
+ * @param {frame_id_t} frame_id 想要取消固定的frame的id
  */
-size_t ClockReplacer::Size() {
+void ClockReplacer::unpin_scan(frame_id_t frame_id) {
     const std::lock_guard<mutex_t> guard(mutex_);
+    if (circular_[frame_id % capacity_] == ClockReplacer::Status::EMPTY_OR_PINNED) {
+        size_++;
+        circular_[frame_id % capacity_] = ClockReplacer::Status::SCANNED;
+        scan_iters_[frame_id % capacity_] = scan_list_.insert(scan_list_.end(), frame_id % capacity_);
+    }
+}
 
-    // 返回在[arg0, arg1)范围内满足特定条件(arg2)的元素的数目
-    // return all items that in the range[circular_.begin, circular_.end )
-    // and be met the condition: status!=EMPTY_OR_PINNED
-    // That is the number of frames in the buffer pool that storage page (NOT EMPTY_OR_PINNED)
-    return std::count_if(circular_.begin(), circular_.end(),
-                         [](ClockReplacer::Status status) { return status != ClockReplacer::Status::EMPTY_OR_PINNED; });
+/**
+ * @description: 可以被淘汰的frame的数量
+ * @return {size_t} 可以被淘汰的frame的数量
+ */
+size_t ClockReplacer::Size() {
+    const std::lock_guard<mutex_t> guard(mutex_);
+    return size_;
 }
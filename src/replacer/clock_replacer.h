@@ -1,6 +1,7 @@
 
 #pragma once
 
+#include <list>
 #include <mutex>  // NOLINT
 #include <vector>
 
@@ -14,7 +15,8 @@ class ClockReplacer : public Replacer {
     // EMPTY:     该frame没有存储page或者没有被固定
     // ACCESSED:  该frame不久前被线程使用过
     // UNTOUCHED: 该frame可以被victim获取
-    enum class Status { UNTOUCHED, ACCESSED, EMPTY_OR_PINNED };
+    // SCANNED:   该frame只被顺序扫描访问过，在指针转动之前优先被victim获取
+    enum class Status { UNTOUCHED, ACCESSED, EMPTY_OR_PINNED, SCANNED };
 
     /**
      * @description: 创建一个新的ClockReplacer
@@ -30,11 +32,17 @@ class ClockReplacer : public Replacer {
 
     void unpin(frame_id_t frame_id) override;
 
+    void unpin_scan(frame_id_t frame_id) override;
+
     size_t Size() override;
 
    private:
     std::vector<Status> circular_;
     frame_id_t hand_{0};
     size_t capacity_;
+    size_t size_{0};    // 状态不是EMPTY_OR_PINNED的frame的数量
+    // 状态为SCANNED的frame，按照unpin的顺序排列；扫描的页面不经过指针淘汰，否则指针在扫描期间转过的热点页面都会失去访问位
+    std::list<frame_id_t> scan_list_;
+    std::vector<std::list<frame_id_t>::iterator> scan_iters_;
     mutex_t mutex_;
 };
\ No newline at end of file
@@ -67,3 +67,29 @@ TEST(ClockReplacerTest, CornerCaseTest) {
     EXPECT_FALSE(clock_replacer.victim(&value));
     EXPECT_EQ(0, clock_replacer.Size());
 }
+
+TEST(ClockReplacerTest, ScanResistanceTest) {
+    ClockReplacer clock_replacer(8);
+    int value;
+
+    // Scenario: frames 0 and 1 are hot pages, frames 2..7 are unpinned by a sequential scan.
+    clock_replacer.unpin(0);
+    clock_replacer.unpin(1);
+    for (int i = 2; i < 8; ++i) {
+        clock_replacer.unpin_scan(i);
+    }
+    EXPECT_EQ(8, clock_replacer.Size());
+
+    // Scenario: the scanned frames are evicted in the order of unpin, before the hand moves.
+    clock_replacer.pin(3);
+    for (int i = 2; i < 8; ++i) {
+        if (i == 3) continue;
+        EXPECT_TRUE(clock_replacer.victim(&value));
+        EXPECT_EQ(i, value);
+    }
+    // Scenario: frame 3 is accessed normally afterwards, the hot pages keep their reference bits.
+    clock_replacer.unpin(3);
+    EXPECT_TRUE(clock_replacer.victim(&value));
+    EXPECT_EQ(0, value);
+    EXPECT_EQ(2, clock_replacer.Size());
+}
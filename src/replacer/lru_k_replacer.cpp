@@ -0,0 +1,95 @@
+#include "lru_k_replacer.h"
+
+LRUKReplacer::LRUKReplacer(size_t num_pages, size_t k) : frames_(num_pages), k_(k) {}
+
+LRUKReplacer::~LRUKReplacer() = default;
+
+/**
+ * @description: 使用LRU-K策略淘汰一个frame，先淘汰访问次数不足K次的frame，再淘汰倒数第K次访问最早的frame
+ * @param {frame_id_t*} frame_id 被移除的frame的id
+ * @return {bool} 如果成功淘汰了一个页面则返回true，否则返回false
+ */
+bool LRUKReplacer::victim(frame_id_t* frame_id) {
+    std::scoped_lock lock{latch_};
+    auto& candidates = cold_.empty() ? hot_ : cold_;
+    if (candidates.empty()) {
+        return false;
+    }
+    *frame_id = candidates.begin()->second;
+    candidates.erase(candidates.begin());
+    // 被淘汰之后帧中会放入新的页面，访问历史不再有意义
+    frames_[*frame_id].history_.clear();
+    frames_[*frame_id].evictable_ = false;
+    return true;
+}
+
+/**
+ * @description: 固定指定的frame，即该页面无法被淘汰
+ * @param {frame_id_t} 需要固定的frame的id
+ */
+void LRUKReplacer::pin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    FrameInfo& frame = frames_[frame_id];
+    if (!frame.evictable_) {
+        return;
+    }
+    uint64_t key = frame.history_.empty() ? 0 : frame.history_.front();
+    if (frame.history_.size() >= k_) {
+        hot_.erase({key, frame_id});
+    } else {
+        cold_.erase({key, frame_id});
+    }
+    frame.evictable_ = false;
+}
+
+/**
+ * @description: 取消固定一个frame，记录一次访问，代表该页面可以被淘汰
+ * @param {frame_id_t} frame_id 取消固定的frame的id
+ */
+void LRUKReplacer::unpin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    FrameInfo& frame = frames_[frame_id];
+    if (frame.evictable_) {
+        return;
+    }
+    frame.history_.push_back(++current_timestamp_);
+    if (frame.history_.size() > k_) {
+        frame.history_.erase(frame.history_.begin());
+    }
+    set_evictable(frame_id);
+}
+
+/**
+ * @description: 取消固定一个只被顺序扫描访问过的frame，不记录这次访问，扫描读入的页面不会因为扫描而变热
+ * @param {frame_id_t} frame_id 取消固定的frame的id
+ */
+void LRUKReplacer::unpin_scan(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    if (frames_[frame_id].evictable_) {
+        return;
+    }
+    set_evictable(frame_id);
+}
+
+/**
+ * @description: 将frame按照访问历史加入cold_或hot_，没有访问历史的frame最先被淘汰，调用时持有latch_
+ * @param {frame_id_t} frame_id 可以被淘汰的frame的id
+ */
+void LRUKReplacer::set_evictable(frame_id_t frame_id) {
+    FrameInfo& frame = frames_[frame_id];
+    uint64_t key = frame.history_.empty() ? 0 : frame.history_.front();
+    if (frame.history_.size() >= k_) {
+        hot_.emplace(key, frame_id);
+    } else {
+        cold_.emplace(key, frame_id);
+    }
+    frame.evictable_ = true;
+}
+
+/**
+ * @description: 获取当前replacer中可以被淘汰的页面数量
+ */
+size_t LRUKReplacer::Size() {
+    std::scoped_lock lock{latch_};
+    return cold_.size() + hot_.size();
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "common/config.h"
+#include "replacer/replacer.h"
+
+/*
+LRUKReplacer实现了LRU-K替换策略：淘汰backward K-distance(当前时间与倒数第K次访问的时间差)最大的frame，
+访问次数不足K次的frame的K-distance视为无穷大，它们之间按照最早一次访问的时间淘汰。
+只被访问过一次的页面(例如顺序扫描读入的页面)总是先于被多次访问的热点页面被淘汰。
+*/
+class LRUKReplacer : public Replacer {
+   public:
+    /**
+     * @description: 创建一个新的LRUKReplacer
+     * @param {size_t} num_pages LRUKReplacer最多需要存储的page数量，frame_id需要小于num_pages
+     * @param {size_t} k 每个frame记录的最近访问次数
+     */
+    explicit LRUKReplacer(size_t num_pages, size_t k = LRU_K_REPLACER_K);
+
+    ~LRUKReplacer() override;
+
+    bool victim(frame_id_t *frame_id) override;
+
+    void pin(frame_id_t frame_id) override;
+
+    void unpin(frame_id_t frame_id) override;
+
+    void unpin_scan(frame_id_t frame_id) override;
+
+    size_t Size() override;
+
+   private:
+    struct FrameInfo {
+        std::vector<uint64_t> history_; // 最近K次访问的时间戳，首部是最早的一次；空的vector不分配内存，空槽位没有额外的开销
+        bool evictable_ = false;        // 是否在cold_或hot_中
+    };
+
+    void set_evictable(frame_id_t frame_id);
+
+    std::mutex latch_;
+    std::vector<FrameInfo> frames_;
+    // 可以被淘汰的frame，按照history_首部的时间戳排序；cold_中的frame访问次数不足K次，优先被淘汰
+    std::set<std::pair<uint64_t, frame_id_t>> cold_;
+    std::set<std::pair<uint64_t, frame_id_t>> hot_;
+    uint64_t current_timestamp_ = 0;
+    size_t k_;
+};
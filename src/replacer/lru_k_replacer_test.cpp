@@ -0,0 +1,131 @@
+#include "replacer/lru_k_replacer.h"
+
+#include <cstdio>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+TEST(LRUKReplacerTest, SampleTest) {
+    LRUKReplacer lru_k_replacer(7, 2);
+
+    // Scenario: unpin six frames, each of them has been accessed once.
+    for (int i = 1; i <= 6; ++i) {
+        lru_k_replacer.unpin(i);
+    }
+    EXPECT_EQ(6, lru_k_replacer.Size());
+
+    // Scenario: access frame 1 again, it now has 2 accesses and is evicted after all the other frames.
+    lru_k_replacer.pin(1);
+    lru_k_replacer.unpin(1);
+    EXPECT_EQ(6, lru_k_replacer.Size());
+
+    // Scenario: frames with less than k accesses are evicted first, in the order of their first access.
+    int value;
+    EXPECT_TRUE(lru_k_replacer.victim(&value));
+    EXPECT_EQ(2, value);
+    EXPECT_TRUE(lru_k_replacer.victim(&value));
+    EXPECT_EQ(3, value);
+    EXPECT_EQ(4, lru_k_replacer.Size());
+
+    // Scenario: pin frame 4, it can not be evicted.
+    lru_k_replacer.pin(4);
+    EXPECT_EQ(3, lru_k_replacer.Size());
+    EXPECT_TRUE(lru_k_replacer.victim(&value));
+    EXPECT_EQ(5, value);
+
+    // Scenario: frame 4 is accessed twice, its 2nd most recent access is later than frame 1's.
+    lru_k_replacer.unpin(4);
+    EXPECT_TRUE(lru_k_replacer.victim(&value));
+    EXPECT_EQ(6, value);
+    EXPECT_TRUE(lru_k_replacer.victim(&value));
+    EXPECT_EQ(1, value);
+    EXPECT_TRUE(lru_k_replacer.victim(&value));
+    EXPECT_EQ(4, value);
+    EXPECT_FALSE(lru_k_replacer.victim(&value));
+    EXPECT_EQ(0, lru_k_replacer.Size());
+}
+
+TEST(LRUKReplacerTest, EvictedFrameLosesHistory) {
+    LRUKReplacer lru_k_replacer(4, 2);
+    int value;
+
+    lru_k_replacer.unpin(0);
+    lru_k_replacer.pin(0);
+    lru_k_replacer.unpin(0);
+    EXPECT_TRUE(lru_k_replacer.victim(&value));
+    EXPECT_EQ(0, value);
+
+    // Frame 0 holds a new page now, its single access makes it colder than frame 1.
+    lru_k_replacer.unpin(1);
+    lru_k_replacer.pin(1);
+    lru_k_replacer.unpin(1);
+    lru_k_replacer.unpin(0);
+    EXPECT_TRUE(lru_k_replacer.victim(&value));
+    EXPECT_EQ(0, value);
+    EXPECT_TRUE(lru_k_replacer.victim(&value));
+    EXPECT_EQ(1, value);
+}
+
+TEST(LRUKReplacerTest, ScanResistanceTest) {
+    LRUKReplacer lru_k_replacer(8, 2);
+    int value;
+
+    // Scenario: frames 0 and 1 are hot pages.
+    for (int i = 0; i < 2; ++i) {
+        lru_k_replacer.unpin(i);
+        lru_k_replacer.pin(i);
+        lru_k_replacer.unpin(i);
+    }
+    // Scenario: a sequential scan touches frames 2..7, which are evicted before the hot pages.
+    for (int i = 2; i < 8; ++i) {
+        lru_k_replacer.unpin_scan(i);
+    }
+    EXPECT_EQ(8, lru_k_replacer.Size());
+    for (int i = 2; i < 8; ++i) {
+        EXPECT_TRUE(lru_k_replacer.victim(&value));
+        EXPECT_NE(0, value);
+        EXPECT_NE(1, value);
+    }
+    // Scenario: a hot page touched by the scan keeps its history.
+    lru_k_replacer.pin(0);
+    lru_k_replacer.unpin_scan(0);
+    EXPECT_TRUE(lru_k_replacer.victim(&value));
+    EXPECT_EQ(0, value);
+    EXPECT_TRUE(lru_k_replacer.victim(&value));
+    EXPECT_EQ(1, value);
+}
+
+TEST(LRUKReplacerTest, ConcurrencyTest) {
+    const int num_threads = 4;
+    const int num_frames = 1000;
+    LRUKReplacer lru_k_replacer(num_threads * num_frames, 2);
+
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; ++tid) {
+        threads.emplace_back([tid, &lru_k_replacer]() {
+            for (int i = tid * num_frames; i < (tid + 1) * num_frames; ++i) {
+                lru_k_replacer.unpin(i);
+                lru_k_replacer.pin(i);
+                if (i % 2 == 0) {
+                    lru_k_replacer.unpin(i);
+                } else {
+                    lru_k_replacer.unpin_scan(i);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(num_threads * num_frames, lru_k_replacer.Size());
+
+    std::vector<bool> evicted(num_threads * num_frames, false);
+    int value;
+    for (int i = 0; i < num_threads * num_frames; ++i) {
+        EXPECT_TRUE(lru_k_replacer.victim(&value));
+        EXPECT_FALSE(evicted[value]);
+        evicted[value] = true;
+    }
+    EXPECT_FALSE(lru_k_replacer.victim(&value));
+}
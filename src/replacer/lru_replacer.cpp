@@ -16,9 +16,8 @@ bool LRUReplacer::victim(frame_id_t* frame_id) {
     // 它能够避免死锁发生，其构造函数能够自动进行上锁操作，析构函数会对互斥量进行解锁操作，保证线程安全。
     std::scoped_lock<std::mutex> lock{latch_};
     // std::cout << "LRU SIZE = " << LRUlist_.size() << std::endl;
+    // 缓冲池在无锁命中时会并发地pin帧，调用者检查Size()之后列表仍然可能变为空，这里不能抛出异常
     if (LRUlist_.empty()) {
-        // std::cout << "This line is number: " << __FILE__  << ":" << __LINE__ << std::endl;
-        throw RMDBError("LRU Replacer is empty");
         return false;
     }
     // list<int>a，那么a.back()取出的是int类型
@@ -55,7 +54,7 @@ void LRUReplacer::unpin(frame_id_t frame_id) {
         return;
     }
     // 已达最大容量，无法添加到replacer
-    if (Size() == max_size_) {
+    if (LRUlist_.size() == max_size_) {
         return;
     }
     // 正常添加到replacer
@@ -65,6 +64,25 @@ void LRUReplacer::unpin(frame_id_t frame_id) {
 }
 
 /**
- * @description: 获取当前replacer中可以被淘汰的页面数量
+ * @description: 取消固定一个只被顺序扫描访问过的frame，将其放在链表尾部，下一次淘汰时优先淘汰
+ * @param {frame_id_t} frame_id 取消固定的frame的id
  */
-size_t LRUReplacer::Size() { return LRUlist_.size(); }
+void LRUReplacer::unpin_scan(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    if (LRUhash_.count(frame_id) != 0) {
+        return;
+    }
+    if (LRUlist_.size() == max_size_) {
+        return;
+    }
+    LRUlist_.push_back(frame_id);
+    LRUhash_.emplace(frame_id, std::prev(LRUlist_.end()));
+}
+
+/**
+ * @description: 获取当前replacer中可以被淘汰的页面数量，BufferPool无锁的unpin会与之并发
+ */
+size_t LRUReplacer::Size() {
+    std::scoped_lock lock{latch_};
+    return LRUlist_.size();
+}
@@ -27,6 +27,8 @@ class LRUReplacer : public Replacer {
 
     void unpin(frame_id_t frame_id);
 
+    void unpin_scan(frame_id_t frame_id);
+
     size_t Size();
 
    private:
@@ -30,6 +30,14 @@ class Replacer {
      */
     virtual void unpin(frame_id_t frame_id) = 0;
 
+    /**
+     * Unpins a frame that was only touched by a sequential scan since it was last unpinned.
+     * Such a frame should be victimized before the frames used by other accesses, so that a large scan
+     * does not flush the working set out of the buffer pool. By default it is treated as a normal unpin.
+     * @param frame_id the id of the frame to unpin
+     */
+    virtual void unpin_scan(frame_id_t frame_id) { unpin(frame_id); }
+
     /** @return the number of elements in the replacer that can be victimized */
     virtual size_t Size() = 0;
 };
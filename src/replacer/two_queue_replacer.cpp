@@ -0,0 +1,118 @@
+#include "two_queue_replacer.h"
+
+#include <algorithm>
+
+TwoQueueReplacer::TwoQueueReplacer(size_t num_pages, double a1_ratio) : frames_(num_pages) {
+    a1_max_size_ = std::max<size_t>(1, static_cast<size_t>(num_pages * a1_ratio));
+}
+
+TwoQueueReplacer::~TwoQueueReplacer() = default;
+
+/**
+ * @description: 使用2Q策略淘汰一个frame，A1中的frame超过其容量或者Am为空时淘汰A1中最早进入的frame，否则淘汰Am中最久未被访问的frame
+ * @param {frame_id_t*} frame_id 被移除的frame的id
+ * @return {bool} 如果成功淘汰了一个页面则返回true，否则返回false
+ */
+bool TwoQueueReplacer::victim(frame_id_t* frame_id) {
+    std::scoped_lock lock{latch_};
+    bool from_a1 = !a1_list_.empty() && (a1_num_ > a1_max_size_ || am_list_.empty());
+    auto& list = from_a1 ? a1_list_ : am_list_;
+    if (list.empty()) {
+        return false;
+    }
+    *frame_id = list.back();
+    list.pop_back();
+    if (from_a1) {
+        a1_num_--;
+    }
+    frames_[*frame_id].queue_ = Queue::NONE;
+    frames_[*frame_id].evictable_ = false;
+    return true;
+}
+
+/**
+ * @description: 固定指定的frame，即该页面无法被淘汰，frame仍然属于原来的队列
+ * @param {frame_id_t} 需要固定的frame的id
+ */
+void TwoQueueReplacer::pin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    FrameInfo& frame = frames_[frame_id];
+    if (!frame.evictable_) {
+        return;
+    }
+    if (frame.queue_ == Queue::A1) {
+        a1_list_.erase(frame.iter_);
+    } else {
+        am_list_.erase(frame.iter_);
+    }
+    frame.evictable_ = false;
+}
+
+/**
+ * @description: 取消固定一个frame，第一次访问的frame进入A1，在A1中再次被访问的frame提升到Am
+ * @param {frame_id_t} frame_id 取消固定的frame的id
+ */
+void TwoQueueReplacer::unpin(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    FrameInfo& frame = frames_[frame_id];
+    if (frame.evictable_) {
+        return;
+    }
+    if (frame.queue_ == Queue::NONE) {
+        a1_num_++;
+        add_to_queue(frame_id, Queue::A1, true);
+        return;
+    }
+    if (frame.queue_ == Queue::A1) {
+        a1_num_--;
+    }
+    add_to_queue(frame_id, Queue::AM, true);
+}
+
+/**
+ * @description: 取消固定一个只被顺序扫描访问过的frame，它留在A1中最先被淘汰的位置，不会被提升到Am
+ * @param {frame_id_t} frame_id 取消固定的frame的id
+ */
+void TwoQueueReplacer::unpin_scan(frame_id_t frame_id) {
+    std::scoped_lock lock{latch_};
+    FrameInfo& frame = frames_[frame_id];
+    if (frame.evictable_) {
+        return;
+    }
+    if (frame.queue_ == Queue::AM) {
+        add_to_queue(frame_id, Queue::AM, true);
+        return;
+    }
+    if (frame.queue_ == Queue::NONE) {
+        a1_num_++;
+    }
+    add_to_queue(frame_id, Queue::A1, false);
+}
+
+/**
+ * @description: 将frame加入队列的首部或者尾部，调用时持有latch_
+ * @param {frame_id_t} frame_id 可以被淘汰的frame的id
+ * @param {Queue} queue frame加入的队列
+ * @param {bool} front 加入首部为true，加入尾部(下一个被淘汰)为false
+ */
+void TwoQueueReplacer::add_to_queue(frame_id_t frame_id, Queue queue, bool front) {
+    FrameInfo& frame = frames_[frame_id];
+    auto& list = queue == Queue::A1 ? a1_list_ : am_list_;
+    if (front) {
+        list.push_front(frame_id);
+        frame.iter_ = list.begin();
+    } else {
+        list.push_back(frame_id);
+        frame.iter_ = std::prev(list.end());
+    }
+    frame.queue_ = queue;
+    frame.evictable_ = true;
+}
+
+/**
+ * @description: 获取当前replacer中可以被淘汰的页面数量
+ */
+size_t TwoQueueReplacer::Size() {
+    std::scoped_lock lock{latch_};
+    return a1_list_.size() + am_list_.size();
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <vector>
+
+#include "common/config.h"
+#include "replacer/replacer.h"
+
+/*
+TwoQueueReplacer实现了简化的2Q替换策略：第一次被访问的frame进入FIFO队列A1，在A1中再次被访问时提升到LRU队列Am。
+A1中的frame数量超过A1的容量时优先淘汰A1中最早进入的frame，因此只被访问一次的页面(例如顺序扫描读入的页面)不会把Am中的热点页面挤出去。
+replacer只能看到frame，frame被淘汰之后会放入别的页面，因此不维护记录被淘汰页面的A1out队列。
+*/
+class TwoQueueReplacer : public Replacer {
+   public:
+    /**
+     * @description: 创建一个新的TwoQueueReplacer
+     * @param {size_t} num_pages TwoQueueReplacer最多需要存储的page数量，frame_id需要小于num_pages
+     * @param {double} a1_ratio A1队列的容量占num_pages的比例
+     */
+    explicit TwoQueueReplacer(size_t num_pages, double a1_ratio = TWO_QUEUE_A1_RATIO);
+
+    ~TwoQueueReplacer() override;
+
+    bool victim(frame_id_t *frame_id) override;
+
+    void pin(frame_id_t frame_id) override;
+
+    void unpin(frame_id_t frame_id) override;
+
+    void unpin_scan(frame_id_t frame_id) override;
+
+    size_t Size() override;
+
+   private:
+    // frame当前属于的队列，frame被pin住时仍然属于原来的队列，只是不在队列的链表中
+    enum class Queue { NONE, A1, AM };
+
+    struct FrameInfo {
+        Queue queue_ = Queue::NONE;
+        bool evictable_ = false;
+        std::list<frame_id_t>::iterator iter_;
+    };
+
+    void add_to_queue(frame_id_t frame_id, Queue queue, bool front);
+
+    std::mutex latch_;
+    std::vector<FrameInfo> frames_;
+    std::list<frame_id_t> a1_list_;     // A1中可以被淘汰的frame，首部最晚进入，尾部最先被淘汰
+    std::list<frame_id_t> am_list_;     // Am中可以被淘汰的frame，首部表示最近被访问
+    size_t a1_num_ = 0;                 // 属于A1的frame数量，包括被pin住的frame
+    size_t a1_max_size_;                // A1的容量
+};
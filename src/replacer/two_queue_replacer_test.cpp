@@ -0,0 +1,126 @@
+#include "replacer/two_queue_replacer.h"
+
+#include <cstdio>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "gtest/gtest.h"
+
+TEST(TwoQueueReplacerTest, SampleTest) {
+    // A1 holds at most 2 of the 8 frames.
+    TwoQueueReplacer two_queue_replacer(8, 0.25);
+
+    // Scenario: frames 1 and 2 are accessed twice and promoted to Am.
+    for (int i = 1; i <= 2; ++i) {
+        two_queue_replacer.unpin(i);
+        two_queue_replacer.pin(i);
+        two_queue_replacer.unpin(i);
+    }
+    // Scenario: frames 3, 4 and 5 are accessed once and stay in A1.
+    for (int i = 3; i <= 5; ++i) {
+        two_queue_replacer.unpin(i);
+    }
+    EXPECT_EQ(5, two_queue_replacer.Size());
+
+    // Scenario: A1 is over its capacity, so its oldest frame is evicted first.
+    int value;
+    EXPECT_TRUE(two_queue_replacer.victim(&value));
+    EXPECT_EQ(3, value);
+
+    // Scenario: A1 is within its capacity now, the least recently used frame of Am is evicted.
+    EXPECT_TRUE(two_queue_replacer.victim(&value));
+    EXPECT_EQ(1, value);
+
+    // Scenario: pinned frames still count towards A1.
+    two_queue_replacer.pin(4);
+    EXPECT_EQ(2, two_queue_replacer.Size());
+    EXPECT_TRUE(two_queue_replacer.victim(&value));
+    EXPECT_EQ(2, value);
+
+    // Scenario: Am is empty, frames are evicted from A1.
+    EXPECT_TRUE(two_queue_replacer.victim(&value));
+    EXPECT_EQ(5, value);
+    EXPECT_FALSE(two_queue_replacer.victim(&value));
+
+    // Scenario: frame 4 is accessed again and promoted to Am.
+    two_queue_replacer.unpin(4);
+    EXPECT_EQ(1, two_queue_replacer.Size());
+    EXPECT_TRUE(two_queue_replacer.victim(&value));
+    EXPECT_EQ(4, value);
+    EXPECT_EQ(0, two_queue_replacer.Size());
+}
+
+TEST(TwoQueueReplacerTest, ScanResistanceTest) {
+    TwoQueueReplacer two_queue_replacer(16, 0.25);
+    int value;
+
+    // Scenario: frames 0..3 are hot pages in Am.
+    for (int i = 0; i < 4; ++i) {
+        two_queue_replacer.unpin(i);
+        two_queue_replacer.pin(i);
+        two_queue_replacer.unpin(i);
+    }
+    // Scenario: a sequential scan touches frames 4..15 twice, the scanned frames are never promoted.
+    for (int round = 0; round < 2; ++round) {
+        for (int i = 4; i < 16; ++i) {
+            two_queue_replacer.pin(i);
+            two_queue_replacer.unpin_scan(i);
+        }
+    }
+    EXPECT_EQ(16, two_queue_replacer.Size());
+    // Scenario: the scanned frames beyond the capacity of A1 are evicted before the hot pages.
+    for (int i = 4; i < 12; ++i) {
+        EXPECT_TRUE(two_queue_replacer.victim(&value));
+        EXPECT_GE(value, 4);
+    }
+    // Scenario: A1 is within its capacity, the least recently used hot page is evicted.
+    EXPECT_TRUE(two_queue_replacer.victim(&value));
+    EXPECT_EQ(0, value);
+}
+
+TEST(TwoQueueReplacerTest, ScanFrameIsNextVictim) {
+    TwoQueueReplacer two_queue_replacer(8, 0.5);
+    int value;
+
+    two_queue_replacer.unpin(0);
+    two_queue_replacer.unpin(1);
+    two_queue_replacer.unpin_scan(2);
+    EXPECT_TRUE(two_queue_replacer.victim(&value));
+    EXPECT_EQ(2, value);
+    EXPECT_TRUE(two_queue_replacer.victim(&value));
+    EXPECT_EQ(0, value);
+}
+
+TEST(TwoQueueReplacerTest, ConcurrencyTest) {
+    const int num_threads = 4;
+    const int num_frames = 1000;
+    TwoQueueReplacer two_queue_replacer(num_threads * num_frames);
+
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; ++tid) {
+        threads.emplace_back([tid, &two_queue_replacer]() {
+            for (int i = tid * num_frames; i < (tid + 1) * num_frames; ++i) {
+                two_queue_replacer.unpin(i);
+                two_queue_replacer.pin(i);
+                if (i % 2 == 0) {
+                    two_queue_replacer.unpin(i);
+                } else {
+                    two_queue_replacer.unpin_scan(i);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(num_threads * num_frames, two_queue_replacer.Size());
+
+    std::vector<bool> evicted(num_threads * num_frames, false);
+    int value;
+    for (int i = 0; i < num_threads * num_frames; ++i) {
+        EXPECT_TRUE(two_queue_replacer.victim(&value));
+        EXPECT_FALSE(evicted[value]);
+        evicted[value] = true;
+    }
+    EXPECT_FALSE(two_queue_replacer.victim(&value));
+}
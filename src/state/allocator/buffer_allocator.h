@@ -229,10 +229,12 @@ public:
         write(src, LOCK_STATE_SIZE_LOCAL);
     }
 
+    // 调用者需要保证剩余空间足够(见LogManager::add_log_to_buffer)，否则会覆盖还没有发送的日志
     void write_log(RedoLogRecord* redolog) {
         int curr_tail;
         {
             std::lock_guard<std::mutex> latch(latch_);
+            assert(redolog->log_tot_len_ < free_size_);
             curr_tail = tail_;
             tail_ = (tail_ + redolog->log_tot_len_) % buf_size_;
             free_size_ -= redolog->log_tot_len_;
@@ -292,8 +294,8 @@ public:
             return std::move(std::string(buffer_ + head, size));
         }
         else {
-            int size1 = buf_size_ - head_;
-            std::string str1(buffer_ + head_, size1);
+            int size1 = buf_size_ - head;
+            std::string str1(buffer_ + head, size1);
             std::string str2(buffer_, size - size1);
             return std::move(str1 + str2);
         }
@@ -369,6 +371,32 @@ public:
                 delete redo_log_hdr;
                 return insert_redo_log;
             } break;
+            case RedoLogType::PURGE: {
+                PurgeRedoLogRecord* purge_redo_log = new PurgeRedoLogRecord();
+                if(log_tail < head) {
+                    std::string tmp = std::move(get_range_string(head, log_tail, redo_log_hdr->log_tot_len_));
+                    purge_redo_log->deserialize(tmp.c_str());
+                }
+                else {
+                    purge_redo_log->deserialize(buffer_ + head);
+                }
+                head += redo_log_hdr->log_tot_len_;
+                delete redo_log_hdr;
+                return purge_redo_log;
+            } break;
+            case RedoLogType::COMPACT: {
+                CompactRedoLogRecord* compact_redo_log = new CompactRedoLogRecord();
+                if(log_tail < head) {
+                    std::string tmp = std::move(get_range_string(head, log_tail, redo_log_hdr->log_tot_len_));
+                    compact_redo_log->deserialize(tmp.c_str());
+                }
+                else {
+                    compact_redo_log->deserialize(buffer_ + head);
+                }
+                head += redo_log_hdr->log_tot_len_;
+                delete redo_log_hdr;
+                return compact_redo_log;
+            } break;
             default:
             std::cout << "Invalid log type\n";
             return nullptr;
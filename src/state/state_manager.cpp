@@ -119,6 +119,31 @@ void ContextManager::flush_logs(int64_t curr_state_tail, int64_t curr_head, int6
     log_flush_thread_cv_.notify_all();
 }
 
+/**
+ * used by the state_pool commit mode: a transaction is acknowledged once its commit log is durable in the state node,
+ * the requests of concurrent transactions are merged into one flush_logs() by the log flush thread
+ */
+void ContextManager::wait_logs_durable() {
+    std::unique_lock<std::mutex> lock(log_flush_mutex_);
+    int64_t curr_head;
+    int64_t curr_tail;
+    log_rdma_buffer_->get_curr_head_tail(curr_head, curr_tail);
+    {
+        std::scoped_lock<std::mutex> latch(state_latch_);
+        curr_log_head_ = curr_head;
+        curr_log_tail_ = curr_tail;
+        need_flush_offset_ = curr_tail;
+    }
+    // all the logs in the buffer have been written into the state node
+    if(need_flush_offset_ == flushed_log_offset_) return;
+
+    uint64_t request_seq = ++log_flush_request_seq_;
+    log_flush_thread_cv_.notify_all();
+    log_flush_thread_cv_.wait(lock, [&]() {
+        return log_flush_done_seq_ >= request_seq;
+    });
+}
+
 void ContextManager::checkpoint() {
     // only one flush_states operation can be invoked simultaneously
     std::unique_lock<std::mutex> latch(state_latch_);
@@ -183,19 +208,8 @@ void ContextManager::fetch_and_print_lock_states() {
     delete[] origin_bitmap;
 }
 
-LockRequestQueue* ContextManager::get_record_request_queue_(int record_no, LockListInBucket* lock_list) {
-    LockRequestQueue* request_queue = lock_list->first_lock_queue_;
-    while(request_queue != nullptr) {
-        if(request_queue->record_no_ == record_no) {
-            return request_queue;
-        }
-        request_queue = request_queue->next_;
-    }   
-
-    return nullptr;
-}
-
-void ContextManager::fetch_lock_states(std::unordered_map<LockDataId, LockListInBucket>* lock_table, Transaction** active_txn_list, int thread_num) {
+// 从状态节点读取所有锁并加入到所属的事务中，由LockManager把它们放回锁表
+void ContextManager::fetch_lock_states(std::vector<Lock*>* locks, Transaction** active_txn_list, int thread_num) {
 
     std::unordered_map<int, int> index_id_map_for_txn;
     for(int i = 0; i < thread_num; ++i) {
@@ -221,66 +235,9 @@ void ContextManager::fetch_lock_states(std::unordered_map<LockDataId, LockListIn
         // std::cout << "print lock:\n";
         // std::cout << "trx_id_: " << lock->trx_id_ << ", table_id: " << lock->table_id_ << ", record_no: " << lock->record_no_ << "\n";
         // add lock into txn
-        active_txn_list[index_id_map_for_txn[lock->trx_id_]]->append_lock(lock);
-        if(lock->record_no_ == -1) {
-            // table lock
-            LockDataId lock_data_id(lock->table_id_, LockDataType::TABLE);
-            if(lock_table->count(lock_data_id) == 0) {
-                LockRequestQueue* request_queue = new LockRequestQueue();
-                request_queue->request_queue_->next_ = lock;
-                lock->prev_ = request_queue->request_queue_;
-                lock_table->emplace(std::piecewise_construct, std::forward_as_tuple(lock_data_id), 
-                                    std::forward_as_tuple());
-                LockListInBucket* lock_list_in_page = &lock_table->find(lock_data_id)->second;
-                lock_list_in_page->bucket_id_ = -1;
-                lock_list_in_page->first_lock_queue_ = request_queue;
-                continue;
-            }
-            LockListInBucket* lock_list_in_page = &lock_table->find(lock_data_id)->second;
-            LockRequestQueue* request_queue = lock_list_in_page->first_lock_queue_;
-            if(request_queue == nullptr) {
-                LockRequestQueue* request_queue = new LockRequestQueue();
-                request_queue->request_queue_->next_ = lock;
-                lock->prev_ = request_queue->request_queue_;
-                lock_list_in_page->first_lock_queue_ = request_queue;
-            }
-            else {
-                lock->next_ = request_queue->request_queue_->next_;
-                lock->prev_ = request_queue->request_queue_;
-                if(request_queue->request_queue_->next_ != nullptr) {
-                    request_queue->request_queue_->next_->prev_ = lock;
-                }
-                request_queue->request_queue_->next_ = lock;
-            }
-        }
-        else {
-            // record lock
-            LockDataId lock_data_id(lock->table_id_, lock->record_no_, LockDataType::RECORD);
-            if(lock_table->count(lock_data_id) == 0) {
-                LockRequestQueue* request_queue = new LockRequestQueue(lock->record_no_, lock);
-                lock_table->emplace(std::piecewise_construct, std::forward_as_tuple(lock_data_id), 
-                            std::forward_as_tuple());
-                LockListInBucket* lock_list_in_page = &lock_table->find(lock_data_id)->second;
-                lock_list_in_page->bucket_id_ = lock->record_no_ / BUCKET_SIZE;
-                lock_list_in_page->first_lock_queue_ = request_queue;
-                continue;
-            }
-            LockListInBucket* lock_list_in_page = &lock_table->find(lock_data_id)->second;
-            LockRequestQueue* request_queue = get_record_request_queue_(lock->record_no_, lock_list_in_page);
-            if(request_queue == nullptr) {
-                request_queue = new LockRequestQueue(lock->record_no_, lock);
-                request_queue->next_ = lock_list_in_page->first_lock_queue_;
-                lock_list_in_page->first_lock_queue_ = request_queue;
-            }
-            else {
-                lock->next_ = request_queue->request_queue_->next_;
-                lock->prev_ = request_queue->request_queue_;
-                if(request_queue->request_queue_->next_ != nullptr) {
-                    request_queue->request_queue_->next_->prev_ = lock;
-                }
-                request_queue->request_queue_->next_ = lock;
-            }
-        }
+        lock->txn_ = active_txn_list[index_id_map_for_txn[lock->trx_id_]];
+        lock->txn_->append_lock(lock);
+        locks->push_back(lock);
         // std::cout << "lock trx_id: " << lock->trx_id_ << ", table_id: " << lock->table_id_ << ", record_no:" << lock->record_no_ << "\n";
     }
 }
@@ -55,11 +55,13 @@ public:
     // // implementation of the r_write_context_entry() for log
     void flush_logs(int64_t curr_state_tail, int64_t curr_head, int64_t curr_tail);
 
+    // wait until all the logs currently in the log buffer are written into the state node
+    void wait_logs_durable();
+
     void checkpoint();
 
     // implementation for read_context() interfaces
-    void fetch_lock_states(std::unordered_map<LockDataId, LockListInBucket>* lock_table, Transaction** active_txn_list, int thread_num);
-    LockRequestQueue* get_record_request_queue_(int record_no, LockListInBucket* lock_list);
+    void fetch_lock_states(std::vector<Lock*>* locks, Transaction** active_txn_list, int thread_num);
     void fetch_log_states();
     void fetch_active_txns(Transaction** active_txn_list, int thread_num);
 
@@ -162,6 +164,7 @@ private:
             int64_t curr_need_flush_offset;
             int64_t curr_head;
             int64_t curr_tail;
+            uint64_t curr_request_seq = log_flush_request_seq_;
             {
                 std::scoped_lock<std::mutex> latch(state_latch_);
                 curr_need_flush_offset = need_flush_offset_;
@@ -169,6 +172,8 @@ private:
                 curr_tail = curr_log_tail_;
             }
             flush_logs(curr_need_flush_offset, curr_head, curr_tail);
+            log_flush_done_seq_ = curr_request_seq;
+            log_flush_thread_cv_.notify_all();
         }
     }
 
@@ -178,6 +183,8 @@ private:
     std::thread log_flush_thread_;
     std::mutex log_flush_mutex_;
     std::condition_variable log_flush_thread_cv_;
+    uint64_t log_flush_request_seq_ = 0;        // the number of wait_logs_durable() requests, protected by log_flush_mutex_
+    uint64_t log_flush_done_seq_ = 0;           // the requests that have been covered by a finished flush_logs()
 
     std::thread lock_flush_thread_;
     std::mutex lock_flush_mutex_;
@@ -1,34 +1,245 @@
 #include "buffer_pool_manager.h"
+
+#include <sys/mman.h>  // for mmap
+
+#include <climits>     // for IOV_MAX
+
 #include "storage/storage_service.pb.h"
 #include "debug_log.h"
 
+FramePool::FramePool(size_t frame_num, char* frame_data) {
+    pages_ = new Page[frame_num];
+    free_frames_.reserve(frame_num);
+    // 逆序加入，先分配的帧在数据区的前部
+    for (size_t i = frame_num; i > 0; --i) {
+        pages_[i - 1].data_ = frame_data + (i - 1) * PAGE_SIZE;
+        free_frames_.push_back(&pages_[i - 1]);
+    }
+    free_num_.store(frame_num, std::memory_order_relaxed);
+}
+
+/**
+ * @description: 为requester分配一个帧，优先使用空闲帧，否则依次让hand_指向的分区借出一个帧，
+ *              hand_指向requester自己时由requester淘汰自己的页面，调用时持有requester的latch_
+ * @return {Page*} 分配的帧，没有可用的帧或者需要requester淘汰自己的页面时返回nullptr
+ * @param {BufferPool*} requester 需要帧的分区
+ * @param {bool} evict_self requester是否有可以淘汰的页面，为false时询问所有其他分区
+ */
+Page* FramePool::get_frame(BufferPool* requester, bool evict_self) {
+    if (free_num_.load(std::memory_order_relaxed) > 0) {
+        std::scoped_lock lock{latch_};
+        if (!free_frames_.empty()) {
+            Page* page = free_frames_.back();
+            free_frames_.pop_back();
+            free_num_.store(free_frames_.size(), std::memory_order_relaxed);
+            return page;
+        }
+    }
+    size_t tries = evict_self ? BUFFER_POOL_LEND_TRIES : BUFFER_POOL_NUM;
+    for (size_t i = 0; i < tries; ++i) {
+        BufferPool* buffer_pool = buffer_pools_[hand_.fetch_add(1, std::memory_order_relaxed) % BUFFER_POOL_NUM];
+        if (buffer_pool == requester) {
+            if (evict_self) return nullptr;
+            continue;
+        }
+        Page* page = buffer_pool->lend_frame();
+        if (page != nullptr) return page;
+    }
+    return nullptr;
+}
+
+/**
+ * @description: 归还一个不再持有页面的帧
+ * @param {Page*} page 归还的帧
+ */
+void FramePool::put_frame(Page* page) {
+    std::scoped_lock lock{latch_};
+    free_frames_.push_back(page);
+    free_num_.store(free_frames_.size(), std::memory_order_relaxed);
+}
+
 /**
  * @description: 从free_list或replacer中得到可淘汰帧页的 *frame_id
+ *              分区还有空槽位时先向FramePool申请一个帧(空闲帧或者其他分区借出的帧)，否则淘汰本分区的页面，
+ *              本分区没有可以淘汰的页面时再向所有其他分区借一个帧
  * @return {bool} true: 可替换帧查找成功 , false: 可替换帧查找失败
  * @param {frame_id_t*} frame_id 帧页id指针,返回成功找到的可替换帧id
  */
 bool BufferPool::find_victim_page(frame_id_t* frame_id) {
-    // Todo:
-    // 1 使用BufferPool::free_list_判断缓冲池是否已满需要淘汰页面
-    // 1.1 未满获得frame
-    // 1.2 已满使用lru_replacer中的方法选择淘汰页面
-    // std::cout << "This line is number: " << __FILE__  << ":" << __LINE__ << std::endl;
-    // 1 缓冲池还有freepages(缓冲池未满),即free_list非空,直接从free_list取出一个
+    // 1 还有空槽位，从FramePool获取一个帧
     // 注意,在此函数中从free_list首部取出frame_id,在DeletePage函数中从free_list尾部添加frame_id
     if (!free_list_.empty()) {
-        *frame_id = free_list_.front();
-        free_list_.pop_front();
+        Page* page = frame_pool_->get_frame(this, replacer_->Size() > 0);
+        if (page != nullptr) {
+            attach_frame(page, frame_id);
+            return true;
+        }
+    }
+    // 2 淘汰本分区的页面
+    if (replacer_->Size() > 0 && evict_page(frame_id)) {
         return true;
     }
-    // std::cout << "This line is number: " << __FILE__  << ":" << __LINE__ << std::endl;
-    // std::cout << "replacer_: " << (char *)replacer_ << std::endl;
-    // 2 缓冲池已满，根据LRU策略计算是否有victim frame_id
-    bool ret = replacer_->victim(frame_id);
+    // 3 本分区没有可以淘汰的页面，向其他分区借一个帧
+    if (!free_list_.empty()) {
+        Page* page = frame_pool_->get_frame(this, false);
+        if (page != nullptr) {
+            attach_frame(page, frame_id);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @description: 根据置换策略淘汰本分区的一个页面，调用时持有latch_
+ * @return {bool} 淘汰成功返回true
+ * @param {frame_id_t*} frame_id 被淘汰页面所在的槽位
+ */
+bool BufferPool::evict_page(frame_id_t* frame_id) {
+    // 正在被后台刷脏写回的页面不能被淘汰，否则写回失败时无法重新标记为脏页，再次读取时也可能读到旧的数据
+    std::vector<frame_id_t> skipped;
+    bool ret = false;
+    // fetch_page_optimistic不持有latch_也会从replacer中pin走帧，Size()大于0时victim仍然可能失败
+    while (replacer_->victim(frame_id)) {
+        Page* page = frames_[*frame_id];
+        // 无锁路径上的pin和unpin不持有latch_，replacer中可能有已经被pin住的帧或者空槽位，直接丢弃，
+        // 被pin住的帧在pin count减为0时会重新加入replacer
+        if (page == nullptr) {
+            continue;
+        }
+        if (writing_pages_.empty() || writing_pages_.count(page->get_page_id()) == 0) {
+            if (page->try_lock_frame()) {
+                ret = true;
+                break;
+            }
+            continue;
+        }
+        skipped.push_back(*frame_id);
+        if (replacer_->Size() == 0) {
+            break;
+        }
+    }
+    for (frame_id_t skipped_frame : skipped) {
+        replacer_->unpin(skipped_frame);
+    }
     return ret;
 }
 
+/**
+ * @description: 把从FramePool获取的帧放入一个空槽位，调用时持有latch_
+ * @param {Page*} page 获取的帧，不在任何分区的页表中
+ * @param {frame_id_t*} frame_id 返回帧所在的槽位
+ */
+void BufferPool::attach_frame(Page* page, frame_id_t* frame_id) {
+    *frame_id = free_list_.front();
+    free_list_.pop_front();
+    frames_[*frame_id] = page;
+    page->frame_id_ = *frame_id;
+    frame_num_++;
+}
+
+/**
+ * @description: 槽位中的帧已经不再持有页面(已从页表中移除且不在replacer中)，把处于锁定状态的帧归还给FramePool，调用时持有latch_
+ * @param {frame_id_t} frame_id 释放的槽位
+ */
+void BufferPool::release_frame(frame_id_t frame_id) {
+    frame_pool_->put_frame(frames_[frame_id]);
+    frames_[frame_id] = nullptr;
+    free_list_.push_back(frame_id);  // 加到尾部
+    frame_num_--;
+}
+
+/**
+ * @description: 其他分区没有空闲帧可用时，从本分区淘汰一个不需要写回的页面，把它的帧借出去。
+ *              调用者持有自己分区的latch_，这里只尝试获取latch_，避免两个分区互相借帧时死锁
+ * @return {Page*} 借出的帧，无法借出时返回nullptr
+ */
+Page* BufferPool::lend_frame() {
+    std::unique_lock<std::mutex> lock{latch_, std::try_to_lock};
+    // Size()只用于快速跳过，无锁命中可能在这之后pin走帧，以victim的返回值为准
+    if (!lock.owns_lock() || frame_num_ <= min_size_ || replacer_->Size() == 0) {
+        return nullptr;
+    }
+    frame_id_t frame_id;
+    if (!replacer_->victim(&frame_id)) {
+        return nullptr;
+    }
+    Page* page = frames_[frame_id];
+    if (page == nullptr || !page->try_lock_frame()) {
+        return nullptr;
+    }
+    // 存储节点的脏页需要写回才能淘汰，正在写回的页面也不能淘汰，这里不等待IO，放回replacer
+    if ((node_type_ == STORAGE_NODE && page->is_dirty_) || writing_pages_.count(page->get_page_id()) > 0) {
+        page->unlock_frame(0);
+        if (page->is_scan_) {
+            replacer_->unpin_scan(frame_id);
+        } else {
+            replacer_->unpin(frame_id);
+        }
+        return nullptr;
+    }
+    // 计算节点的页面可以随时从存储层重新获取，脏页直接丢弃
+    PageId invalid_page_id{.table_id = page->get_page_id().table_id, .page_no = INVALID_PAGE_ID};
+    update_page(page, invalid_page_id, frame_id);
+    page->is_dirty_ = false;
+    frames_[frame_id] = nullptr;
+    free_list_.push_back(frame_id);
+    frame_num_--;
+    return page;
+}
+
+/**
+ * @description: 淘汰脏页时把页面数据拷贝出来，由调用者在释放latch_之后写回磁盘，写回完成之前该页面记录在writing_pages_中，
+ *              读取该页面的线程需要等待写回完成，调用时持有latch_
+ * @return {bool} 需要写回返回true
+ * @param {Page*} page 被淘汰的帧
+ * @param {FlushPage*} evicted 拷贝出来的页面
+ */
+bool BufferPool::copy_evicted_page(Page* page, FlushPage* evicted) {
+    if (!page->is_dirty() || page->get_page_id().page_no == INVALID_PAGE_ID) {
+        return false;
+    }
+    evicted->page_id_ = page->get_page_id();
+    evicted->data_ = FlushPage::alloc_data();
+    memcpy(evicted->data_.get(), page->get_data(), PAGE_SIZE);
+    page->is_dirty_ = false;
+    writing_pages_[evicted->page_id_]++;
+    return true;
+}
+
+/**
+ * @description: 页面的一次写回完成，调用时持有latch_，调用者释放latch_之后需要唤醒load_cv_上的等待者
+ * @param {PageId} page_id 写回的页面
+ */
+void BufferPool::end_write(PageId page_id) {
+    auto iter = writing_pages_.find(page_id);
+    if (iter != writing_pages_.end() && --iter->second == 0) {
+        writing_pages_.erase(iter);
+    }
+}
+
+/**
+ * @description: 拷贝出来的页面写回完成，写回失败时页面如果还在缓冲池中则重新标记为脏页，并唤醒等待该页面写回的线程
+ * @param {PageId} page_id 写回的页面
+ * @param {bool} success 是否写回成功
+ */
+void BufferPool::finish_write(PageId page_id, bool success) {
+    {
+        std::scoped_lock lock{latch_};
+        end_write(page_id);
+        if (!success) {
+            Page* page = page_table_.find(page_id);
+            if (page != nullptr) {
+                page->is_dirty_ = true;
+            }
+        }
+    }
+    load_cv_.notify_all();
+}
+
 /**
  * @description: 更新页面数据, 如果为脏页则需写入磁盘，再更新为新页面，更新page元数据(data, is_dirty, page_id)和page table
+ *              调用时持有latch_并且帧已经被锁定，无锁的查找不会pin住正在被替换的帧
  * @param {Page*} page 写回页指针
  * @param {PageId} new_page_id 新的page_id
  * @param {frame_id_t} new_frame_id 新的帧frame_id
@@ -39,62 +250,191 @@ void BufferPool::update_page(Page *page, PageId new_page_id, frame_id_t new_fram
     // 2 更新page table
     // 3 重置page的data，更新page id
     // std::cout << "This line is number: " << __FILE__  << ":" << __LINE__ << std::endl;
+    // 预读的页面在被访问之前就被替换
+    if (page->is_prefetched_) {
+        page->is_prefetched_ = false;
+        prefetch_misses_++;
+    }
     // 2 更新page table
-    page_table_.erase(page->get_page_id());          // 删除页表中原page_id和其对应frame_id
+    if (page->get_page_id().page_no != INVALID_PAGE_ID) {
+        page_table_.erase(page->get_page_id());      // 删除页表中原page_id和其对应的帧
+    }
     if (new_page_id.page_no != INVALID_PAGE_ID) {  // 注意INVALID_PAGE_ID不要加到页表
-        page_table_[new_page_id] = new_frame_id;   // 新的page_id和其对应frame_id加到页表
+        page_table_.insert(new_page_id, page);     // 新的page_id和其对应的帧加到页表
     }
 
     // 3 重置page的data，更新page id
     page->reset_memory();
     page->id_ = new_page_id;
+    page->frame_tag_.store(new_page_id.Get(), std::memory_order_release);
 }
 
-void BufferPool::fetch_page_from_disk(Page* page, PageId page_id, frame_id_t frame_id) {
-    // 1 如果是脏页，一定要写回磁盘，并且把dirty置为false
-    if (page->is_dirty()) {
-        disk_manager_->write_page(disk_manager_->get_table_fd(page->get_page_id().table_id), page->get_page_id().page_no, page->get_data(), PAGE_SIZE);
-        page->is_dirty_ = false;
+/**
+ * @description: 存储节点从磁盘读取页面。调用时持有latch_，先把帧加入页表并标记为is_loading_，
+ *              然后释放latch_，把被淘汰脏页的写回和目标页面的读取放在同一个batch中提交
+ * @return {Page*} 读取完成并被pin住的页面
+ * @param {unique_lock<mutex>&} lock 持有latch_的锁，返回时已经释放
+ * @param {Page*} page victim帧
+ * @param {PageId} page_id 需要读取的页面
+ * @param {frame_id_t} frame_id victim帧的帧号
+ */
+Page* BufferPool::fetch_page_from_disk(std::unique_lock<std::mutex>& lock, Page* page, PageId page_id, frame_id_t frame_id) {
+    // 1 如果是脏页，一定要写回磁盘，先把数据拷贝出来，帧中的数据会被目标页面覆盖
+    FlushPage evicted;
+    bool need_write = copy_evicted_page(page, &evicted);
+    update_page(page, page_id, frame_id);
+    replacer_->pin(frame_id);
+    page->is_loading_ = true;
+    lock.unlock();
+
+    DiskIOBatch batch;
+    if (need_write) {
+        batch.add_write(disk_manager_->get_table_io_fd(evicted.page_id_.table_id), evicted.page_id_.page_no, evicted.data_.get(), PAGE_SIZE);
     }
-    update_page(page, page_id, frame_id);  // data置为空，dirty页写入磁盘，然后dirty状态置false
-    disk_manager_->read_page(disk_manager_->get_table_fd(page_id.table_id), page_id.page_no, page->get_data(), PAGE_SIZE);
+    batch.add_read(disk_manager_->get_table_io_fd(page_id.table_id), page_id.page_no, page->get_data(), PAGE_SIZE);
+    batch.submit();
+    batch.wait();
+    bool write_success = !need_write || batch.succeeded(0);
+    bool read_success = batch.succeeded(batch.size() - 1);
+
+    lock.lock();
+    if (need_write) {
+        end_write(evicted.page_id_);
+    }
+    page->is_loading_ = false;
+    if (!read_success) {
+        PageId invalid_page_id{.table_id = page_id.table_id, .page_no = INVALID_PAGE_ID};
+        update_page(page, invalid_page_id, frame_id);
+        release_frame(frame_id);
+    } else {
+        // 加载完成，解锁之后可以被无锁的fetch_page命中
+        page->unlock_frame(1);
+    }
+    lock.unlock();
+    load_cv_.notify_all();
+    if (!write_success) {
+        throw InternalError("BufferPool::fetch_page_from_disk write back Error");
+    }
+    if (!read_success) {
+        throw InternalError("DiskManager::read_page Error");
+    }
+    return page;
 }
 
-void BufferPool::fetch_page_from_rpc(Page* page, PageId page_id, frame_id_t frame_id) {
+/**
+ * @description: 通过GetLatestPage从存储层获取页面的最新版本, 调用时不持有latch_
+ *              调用者需要保证该帧已经被pin住并且被标记为is_loading_, 防止该帧在加载过程中被淘汰
+ * @return {bool} rpc成功返回true, 否则返回false
+ * @param {Page*} page 用于存放页面数据的帧
+ * @param {PageId} page_id 需要获取的页面
+ */
+bool BufferPool::fetch_page_from_rpc(Page* page, PageId page_id) {
     // RwServerDebug::getInstance()->DEBUG_PRINT("[fetch_page_from_rpc][begin][table id: " + std::to_string(page_id.table_id) + ", page no: " + std::to_string(page_id.page_no));
-    update_page(page, page_id, frame_id);
-    storage_service::StorageService_Stub stub(page_channel_);
+    return fetch_pages_from_rpc(page_channel_, slice_mgr_, {page_id}, {page});
+}
+
+/**
+ * @description: 在一次GetLatestPage rpc中获取多个页面的最新版本, 调用时不持有任何buffer pool的latch_
+ * @return {bool} rpc成功返回true, 否则返回false
+ * @param {Channel*} page_channel 与存储层通信的channel
+ * @param {SliceMetaManager*} slice_mgr 用于获取页面所在slice的最新lsn
+ * @param {vector<PageId>&} page_ids 需要获取的页面
+ * @param {vector<Page*>&} pages 用于存放页面数据的帧, pages[i]存放page_ids[i]的数据
+ */
+bool BufferPool::fetch_pages_from_rpc(brpc::Channel* page_channel, SliceMetaManager* slice_mgr, const std::vector<PageId>& page_ids, const std::vector<Page*>& pages) {
+    storage_service::StorageService_Stub stub(page_channel);
     storage_service::GetLatestPageRequest request;
-    storage_service::GetLatestPageResponse* response = new storage_service::GetLatestPageResponse;
-    brpc::Controller* cntl = new brpc::Controller;
-
-    request.add_page_id();
-    request.mutable_page_id(0)->set_table_id(page_id.table_id);
-    request.mutable_page_id(0)->set_slice_id(page_id.page_no / SLICE_NUM);
-    request.mutable_page_id(0)->set_page_no(page_id.page_no);
-    request.add_latest_lsn(slice_mgr_->get_latest_lsn(SliceId(page_id.table_id, page_id.page_no/SLICE_NUM)));
+    storage_service::GetLatestPageResponse response;
+    brpc::Controller cntl;
+
+    for(size_t i = 0; i < page_ids.size(); ++i) {
+        auto* page_id = request.add_page_id();
+        page_id->set_table_id(page_ids[i].table_id);
+        page_id->set_slice_id(page_ids[i].page_no / SLICE_NUM);
+        page_id->set_page_no(page_ids[i].page_no);
+        request.add_latest_lsn(slice_mgr->get_latest_lsn(SliceId(page_ids[i].table_id, page_ids[i].page_no / SLICE_NUM)));
+    }
     // std::cout << "try to get page: table_id:" << page_id.table_id << ", page_id:" << page_id.page_no << "\n";
-    stub.GetLatestPage(cntl, &request, response, NULL);
+    stub.GetLatestPage(&cntl, &request, &response, NULL);
     // std::cout << "response->data.size" << response->data().size() << "\n";
 
+    // 页面通过response attachment按照请求的顺序返回，直接拷贝到帧中
+    butil::IOBuf& attachment = cntl.response_attachment();
+    if(cntl.Failed() || attachment.size() != page_ids.size() * PAGE_SIZE) {
+        LOG(ERROR) << "Fail to fetch " << page_ids.size() << " pages from storage, first page: " 
+                   << PageId(page_ids[0]).toString() << ", error: " << cntl.ErrorText();
+        return false;
+    }
     // RwServerDebug::getInstance()->DEBUG_PRINT("[fetch_page_from_rpc][end][table id: " + std::to_string(page_id.table_id) + ", page no: " + std::to_string(page_id.page_no));
-    memcpy(page->data_, response->data()[0].c_str(), PAGE_SIZE);
-    delete response;
-    delete cntl;
+    for(size_t i = 0; i < pages.size(); ++i) {
+        attachment.cutn(pages[i]->get_data(), PAGE_SIZE);
+    }
+    return true;
+}
+
+/**
+ * @description: 为预读的页面分配一个帧，将其加入页表并标记为is_loading_，由预读线程在释放latch_后统一发送rpc或者读取磁盘
+ * @return {Page*} 分配的帧，如果页面已经在缓冲池中(或正在被加载、正在被写回)，或者没有可用的帧，则返回nullptr
+ * @param {PageId} page_id 需要预读的页面
+ * @param {FlushPage*} evicted 存储节点传入，用于接收被淘汰的脏页，由调用者写回后调用finish_write；计算节点不写回被淘汰的页面
+ */
+Page* BufferPool::reserve_prefetch_frame(PageId page_id, FlushPage* evicted) {
+    std::scoped_lock lock{latch_};
+
+    if (page_table_.find(page_id) != nullptr || writing_pages_.count(page_id) > 0) {
+        return nullptr;
+    }
+    // 预读不会替换正在被使用的页面，也不会为了预读而阻塞
+    frame_id_t frame_id = INVALID_FRAME_ID;
+    if ((free_list_.empty() && replacer_->Size() == 0) || !find_victim_page(&frame_id)) {
+        return nullptr;
+    }
+    Page *page = frames_[frame_id];
+    if (evicted != nullptr) {
+        copy_evicted_page(page, evicted);
+    }
+    update_page(page, page_id, frame_id);
+    replacer_->pin(frame_id);
+    page->is_loading_ = true;
+    page->is_scan_ = false;
+    return page;
+}
+
+/**
+ * @description: 预读的rpc完成后，取消预读帧的loading状态并unpin，唤醒等待该页面的线程
+ * @param {Page*} page reserve_prefetch_frame返回的帧
+ * @param {bool} success rpc是否成功
+ */
+void BufferPool::finish_prefetch(Page* page, bool success) {
+    {
+        std::scoped_lock lock{latch_};
+        frame_id_t frame_id = page->frame_id_;
+        // 加载过程中帧处于锁定状态，其他线程只会在load_cv_上等待而不会pin该帧
+        page->is_loading_ = false;
+        if (!success) {
+            PageId invalid_page_id{.table_id = page->get_page_id().table_id, .page_no = INVALID_PAGE_ID};
+            update_page(page, invalid_page_id, frame_id);
+            release_frame(frame_id);
+        } else {
+            page->is_prefetched_ = true;
+            page->unlock_frame(0);
+            replacer_->unpin(frame_id);
+        }
+    }
+    load_cv_.notify_all();
 }
 
 /**
  * @description: 从buffer pool获取需要的页。
  *              如果页表中存在page_id（说明该page在缓冲池中），并且pin_count++。
  *              如果页表不存在page_id（说明该page在磁盘中），则找缓冲池victim page，将其替换为磁盘中读取的page，pin_count置1。
+ *              从存储层或磁盘获取页面时，先将帧标记为is_loading_并释放latch_，其他请求同一页面的线程在load_cv_上等待该帧加载完成，
+ *              不会重复发送rpc或读取磁盘，也不会阻塞同一分区中其他页面的访问。
  * @return {Page*} 若获得了需要的页则将其返回，否则返回nullptr
  * @param {PageId} page_id 需要获取的页的PageId
+ * @param {AccessType} access 顺序扫描传入SCAN，页面上一次unpin之后只被扫描访问过时，pin count减为0后会被replacer优先淘汰
  */
-Page* BufferPool::fetch_page(PageId page_id) {
-    /**
-     * @note: this function is specifically used in compute_pool
-    */
-   
+Page* BufferPool::fetch_page(PageId page_id, AccessType access) {
     //Todo:
     // 1.     从page_table_中搜寻目标页
     // 1.1    若目标页有被page_table_记录，则将其所在frame固定(pin)，并返回目标页。
@@ -103,95 +443,153 @@ Page* BufferPool::fetch_page(PageId page_id) {
     // 3.     调用disk_manager_的read_page读取目标页到frame
     // 4.     固定目标页，更新pin_count_
     // 5.     返回目标页
-    // std::scoped_lock lock{latch_};
-    // std::cout << "This line is number: " << __FILE__  << ":" << __LINE__ << std::endl;
-    std::scoped_lock lock{latch_};
-
-    if(page_id.page_no == 0)
-        std::cout << "try to fetch page, pageid={tabel_id=" << page_id.table_id << ",page_no=" << page_id.page_no << "}\n";
-
-    auto iter = page_table_.find(page_id);
-    // 1 该page在页表中存在（说明该page在缓冲池中）
-    if (iter != page_table_.end()) {
-        if(page_id.page_no == 0)
-            std::cout << "page found in buffer\n";
-        frame_id_t frame_id = iter->second;  // iter是pair类型，其second是page_id对应的frame_id
-        Page *page = &pages_[frame_id];      // 由frame_id得到page
-        replacer_->pin(frame_id);            // pin it
-        page->pin_count_++;                  // 更新pin_count
-        // std::cout << "[PIN][PageNo: " << page_id.page_no << "]" << std::endl;
+    // 0 先不获取latch_查找页表，命中时直接pin住页面返回
+    Page *page = fetch_page_optimistic(page_id, access);
+    if (page != nullptr) {
         return page;
     }
-    if(page_id.page_no == 0)
-        std::cout << "page not found in buffer\n";
-    // 2 该page在页表中不存在（说明该page不在缓冲池中，而在磁盘中）
+    // 未命中，或者页面正在被加载、替换时，获取latch_重新查找
+    std::unique_lock<std::mutex> lock{latch_};
+
     frame_id_t frame_id = INVALID_FRAME_ID;
-    // 2.1 没有找到victim page
-    if (!find_victim_page(&frame_id)) {
-        return nullptr;
+    while (true) {
+        page = page_table_.find(page_id);
+        if (page == nullptr) {
+            // 1.0 该page刚被淘汰，正在写回磁盘，等待写回完成后再从磁盘读取
+            if (writing_pages_.count(page_id) > 0) {
+                load_cv_.wait(lock);
+                continue;
+            }
+            // 2 该page在页表中不存在（说明该page不在缓冲池中，而在磁盘中）
+            if (find_victim_page(&frame_id)) {
+                break;
+            }
+            // 2.1 没有找到victim page，如果可以淘汰的页面都在被写回，等待写回完成后重试
+            if (writing_pages_.empty()) {
+                return nullptr;
+            }
+            load_cv_.wait(lock);
+            continue;
+        }
+        // 1 该page在页表中存在（说明该page在缓冲池中或正在被其他线程加载）
+        frame_id = page->frame_id_;
+        if (!page->is_loading_) {
+            if (page->is_prefetched_) {
+                page->is_prefetched_ = false;
+                prefetch_hits_++;
+            }
+            fetch_hits_.fetch_add(1, std::memory_order_relaxed);
+            // 持有latch_时页表中没有在加载的帧都没有被锁定，与无锁路径上的pin通过原子操作并发
+            if (page->pin() == 0) {
+                page->is_scan_ = (access == AccessType::SCAN);
+            } else if (access == AccessType::NORMAL) {
+                page->is_scan_ = false;
+            }
+            replacer_->pin(frame_id);            // pin it
+            // std::cout << "[PIN][PageNo: " << page_id.page_no << "]" << std::endl;
+            return page;
+        }
+        // 1.1 其他线程正在加载该页面，等待其加载完成后重新查找页表（加载失败时该页会从页表中移除）
+        // 加载完成之后帧可能被淘汰并借给其他分区，先确认帧仍然持有该页面再读取is_loading_
+        load_cv_.wait(lock, [this, page, page_id] { return page_table_.find(page_id) != page || !page->is_loading_; });
     }
-    // 2.2 找到victim page，将其data替换为磁盘中该page的内容
-    Page *page = &pages_[frame_id];
-    // disk_manager_->ReadPage(page_id, page->data_);
-    // disk_manager_->read_page(page->get_page_id().fd, page->get_page_id().page_no, page->get_data(), PAGE_SIZE);
+    // 2.2 找到victim page(已经被锁定)，将其data替换为磁盘中该page的内容
+    fetch_misses_.fetch_add(1, std::memory_order_relaxed);
+    page = frames_[frame_id];
+    page->is_scan_ = (access == AccessType::SCAN);
     if(node_type_ == STORAGE_NODE) {
-        fetch_page_from_disk(page, page_id, frame_id);
-    }
-    else {
-        fetch_page_from_rpc(page, page_id, frame_id);
+        return fetch_page_from_disk(lock, page, page_id, frame_id);
     }
 
-    replacer_->pin(frame_id);  // pin it
-    page->pin_count_ = 1;
+    // 2.3 计算节点: 先将帧加入页表并标记为loading，pin住防止被淘汰，然后释放latch_发送rpc
+    update_page(page, page_id, frame_id);
+    replacer_->pin(frame_id);
+    page->is_loading_ = true;
+    lock.unlock();
+
+    bool success = fetch_page_from_rpc(page, page_id);
+
+    lock.lock();
+    page->is_loading_ = false;
+    if (!success) {
+        // 加载失败，归还该帧，等待者会重新查找页表并自行发起加载
+        PageId invalid_page_id{.table_id = page_id.table_id, .page_no = INVALID_PAGE_ID};
+        update_page(page, invalid_page_id, frame_id);
+        release_frame(frame_id);
+        page = nullptr;
+    } else {
+        page->unlock_frame(1);
+    }
+    lock.unlock();
+    load_cv_.notify_all();
     // std::cout << "[PIN][PageNo: " << page_id.page_no << "]" << std::endl;
     return page;
 }
 
+/**
+ * @description: fetch_page命中时不获取latch_的路径。无锁查找页表得到帧，在帧没有被锁定(淘汰、加载中)并且帧中仍然是该页面时
+ *              原子地增加pin count；pin count从0变为1时才需要通知replacer，replacer有自己的锁
+ * @return {Page*} pin住的页面，未命中、页面正在被加载或替换、页面是还没有被访问过的预读页面时返回nullptr，由调用者获取latch_重试
+ * @param {PageId} page_id 需要获取的页的PageId
+ * @param {AccessType} access 访问方式
+ */
+Page* BufferPool::fetch_page_optimistic(PageId page_id, AccessType access) {
+    Page* page = page_table_.find(page_id);
+    // 预读页面的第一次访问在latch_下统计预读命中
+    if (page == nullptr || page->is_prefetched_.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    int pin_count = page->try_pin(page_id.Get());
+    if (pin_count < 0) {
+        return nullptr;
+    }
+    fetch_hits_.fetch_add(1, std::memory_order_relaxed);
+    if (pin_count == 0) {
+        page->is_scan_ = (access == AccessType::SCAN);
+        // 帧被pin住之后不会被替换，frame_id_不会改变
+        replacer_->pin(page->frame_id_);
+    } else if (access == AccessType::NORMAL) {
+        page->is_scan_ = false;
+    }
+    return page;
+}
+
 /**
  * @description: 取消固定pin_count>0的在缓冲池中的page
+ *              调用者持有该页面的pin，帧不会被替换，无锁查找到的帧中是该页面时直接原子地减少pin count，不需要获取latch_
  * @return {bool} 如果目标页的pin_count<=0则返回false，否则返回true
  * @param {PageId} page_id 目标page的page_id
  * @param {bool} is_dirty 若目标page应该被标记为dirty则为true，否则为false
  */
 bool BufferPool::unpin_page(PageId page_id, bool is_dirty) {
-    // Todo:
-    // 0. lock latch
-    // 1. 尝试在page_table_中搜寻page_id对应的页P
-    // 1.1 P在页表中不存在 return false
-    // 1.2 P在页表中存在，获取其pin_count_
-    // 2.1 若pin_count_已经等于0，则返回false
-    // 2.2 若pin_count_大于0，则pin_count_自减一
-    // 2.2.1 若自减后等于0，则调用replacer_的Unpin
-    // 3 根据参数is_dirty，更改P的is_dirty_
-    
-    try {
+    Page* page = page_table_.find(page_id);
+    if (page == nullptr || page->frame_tag_.load(std::memory_order_acquire) != page_id.Get()) {
+        // 1 无锁查找可能因为并发的删除而没有找到，获取latch_重新查找
         std::scoped_lock lock{latch_};
-    } catch(const std::system_error& e) {
-        std::cout << "system_error: " << e.code() << "meaning: " << e.what() << "\n";
+        page = page_table_.find(page_id);
+        // 1.1 该page在页表中不存在
+        if (page == nullptr) {
+            return false;
+        }
     }
-
-    auto iter = page_table_.find(page_id);
-    // 1 该page在页表中不存在
-    if (iter == page_table_.end()) {
-        return false;
+    // 2 pin count减为0之后帧可能马上被替换，先读取帧的槽位和访问方式，并标记脏页
+    frame_id_t frame_id = page->frame_id_;
+    bool is_scan = page->is_scan_;
+    if (is_dirty) {
+        page->is_dirty_ = true;  // this logic is NOT equal to: page->is_dirty_ = is_dirty
     }
-    // 2 该page在页表中存在
-    frame_id_t frame_id = iter->second;  // iter是pair类型，其second是page_id对应的frame_id
-    Page *page = &pages_[frame_id];      // 由frame_id得到page
+    int pin_count = page->unpin();
     // 2.1 pin_count = 0
-    if (page->pin_count_ == 0) {
+    if (pin_count < 0) {
         return false;
     }
-    // 2.2 pin_count > 0
-    // 只有pin_count>0才能进行pin_count--，如果pin_count=0之前就直接返回了
-    page->pin_count_--;  // 这里特别注意，只有pin_count减到0的时候才让replacer进行unpin
-    // std::cout << "[UNPIN][PageNo: " << page_id.page_no << "}" << std::endl;
-    
-    if (page->pin_count_ == 0) {
-        replacer_->unpin(frame_id);
-    }
-    if (is_dirty) {
-        page->is_dirty_ = true;  // this logic is NOT equal to: page->is_dirty_ = is_dirty
+    // 2.2 只有pin_count减到0的时候才让replacer进行unpin
+    if (pin_count == 0) {
+        if (is_scan) {
+            replacer_->unpin_scan(frame_id);
+        } else {
+            replacer_->unpin(frame_id);
+        }
     }
     return true;
 }
@@ -199,16 +597,16 @@ bool BufferPool::unpin_page(PageId page_id, bool is_dirty) {
 /**
  * @description: 创建一个新的page，即从磁盘中移动一个新建的空page到缓冲池某个位置。
  * @return {Page*} 返回新创建的page，若创建失败则返回nullptr
- * @param {PageId*} page_id 当成功创建一个新的page时存储其page_id
+ * @param {PageId*} page_id 新page的page_id，page_no已经由BufferPoolManager分配
  */
 Page* BufferPool::new_page(PageId* page_id) {
     // 1.   获得一个可用的frame，若无法获得则返回nullptr
-    // 2.   在fd对应的文件分配一个新的page_id
+    // 2.   更新页表，page_id在调用之前已经分配
     // 3.   将frame的数据写回磁盘
     // 4.   固定frame，更新pin_count_
     // 5.   返回获得的page
     // std::cout << "This line is number: " << __FILE__  << ":" << __LINE__ << std::endl;
-    std::scoped_lock lock{latch_};
+    std::unique_lock<std::mutex> lock{latch_};
 
     // std::cout << "This line is number: " << __FILE__  << ":" << __LINE__ << std::endl;
     frame_id_t frame_id = INVALID_FRAME_ID;
@@ -219,19 +617,28 @@ Page* BufferPool::new_page(PageId* page_id) {
     }
     // std::cout << "This line is number: " << __FILE__  << ":" << __LINE__ << std::endl;
     // 2 得到victim frame_id（从free_list或replacer中得到）
-    (*page_id).page_no =
-        disk_manager_->allocate_page(disk_manager_->get_table_fd((*page_id).table_id));  // 在fd对应的文件分配一个新的page_id（修改了外部参数*page_id）
-    Page *page = &pages_[frame_id];                  // 由frame_id得到page
+    Page *page = frames_[frame_id];                  // 由frame_id得到page
     // std::cout << "This line is number: " << __FILE__  << ":" << __LINE__ << std::endl;
-    if (page->is_dirty()) {
-        disk_manager_->write_page(disk_manager_->get_table_fd(page->get_page_id().table_id), page->get_page_id().page_no, page->get_data(), PAGE_SIZE);
-        page->is_dirty_ = false;
-    }
+    // 3 被淘汰的脏页在释放latch_之后再写回
+    FlushPage evicted;
+    bool need_write = copy_evicted_page(page, &evicted);
     // std::cout << "This line is number: " << __FILE__  << ":" << __LINE__ << std::endl;
     update_page(page, *page_id, frame_id);
     // std::cout << "This line is number: " << __FILE__  << ":" << __LINE__ << std::endl;
     replacer_->pin(frame_id);
-    page->pin_count_ = 1;
+    page->is_scan_ = false;
+    page->unlock_frame(1);
+    lock.unlock();
+    if (need_write) {
+        DiskIOBatch batch;
+        batch.add_write(disk_manager_->get_table_io_fd(evicted.page_id_.table_id), evicted.page_id_.page_no, evicted.data_.get(), PAGE_SIZE);
+        batch.submit();
+        bool success = batch.wait();
+        finish_write(evicted.page_id_, success);
+        if (!success) {
+            throw InternalError("BufferPool::new_page write back Error");
+        }
+    }
     // std::cout << "[PIN][PageNo: " << (*page_id).page_no << "]" << std::endl;
     return page;
 }
@@ -247,24 +654,25 @@ bool BufferPool::delete_page(PageId page_id) {
     // 3.   将目标页数据写回磁盘，从页表中删除目标页，重置其元数据，将其加入free_list_，返回true
     std::scoped_lock lock{latch_};
 
-    auto iter = page_table_.find(page_id);
+    Page *page = page_table_.find(page_id);
     // 1 该page在页表中不存在
-    if (iter == page_table_.end()) {
+    if (page == nullptr) {
         return true;
     }
     // 2 该page在页表中存在
-    frame_id_t frame_id = iter->second;  // iter是pair类型，其second是page_id对应的frame_id
-    Page *page = &pages_[frame_id];      // 由frame_id得到page
+    frame_id_t frame_id = page->frame_id_;
 
     // the page still used by some thread, can not deleted(replaced)
-    if (page->pin_count_ > 0) {
+    // 锁定帧，之后无锁的fetch_page不能再pin住它
+    if (!page->try_lock_frame()) {
         return false;
     }
     // Now, pin_count is 0, so you can delete it
     // disk_manager_->deallocate_page(page_id);  // This does not actually need to do anything for now
     PageId new_page_id{.table_id = page->get_page_id().table_id, .page_no = INVALID_PAGE_ID};
     update_page(page, new_page_id, frame_id);  // 注意此处不要把INVALID_PAGE_ID加到页表
-    free_list_.push_back(frame_id);           // 加到尾部
+    replacer_->pin(frame_id);                 // 该帧归还给FramePool，不能再被replacer淘汰
+    release_frame(frame_id);
     return true;
 }
 
@@ -285,20 +693,36 @@ bool BufferPool::flush_page(PageId page_id) {
     if (page_id.page_no == INVALID_PAGE_ID) {
         return false;
     }
-    auto iter = page_table_.find(page_id);
+    Page *page = page_table_.find(page_id);
     // 1 该page在页表中不存在
-    if (iter == page_table_.end()) {
+    if (page == nullptr) {
         return false;
     }
     // 2 该page在页表中存在
-    frame_id_t frame_id = iter->second;  // iter是pair类型，其second是page_id对应的frame_id
-    Page *page = &pages_[frame_id];      // 由frame_id得到page
+    // 正在加载的帧中还没有有效的数据
+    if (page->is_loading_) {
+        return false;
+    }
     // force_page(page); // 这里不能写成force_page中只刷新脏页，这里就算不是脏的也进行刷新
-    disk_manager_->write_page(disk_manager_->get_table_fd(page->get_page_id().table_id), page->get_page_id().page_no, page->get_data(), PAGE_SIZE);
-    page->is_dirty_ = false;
+    write_back(page);
     return true;
 }
 
+/**
+ * @description: 同步写回页面并清除脏标记，调用时持有latch_。无锁的unpin_page可能同时把页面标记为脏页，
+ *              先清除脏标记再写回，写回期间的修改会保留脏标记，写回失败时恢复脏标记
+ * @param {Page*} page 写回的页面
+ */
+void BufferPool::write_back(Page* page) {
+    page->is_dirty_ = false;
+    try {
+        disk_manager_->write_page(disk_manager_->get_table_io_fd(page->get_page_id().table_id), page->get_page_id().page_no, page->get_data(), PAGE_SIZE);
+    } catch (...) {
+        page->is_dirty_ = true;
+        throw;
+    }
+}
+
 /**
  * @description: 将buffer_pool中的所有页写回到磁盘
  * @param {int} table_id 表id
@@ -306,11 +730,249 @@ bool BufferPool::flush_page(PageId page_id) {
 void BufferPool::flush_all_pages(int table_id) {
     std::scoped_lock lock{latch_};
 
-    for (size_t i = 0; i < pool_size_; i++) {
-        Page *page = &pages_[i];
-        if (page->get_page_id().table_id == table_id && page->get_page_id().page_no != INVALID_PAGE_ID) {
-            disk_manager_->write_page(disk_manager_->get_table_fd(page->get_page_id().table_id), page->get_page_id().page_no, page->get_data(), PAGE_SIZE);
-            page->is_dirty_ = false;
+    for (size_t i = 0; i < max_size_; i++) {
+        Page *page = frames_[i];
+        if (page == nullptr) {
+            continue;
+        }
+        if (page->get_page_id().table_id == table_id && page->get_page_id().page_no != INVALID_PAGE_ID && !page->is_loading_) {
+            write_back(page);
         }
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @description: 从next_frame开始扫描缓冲池，把脏页的数据拷贝出来并清除脏标记，拷贝max_pages个页面或者扫描完整个缓冲池时返回
+ *              拷贝期间持有latch_，拷贝之后再被修改的页面会在unpin时重新标记为脏页，
+ *              拷贝出来的页面在调用finish_write之前记录在writing_pages_中，不会被淘汰
+ * @return {bool} 已经扫描完整个缓冲池返回true
+ * @param {size_t*} next_frame 开始扫描的帧，返回时更新为下一个需要扫描的帧
+ * @param {size_t} max_pages pages中最多的页面数量
+ * @param {vector<FlushPage>*} pages 拷贝出来的脏页
+ */
+bool BufferPool::copy_dirty_pages(size_t* next_frame, size_t max_pages, std::vector<FlushPage>* pages) {
+    std::scoped_lock lock{latch_};
+    for (; *next_frame < max_size_ && pages->size() < max_pages; ++(*next_frame)) {
+        Page* page = frames_[*next_frame];
+        if (page == nullptr || !page->is_dirty_ || page->is_loading_ || page->id_.page_no == INVALID_PAGE_ID) {
+            continue;
+        }
+        FlushPage flush_page{page->id_, FlushPage::alloc_data()};
+        // 无锁的unpin_page会并发地设置脏标记，先清除再拷贝，拷贝期间被修改的页面仍然是脏页
+        page->is_dirty_ = false;
+        memcpy(flush_page.data_.get(), page->get_data(), PAGE_SIZE);
+        pages->push_back(std::move(flush_page));
+        writing_pages_[page->id_]++;
+    }
+    return *next_frame >= max_size_;
+}
+
+void BufferPool::get_writing_pages(std::vector<PageId>* page_ids) {
+    std::scoped_lock lock{latch_};
+    for (auto& entry : writing_pages_) {
+        page_ids->push_back(entry.first);
+    }
+}
+
+/**
+ * @description: 等待page_ids中的页面写回完成。写回完成之前页面不能被重新加载，因此也不会被再次淘汰，
+ *              页面不在writing_pages_中时调用之前开始的写回一定已经完成
+ * @param {vector<PageId>&} page_ids get_writing_pages返回的页面
+ */
+void BufferPool::wait_for_writes(const std::vector<PageId>& page_ids) {
+    std::unique_lock<std::mutex> lock{latch_};
+    for (auto& page_id : page_ids) {
+        load_cv_.wait(lock, [&]() { return writing_pages_.count(page_id) == 0; });
+    }
+}
+
+/**
+ * @description: 存储节点后台刷脏，把所有缓冲池中的脏页按批拷贝出来写回磁盘，最后把表文件落盘，
+ *              返回true时，调用之前完成的修改都已经持久化
+ * @return {bool} 所有脏页都写回并落盘返回true
+ * @param {size_t*} flushed 写回的页面数量
+ */
+bool BufferPoolManager::flush_dirty_pages(size_t* flushed) {
+    bool success = true;
+    *flushed = 0;
+    // 淘汰脏页的线程在释放latch_之后才写回，此时正在写回的页面不在缓冲池中，也不会被拷贝，
+    // 需要等它们写入表文件之后再落盘，否则这些修改没有持久化，对应的日志却会被删除
+    std::vector<std::vector<PageId>> writing_pages(BUFFER_POOL_NUM);
+    for (size_t i = 0; i < BUFFER_POOL_NUM; ++i) {
+        buffer_pools_[i]->get_writing_pages(&writing_pages[i]);
+    }
+    std::vector<FlushPage> pages;
+    for (size_t i = 0; i < BUFFER_POOL_NUM; ++i) {
+        size_t next_frame = 0;
+        bool finished = false;
+        while (!finished) {
+            finished = buffer_pools_[i]->copy_dirty_pages(&next_frame, PAGE_FLUSH_BATCH_SIZE, &pages);
+            if (pages.size() >= PAGE_FLUSH_BATCH_SIZE) {
+                success &= write_flush_pages(pages, flushed);
+                pages.clear();
+            }
+        }
+    }
+    success &= write_flush_pages(pages, flushed);
+    for (size_t i = 0; i < BUFFER_POOL_NUM; ++i) {
+        buffer_pools_[i]->wait_for_writes(writing_pages[i]);
+    }
+    // 被淘汰的脏页也只是写入了page cache
+    try {
+        disk_manager_->sync_table_files();
+    } catch (RMDBError& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        success = false;
+    }
+    return success;
+}
+
+/**
+ * @description: 按照(table_id, page_no)排序，同一个文件中连续的页面合并为一个写请求，所有写请求放在一个batch中一起提交
+ * @return {bool} 所有页面都写回成功返回true，写入失败的页面会被重新标记为脏页
+ * @param {vector<FlushPage>&} pages 拷贝出来的脏页
+ * @param {size_t*} flushed 累加成功写回的页面数量
+ */
+bool BufferPoolManager::write_flush_pages(std::vector<FlushPage>& pages, size_t* flushed) {
+    std::sort(pages.begin(), pages.end(), [](const FlushPage& a, const FlushPage& b) {
+        if (a.page_id_.table_id != b.page_id_.table_id) return a.page_id_.table_id < b.page_id_.table_id;
+        return a.page_id_.page_no < b.page_id_.page_no;
+    });
+    DiskIOBatch batch;
+    std::vector<size_t> run_begins;     // 每个写请求的第一个页面在pages中的下标
+    size_t begin = 0;
+    while (begin < pages.size()) {
+        size_t end = begin + 1;
+        while (end < pages.size() && end - begin < IOV_MAX && pages[end].page_id_.table_id == pages[begin].page_id_.table_id &&
+               pages[end].page_id_.page_no == pages[end - 1].page_id_.page_no + 1) {
+            ++end;
+        }
+        std::vector<const char*> datas;
+        for (size_t i = begin; i < end; ++i) {
+            datas.push_back(pages[i].data_.get());
+        }
+        batch.add_write_pages(disk_manager_->get_table_io_fd(pages[begin].page_id_.table_id), pages[begin].page_id_.page_no, datas);
+        run_begins.push_back(begin);
+        begin = end;
+    }
+    run_begins.push_back(pages.size());
+    batch.submit();
+    bool success = batch.wait();
+
+    for (size_t run = 0; run + 1 < run_begins.size(); ++run) {
+        bool run_success = batch.succeeded(run);
+        if (run_success) {
+            *flushed += run_begins[run + 1] - run_begins[run];
+        } else {
+            std::cerr << "Error: DiskManager::write_pages Error, table_id: " << pages[run_begins[run]].page_id_.table_id 
+                      << ", page_no: " << pages[run_begins[run]].page_id_.page_no << "\n";
+        }
+        for (size_t i = run_begins[run]; i < run_begins[run + 1]; ++i) {
+            buffer_pools_[pages[i].page_id_.page_no % BUFFER_POOL_NUM]->finish_write(pages[i].page_id_, run_success);
+        }
+    }
+    return success;
+}
+
+/**
+ * @description: 预读一批页面，已经在缓冲池中的页面会被跳过，计算节点通过一次GetLatestPage rpc批量获取剩余的页面，
+ *              存储节点通过一个batch批量读取磁盘，获取后的页面处于unpin状态，等待后续的fetch_page命中
+ * @param {vector<PageId>&} page_ids 需要预读的页面
+ */
+void BufferPoolManager::prefetch_pages(const std::vector<PageId>& page_ids) {
+    if(page_ids.empty()) return;
+    if(node_type_ == STORAGE_NODE) {
+        prefetch_pages_from_disk(page_ids);
+        return;
+    }
+
+    std::vector<PageId> fetch_ids;
+    std::vector<Page*> fetch_pages;
+    for(auto& page_id: page_ids) {
+        Page* page = buffer_pools_[page_id.page_no % BUFFER_POOL_NUM]->reserve_prefetch_frame(page_id);
+        if(page != nullptr) {
+            fetch_ids.push_back(page_id);
+            fetch_pages.push_back(page);
+        }
+    }
+    if(fetch_ids.empty()) return;
+
+    bool success = BufferPool::fetch_pages_from_rpc(page_channel_, slice_mgr_, fetch_ids, fetch_pages);
+    for(size_t i = 0; i < fetch_ids.size(); ++i) {
+        buffer_pools_[fetch_ids[i].page_no % BUFFER_POOL_NUM]->finish_prefetch(fetch_pages[i], success);
+    }
+}
+
+/**
+ * @description: 存储节点预读一批页面，所有缺失页面的读取和被淘汰脏页的写回分别放在一个batch中一起提交，
+ *              被淘汰的页面和预读的页面不会重叠，两个batch之间不需要保证顺序
+ * @param {vector<PageId>&} page_ids 需要预读的页面
+ */
+void BufferPoolManager::prefetch_pages_from_disk(const std::vector<PageId>& page_ids) {
+    std::vector<PageId> fetch_ids;
+    std::vector<Page*> fetch_pages;
+    std::vector<FlushPage> evicted_pages;
+    DiskIOBatch read_batch;
+    DiskIOBatch write_batch;
+    for(auto& page_id: page_ids) {
+        FlushPage evicted;
+        Page* page = buffer_pools_[page_id.page_no % BUFFER_POOL_NUM]->reserve_prefetch_frame(page_id, &evicted);
+        if(page == nullptr) continue;
+        read_batch.add_read(disk_manager_->get_table_io_fd(page_id.table_id), page_id.page_no, page->get_data(), PAGE_SIZE);
+        fetch_ids.push_back(page_id);
+        fetch_pages.push_back(page);
+        if(evicted.data_ != nullptr) {
+            write_batch.add_write(disk_manager_->get_table_io_fd(evicted.page_id_.table_id), evicted.page_id_.page_no, evicted.data_.get(), PAGE_SIZE);
+            evicted_pages.push_back(std::move(evicted));
+        }
+    }
+    if(fetch_ids.empty()) return;
+
+    write_batch.submit();
+    read_batch.submit();
+    write_batch.wait();
+    read_batch.wait();
+    for(size_t i = 0; i < evicted_pages.size(); ++i) {
+        bool success = write_batch.succeeded(i);
+        if(!success) {
+            std::cerr << "Error: BufferPool::prefetch write back Error, table_id: " << evicted_pages[i].page_id_.table_id 
+                      << ", page_no: " << evicted_pages[i].page_id_.page_no << "\n";
+        }
+        buffer_pools_[evicted_pages[i].page_id_.page_no % BUFFER_POOL_NUM]->finish_write(evicted_pages[i].page_id_, success);
+    }
+    for(size_t i = 0; i < fetch_ids.size(); ++i) {
+        buffer_pools_[fetch_ids[i].page_no % BUFFER_POOL_NUM]->finish_prefetch(fetch_pages[i], read_batch.succeeded(i));
+    }
+}
+
+/**
+ * @description: 为所有帧分配一块连续的按PAGE_SIZE对齐的数据区。优先使用MAP_HUGETLB映射2MB大页，
+ *              系统没有预留大页时退化为普通的匿名映射，并通过madvise建议内核使用透明大页，减少访问缓冲池时的TLB miss
+ * @param {size_t} size 所有帧数据的总大小
+ */
+void BufferPoolManager::allocate_frame_arena(size_t size) {
+    if (size == 0) return;
+    size_t huge_size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    void* arena = mmap(nullptr, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (arena != MAP_FAILED) {
+        frame_arena_ = static_cast<char*>(arena);
+        frame_arena_size_ = huge_size;
+        frame_arena_huge_ = true;
+        return;
+    }
+    arena = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (arena == MAP_FAILED) {
+        throw UnixError();
+    }
+    madvise(arena, size, MADV_HUGEPAGE);
+    frame_arena_ = static_cast<char*>(arena);
+    frame_arena_size_ = size;
+    frame_arena_huge_ = false;
+}
+
+void BufferPoolManager::free_frame_arena() {
+    if (frame_arena_ != nullptr) {
+        munmap(frame_arena_, frame_arena_size_);
+        frame_arena_ = nullptr;
+    }
+}
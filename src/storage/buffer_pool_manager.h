@@ -1,9 +1,14 @@
 #pragma once
 #include <fcntl.h>
+#include <stdlib.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
 #include <list>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 #include <brpc/channel.h>
@@ -12,45 +17,110 @@
 #include "disk_manager.h"
 #include "errors.h"
 #include "page.h"
+#include "page_table.h"
 #include "replacer/clock_replacer.h"
+#include "replacer/lru_k_replacer.h"
 #include "replacer/lru_replacer.h"
+#include "replacer/two_queue_replacer.h"
 #include "replacer/replacer.h"
 #include "common/common.h"
 
+// 后台刷脏或淘汰时从缓冲池中拷贝出来的页面，数据按PAGE_SIZE对齐，可以直接通过O_DIRECT写入
+struct FlushPage {
+    struct DataDeleter {
+        void operator()(char* data) const { free(data); }
+    };
+    using Data = std::unique_ptr<char, DataDeleter>;
+
+    PageId page_id_;
+    Data data_;
+
+    static Data alloc_data() {
+        char* data = static_cast<char*>(aligned_alloc(PAGE_SIZE, PAGE_SIZE));
+        if (data == nullptr) throw std::bad_alloc();
+        return Data(data);
+    }
+};
+
+class BufferPool;
+
+/**
+ * FramePool管理所有分区共享的帧(Page对象及其数据区)。初始时所有的帧都是空闲的，分区按需取用；
+ * 空闲帧用完之后，缺页的分区从全局指针hand_指向的分区借一个可以直接丢弃的帧，hand_在所有分区之间轮转，
+ * 访问越频繁的分区借到的帧越多，各分区的缺页率趋于相同，缓冲池的有效容量不受page_no % BUFFER_POOL_NUM分区倾斜的影响
+ */
+class FramePool {
+   public:
+    // frame_data为frame_num个按PAGE_SIZE对齐的帧数据，由BufferPoolManager统一分配和释放
+    FramePool(size_t frame_num, char* frame_data);
+
+    ~FramePool() { delete[] pages_; }
+
+    void set_buffer_pools(BufferPool** buffer_pools) { buffer_pools_ = buffer_pools; }
+
+    // 调用时持有requester的latch_
+    Page* get_frame(BufferPool* requester, bool evict_self);
+
+    void put_frame(Page* page);
+
+    size_t free_frame_num() const { return free_num_.load(std::memory_order_relaxed); }
+
+   private:
+    Page* pages_;                           // 所有帧的Page对象
+    std::mutex latch_;                      // 保护free_frames_
+    std::vector<Page*> free_frames_;        // 不属于任何分区的空闲帧
+    std::atomic<size_t> free_num_{0};       // free_frames_的大小，空闲帧用完之后不需要再获取latch_
+    std::atomic<size_t> hand_{0};           // 下一个被要求借出帧的分区
+    BufferPool** buffer_pools_ = nullptr;
+};
+
 class BufferPool {
    private:
-    size_t pool_size_;      // buffer_pool中可容纳页面的个数，即帧的个数
-    Page *pages_;           // buffer_pool中的Page对象数组，在构造空间中申请内存空间，在析构函数中释放，大小为BUFFER_POOL_SIZE
-    std::unordered_map<PageId, frame_id_t, PageIdHash> page_table_; // 帧号和页面号的映射哈希表，用于根据页面的PageId定位该页面的帧编号
-    std::list<frame_id_t> free_list_;   // 空闲帧编号的链表
+    size_t max_size_;       // buffer_pool中槽位的个数，即最多可以持有的帧的个数，frame_id为槽位的下标
+    size_t min_size_;       // 持有的帧不超过min_size_时不再借出帧
+    size_t frame_num_ = 0;  // 当前持有的帧的个数
+    std::vector<Page*> frames_;     // 每个槽位持有的帧，空槽位为nullptr，帧由FramePool在各个分区之间分配
+    FramePool* frame_pool_;
+    PageTable page_table_;  // 页面到帧的映射，命中时不需要获取latch_就可以查找，帧所在的槽位为Page::frame_id_
+    std::list<frame_id_t> free_list_;   // 空槽位编号的链表
     DiskManager *disk_manager_;     // used for storage_pool, no use in compute_pool
-    Replacer *replacer_;    // buffer_pool的置换策略，当前赛题中为LRU置换策略
+    Replacer *replacer_;    // buffer_pool的置换策略，由replacer_type选择
     std::mutex latch_;      // 用于共享数据结构的并发控制
+    std::condition_variable load_cv_;   // 等待正在加载(is_loading_)的帧完成加载，或者正在写回的页面完成写回
+    std::unordered_map<PageId, int, PageIdHash> writing_pages_;    // 数据已经拷贝出来正在写回磁盘的页面及其在途的写请求数量
     brpc::Channel* page_channel_;
     SliceMetaManager* slice_mgr_;
     NodeType node_type_;
+    size_t prefetch_hits_ = 0;      // 预取的页面在被淘汰前被访问的次数
+    size_t prefetch_misses_ = 0;    // 预取的页面在被访问之前就被淘汰的次数
+    // 无锁命中时也会修改，读取时不需要latch_，可以在信号处理函数中统计命中率
+    std::atomic<size_t> fetch_hits_{0};     // fetch_page命中缓冲池的次数
+    std::atomic<size_t> fetch_misses_{0};   // fetch_page需要从存储层或磁盘加载页面的次数
 
    public:
-    BufferPool(NodeType node_type, size_t pool_size, brpc::Channel* page_channel, DiskManager* disk_manager = nullptr, SliceMetaManager* slice_mgr = nullptr)
-        : node_type_(node_type), pool_size_(pool_size), page_channel_(page_channel), disk_manager_(disk_manager), slice_mgr_(slice_mgr) {
-        // 为buffer pool分配一块连续的内存空间
-        pages_ = new Page[pool_size_];
+    // share为平均分配给每个分区的帧数，帧由frame_pool统一分配，分区最多持有share * BUFFER_POOL_MAX_SHARE个帧
+    BufferPool(NodeType node_type, size_t share, size_t max_size, FramePool* frame_pool, brpc::Channel* page_channel, DiskManager* disk_manager = nullptr,
+               SliceMetaManager* slice_mgr = nullptr, const std::string& replacer_type = REPLACER_TYPE)
+        : node_type_(node_type), max_size_(max_size), min_size_(static_cast<size_t>(share * BUFFER_POOL_MIN_SHARE)), frames_(max_size, nullptr),
+          frame_pool_(frame_pool), page_table_(max_size), page_channel_(page_channel), disk_manager_(disk_manager), slice_mgr_(slice_mgr) {
         // 可以被Replacer改变
-        if (REPLACER_TYPE.compare("LRU"))
-            replacer_ = new LRUReplacer(pool_size_);
-        else if (REPLACER_TYPE.compare("CLOCK"))
-            replacer_ = new LRUReplacer(pool_size_);
+        if (replacer_type == "CLOCK")
+            replacer_ = new ClockReplacer(max_size_);
+        else if (replacer_type == "LRU-K")
+            replacer_ = new LRUKReplacer(max_size_);
+        else if (replacer_type == "2Q")
+            // A1的容量按照平均分配的帧数计算，而不是槽位的个数
+            replacer_ = new TwoQueueReplacer(max_size_, max_size_ == 0 ? TWO_QUEUE_A1_RATIO : TWO_QUEUE_A1_RATIO * share / max_size_);
         else {
-            replacer_ = new LRUReplacer(pool_size_);
+            replacer_ = new LRUReplacer(max_size_);
         }
-        // 初始化时，所有的page都在free_list_中
-        for (size_t i = 0; i < pool_size_; ++i) {
+        // 初始化时，所有的槽位都在free_list_中
+        for (size_t i = 0; i < max_size_; ++i) {
             free_list_.emplace_back(static_cast<frame_id_t>(i));  // static_cast转换数据类型
         }
     }
 
     ~BufferPool() {
-        delete[] pages_;
         delete replacer_;
     }
 
@@ -61,13 +131,25 @@ class BufferPool {
     static void mark_dirty(Page* page) { page->is_dirty_ = true; }
 
    public: 
-    Page* fetch_page(PageId page_id);
+    // access为SCAN时页面在unpin之后会被replacer优先淘汰
+    Page* fetch_page(PageId page_id, AccessType access = AccessType::NORMAL);
+
+    // 不获取latch_的命中路径，页面不在缓冲池中或者正在被替换时返回nullptr
+    Page* fetch_page_optimistic(PageId page_id, AccessType access);
+
+    // used for storage_node, called with latch_ held, releases latch_ during disk io
+    Page* fetch_page_from_disk(std::unique_lock<std::mutex>& lock, Page* page, PageId page_id, frame_id_t frame_id);
 
-    // used for storage_node
-    void fetch_page_from_disk(Page* page, PageId page_id, frame_id_t frame_id);
+    // used for compute_node, called without holding latch_
+    bool fetch_page_from_rpc(Page* page, PageId page_id);
 
-    // used for compute_node
-    void fetch_page_from_rpc(Page* page, PageId page_id, frame_id_t frame_id);
+    // fetch multiple pages in a single GetLatestPage rpc, pages[i] receives the data of page_ids[i]
+    static bool fetch_pages_from_rpc(brpc::Channel* page_channel, SliceMetaManager* slice_mgr, const std::vector<PageId>& page_ids, const std::vector<Page*>& pages);
+
+    // used for read-ahead, evicted receives the dirty page evicted from the frame on storage_node
+    Page* reserve_prefetch_frame(PageId page_id, FlushPage* evicted = nullptr);
+
+    void finish_prefetch(Page* page, bool success);
 
     bool unpin_page(PageId page_id, bool is_dirty);
 
@@ -79,37 +161,92 @@ class BufferPool {
 
     void flush_all_pages(int table_id);
 
+    // used for storage_node background flusher
+    bool copy_dirty_pages(size_t* next_frame, size_t max_pages, std::vector<FlushPage>* pages);
+
+    void finish_write(PageId page_id, bool success);
+
+    // 后台刷脏开始时正在写回的页面(淘汰脏页时的写回)，刷脏在落盘之前等待这些写回完成
+    void get_writing_pages(std::vector<PageId>* page_ids);
+
+    void wait_for_writes(const std::vector<PageId>& page_ids);
+
+    // 由其他分区通过FramePool调用，不等待latch_
+    Page* lend_frame();
+
     void print_buffer_info() {
-        std::cout << "Pool Size: " << pool_size_ << ", Free size: " << free_list_.size() << ", Unpin size: " << replacer_->Size() << std::endl;
+        std::cout << "Pool Size: " << frame_num_ << "/" << max_size_ << ", Free size: " << free_list_.size() << ", Unpin size: " << replacer_->Size() 
+                  << ", Prefetch hits: " << prefetch_hits_ << ", Prefetch misses: " << prefetch_misses_ 
+                  << ", Fetch hits: " << fetch_hits_.load() << ", Fetch misses: " << fetch_misses_.load() << std::endl;
+    }
+
+    void get_fetch_stats(size_t* hits, size_t* misses) {
+        *hits += fetch_hits_.load(std::memory_order_relaxed);
+        *misses += fetch_misses_.load(std::memory_order_relaxed);
+    }
+
+    void get_prefetch_stats(size_t* hits, size_t* misses) {
+        std::scoped_lock lock{latch_};
+        *hits += prefetch_hits_;
+        *misses += prefetch_misses_;
     }
 
    private:
     bool find_victim_page(frame_id_t* frame_id);
 
+    bool evict_page(frame_id_t* frame_id);
+
+    void attach_frame(Page* page, frame_id_t* frame_id);
+
+    void release_frame(frame_id_t frame_id);
+
     void update_page(Page* page, PageId new_page_id, frame_id_t new_frame_id);
+
+    bool copy_evicted_page(Page* page, FlushPage* evicted);
+
+    void write_back(Page* page);
+
+    void end_write(PageId page_id);
 };
 
 
 class BufferPoolManager {
     public:
-    BufferPoolManager(NodeType node_type, size_t pool_size, brpc::Channel* page_channel, DiskManager* disk_manager = nullptr, SliceMetaManager* slice_mgr = nullptr){
+    BufferPoolManager(NodeType node_type, size_t pool_size, brpc::Channel* page_channel, DiskManager* disk_manager = nullptr, SliceMetaManager* slice_mgr = nullptr,
+                      const std::string& replacer_type = REPLACER_TYPE){
+        node_type_ = node_type;
+        if (replacer_type != "LRU" && replacer_type != "CLOCK" && replacer_type != "LRU-K" && replacer_type != "2Q") {
+            std::cerr << "Unknown replacer type: " << replacer_type << ", use LRU instead" << std::endl;
+        }
+        page_channel_ = page_channel;
+        slice_mgr_ = slice_mgr;
         disk_manager_ = disk_manager;
-        int size_per_pool = pool_size / BUFFER_POOL_NUM;
+        size_t size_per_pool = pool_size / BUFFER_POOL_NUM;
+        size_t frame_num = size_per_pool * BUFFER_POOL_NUM;
+        allocate_frame_arena(frame_num * PAGE_SIZE);
+        frame_pool_ = new FramePool(frame_num, frame_arena_);
+        // 帧不再固定属于某个分区，访问倾斜时热点分区可以持有多于平均数量的帧
+        size_t max_size_per_pool = std::min(frame_num, size_per_pool * BUFFER_POOL_MAX_SHARE);
         for(size_t i = 0; i < BUFFER_POOL_NUM; ++i)
-            buffer_pools_[i] = new BufferPool(node_type, size_per_pool, page_channel, disk_manager, slice_mgr);
+            buffer_pools_[i] = new BufferPool(node_type, size_per_pool, max_size_per_pool, frame_pool_, page_channel, disk_manager, slice_mgr, replacer_type);
+        frame_pool_->set_buffer_pools(buffer_pools_);
     }
 
     ~BufferPoolManager() {
         for(size_t i = 0; i < BUFFER_POOL_NUM; ++i) delete buffer_pools_[i];
+        delete frame_pool_;
+        free_frame_arena();
     }
 
-    Page* fetch_page(PageId page_id) {
-        return buffer_pools_[page_id.page_no % BUFFER_POOL_NUM]->fetch_page(page_id);
+    Page* fetch_page(PageId page_id, AccessType access = AccessType::NORMAL) {
+        return buffer_pools_[page_id.page_no % BUFFER_POOL_NUM]->fetch_page(page_id, access);
     }
 
+    // 先分配页号再根据页号选择分区，并发创建页面时每个页面都进入之后fetch_page查找的分区
+    // 分区中没有可用的帧时分配的页号不再使用
     Page* new_page(PageId* page_id) {
-        int page_no = disk_manager_->get_fd2pageno(disk_manager_->get_table_fd((*page_id).table_id));
-        return buffer_pools_[page_no % BUFFER_POOL_NUM]->new_page(page_id);
+        page_id->page_no = disk_manager_->allocate_page(disk_manager_->get_table_fd(page_id->table_id));
+        return buffer_pools_[page_id->page_no % BUFFER_POOL_NUM]->new_page(page_id);
     }
 
     bool delete_page(PageId page_id) {
@@ -126,15 +263,53 @@ class BufferPoolManager {
         }
     }
 
+    void prefetch_pages(const std::vector<PageId>& page_ids);
+
+    bool flush_dirty_pages(size_t* flushed);
+
+    void get_prefetch_stats(size_t* hits, size_t* misses) {
+        *hits = *misses = 0;
+        for(size_t i = 0; i < BUFFER_POOL_NUM; ++i) {
+            buffer_pools_[i]->get_prefetch_stats(hits, misses);
+        }
+    }
+
+    // 所有分区fetch_page的命中和未命中次数，用于比较不同置换策略的命中率
+    void get_fetch_stats(size_t* hits, size_t* misses) {
+        *hits = *misses = 0;
+        for(size_t i = 0; i < BUFFER_POOL_NUM; ++i) {
+            buffer_pools_[i]->get_fetch_stats(hits, misses);
+        }
+    }
+
     /*
         打印每个buffer的页面信息
     */
     void print_buffer_info() {
+        std::cout << "Frame arena size: " << frame_arena_size_ << ", huge page: " << frame_arena_huge_ << ", free frames: " << frame_pool_->free_frame_num() << std::endl;
         for(int i = 0; i < BUFFER_POOL_NUM; ++i) {
             buffer_pools_[i]->print_buffer_info();
         }
     }
 
+    private:
+    void allocate_frame_arena(size_t size);
+
+    void free_frame_arena();
+
+    void prefetch_pages_from_disk(const std::vector<PageId>& page_ids);
+
+    bool write_flush_pages(std::vector<FlushPage>& pages, size_t* flushed);
+
+    char* frame_arena_ = nullptr;       // 所有帧的数据区，按PAGE_SIZE对齐
+    size_t frame_arena_size_ = 0;       // 映射的大小，使用大页时向上对齐到HUGE_PAGE_SIZE
+    bool frame_arena_huge_ = false;     // 是否由MAP_HUGETLB大页映射
+    FramePool* frame_pool_ = nullptr;   // 所有分区共享的帧
+
+    public:
     BufferPool* buffer_pools_[BUFFER_POOL_NUM];
     DiskManager* disk_manager_;
+    brpc::Channel* page_channel_;
+    SliceMetaManager* slice_mgr_;
+    NodeType node_type_;
 };
\ No newline at end of file
@@ -3,8 +3,52 @@
 #include <assert.h>    // for assert
 #include <string.h>    // for memset
 #include <sys/stat.h>  // for stat
+#include <sys/uio.h>   // for pwritev
 #include <unistd.h>    // for lseek
 
+#include <algorithm>
+#include <climits>     // for IOV_MAX
+
+#ifdef ENABLE_IO_URING
+#include <liburing.h>
+
+namespace {
+// 每个线程一个io_uring实例，提交请求和收割完成事件都不需要加锁
+struct ThreadRing {
+    struct io_uring ring_;
+    bool available_ = false;    // 内核不支持或者被禁用io_uring时退化为preadv/pwritev
+    unsigned inflight_ = 0;     // 已经放入提交队列但还没有收割的请求数量
+
+    ThreadRing() { available_ = (io_uring_queue_init(IO_URING_QUEUE_DEPTH, &ring_, 0) == 0); }
+
+    ~ThreadRing() {
+        if (available_) io_uring_queue_exit(&ring_);
+    }
+};
+
+ThreadRing& thread_ring() {
+    thread_local ThreadRing ring;
+    return ring;
+}
+
+// 收割一个完成事件，完成的请求可能属于当前线程的任意一个batch
+void reap_one(ThreadRing& ring) {
+    struct io_uring_cqe* cqe = nullptr;
+    int ret;
+    while ((ret = io_uring_wait_cqe(&ring.ring_, &cqe)) == -EINTR) {
+    }
+    if (ret < 0) {
+        throw InternalError("DiskIOBatch::wait Error");
+    }
+    auto* request = static_cast<DiskIORequest*>(io_uring_cqe_get_data(cqe));
+    request->res_ = cqe->res;
+    (*request->batch_pending_)--;
+    io_uring_cqe_seen(&ring.ring_, cqe);
+    ring.inflight_--;
+}
+}  // namespace
+#endif
+
 DiskManager::DiskManager() { memset(fd2pageno_, 0, MAX_FD * (sizeof(std::atomic<page_id_t>) / sizeof(char))); }
 
 /**
@@ -30,6 +74,121 @@ void DiskManager::write_page(int fd, page_id_t page_no, const char *offset, int
     }
 }
 
+DiskIOBatch::~DiskIOBatch() {
+    // 内核完成请求之前不能释放请求和缓冲区
+    if (submitted_ && pending_ > 0) {
+        wait();
+    }
+}
+
+/**
+ * @description: 添加一个读请求，从文件的page_no页面读取num_bytes字节到buf中
+ */
+void DiskIOBatch::add_read(int fd, page_id_t page_no, char *buf, int num_bytes) {
+    assert(!submitted_);
+    DiskIORequest request{fd, (off_t)page_no * (off_t)PAGE_SIZE, false, {{buf, (size_t)num_bytes}}, (size_t)num_bytes};
+    requests_.push_back(std::move(request));
+}
+
+/**
+ * @description: 添加一个写请求，把buf中的num_bytes字节写入文件的page_no页面
+ */
+void DiskIOBatch::add_write(int fd, page_id_t page_no, const char *buf, int num_bytes) {
+    assert(!submitted_);
+    DiskIORequest request{fd, (off_t)page_no * (off_t)PAGE_SIZE, true, {{const_cast<char*>(buf), (size_t)num_bytes}}, (size_t)num_bytes};
+    requests_.push_back(std::move(request));
+}
+
+/**
+ * @description: 添加把多个连续的页面写入文件的请求，每IOV_MAX个页面合并为一个pwritev，不需要先拷贝到一块连续的内存中
+ * @param {int} fd 磁盘文件的文件句柄
+ * @param {page_id_t} first_page_no 第一个页面的page_no，pages[i]写入first_page_no + i
+ * @param {vector<const char*>&} pages 每个页面的数据，大小均为PAGE_SIZE
+ */
+void DiskIOBatch::add_write_pages(int fd, page_id_t first_page_no, const std::vector<const char*> &pages) {
+    assert(!submitted_);
+    for (size_t begin = 0; begin < pages.size(); begin += IOV_MAX) {
+        size_t end = std::min(pages.size(), begin + (size_t)IOV_MAX);
+        DiskIORequest request{fd, (off_t)(first_page_no + begin) * (off_t)PAGE_SIZE, true, {}, (end - begin) * PAGE_SIZE};
+        for (size_t i = begin; i < end; ++i) {
+            request.iov_.push_back({const_cast<char*>(pages[i]), (size_t)PAGE_SIZE});
+        }
+        requests_.push_back(std::move(request));
+    }
+}
+
+/**
+ * @description: 提交batch中的所有请求，使用io_uring时只把请求放入提交队列并通知内核，不等待请求完成
+ */
+void DiskIOBatch::submit() {
+    assert(!submitted_);
+    submitted_ = true;
+    pending_ = requests_.size();
+#ifdef ENABLE_IO_URING
+    ThreadRing& ring = thread_ring();
+    if (ring.available_) {
+        for (auto& request : requests_) {
+            // 限制每个线程在途的请求数量，保证提交队列有空位并且完成队列不会溢出
+            while (ring.inflight_ >= IO_URING_QUEUE_DEPTH) {
+                if (io_uring_submit(&ring.ring_) < 0) {
+                    throw InternalError("DiskIOBatch::submit Error");
+                }
+                reap_one(ring);
+            }
+            struct io_uring_sqe* sqe = io_uring_get_sqe(&ring.ring_);
+            if (request.is_write_) {
+                io_uring_prep_writev(sqe, request.fd_, request.iov_.data(), request.iov_.size(), request.offset_);
+            } else {
+                io_uring_prep_readv(sqe, request.fd_, request.iov_.data(), request.iov_.size(), request.offset_);
+            }
+            request.batch_pending_ = &pending_;
+            io_uring_sqe_set_data(sqe, &request);
+            ring.inflight_++;
+        }
+        if (io_uring_submit(&ring.ring_) < 0) {
+            throw InternalError("DiskIOBatch::submit Error");
+        }
+        return;
+    }
+#endif
+    for (auto& request : requests_) {
+        if (request.is_write_) {
+            request.res_ = pwritev(request.fd_, request.iov_.data(), request.iov_.size(), request.offset_);
+        } else {
+            request.res_ = preadv(request.fd_, request.iov_.data(), request.iov_.size(), request.offset_);
+        }
+    }
+    pending_ = 0;
+}
+
+/**
+ * @description: 等待batch中的所有请求完成
+ * @return {bool} 所有请求都完成了全部数据的读写返回true
+ */
+bool DiskIOBatch::wait() {
+    assert(submitted_);
+#ifdef ENABLE_IO_URING
+    while (pending_ > 0) {
+        reap_one(thread_ring());
+    }
+#endif
+    for (size_t i = 0; i < requests_.size(); ++i) {
+        if (!succeeded(i)) return false;
+    }
+    return true;
+}
+
+/**
+ * @description: 把所有表文件在page cache中的数据落盘
+ */
+void DiskManager::sync_table_files() {
+    for (auto &entry : table2fd_) {
+        if (fsync(entry.second) != 0) {
+            throw InternalError("DiskManager::sync_table_files Error");
+        }
+    }
+}
+
 /**
  * @description: 读取文件中指定编号的页面中的部分数据到内存中
  * @param {int} fd 磁盘文件的文件句柄
@@ -191,6 +350,11 @@ void DiskManager::close_file(int fd) {
     std::string filename = fd2path_[fd];
     path2fd_.erase(filename);
     fd2path_.erase(fd);
+    auto direct_iter = fd2direct_fd_.find(fd);
+    if (direct_iter != fd2direct_fd_.end()) {
+        close(direct_iter->second);
+        fd2direct_fd_.erase(direct_iter);
+    }
     if (close(fd) != 0) {
         throw UnixError();
     }
@@ -240,8 +404,29 @@ int DiskManager::get_table_fd(int table_id) {
     return table2fd_[table_id];
 }
 
+/**
+ * @description: 获得缓冲池读写表中页面使用的文件句柄，开启direct io时返回以O_DIRECT打开的句柄，
+ *              使用该句柄的缓冲区、偏移和长度都需要按PAGE_SIZE对齐
+ * @return {int} 文件句柄
+ * @param {int} table_id 表id
+ */
+int DiskManager::get_table_io_fd(int table_id) {
+    int fd = get_table_fd(table_id);
+    auto iter = fd2direct_fd_.find(fd);
+    return iter == fd2direct_fd_.end() ? fd : iter->second;
+}
+
 void DiskManager::set_table_fd(int table_id, int fd) {
     table2fd_.emplace(table_id, fd);
+    if (direct_io_ && fd2path_.count(fd) && !fd2direct_fd_.count(fd)) {
+        int direct_fd = open(fd2path_[fd].c_str(), O_RDWR | O_DIRECT);
+        if (direct_fd < 0) {
+            // 文件系统不支持O_DIRECT(例如tmpfs)时退化为使用page cache
+            std::cerr << "Fail to open " << fd2path_[fd] << " with O_DIRECT, errno: " << errno << "\n";
+            return;
+        }
+        fd2direct_fd_[fd] = direct_fd;
+    }
 }
 
 /**
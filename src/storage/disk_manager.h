@@ -2,6 +2,7 @@
 
 #include <fcntl.h>     
 #include <sys/stat.h>  
+#include <sys/uio.h>   
 #include <unistd.h>    
 
 #include <atomic>
@@ -9,10 +10,61 @@
 #include <iostream>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "common/config.h"
 #include "errors.h"  
 
+/**
+ * @description: 一次磁盘读写请求，读写的数据由iov_描述，res_为请求完成后的返回值(读写的字节数或者-errno)
+ */
+struct DiskIORequest {
+    int fd_;
+    off_t offset_;
+    bool is_write_;
+    std::vector<struct iovec> iov_;
+    size_t num_bytes_;
+    ssize_t res_ = 0;
+    size_t* batch_pending_ = nullptr;   // 所属batch中未完成的请求数量
+};
+
+/**
+ * @description: 一批磁盘读写请求。开启ENABLE_IO_URING时，一批请求通过当前线程的io_uring一次提交，由wait()收割完成事件；
+ *              否则退化为在submit()中逐个调用preadv/pwritev。
+ *              submit()和wait()必须在同一个线程中调用，两者之间不能切换bthread，batch中的缓冲区在wait()返回之前必须有效
+ */
+class DiskIOBatch {
+   public:
+    DiskIOBatch() = default;
+
+    ~DiskIOBatch();
+
+    DiskIOBatch(const DiskIOBatch&) = delete;
+    DiskIOBatch& operator=(const DiskIOBatch&) = delete;
+
+    void add_read(int fd, page_id_t page_no, char *buf, int num_bytes);
+
+    void add_write(int fd, page_id_t page_no, const char *buf, int num_bytes);
+
+    void add_write_pages(int fd, page_id_t first_page_no, const std::vector<const char*> &pages);
+
+    size_t size() const { return requests_.size(); }
+
+    void submit();
+
+    bool wait();
+
+    /**
+     * @description: 第i个请求是否完成了全部数据的读写，需要在wait()之后调用
+     */
+    bool succeeded(size_t i) const { return requests_[i].res_ == (ssize_t)requests_[i].num_bytes_; }
+
+   private:
+    std::vector<DiskIORequest> requests_;
+    size_t pending_ = 0;
+    bool submitted_ = false;
+};
+
 /**
  * @description: DiskManager的作用主要是根据上层的需要对磁盘文件进行操作
  */
@@ -24,6 +76,8 @@ class DiskManager {
 
     void write_page(int fd, page_id_t page_no, const char *offset, int num_bytes);
 
+    void sync_table_files();
+
     void read_page(int fd, page_id_t page_no, char *offset, int num_bytes);
 
     page_id_t allocate_page(int fd);
@@ -56,8 +110,16 @@ class DiskManager {
 
     int get_table_fd(int table_id);
 
+    int get_table_io_fd(int table_id);
+
     void set_table_fd(int table_id, int fd);
 
+    /**
+     * @description: 开启后，表文件额外以O_DIRECT打开一个句柄，缓冲池对帧的读写通过get_table_io_fd绕过page cache，
+     *              避免页面在缓冲池和page cache中被缓存两次；文件头等非对齐的读写仍然使用普通句柄。需要在打开表文件之前设置
+     */
+    void set_direct_io(bool direct_io) { direct_io_ = direct_io; }
+
     /*日志操作*/
     int read_log(char *log_data, int size, int offset);
 
@@ -89,6 +151,8 @@ class DiskManager {
     std::unordered_map<std::string, int> path2fd_;  //<Page文件磁盘路径,Page fd>哈希表
     std::unordered_map<int, std::string> fd2path_;  //<Page fd,Page文件磁盘路径>哈希表
     std::unordered_map<int, int> table2fd_;         // <table_id, fd>哈希表
+    std::unordered_map<int, int> fd2direct_fd_;     // <fd, 以O_DIRECT打开同一个文件的fd>哈希表
+    bool direct_io_ = false;
 
     int log_fd_ = -1;                             // WAL日志文件的文件句柄，默认为-1，代表未打开日志文件
     std::atomic<page_id_t> fd2pageno_[MAX_FD]{};  // 文件中已经分配的页面个数，初始值为0
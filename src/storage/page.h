@@ -3,6 +3,12 @@
  */
 #pragma once
 
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+
 #include "common/config.h"
 #include "common/rwlatch.h"
 
@@ -33,6 +39,9 @@ struct PageIdHash {
     size_t operator()(const PageId &x) const { return (x.table_id << 16) | x.page_no; }
 };
 
+// 访问页面的方式，顺序扫描访问的页面在unpin时提示replacer优先淘汰，避免大表扫描把热点页面挤出缓冲池
+enum class AccessType { NORMAL, SCAN };
+
 template <>
 struct std::hash<PageId> {
     size_t operator()(const PageId &obj) const { return std::hash<int64_t>()(obj.Get()); }
@@ -41,28 +50,52 @@ struct std::hash<PageId> {
 
 class Page {
     friend class BufferPool;
+    friend class FramePool;
 
    public:
     
-    Page() { reset_memory(); }
+    // data_由BufferPool指向帧数据区中属于该帧的一段
+    Page() = default;
 
     ~Page() = default;
 
+    /**
+     * @description: 不属于缓冲池的页面(例如批量导入时构建的结点)，由Page自己分配并持有按PAGE_SIZE对齐的数据区，数据区初始化为0
+     */
+    static std::unique_ptr<Page> alloc_standalone() {
+        auto page = std::make_unique<Page>();
+        page->owned_data_.reset(static_cast<char*>(aligned_alloc(PAGE_SIZE, PAGE_SIZE)));
+        if (page->owned_data_ == nullptr) throw std::bad_alloc();
+        page->data_ = page->owned_data_.get();
+        page->reset_memory();
+        return page;
+    }
+
     PageId get_page_id() const { return id_; }
 
     inline char *get_data() { return data_; }
 
     bool is_dirty() const { return is_dirty_; }
 
+    int get_pin_count() const { return static_cast<int>(frame_state_.load(std::memory_order_acquire) & FRAME_PIN_MASK); }
+
     /**
-     * @description: 获取page的写锁
+     * @description: 获取page的写锁，同时将版本号置为奇数，使正在乐观读该页面的线程校验失败。
+     *              版本号加一之后需要release屏障，保证之后对页面数据的写不会先于奇数版本号被其他线程看到
      */
-    inline void WLatch() { rwlatch_.WLock(); }
+    inline void WLatch() { 
+        rwlatch_.WLock(); 
+        version_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
 
     /**
-     * @description: 释放page的写锁 
+     * @description: 释放page的写锁，版本号加一后变回偶数
      */
-    inline void WUnlatch() { rwlatch_.WUnlock(); }
+    inline void WUnlatch() { 
+        version_.fetch_add(1, std::memory_order_release);
+        rwlatch_.WUnlock(); 
+    }
 
     /**
      * @description: 获取page的读锁
@@ -74,6 +107,25 @@ class Page {
      */
     inline void RUnlatch() { rwlatch_.RUnlock(); }
 
+    /**
+     * @description: 乐观读，不加锁，只记录当前的版本号，读完之后需要调用validate检查期间页面是否被修改
+     * @return {bool} 如果页面正在被写者持有则返回false，调用者需要重试
+     * @param {uint64_t*} version 当前的版本号
+     */
+    inline bool optimistic_read(uint64_t* version) const {
+        *version = version_.load(std::memory_order_acquire);
+        return (*version & 1) == 0;
+    }
+
+    /**
+     * @description: 检查乐观读期间页面是否被修改过
+     * @param {uint64_t} version optimistic_read返回的版本号
+     */
+    inline bool validate(uint64_t version) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return version_.load(std::memory_order_relaxed) == version;
+    }
+
     static constexpr size_t OFFSET_PAGE_START = 0;
     static constexpr size_t OFFSET_LSN = 0;
     static constexpr size_t OFFSET_PAGE_HDR = 4;
@@ -85,20 +137,90 @@ class Page {
    private:
     void reset_memory() { memset(data_, 0, PAGE_SIZE); }  // 将data_的PAGE_SIZE个字节填充为0
 
+    // frame_state_: 高32位为版本号，FRAME_LOCKED位表示帧正在被淘汰、加载或者空闲，低31位为pin count
+    static constexpr uint64_t FRAME_LOCKED = 1ULL << 31;
+    static constexpr uint64_t FRAME_PIN_MASK = FRAME_LOCKED - 1;
+    static constexpr uint64_t FRAME_VERSION_ONE = 1ULL << 32;
+
+    /**
+     * @description: 不持有BufferPool的latch_时pin住帧，帧没有被锁定并且其中仍然是tag对应的页面时pin_count加一。
+     *              版本号在帧每次被锁定时加一，读到的frame_tag_和CAS时的版本号一致，说明期间帧没有被替换
+     * @return {int} pin之前的pin count，失败返回-1
+     * @param {int64_t} tag 页面的PageId::Get()
+     */
+    int try_pin(int64_t tag) {
+        uint64_t state = frame_state_.load(std::memory_order_acquire);
+        while (true) {
+            if ((state & FRAME_LOCKED) != 0 || frame_tag_.load(std::memory_order_acquire) != tag) return -1;
+            if (frame_state_.compare_exchange_weak(state, state + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                return static_cast<int>(state & FRAME_PIN_MASK);
+            }
+        }
+    }
+
+    // 持有latch_时pin住一个没有被锁定的帧，返回pin之前的pin count
+    int pin() { return static_cast<int>(frame_state_.fetch_add(1, std::memory_order_acq_rel) & FRAME_PIN_MASK); }
+
+    // pin_count减一，返回减之后的pin count，pin_count已经为0时返回-1
+    int unpin() {
+        uint64_t state = frame_state_.load(std::memory_order_acquire);
+        do {
+            if ((state & FRAME_PIN_MASK) == 0) return -1;
+        } while (!frame_state_.compare_exchange_weak(state, state - 1, std::memory_order_acq_rel, std::memory_order_acquire));
+        return static_cast<int>((state - 1) & FRAME_PIN_MASK);
+    }
+
+    // 持有latch_时锁定一个没有被pin住的帧，锁定之后try_pin都会失败，帧可以被替换
+    bool try_lock_frame() {
+        uint64_t state = frame_state_.load(std::memory_order_acquire);
+        if ((state & (FRAME_LOCKED | FRAME_PIN_MASK)) != 0) return false;
+        return frame_state_.compare_exchange_strong(state, (state + FRAME_VERSION_ONE) | FRAME_LOCKED, std::memory_order_acq_rel);
+    }
+
+    // 帧中的页面已经可以被访问，解锁并设置pin count，调用时持有latch_
+    void unlock_frame(int pin_count) {
+        uint64_t state = frame_state_.load(std::memory_order_relaxed);
+        frame_state_.store((state & ~(FRAME_LOCKED | FRAME_PIN_MASK)) | static_cast<uint64_t>(pin_count), std::memory_order_release);
+    }
+
     /** page的唯一标识符 */
     PageId id_;
 
     /** The actual data that is stored within a page.
-     *  该页面在bufferPool中的偏移地址
+     *  该页面在bufferPool中的偏移地址，指向BufferPoolManager分配的按PAGE_SIZE对齐的帧数据区，元数据和页面数据分开存放
      */
-    char data_[PAGE_SIZE] = {};
+    char *data_ = nullptr;
+
+    struct OwnedDataDeleter {
+        void operator()(char* data) const { free(data); }
+    };
+    /** alloc_standalone分配的数据区，缓冲池中的帧为空 */
+    std::unique_ptr<char, OwnedDataDeleter> owned_data_;
+
+    /** 脏页判断，无锁unpin时也会设置 */
+    std::atomic<bool> is_dirty_{false};
+
+    /** 版本号、锁定标记和pin count，空闲的帧处于锁定状态 */
+    std::atomic<uint64_t> frame_state_{FRAME_LOCKED};
 
-    /** 脏页判断 */
-    bool is_dirty_ = false;
+    /** 帧中页面的PageId::Get()，只在帧被锁定时修改 */
+    std::atomic<int64_t> frame_tag_{-1};
 
-    /** The pin count of this page. */
-    int pin_count_ = 0;
+    /** 帧在所属BufferPool中的槽位，帧被pin住时不会改变 */
+    frame_id_t frame_id_ = INVALID_FRAME_ID;
+
+    /** 该帧正在从存储层加载页面数据, 加载完成前其他线程不能读取data_ */
+    bool is_loading_ = false;
+
+    /** 该页面由预读加载，且还没有被访问过 */
+    std::atomic<bool> is_prefetched_{false};
+
+    /** 该页面上一次被unpin之后只被顺序扫描访问过，pin count减为0时调用replacer的unpin_scan */
+    std::atomic<bool> is_scan_{false};
 
     /** Page latch. */
     ReaderWriterLatch rwlatch_;
+
+    /** 乐观锁耦合使用的版本号，每次获取和释放写锁都会加一，奇数表示页面正在被修改 */
+    std::atomic<uint64_t> version_{0};
 };
\ No newline at end of file
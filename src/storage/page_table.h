@@ -0,0 +1,101 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+#include "page.h"
+
+/*
+PageTable是BufferPool的页表，使用线性探测的开放寻址哈希表，把PageId映射到持有该页面的帧。
+插入和删除只在持有BufferPool的latch_时进行(单写者)，查找不需要加锁：
+无锁查找可能因为并发的删除而找不到页面，此时调用者回到加锁的路径重新查找；
+也可能返回已经被替换的帧，调用者需要用帧的frame_tag_校验帧中是否仍然是该页面。
+删除时把后面的元素向前移动(backward shift)，表中不会留下墓碑，不需要重建。
+*/
+class PageTable {
+   public:
+    // 表的大小为不小于2 * max_size的2的幂，负载因子不超过0.5
+    explicit PageTable(size_t max_size) {
+        capacity_ = 1;
+        while (capacity_ < 2 * max_size) capacity_ <<= 1;
+        slots_.reset(new Slot[capacity_]);
+    }
+
+    /**
+     * @description: 查找页面所在的帧，可以在不持有latch_时调用
+     * @return {Page*} 持有该页面的帧，没有找到返回nullptr
+     * @param {PageId} page_id 需要查找的页面
+     */
+    Page* find(PageId page_id) const {
+        int64_t key = page_id.Get();
+        for (size_t i = hash(key);; i = (i + 1) & (capacity_ - 1)) {
+            int64_t slot_key = slots_[i].key_.load(std::memory_order_acquire);
+            if (slot_key == key) return slots_[i].page_.load(std::memory_order_relaxed);
+            if (slot_key == EMPTY_KEY) return nullptr;
+        }
+    }
+
+    /**
+     * @description: 插入页面，页面不能已经在表中，调用时持有latch_
+     * @param {PageId} page_id 插入的页面
+     * @param {Page*} page 持有该页面的帧
+     */
+    void insert(PageId page_id, Page* page) {
+        int64_t key = page_id.Get();
+        size_t i = hash(key);
+        while (slots_[i].key_.load(std::memory_order_relaxed) != EMPTY_KEY) {
+            i = (i + 1) & (capacity_ - 1);
+        }
+        // 先写入帧再发布key，查找到key的线程一定能看到对应的帧
+        slots_[i].page_.store(page, std::memory_order_relaxed);
+        slots_[i].key_.store(key, std::memory_order_release);
+    }
+
+    /**
+     * @description: 删除页面，后面探测链上的元素向前移动填补空位，调用时持有latch_
+     * @param {PageId} page_id 删除的页面，不在表中时什么也不做
+     */
+    void erase(PageId page_id) {
+        int64_t key = page_id.Get();
+        size_t hole = hash(key);
+        while (true) {
+            int64_t slot_key = slots_[hole].key_.load(std::memory_order_relaxed);
+            if (slot_key == EMPTY_KEY) return;
+            if (slot_key == key) break;
+            hole = (hole + 1) & (capacity_ - 1);
+        }
+        for (size_t i = (hole + 1) & (capacity_ - 1);; i = (i + 1) & (capacity_ - 1)) {
+            int64_t slot_key = slots_[i].key_.load(std::memory_order_relaxed);
+            if (slot_key == EMPTY_KEY) break;
+            // home不在(hole, i]之间的元素可以移动到hole
+            size_t home = hash(slot_key);
+            if (((i - home) & (capacity_ - 1)) >= ((i - hole) & (capacity_ - 1))) {
+                slots_[hole].page_.store(slots_[i].page_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+                slots_[hole].key_.store(slot_key, std::memory_order_release);
+                hole = i;
+            }
+        }
+        slots_[hole].key_.store(EMPTY_KEY, std::memory_order_release);
+    }
+
+   private:
+    // PageId::Get()不会等于EMPTY_KEY，INVALID_PAGE_ID的页面不会加入页表
+    static constexpr int64_t EMPTY_KEY = -1;
+
+    struct Slot {
+        std::atomic<int64_t> key_{EMPTY_KEY};
+        std::atomic<Page*> page_{nullptr};
+    };
+
+    // 同一个BufferPool中页面的page_no模BUFFER_POOL_NUM相同，需要把高位混合到低位
+    size_t hash(int64_t key) const {
+        uint64_t h = static_cast<uint64_t>(key);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        return h & (capacity_ - 1);
+    }
+
+    size_t capacity_;
+    std::unique_ptr<Slot[]> slots_;
+};
@@ -2,7 +2,12 @@
 
 namespace storage_service {
     StoragePoolImpl::StoragePoolImpl(DiskManager* disk_manager, LogStore *log_store, ShareStatus *share_status, BufferPoolManager* buffer_pool_mgr)
-        : disk_manager_(disk_manager), log_store_(log_store), share_status_(share_status), buffer_pool_manager_(buffer_pool_mgr) {}
+        : disk_manager_(disk_manager), log_store_(log_store), share_status_(share_status), buffer_pool_manager_(buffer_pool_mgr) {
+        // 启动时need_replay_lsn_为log store中记录的flushed lsn，计算节点通过GetPersistLsn获取它，并从它之后重新发送日志
+        if(share_status_ != nullptr) {
+            written_lsn_ = share_status_->need_replay_lsn_;
+        }
+    }
 
     StoragePoolImpl::~StoragePoolImpl(){}
 
@@ -24,27 +29,92 @@ namespace storage_service {
         //     }
         // }
 // #ifdef ENABLE_LOG_STORE
-        auto log_buf = request->log();
         // std::cout << "receive log_write message from compute node, log_message is: " << request->log() << "\n";
-        int len = log_buf.length();
-        int off = 0;
-        const char* src = log_buf.c_str();
-        while(off < len) {
-            RedoLogType log_type = *reinterpret_cast<const RedoLogType*>(src + off + REDO_LOG_TYPE_OFFSET);
-            int lsn = *reinterpret_cast<const lsn_t*>(src + off + REDO_LOG_LSN_OFFSET);
-            int log_tot_len = *reinterpret_cast<const uint32_t*>(src + off + REDO_LOG_TOTLEN_OFFSET);
-            int is_persisit = *reinterpret_cast<const bool*>(src + off + REDO_LOG_IS_PERSIST_OFFSET);
+        lsn_t replay_lsn = INVALID_LSN;
+        std::vector<std::pair<lsn_t, std::string_view>> redo_logs;
+        auto add_log = [&](const char* log, uint32_t log_tot_len) {
+            int lsn = *reinterpret_cast<const lsn_t*>(log + REDO_LOG_LSN_OFFSET);
+            int is_persisit = *reinterpret_cast<const bool*>(log + REDO_LOG_IS_PERSIST_OFFSET);
             // std::cout << "lsn: " << lsn << ", log_tot_len: " << log_tot_len << ", is_persist: " << is_persisit << "\n";
-            log_store_->write_log(lsn, log_buf.substr(off, log_tot_len));
+            redo_logs.emplace_back(lsn, std::string_view(log, log_tot_len));
             if(is_persisit) {
-                share_status_->need_replay_lsn_ = lsn;
+                replay_lsn = lsn;
+            }
+        };
+
+        brpc::Controller* cntl = static_cast<brpc::Controller*>(controller);
+        // 跨越attachment中block边界的日志需要拷贝到连续的内存中
+        std::deque<std::string> copied_logs;
+        if(!cntl->request_attachment().empty()) {
+            // 直接在attachment的block上解析日志，rest与attachment共享block，pop_front不会释放日志所在的内存
+            butil::IOBuf rest = cntl->request_attachment();
+            char log_hdr[REDO_LOG_HEADER_SIZE];
+            while(!rest.empty()) {
+                rest.copy_to(log_hdr, REDO_LOG_HEADER_SIZE);
+                uint32_t log_tot_len = *reinterpret_cast<const uint32_t*>(log_hdr + REDO_LOG_TOTLEN_OFFSET);
+                butil::StringPiece block = rest.backing_block(0);
+                if(block.size() >= log_tot_len) {
+                    add_log(block.data(), log_tot_len);
+                } else {
+                    copied_logs.emplace_back();
+                    rest.copy_to(&copied_logs.back(), log_tot_len);
+                    add_log(copied_logs.back().data(), log_tot_len);
+                }
+                rest.pop_front(log_tot_len);
+            }
+        } else {
+            const std::string& log_buf = request->log();
+            size_t off = 0;
+            while(off < log_buf.length()) {
+                uint32_t log_tot_len = *reinterpret_cast<const uint32_t*>(log_buf.data() + off + REDO_LOG_TOTLEN_OFFSET);
+                add_log(log_buf.data() + off, log_tot_len);
+                off += log_tot_len;
             }
-            off += log_tot_len;
+        }
+        if(redo_logs.empty()) {
+            return;
+        }
+        lsn_t first_lsn = redo_logs.front().first;
+        lsn_t last_lsn = redo_logs.back().first;
+        // 一次LogWrite中的日志作为一个WriteBatch写入，失败时计算节点会重新发送整个batch
+        if(!log_store_->write_logs(redo_logs)) {
+            controller->SetFailed("failed to write logs into the log store");
+            return;
         }
 // #endif
+        advance_written_lsn(first_lsn, last_lsn, replay_lsn);
         return;
     }
 
+    /**
+     * @description: 计算节点同时有多个LogWrite在发送中，它们可能乱序到达；need_replay_lsn_只能越过连续写入的日志，
+     * 否则回放线程会读到还没有写入的lsn。乱序到达的batch先记录在pending_log_batches_中，前面的batch到达之后再一起推进
+     * @param {lsn_t} first_lsn batch中第一条日志的lsn
+     * @param {lsn_t} last_lsn batch中最后一条日志的lsn
+     * @param {lsn_t} replay_lsn batch中最后一条需要回放的日志，没有时为INVALID_LSN
+     */
+    void StoragePoolImpl::advance_written_lsn(lsn_t first_lsn, lsn_t last_lsn, lsn_t replay_lsn) {
+        std::lock_guard<std::mutex> latch(log_write_latch_);
+        pending_log_batches_[first_lsn] = std::make_pair(last_lsn, replay_lsn);
+
+        auto iter = pending_log_batches_.begin();
+        bool need_replay = false;
+        // 重复发送的batch(first_lsn <= written_lsn_)直接合并
+        while(iter != pending_log_batches_.end() && iter->first <= written_lsn_ + 1) {
+            written_lsn_ = std::max(written_lsn_, iter->second.first);
+            if(iter->second.second > share_status_->need_replay_lsn_) {
+                share_status_->need_replay_lsn_ = iter->second.second;
+                need_replay = true;
+            }
+            iter = pending_log_batches_.erase(iter);
+        }
+        // 唤醒等待新日志的回放线程
+        if(need_replay) {
+            std::lock_guard<std::mutex> replay_latch(share_status_->replay_mutex_);
+            share_status_->need_replay_cv_.notify_one();
+        }
+    }
+
     void StoragePoolImpl::GetOldPage(::google::protobuf::RpcController* controller,
                        const ::storage_service::GetOldPageRequest* request,
                        ::storage_service::GetOldPageResponse* response,
@@ -56,18 +126,30 @@ namespace storage_service {
          * TODO: 优化：这里应该把最新的page放在storage节点的buffer_pool里面，从buffer里面读而不是从磁盘读
         */
 
+        // 所有页面的读取放在一个batch中一起提交
+        std::vector<std::string> datas(request->page_id().size(), std::string(PAGE_SIZE, 0));
+        DiskIOBatch batch;
         for(int i = 0; i < request->page_id().size(); ++i) {
             int table_id = request->page_id()[i].table_id();
             int fd = disk_manager_->get_table_fd(table_id);
             int page_no = request->page_id()[i].page_no();
             // std::cout << "table_id: " << table_id << ", page_id: " << request->page_id()[i].page_no();
-            char data[PAGE_SIZE];
-            try{
-                disk_manager_->read_page(fd, page_no, data, PAGE_SIZE);
-                response->add_data(std::move(std::string(data, PAGE_SIZE)));
-            } catch(RMDBError& e) {
-                std::cerr << "Error: " << e.what() << "\n";
+            batch.add_read(fd, page_no, &datas[i][0], PAGE_SIZE);
+        }
+        try{
+            batch.submit();
+            batch.wait();
+        } catch(RMDBError& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return;
+        }
+        for(int i = 0; i < request->page_id().size(); ++i) {
+            if(!batch.succeeded(i)) {
+                std::cerr << "Error: DiskManager::read_page Error, table_id: " << request->page_id()[i].table_id() 
+                          << ", page_no: " << request->page_id()[i].page_no() << "\n";
+                continue;
             }
+            response->add_data(std::move(datas[i]));
         }
 
         // response->set_data(return_pages);
@@ -81,28 +163,42 @@ namespace storage_service {
                        ::google::protobuf::Closure* done) {
         // std::cout << "receive get_latest_page message from compute node.\n";
         brpc::ClosureGuard done_guard(done);
+        brpc::Controller* cntl = static_cast<brpc::Controller*>(controller);
 
         /**
          * TODO: 优化：这里应该把最新的page放在storage节点的buffer_pool里面，从buffer里面读而不是从磁盘读
         */
     //    std::cout << "page request: pageid={" << request->page_id()[0].table_id() << "," << request->page_id()[0].page_no() << "\n";
 
+        // 多个页面的请求先把不在缓冲池中的页面通过一个batch批量读入，之后的回放和fetch_page都会命中缓冲池
+        if(request->page_id().size() > 1) {
+            std::vector<PageId> page_ids;
+            for(int i = 0; i < request->page_id().size(); ++i) {
+                page_ids.push_back(PageId{request->page_id()[i].table_id(), request->page_id()[i].page_no()});
+            }
+            buffer_pool_manager_->prefetch_pages(page_ids);
+        }
+
         for(int i = 0; i < request->page_id().size(); ++i) {
             int lsn = request->latest_lsn()[i];
             int table_id = request->page_id()[i].table_id();
             // int fd = disk_manager_->get_table_fd(table_id);
             int page_no = request->page_id()[i].page_no();
             // std::cout << "table_id: " << table_id << ", page_id: " << request->page_id()[i].page_no() << ", lsn: " << lsn << "\n";
-            char data[PAGE_SIZE];
             // disk_manager_->read_page(fd, page_no, data, PAGE_SIZE);
-            while(lsn > share_status_->current_replay_lsn_) {
-                // wait
+            // 只回放这个page上还没有回放的日志，不等待全局的回放进度
+            if(lsn > share_status_->current_replay_lsn_) {
                 // std::cout << "waitingforlogreplay: " << "lsn=" << lsn << "replaylsn=" << share_status_->current_replay_lsn_<<"\n";
+                share_status_->replay_page_(PageId{table_id, page_no}, lsn);
             }
+            // 页面按照请求的顺序直接拷贝到response attachment中，不经过protobuf
             Page* page = buffer_pool_manager_->fetch_page(PageId{table_id, page_no});
-            memcpy(data, page->get_data(), PAGE_SIZE);
+            if(page == nullptr) {
+                cntl->SetFailed("failed to fetch page " + std::to_string(page_no) + " of table " + std::to_string(table_id));
+                return;
+            }
+            cntl->response_attachment().append(page->get_data(), PAGE_SIZE);
             buffer_pool_manager_->unpin_page(PageId{table_id, page_no}, false);
-            response->add_data(std::move(std::string(data, PAGE_SIZE)));
         }
         // std::cout << "success to get_new_pages.\n";
         return;
@@ -4,6 +4,10 @@
 #include <brpc/server.h>
 #include <gflags/gflags.h>
 
+#include <deque>
+#include <map>
+#include <mutex>
+
 #include "storage_service.pb.h"
 #include "storage/disk_manager.h"
 #include "recovery/log_manager.h"
@@ -39,9 +43,15 @@ public:
                        ::google::protobuf::Closure* done);
 
 private:
+    void advance_written_lsn(lsn_t first_lsn, lsn_t last_lsn, lsn_t replay_lsn);
+
     DiskManager* disk_manager_;
     LogStore *log_store_;
     BufferPoolManager* buffer_pool_manager_;
     ShareStatus *share_status_;
+
+    std::mutex log_write_latch_;
+    lsn_t written_lsn_ = INVALID_LSN;                                       // 连续写入LogStore的最后一条日志，从启动时的flushed lsn开始
+    std::map<lsn_t, std::pair<lsn_t, lsn_t>> pending_log_batches_;          // 乱序到达的batch: first_lsn -> (last_lsn, replay_lsn)
 };
 }
\ No newline at end of file
@@ -3,87 +3,354 @@
 #include "log_replay.h"
 #include "debug_log.h"
 
-LogReplay::LogReplay(LogStore *log_store, DiskManager *disk_manager, IxManager *ix_manager, SmManager *sm_manager, ShareStatus *share_status) 
+LogReplay::LogReplay(LogStore *log_store, DiskManager *disk_manager, IxManager *ix_manager, SmManager *sm_manager, ShareStatus *share_status,
+                     int worker_num) 
     : log_store_(log_store), disk_manager_(disk_manager), ix_manager_(ix_manager), sm_manager_(sm_manager), share_status_(share_status) {
         std::cout << "try to start log replay thread! \n";
+        dispatched_lsn_ = share_status_->current_replay_lsn_;
+        index_handles_ = sm_manager_->get_table_id_index_map();
         /*
-            start replay thread
+            start replay workers and the dispatcher
         */
+        for(int i = 0; i < worker_num; ++i) {
+            workers_.emplace_back(std::make_unique<ReplayWorker>());
+        }
+        for(int i = 0; i < worker_num; ++i) {
+            workers_[i]->thread_ = std::thread(&LogReplay::replay_worker, this, i);
+        }
         replay_thread_ = std::thread(&LogReplay::replay_log, this);
-        std::cout << "replay thread starts!\n";
+        share_status_->replay_page_ = [this](const PageId &page_id, lsn_t lsn) { replay_page(page_id, lsn); };
+        share_status_->pause_replay_ = [this]() { return pause_replay(); };
+        share_status_->resume_replay_ = [this]() { resume_replay(); };
+        std::cout << "replay thread starts! replay workers: " << worker_num << "\n";
+    }
+
+LogReplay::~LogReplay() {
+    {
+        std::lock_guard<std::mutex> latch(replay_latch_);
+        stop_ = true;
+        for(auto& worker: workers_) {
+            worker->cv_.notify_all();
+        }
+        dispatch_cv_.notify_all();
+        page_cv_.notify_all();
+    }
+    {
+        std::lock_guard<std::mutex> latch(share_status_->replay_mutex_);
+        share_status_->need_replay_cv_.notify_all();
     }
+    replay_thread_.join();
+    for(auto& worker: workers_) {
+        worker->thread_.join();
+    }
+}
 
 void LogReplay::replay_log() {
     while(true) {
         // std::cout << "LogReplayThread: current_replay_lsn = " << share_status_->current_replay_lsn_ << ", need_replay_lsn_ = " << share_status_->need_replay_lsn_ << "\n";
-        if(share_status_->current_replay_lsn_ < share_status_->need_replay_lsn_) {
-            // do replay
-            lsn_t replay_log = share_status_->current_replay_lsn_ + 1;
-            // retrieve corresponding log
-            std::string redo_log_string = log_store_->read_log(replay_log);
-            replay_single_log(redo_log_string);
-            share_status_->current_replay_lsn_ = replay_log;
+        lsn_t begin_lsn;
+        {
+            std::lock_guard<std::mutex> latch(replay_latch_);
+            if(stop_) return;
+            begin_lsn = dispatched_lsn_ + 1;
+        }
+        lsn_t end_lsn = share_status_->need_replay_lsn_;
+        if(begin_lsn <= end_lsn) {
+            // retrieve the logs in [begin_lsn, end_lsn] with one iterator
+            std::vector<std::string> redo_logs;
+            log_store_->read_logs(begin_lsn, end_lsn, &redo_logs);
+            // 只回放从begin_lsn开始连续的日志，缺失的lsn之后的日志留到下一轮重新读取
+            lsn_t next_lsn = begin_lsn;
+            for(auto& redo_log_string: redo_logs) {
+                auto redo_log = parse_log(redo_log_string);
+                if(redo_log->lsn_ != next_lsn) break;
+                dispatch_log(std::move(redo_log));
+                next_lsn++;
+            }
+            {
+                std::lock_guard<std::mutex> latch(replay_latch_);
+                set_dispatched_lsn(next_lsn - 1);
+                advance_replay_lsn();
+            }
+            if(next_lsn <= end_lsn) {
+                std::cerr << "LogReplayThread: log " << next_lsn << " in [" << begin_lsn << ", " << end_lsn << "] is missing, read " << redo_logs.size() << " logs, retry later\n";
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
         } else {
-            // don't need redo, sleep and wait
-            std::this_thread::sleep_for(std::chrono::milliseconds(50)); //sleep 50 ms
+            // don't need redo, wait until new logs are written into the log store
+            std::unique_lock<std::mutex> latch(share_status_->replay_mutex_);
+            share_status_->need_replay_cv_.wait_for(latch, std::chrono::milliseconds(50), [&]() {
+                return share_status_->need_replay_lsn_ >= begin_lsn;
+            });
+        }
+    }
+}
+
+/**
+ * @description: UPDATE/DELETE只修改一个page中的记录，按照(table, page)分发给worker；
+ * 其他日志可能修改B+树的结构，等待所有worker完成之后由dispatcher自己回放，commit/abort日志不需要回放
+ */
+void LogReplay::dispatch_log(std::unique_ptr<RedoLogRecord> redo_log) {
+    lsn_t lsn = redo_log->lsn_;
+    PageId page_id;
+    switch(redo_log->log_type_) {
+        case RedoLogType::UPDATE: {
+            auto update_redo_log = static_cast<UpdateRedoLogRecord*>(redo_log.get());
+            page_id = PageId{update_redo_log->table_id_, update_redo_log->rid_.page_no};
+        } break;
+        case RedoLogType::DELETE: {
+            auto delete_redo_log = static_cast<DeleteRedoLogRecord*>(redo_log.get());
+            page_id = PageId{delete_redo_log->table_id_, delete_redo_log->rid_.page_no};
+        } break;
+        case RedoLogType::INSERT:
+        case RedoLogType::PURGE:
+        case RedoLogType::COMPACT: {
+            // barrier: 等待之前分发的日志全部回放完成
+            {
+                std::unique_lock<std::mutex> latch(replay_latch_);
+                dispatch_cv_.wait(latch, [&]() {
+                    if(stop_) return true;
+                    if(paused_) return false;
+                    for(auto& worker: workers_) {
+                        if(!worker->tasks_.empty()) return false;
+                    }
+                    return true;
+                });
+                applying_barrier_ = true;
+            }
+            apply_log(redo_log.get());
+            std::lock_guard<std::mutex> latch(replay_latch_);
+            applying_barrier_ = false;
+            set_dispatched_lsn(lsn);
+            advance_replay_lsn();
+            dispatch_cv_.notify_all();
+            return;
+        }
+        default: {
+            std::lock_guard<std::mutex> latch(replay_latch_);
+            set_dispatched_lsn(lsn);
+            advance_replay_lsn();
+            return;
+        }
+    }
+
+    ReplayWorker* worker = workers_[PageIdHash()(page_id) % workers_.size()].get();
+    std::unique_lock<std::mutex> latch(replay_latch_);
+    dispatch_cv_.wait(latch, [&]() { return stop_ || (!paused_ && worker->tasks_.size() < (size_t)LOG_REPLAY_QUEUE_SIZE); });
+    pending_pages_[page_id].tasks_.push_back(ReplayTask{lsn, std::move(redo_log)});
+    worker->tasks_.emplace_back(lsn, page_id);
+    set_dispatched_lsn(lsn);
+    worker->cv_.notify_one();
+}
+
+void LogReplay::set_dispatched_lsn(lsn_t lsn) {
+    dispatched_lsn_ = lsn;
+    if(page_waiters_ > 0) {
+        page_cv_.notify_all();
+    }
+}
+
+void LogReplay::replay_worker(int worker_id) {
+    ReplayWorker* worker = workers_[worker_id].get();
+    std::unique_lock<std::mutex> latch(replay_latch_);
+    while(true) {
+        worker->cv_.wait(latch, [&]() { return stop_ || !worker->tasks_.empty(); });
+        if(stop_) return;
+
+        lsn_t lsn = worker->tasks_.front().first;
+        PageId page_id = worker->tasks_.front().second;
+        // 队首不是这条日志说明它已经被replay_page()回放
+        auto iter = pending_pages_.find(page_id);
+        if(iter != pending_pages_.end() && iter->second.tasks_.front().lsn_ == lsn) {
+            if(iter->second.applying_) {
+                // replay_page()正在回放这条日志
+                ++page_waiters_;
+                page_cv_.wait(latch);
+                --page_waiters_;
+                continue;
+            }
+            apply_page_task(latch, page_id, iter->second);
+        }
+        worker->tasks_.pop_front();
+        advance_replay_lsn();
+        // dispatcher和pause_replay()都可能在等待
+        dispatch_cv_.notify_all();
+    }
+}
+
+/**
+ * @description: GetLatestPage只需要page_id上lsn之前的日志全部回放，等待dispatcher分发到lsn之后，
+ * 直接在当前线程回放这个page上剩余的日志，不需要等待其他page的回放进度
+ * @param {PageId&} page_id 要读取的page
+ * @param {lsn_t} lsn 需要回放到的lsn
+ */
+void LogReplay::replay_page(const PageId &page_id, lsn_t lsn) {
+    std::unique_lock<std::mutex> latch(replay_latch_);
+    ++page_waiters_;
+    // 结构修改类的日志由dispatcher回放，dispatched_lsn_ >= lsn之后这些日志已经回放完成
+    page_cv_.wait(latch, [&]() { return stop_ || dispatched_lsn_ >= lsn; });
+    while(!stop_) {
+        auto iter = pending_pages_.find(page_id);
+        if(iter == pending_pages_.end() || iter->second.tasks_.front().lsn_ > lsn) {
+            break;
+        }
+        if(iter->second.applying_) {
+            page_cv_.wait(latch);
             continue;
         }
+        apply_page_task(latch, page_id, iter->second);
     }
+    --page_waiters_;
 }
 
-void LogReplay::replay_single_log(const std::string &redo_log_str) {
+/**
+ * @description: 不同page的日志由worker并行回放，current_replay_lsn_之后的部分日志可能已经回放，
+ * 刷脏需要拷贝一个恰好包含某个lsn及之前所有日志的状态(insert/purge/compact的重复回放不是幂等的)，
+ * 因此先停止分发新的日志，等待worker和dispatcher回放完所有已经分发的日志。暂停期间GetLatestPage会等待resume_replay()
+ * @return {lsn_t} 已经回放的最大lsn
+ */
+lsn_t LogReplay::pause_replay() {
+    std::unique_lock<std::mutex> latch(replay_latch_);
+    paused_ = true;
+    dispatch_cv_.wait(latch, [&]() {
+        if(stop_) return true;
+        if(applying_barrier_) return false;
+        for(auto& worker: workers_) {
+            if(!worker->tasks_.empty()) return false;
+        }
+        return true;
+    });
+    advance_replay_lsn();
+    return share_status_->current_replay_lsn_;
+}
+
+void LogReplay::resume_replay() {
+    std::lock_guard<std::mutex> latch(replay_latch_);
+    paused_ = false;
+    dispatch_cv_.notify_all();
+}
+
+void LogReplay::apply_page_task(std::unique_lock<std::mutex> &latch, const PageId &page_id, PageRedoQueue &queue) {
+    // applying_期间queue不会被删除，unordered_map插入新的page也不会使queue失效
+    queue.applying_ = true;
+    RedoLogRecord* redo_log = queue.tasks_.front().redo_log_.get();
+    latch.unlock();
+    apply_log(redo_log);
+    latch.lock();
+    queue.applying_ = false;
+    queue.tasks_.pop_front();
+    if(queue.tasks_.empty()) {
+        pending_pages_.erase(page_id);
+    }
+    if(page_waiters_ > 0) {
+        page_cv_.notify_all();
+    }
+}
+
+void LogReplay::advance_replay_lsn() {
+    lsn_t replay_lsn = dispatched_lsn_;
+    for(auto& worker: workers_) {
+        if(!worker->tasks_.empty()) {
+            replay_lsn = std::min(replay_lsn, worker->tasks_.front().first - 1);
+        }
+    }
+    if(replay_lsn > share_status_->current_replay_lsn_) {
+        share_status_->current_replay_lsn_ = replay_lsn;
+    }
+}
+
+IxIndexHandle* LogReplay::get_index_handle(int table_id) {
+    auto iter = index_handles_.find(table_id);
+    if(iter == index_handles_.end()) {
+        throw RMDBError("table id " + std::to_string(table_id) + " not found!");
+    }
+    return iter->second;
+}
+
+std::unique_ptr<RedoLogRecord> LogReplay::parse_log(const std::string &redo_log_str) {
     // deserilize
     RedoLogRecord redo_log_hdr;
     redo_log_hdr.deserialize(redo_log_str.c_str());
 
-    // DEBUG_REPALY_LOG(redo_log_hdr);
-
+    std::unique_ptr<RedoLogRecord> redo_log;
     switch (redo_log_hdr.log_type_)
+    {
+        case RedoLogType::UPDATE: redo_log = std::make_unique<UpdateRedoLogRecord>(); break;
+        case RedoLogType::DELETE: redo_log = std::make_unique<DeleteRedoLogRecord>(); break;
+        case RedoLogType::INSERT: redo_log = std::make_unique<InsertRedoLogRecord>(); break;
+        case RedoLogType::PURGE: redo_log = std::make_unique<PurgeRedoLogRecord>(); break;
+        case RedoLogType::COMPACT: redo_log = std::make_unique<CompactRedoLogRecord>(); break;
+        default: redo_log = std::make_unique<RedoLogRecord>(); break;
+    }
+    redo_log->deserialize(redo_log_str.c_str());
+    return redo_log;
+}
+
+void LogReplay::replay_single_log(const std::string &redo_log_str) {
+    apply_log(parse_log(redo_log_str).get());
+}
+
+void LogReplay::apply_log(RedoLogRecord* redo_log) {
+    // DEBUG_REPALY_LOG(*redo_log);
+
+    switch (redo_log->log_type_)
     {
         case RedoLogType::UPDATE: {
-            UpdateRedoLogRecord update_redo_log;
-            update_redo_log.deserialize(redo_log_str.c_str());
+            auto update_redo_log = static_cast<UpdateRedoLogRecord*>(redo_log);
 
-            // update_redo_log.format_print();
+            // update_redo_log->format_print();
             // puts("");
 
             // do update 
-            std::string table_name = std::string(update_redo_log.table_name_, update_redo_log.table_name_size_);
-            auto index_handle = sm_manager_->primary_index_[table_name].get();
-            if(index_handle == nullptr) {
-                throw RMDBError("table name " + std::string(update_redo_log.table_name_) + " not found!");
-            }
-
-            index_handle->update_record(update_redo_log.rid_, update_redo_log.new_value_.data, nullptr);
+            auto index_handle = get_index_handle(update_redo_log->table_id_);
+            index_handle->replay_update_record(update_redo_log->rid_, update_redo_log->ranges_);
             
             break;
         }
         case RedoLogType::DELETE: {
-            DeleteRedoLogRecord delete_redo_log;
-            delete_redo_log.deserialize(redo_log_str.c_str());
+            auto delete_redo_log = static_cast<DeleteRedoLogRecord*>(redo_log);
 
-            // delete_redo_log.format_print();
+            // delete_redo_log->format_print();
             // puts("");
 
             // do delete
-            std::string table_name = std::string(delete_redo_log.table_name_, delete_redo_log.table_name_size_);
-            auto index_handle = sm_manager_->primary_index_[table_name].get();
+            auto index_handle = get_index_handle(delete_redo_log->table_id_);
 
-            index_handle->update_record(delete_redo_log.rid_, delete_redo_log.delete_value_.data, nullptr);
+            index_handle->delete_record(delete_redo_log->rid_, nullptr);
 
             break;
         }
         
         case RedoLogType::INSERT: {
-            InsertRedoLogRecord insert_redo_log;
-            insert_redo_log.deserialize(redo_log_str.c_str());
+            auto insert_redo_log = static_cast<InsertRedoLogRecord*>(redo_log);
 
-            // insert_redo_log.format_print();
+            // insert_redo_log->format_print();
             // puts("");
-            std::string table_name = std::string(insert_redo_log.table_name_, insert_redo_log.table_name_size_);
-            auto index_handle = sm_manager_->primary_index_[table_name].get();
+            std::string table_name = std::string(insert_redo_log->table_name_, insert_redo_log->table_name_size_);
+            auto index_handle = sm_manager_->get_index_handle(table_name);
 
-            index_handle->replay_insert_record(insert_redo_log.rid_, insert_redo_log.key_, insert_redo_log.insert_value_.data);
+            index_handle->replay_insert_record(insert_redo_log->rid_, insert_redo_log->key_, insert_redo_log->insert_value_.data);
+            break;
+        }
+
+        case RedoLogType::PURGE: {
+            auto purge_redo_log = static_cast<PurgeRedoLogRecord*>(redo_log);
+
+            std::string table_name = std::string(purge_redo_log->table_name_, purge_redo_log->table_name_size_);
+            auto index_handle = sm_manager_->get_index_handle(table_name);
+
+            index_handle->replay_delete_entry(purge_redo_log->key_);
+            break;
+        }
+
+        case RedoLogType::COMPACT: {
+            auto compact_redo_log = static_cast<CompactRedoLogRecord*>(redo_log);
+
+            std::string table_name = std::string(compact_redo_log->table_name_, compact_redo_log->table_name_size_);
+            auto index_handle = sm_manager_->get_index_handle(table_name);
+
+            index_handle->replay_compact_leaf(compact_redo_log->page_no_);
+            break;
         }
     
         default:
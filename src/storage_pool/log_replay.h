@@ -1,6 +1,12 @@
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "storage/buffer_pool_manager.h"
 #include "index/ix.h"
@@ -12,19 +18,87 @@
 
 /* 
     LogReplay
+    replay_log()线程作为dispatcher，从log store中顺序读取日志，按照(table, page)把日志分发给replay worker：
+    同一个page的日志由同一个worker按照lsn顺序回放，不同page的日志并行回放；
+    insert/purge/compact可能修改B+树的结构(分裂、合并)，涉及多个page，这些日志等待所有worker回放完成之后由dispatcher单独回放
+    分发给worker的日志同时按照page索引在pending_pages_中，GetLatestPage通过replay_page()直接回放目标page上未回放的日志，
+    而不需要等待所有page的回放进度
 */
 class LogReplay {
 
 public:
-    // Log Replay初始化时，启动一个线程运行replay_log()
-    LogReplay(LogStore *log_store, DiskManager *disk_manager, IxManager *ix_manager, SmManager *sm_manager,ShareStatus *share_status);
+    // Log Replay初始化时，启动dispatcher线程运行replay_log()，以及worker_num个replay worker
+    LogReplay(LogStore *log_store, DiskManager *disk_manager, IxManager *ix_manager, SmManager *sm_manager,ShareStatus *share_status,
+              int worker_num = LOG_REPLAY_WORKER_NUM);
+
+    ~LogReplay();
 
     void replay_log();
     void replay_single_log(const std::string &redo_log_str);
+
+    // 回放page_id上lsn及之前的所有日志，由GetLatestPage调用
+    void replay_page(const PageId &page_id, lsn_t lsn);
+
+    // 暂停分发新的日志，等待已经分发的日志全部回放完成，返回的lsn及之前的日志都已经回放，之后的日志都没有回放，由PageFlusher调用
+    lsn_t pause_replay();
+
+    void resume_replay();
 private:
+    // 分发给worker的一条日志
+    struct ReplayTask {
+        lsn_t lsn_;
+        std::unique_ptr<RedoLogRecord> redo_log_;
+    };
+
+    // 一个page上还没有回放的日志，按照lsn排序
+    struct PageRedoQueue {
+        std::deque<ReplayTask> tasks_;
+        bool applying_ = false;                 // 队首的日志正在被worker或者GetLatestPage回放
+    };
+
+    struct ReplayWorker {
+        std::thread thread_;
+        std::deque<std::pair<lsn_t, PageId>> tasks_;    // 分发给该worker的日志，回放完成之前留在队首
+        std::condition_variable cv_;
+    };
+
+    static std::unique_ptr<RedoLogRecord> parse_log(const std::string &redo_log_str);
+
+    void apply_log(RedoLogRecord *redo_log);
+
+    void dispatch_log(std::unique_ptr<RedoLogRecord> redo_log);
+
+    void replay_worker(int worker_id);
+
+    // 回放queue队首的日志，回放期间释放latch，调用者需要持有replay_latch_并保证队首的日志没有在回放
+    void apply_page_task(std::unique_lock<std::mutex> &latch, const PageId &page_id, PageRedoQueue &queue);
+
+    // 调用者需要持有replay_latch_
+    void set_dispatched_lsn(lsn_t lsn);
+
+    // 根据物理日志中的table_id找到索引句柄
+    IxIndexHandle* get_index_handle(int table_id);
+
+    // 推进current_replay_lsn_：所有worker中最早的未完成日志之前的日志都已经回放，调用者需要持有replay_latch_
+    void advance_replay_lsn();
+
     // thread
     std::thread     replay_thread_;
 
+    // replay workers
+    std::vector<std::unique_ptr<ReplayWorker>> workers_;
+    std::mutex              replay_latch_;      // 保护worker的任务队列和dispatched_lsn_
+    std::condition_variable dispatch_cv_;       // worker完成日志之后唤醒dispatcher(队列已满，或者等待所有worker完成)
+    lsn_t                   dispatched_lsn_ = INVALID_LSN;
+    bool                    paused_ = false;            // 为true时dispatcher不再分发和回放新的日志
+    bool                    applying_barrier_ = false;  // dispatcher正在回放insert/purge/compact日志
+    std::unordered_map<PageId, PageRedoQueue, PageIdHash> pending_pages_;  // page -> 已经分发但还没有回放的日志
+    std::condition_variable page_cv_;           // 唤醒replay_page()：dispatched_lsn_推进，或者page上的日志回放完成
+    int                     page_waiters_ = 0;  // 正在等待page_cv_的线程数
+
+    std::unordered_map<int, IxIndexHandle*> index_handles_;    // table_id -> index handle，回放开始之前构造，之后只读
+    bool                    stop_ = false;
+
     // disk manager and log buffer
     LogStore            *log_store_;
     DiskManager         *disk_manager_;
@@ -32,4 +106,4 @@ private:
     SmManager           *sm_manager_;
     ShareStatus         *share_status_;
 
-};
\ No newline at end of file
+};
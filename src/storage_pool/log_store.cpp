@@ -1,7 +1,8 @@
+#include <memory>
 #include "log_store.h"
 #include "debug_log.h"
 
-LogStore::LogStore(const std::string &log_store_path) : log_store_path_(log_store_path) {
+LogStore::LogStore(const std::string &log_store_path, bool sync_write) : log_store_path_(log_store_path) {
     rocksdb::Options options;
     options.create_if_missing = true;
     rocksdb::Status status = rocksdb::DB::Open(options, log_store_path, &db_);
@@ -9,16 +10,28 @@ LogStore::LogStore(const std::string &log_store_path) : log_store_path_(log_stor
         std::cerr << "Failed to create log store. Error: " << status.ToString() << std::endl;
         // return -1;
     }
-    std::cout << "Create log store successfully! Redo log path: " << log_store_path << std::endl;
+    write_options_.sync = sync_write;
+    std::cout << "Create log store successfully! Redo log path: " << log_store_path << ", sync write: " << sync_write << std::endl;
+}
+
+const std::string LogStore::FLUSHED_LSN_KEY = std::string(1, '\0');
+
+// lsn非负，编码成4字节大端的无符号整数，字节序和数值顺序一致
+std::string LogStore::encode_lsn_key(lsn_t lsn) {
+    uint32_t value = static_cast<uint32_t>(lsn);
+    char key[sizeof(uint32_t)];
+    for(int i = sizeof(uint32_t) - 1; i >= 0; --i) {
+        key[i] = static_cast<char>(value & 0xff);
+        value >>= 8;
+    }
+    return std::string(key, sizeof(uint32_t));
 }
 
 // write log
 bool LogStore::write_log(lsn_t lsn, const std::string &redo_log) {
-    std::cout << "write log: " << redo_log << std::endl;
-    rocksdb::WriteOptions write_options;
-    std::string key = std::to_string(lsn);
+    std::string key = encode_lsn_key(lsn);
     // std::string value; // TODO: redo_log-> to string
-    rocksdb::Status status = db_->Put(write_options, key, redo_log);
+    rocksdb::Status status = db_->Put(write_options_, key, redo_log);
     #ifdef PRINT_LOG
         StorageDebug::getInstance()->DEBUG_WRITE_LOG(lsn, status.ok(), redo_log);
     #endif
@@ -34,10 +47,27 @@ bool LogStore::write_log(lsn_t lsn, const std::string &redo_log) {
     return true;
 }
 
+// write logs
+bool LogStore::write_logs(const std::vector<std::pair<lsn_t, std::string_view>> &redo_logs) {
+    rocksdb::WriteBatch batch;
+    for(auto& [lsn, redo_log]: redo_logs) {
+        batch.Put(encode_lsn_key(lsn), rocksdb::Slice(redo_log.data(), redo_log.size()));
+        #ifdef PRINT_LOG
+            StorageDebug::getInstance()->DEBUG_WRITE_LOG(lsn, true, std::string(redo_log));
+        #endif
+    }
+    rocksdb::Status status = db_->Write(write_options_, &batch);
+    if (!status.ok()) {
+        std::cerr << "Failed to write " << redo_logs.size() << " logs. Error: " << status.ToString() << std::endl;
+        return false;
+    }
+    return true;
+}
+
 // read log
 std::string LogStore::read_log(lsn_t lsn) {
     rocksdb::ReadOptions read_options;
-    std::string key = std::to_string(lsn);
+    std::string key = encode_lsn_key(lsn);
     std::string value;
     rocksdb::Status status = db_->Get(read_options, key, &value);
     if (status.ok()) {
@@ -49,6 +79,47 @@ std::string LogStore::read_log(lsn_t lsn) {
     }
 }
 
+// read logs
+void LogStore::read_logs(lsn_t begin_lsn, lsn_t end_lsn, std::vector<std::string> *redo_logs) {
+    std::string end_key = encode_lsn_key(end_lsn + 1);
+    rocksdb::Slice upper_bound(end_key);
+    rocksdb::ReadOptions read_options;
+    read_options.iterate_upper_bound = &upper_bound;
+    std::unique_ptr<rocksdb::Iterator> iter(db_->NewIterator(read_options));
+    for(iter->Seek(encode_lsn_key(begin_lsn)); iter->Valid(); iter->Next()) {
+        redo_logs->emplace_back(iter->value().ToString());
+    }
+    if (!iter->status().ok()) {
+        std::cerr << "Failed to read logs in [" << begin_lsn << ", " << end_lsn << "]. Error: " << iter->status().ToString() << std::endl;
+    }
+}
+
+// truncate logs
+bool LogStore::truncate_logs(lsn_t flushed_lsn) {
+    rocksdb::WriteBatch batch;
+    batch.DeleteRange(encode_lsn_key(0), encode_lsn_key(flushed_lsn + 1));
+    batch.Put(FLUSHED_LSN_KEY, rocksdb::Slice(reinterpret_cast<const char*>(&flushed_lsn), sizeof(lsn_t)));
+    // 删除日志和flushed lsn在同一个WriteBatch中原子写入，并且等待落盘，重启之后从flushed lsn之后开始回放
+    rocksdb::WriteOptions write_options = write_options_;
+    write_options.sync = true;
+    rocksdb::Status status = db_->Write(write_options, &batch);
+    if (!status.ok()) {
+        std::cerr << "Failed to truncate logs before lsn " << flushed_lsn << ". Error: " << status.ToString() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// read flushed lsn
+lsn_t LogStore::read_flushed_lsn() {
+    std::string value;
+    rocksdb::Status status = db_->Get(rocksdb::ReadOptions(), FLUSHED_LSN_KEY, &value);
+    if (!status.ok() || value.size() != sizeof(lsn_t)) {
+        return INVALID_LSN;
+    }
+    return *reinterpret_cast<const lsn_t*>(value.data());
+}
+
 // flush to disk
 void LogStore::flush_log_to_disk() {
     // Flush data to disk
@@ -1,20 +1,38 @@
 #pragma once
 
+#include <string_view>
+#include <vector>
+
 #include "recovery/redo_log/redolog_defs.h"
 #include "recovery/redo_log/redo_log.h"
 #include "rocksdb/db.h"
+#include "rocksdb/write_batch.h"
 
 // 使用rocksdb支持log store
+// key为定长的大端编码lsn，rocksdb中key的字节序和lsn的顺序一致，可以用iterator顺序读取一段lsn
 class LogStore {
 public:
-    LogStore(const std::string &log_store_path);
+    // sync_write: 每次写入是否等待rocksdb的WAL落盘
+    LogStore(const std::string &log_store_path, bool sync_write = false);
 
     // insert log
     bool write_log(lsn_t lsn, const std::string &redo_log);
 
+    // insert logs of one LogWrite rpc as a single WriteBatch
+    bool write_logs(const std::vector<std::pair<lsn_t, std::string_view>> &redo_logs);
+
     // read log
     std::string read_log(lsn_t lsn);
 
+    // read logs in [begin_lsn, end_lsn] with one iterator, the logs are appended in lsn order
+    void read_logs(lsn_t begin_lsn, lsn_t end_lsn, std::vector<std::string> *redo_logs);
+
+    // delete logs in [0, flushed_lsn] and record flushed_lsn atomically, called after the pages are flushed
+    bool truncate_logs(lsn_t flushed_lsn);
+
+    // flushed lsn recorded by the last truncate_logs, INVALID_LSN if the logs are never truncated
+    lsn_t read_flushed_lsn();
+
     // flush disk
     void flush_log_to_disk();
 
@@ -24,6 +42,12 @@ public:
     void clear_all();
 
 private:
+    static std::string encode_lsn_key(lsn_t lsn);
+
+    // 长度为1，比所有4字节的lsn key都小，不会被read_logs和truncate_logs访问到
+    static const std::string FLUSHED_LSN_KEY;
+
     rocksdb::DB *db_;
     std::string log_store_path_;
-};
\ No newline at end of file
+    rocksdb::WriteOptions write_options_;
+};
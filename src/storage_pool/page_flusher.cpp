@@ -0,0 +1,58 @@
+#include "page_flusher.h"
+
+PageFlusher::PageFlusher(BufferPoolManager *buffer_pool_manager, LogStore *log_store, ShareStatus *share_status, lsn_t flushed_lsn,
+                         int flush_interval_ms)
+    : flushed_lsn_(flushed_lsn), flush_interval_ms_(flush_interval_ms), buffer_pool_manager_(buffer_pool_manager),
+      log_store_(log_store), share_status_(share_status) {
+    flush_thread_ = std::thread(&PageFlusher::flush_pages, this);
+    std::cout << "page flusher starts! flushed lsn: " << flushed_lsn_ << ", flush interval: " << flush_interval_ms_ << "ms\n";
+}
+
+PageFlusher::~PageFlusher() {
+    {
+        std::lock_guard<std::mutex> latch(latch_);
+        stop_ = true;
+    }
+    stop_cv_.notify_all();
+    flush_thread_.join();
+    flush_once();
+}
+
+void PageFlusher::flush_pages() {
+    std::unique_lock<std::mutex> latch(latch_);
+    while(true) {
+        stop_cv_.wait_for(latch, std::chrono::milliseconds(flush_interval_ms_), [&]() { return stop_; });
+        if(stop_) return;
+        latch.unlock();
+        flush_once();
+        latch.lock();
+    }
+}
+
+/**
+ * @description: 刷一次脏页。刷脏期间暂停日志回放，pause_replay_返回的lsn及之前的日志已经回放完成，之后的日志都没有回放，
+ * 它们的修改要么在缓冲池的脏页中，要么已经在淘汰时写入了表文件，刷脏并落盘之后可以删除这些日志。
+ * 如果刷脏时回放继续进行，拷贝的页面可能包含这个lsn之后的修改，重启之后这些日志会被重复回放
+ */
+void PageFlusher::flush_once() {
+    bool paused = static_cast<bool>(share_status_->pause_replay_);
+    lsn_t replay_lsn = paused ? share_status_->pause_replay_() : share_status_->current_replay_lsn_.load();
+    if(replay_lsn <= get_flushed_lsn()) {
+        if(paused) share_status_->resume_replay_();
+        return;
+    }
+
+    size_t flushed = 0;
+    bool success = buffer_pool_manager_->flush_dirty_pages(&flushed);
+    if(paused) share_status_->resume_replay_();
+    if(!success) {
+        std::cerr << "PageFlusher: failed to flush dirty pages, logs after lsn " << get_flushed_lsn() << " are kept\n";
+        return;
+    }
+    if(!log_store_->truncate_logs(replay_lsn)) {
+        return;
+    }
+    std::lock_guard<std::mutex> latch(latch_);
+    flushed_lsn_ = replay_lsn;
+    // std::cout << "PageFlusher: flush " << flushed << " pages, flushed lsn = " << flushed_lsn_ << "\n";
+}
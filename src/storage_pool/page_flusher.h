@@ -0,0 +1,45 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "storage/buffer_pool_manager.h"
+#include "storage_defs.h"
+#include "log_store.h"
+
+/* 
+    PageFlusher
+    存储节点的后台刷脏线程：每隔flush_interval_ms把缓冲池中的脏页写回磁盘，
+    刷脏期间暂停日志回放，刷脏开始之前已经回放的日志的修改都已经持久化，记录为flushed lsn，并从log store中删除这些日志
+*/
+class PageFlusher {
+
+public:
+    PageFlusher(BufferPoolManager *buffer_pool_manager, LogStore *log_store, ShareStatus *share_status, lsn_t flushed_lsn,
+                int flush_interval_ms = PAGE_FLUSH_INTERVAL_MS);
+
+    // 停止后台线程，并且最后刷一次脏页
+    ~PageFlusher();
+
+    lsn_t get_flushed_lsn() {
+        std::lock_guard<std::mutex> latch(latch_);
+        return flushed_lsn_;
+    }
+
+private:
+    void flush_pages();
+
+    void flush_once();
+
+    std::thread             flush_thread_;
+    std::mutex              latch_;
+    std::condition_variable stop_cv_;
+    bool                    stop_ = false;
+    lsn_t                   flushed_lsn_;           // 这个lsn及之前的日志的修改都已经写回磁盘
+    int                     flush_interval_ms_;
+
+    BufferPoolManager   *buffer_pool_manager_;
+    LogStore            *log_store_;
+    ShareStatus         *share_status_;
+};
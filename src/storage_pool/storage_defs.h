@@ -1,10 +1,21 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
 #include "recovery/redo_log/redolog_defs.h"
+#include "storage/page.h"
 
 struct ShareStatus
 {
     // std::mutex replay_lock_;    // 
     std::atomic<lsn_t> current_replay_lsn_;
     std::atomic<lsn_t> need_replay_lsn_;
-};
\ No newline at end of file
+    std::mutex replay_mutex_;
+    std::condition_variable need_replay_cv_;    // need_replay_lsn_前进之后唤醒回放线程
+    std::function<void(const PageId&, lsn_t)> replay_page_;    // 回放指定page上lsn之前的日志，由LogReplay设置
+    std::function<lsn_t()> pause_replay_;                      // 暂停回放并等待已经分发的日志回放完成，返回已经回放的lsn，由LogReplay设置
+    std::function<void()> resume_replay_;                      // 恢复pause_replay_暂停的回放
+};
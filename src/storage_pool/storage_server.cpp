@@ -113,6 +113,31 @@ int main(int argc, char* argv[]) {
     std::string workload = cJSON_GetObjectItem(storage_node, "workload")->valuestring;
     int record_num = cJSON_GetObjectItem(storage_node, "record_num")->valueint;
     int buffer_pool_size = cJSON_GetObjectItem(storage_node, "buffer_pool_size")->valueint;
+    // log store的写入是否等待rocksdb的WAL落盘，默认不等待
+    bool log_sync_write = false;
+    if(cJSON_GetObjectItem(storage_node, "log_sync_write") != nullptr) {
+        log_sync_write = (cJSON_GetObjectItem(storage_node, "log_sync_write")->valueint == 1);
+    }
+    // 后台刷脏的间隔
+    int flush_interval_ms = PAGE_FLUSH_INTERVAL_MS;
+    if(cJSON_GetObjectItem(storage_node, "flush_interval_ms") != nullptr) {
+        flush_interval_ms = cJSON_GetObjectItem(storage_node, "flush_interval_ms")->valueint;
+    }
+    // 并行回放日志的worker数量
+    int log_replay_workers = LOG_REPLAY_WORKER_NUM;
+    if(cJSON_GetObjectItem(storage_node, "log_replay_workers") != nullptr) {
+        log_replay_workers = cJSON_GetObjectItem(storage_node, "log_replay_workers")->valueint;
+    }
+    // 缓冲池读写表文件是否绕过page cache，默认不绕过
+    bool direct_io = false;
+    if(cJSON_GetObjectItem(storage_node, "direct_io") != nullptr) {
+        direct_io = (cJSON_GetObjectItem(storage_node, "direct_io")->valueint == 1);
+    }
+    // 缓冲池的置换策略: LRU(默认), CLOCK, LRU-K, 2Q
+    std::string replacer_type = REPLACER_TYPE;
+    if(cJSON_GetObjectItem(storage_node, "replacer") != nullptr) {
+        replacer_type = cJSON_GetObjectItem(storage_node, "replacer")->valuestring;
+    }
 
     std::cout << "finish resolving storage_node config\n";
 
@@ -131,7 +156,8 @@ int main(int argc, char* argv[]) {
     std::cout << "finish resolving config.json\n";
 
     auto disk_manager = std::make_shared<DiskManager>();
-    auto buffer_pool_manager = std::make_shared<BufferPoolManager>(NodeType::STORAGE_NODE, buffer_pool_size, nullptr, disk_manager.get());
+    disk_manager->set_direct_io(direct_io);
+    auto buffer_pool_manager = std::make_shared<BufferPoolManager>(NodeType::STORAGE_NODE, buffer_pool_size, nullptr, disk_manager.get(), nullptr, replacer_type);
     auto ix_manager = std::make_shared<IxManager>(buffer_pool_manager.get(), disk_manager.get());
     auto mvcc_manager = std::make_shared<MultiVersionManager>(disk_manager.get(), buffer_pool_manager.get());
     auto sm_manager = std::make_shared<SmManager>(disk_manager.get(), buffer_pool_manager.get(), ix_manager.get(), mvcc_manager.get());
@@ -143,18 +169,24 @@ int main(int argc, char* argv[]) {
     // auto log_manager = std::make_shared<LogManager>();
 
 // #ifdef ENABLE_LOG_STORE
-    auto log_store = std::make_shared<LogStore>("./storage_node_log_storage");
+    auto log_store = std::make_shared<LogStore>("./storage_node_log_storage", log_sync_write);
 
     // clear all log storage data
     // log_store->clear_all();
 
-    // init ShareStatus
-    ShareStatus share_status{.current_replay_lsn_ = -1, .need_replay_lsn_ = -1};
+    // init ShareStatus，flushed lsn之前的日志的修改已经写回磁盘，重启之后从flushed lsn之后开始回放
+    lsn_t flushed_lsn = log_store->read_flushed_lsn();
+    ShareStatus share_status{.current_replay_lsn_ = flushed_lsn, .need_replay_lsn_ = flushed_lsn};
 
     /*
         log replay thread
     */
-    auto log_replay = std::make_shared<LogReplay>(log_store.get(), disk_manager.get(), ix_manager.get(), sm_manager.get(), &share_status);
+    auto log_replay = std::make_shared<LogReplay>(log_store.get(), disk_manager.get(), ix_manager.get(), sm_manager.get(), &share_status, log_replay_workers);
+
+    /*
+        background page flusher
+    */
+    auto page_flusher = std::make_shared<PageFlusher>(buffer_pool_manager.get(), log_store.get(), &share_status, flushed_lsn, flush_interval_ms);
 // #endif
 
     std::cout << "try to start server\n";
@@ -7,6 +7,7 @@
 #include "system/sm_manager.h"
 #include "storage/storage_rpc.h"
 #include "log_replay.h"
+#include "page_flusher.h"
 #include "storage_defs.h"
 
 
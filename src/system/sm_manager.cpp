@@ -97,10 +97,7 @@ void SmManager::open_db(const std::string& db_name) {
         primary_index_.emplace(tab.name_, ix_manager_->open_index(tab.name_, pindex.cols, tab));
 
         for(size_t i = 1; i < tab.indexes_.size(); ++i) {
-            auto &index = tab.indexes_[i];
-            auto index_name = ix_manager_->get_index_name(tab.name_, index.cols);
-            assert(ihs_.count(index_name) == 0);
-            ihs_.emplace(index_name, ix_manager_->open_index(tab.name_, index.cols, tab));
+            open_secondary_index(tab, tab.indexes_[i]);
         }
     }
 
@@ -264,6 +261,7 @@ void SmManager::create_table(const std::string& tab_name, const std::vector<ColD
     index_meta.col_tot_len = col_tot_len;
     index_meta.cols = std::move(pindex_cols);
     index_meta.tab_name = tab_name;
+    index_meta.index_id = tab.table_id_;
     tab.indexes_.push_back(index_meta);
 
     ix_manager_->create_index(tab_name, index_meta.cols, tab);
@@ -315,9 +313,10 @@ void SmManager::drop_table(const std::string& tab_name, Context* context) {
     ix_manager_->destroy_index(tab_name, tab.indexes_[0].cols);
     primary_index_.erase(tab_name);
 
-    for(size_t i = 1; i < tab.indexes_.size(); ++i) {
-        auto &index = tab.indexes_[i];
-        SmManager::drop_index(tab_name, index.cols, context);
+    // drop_index会从tab.indexes_中删除对应的索引元数据
+    while(tab.indexes_.size() > 1) {
+        auto index_cols = tab.indexes_.back().cols;
+        SmManager::drop_index(tab_name, index_cols, context);
     }
     db_.tabs_.erase(tab_name);
     // fhs_.erase(tab_name);
@@ -332,60 +331,56 @@ void SmManager::drop_table(const std::string& tab_name, Context* context) {
  * @param {Context*} context
  */
 void SmManager::create_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context) {
-    // context->lock_mgr_->lock_shared_on_table(context->txn_, fhs_[tab_name]->GetFd());
-
-    // TabMeta &tab = db_.get_table(tab_name);
-    // std::vector<ColMeta> index_cols;
-    // int col_tot_len = 0;
-    // for(size_t i = 0; i < col_names.size(); ++i) {
-    //     index_cols.push_back(*(tab.get_col(col_names[i])));
-    //     col_tot_len += index_cols[i].len;
-    // }
-
-    // if (tab.is_index(col_names)) {
-    //     throw IndexExistsError(tab_name, col_names);
-    // }
+    TabMeta &tab = db_.get_table(tab_name);
+    if (tab.is_index(col_names)) {
+        throw IndexExistsError(tab_name, col_names);
+    }
+    if(context != nullptr) {
+        // 建索引期间不允许其他事务修改表
+        Lock* lock = context->lock_mgr_->request_table_lock(tab.table_id_, context->txn_, LockMode::LOCK_S, context->coro_sched_->t_id_);
+        context->txn_->append_lock(lock);
+    }
 
-    // IndexMeta index_meta;
-    // index_meta.col_num = col_names.size();
-    // index_meta.col_tot_len = col_tot_len;
-    // assert(index_meta.col_num == index_cols.size());
-    // index_meta.cols = std::move(index_cols);
-    // index_meta.tab_name = tab_name;
-    // tab.indexes_.push_back(index_meta);
+    IndexMeta index_meta;
+    index_meta.tab_name = tab_name;
+    index_meta.col_num = col_names.size();
+    index_meta.col_tot_len = 0;
+    index_meta.index_id = tab.next_secondary_index_id();
+    for(auto& col_name: col_names) {
+        index_meta.cols.push_back(*(tab.get_col(col_name)));
+        index_meta.col_tot_len += index_meta.cols.back().len;
+    }
 
-    // // Create index file
-    // // int col_idx = col - tab.cols.begin();
-    
-    // ix_manager_->create_index(tab_name, index_meta.cols, &tab);  // 这里调用了
-    // // Open index file
-    // auto ih = ix_manager_->open_index(tab_name, index_meta.cols);
-    // // Get record file handle
-    // auto file_handle = fhs_.at(tab_name).get();
-    // // Index all records into index
-    // for (RmScan rm_scan(file_handle); !rm_scan.is_end(); rm_scan.next()) {
-    //     auto rec = file_handle->get_record(rm_scan.rid(), context);  // rid是record的存储位置，作为value插入到索引里
-    //     // const char *key = rec->data + col->offset;
-    //     char* key = new char[col_tot_len];
-    //     int offset = 0;
-    //     for(size_t i = 0; i < index_meta.cols.size(); ++i) {
-    //         memcpy(key + offset, rec->data + index_meta.cols[i].offset, index_meta.cols[i].len);
-    //         offset += index_meta.cols[i].len;
-    //     }
-    //     // record data里以各个属性的offset进行分隔，属性的长度为col len，record里面每个属性的数据作为key插入索引里
-    //     ih->insert_entry(key, rm_scan.rid(), context->txn_);  // ljw: 此处调用了！
-    // }
-    // // Store index handle
-    // auto index_name = ix_manager_->get_index_name(tab_name, index_meta.cols);
-    // assert(ihs_.count(index_name) == 0);
-    // // ihs_[index_name] = std::move(ih);
-    // ihs_.emplace(index_name, std::move(ih));
-    // // Mark column index as created
-    // // col->index = true;
+    // 二级索引的key为二级索引字段+主键字段，叶子中的记录只保存key
+    IndexMeta key_meta = tab.get_secondary_key_meta(index_meta);
+    TabMeta index_tab = tab.get_secondary_index_tab_meta(index_meta);
+    auto index_name = ix_manager_->get_index_name(tab_name, index_meta.cols);
+    ix_manager_->create_index_file(index_name, index_tab.cols_, index_tab);
+    open_secondary_index(tab, index_meta);
+    IxIndexHandle* ih = ihs_.at(index_name).get();
+
+    // 扫描主键索引，批量导入所有未被删除的记录
+    {
+        IxBulkLoader bulk_loader(ih, false);
+        IxIndexHandle* pindex_handle = primary_index_.at(tab_name).get();
+        Record index_record(index_tab.record_length_);
+        Record record;
+        // 主键索引中记录的record_no不一定与key的顺序一致，扫描终点的record_no设置为最大值，只根据位置判断是否结束
+        Rid upper = pindex_handle->leaf_end();
+        upper.record_no = INT32_MAX;
+        for(IxScan scan(pindex_handle, pindex_handle->leaf_begin(), upper); !scan.is_end(); scan.next()) {
+            scan.get_record_view(&record);
+            if(record.is_deleted()) continue;
+            make_secondary_key(key_meta, record.raw_data_, index_record.raw_data_);
+            bulk_loader.append(index_record.raw_data_, index_record.record_);
+        }
+        bulk_loader.finish();
+    }
 
-    // flush_meta();
+    tab.indexes_.push_back(index_meta);
+    flush_meta();
 
-    std::cout << "finish create index\n";
+    std::cout << "finish create index: " << index_name << "\n";
 }
 
 /**
@@ -424,4 +419,117 @@ void SmManager::drop_index(const std::string& tab_name, const std::vector<ColMet
     }
     
     SmManager::drop_index(tab_name, col_names, context);
-}
\ No newline at end of file
+}
+/**
+ * @description: 根据名称获取索引句柄，用于日志回放和执行器
+ * @param {string&} name 表名称(主键索引)或者二级索引的文件名
+ * @return {IxIndexHandle*} 索引句柄，不存在时返回nullptr
+ */
+IxIndexHandle* SmManager::get_index_handle(const std::string& name) {
+    auto pindex = primary_index_.find(name);
+    if(pindex != primary_index_.end()) {
+        return pindex->second.get();
+    }
+    auto index = ihs_.find(name);
+    if(index != ihs_.end()) {
+        return index->second.get();
+    }
+    return nullptr;
+}
+
+/**
+ * @description: 物理日志通过PageId中的table_id定位索引，日志回放之前构造table_id到索引句柄的映射
+ * @return {unordered_map<int, IxIndexHandle*>} 包括主键索引和二级索引
+ */
+std::unordered_map<int, IxIndexHandle*> SmManager::get_table_id_index_map() {
+    std::unordered_map<int, IxIndexHandle*> index_map;
+    for(auto& entry: primary_index_) {
+        index_map[entry.second->get_table_id()] = entry.second.get();
+    }
+    for(auto& entry: ihs_) {
+        index_map[entry.second->get_table_id()] = entry.second.get();
+    }
+    return index_map;
+}
+
+/**
+ * @description: 按照key_meta中字段的顺序从表记录中拷贝字段，构造二级索引的key
+ * @param {IndexMeta&} key_meta 二级索引的key元数据，cols中的offset为字段在表记录中的偏移
+ * @param {char*} raw_data 表记录的数据部分(不包括RecordHdr)
+ * @param {char*} key 输出的key，长度为key_meta.col_tot_len
+ */
+void SmManager::make_secondary_key(const IndexMeta& key_meta, const char* raw_data, char* key) {
+    int offset = 0;
+    for(auto& col: key_meta.cols) {
+        memcpy(key + offset, raw_data + col.offset, col.len);
+        offset += col.len;
+    }
+}
+
+/**
+ * @description: 维护表上的二级索引，删除旧记录对应的key并插入新记录对应的key，同时生成redo日志
+ * 二级索引的日志使用索引文件名作为表名，回放时通过get_index_handle找到对应的索引
+ * @param {string&} tab_name 表名称
+ * @param {char*} old_raw 旧记录的数据部分，为nullptr表示插入
+ * @param {char*} new_raw 新记录的数据部分，为nullptr表示删除
+ * @param {Context*} context 为nullptr时不生成日志
+ */
+void SmManager::maintain_secondary_indexes(const std::string& tab_name, const char* old_raw, const char* new_raw, Context* context) {
+    TabMeta &tab = db_.get_table(tab_name);
+    if(tab.indexes_.size() <= 1) return;
+
+    std::unique_ptr<Transaction> txn_empty;
+    Transaction* txn = nullptr;
+    if(context != nullptr) {
+        txn = context->txn_;
+    } else {
+        txn_empty = std::make_unique<Transaction>(0);
+        txn = txn_empty.get();
+    }
+
+    for(size_t i = 1; i < tab.indexes_.size(); ++i) {
+        IndexMeta key_meta = tab.get_secondary_key_meta(tab.indexes_[i]);
+        auto index_name = ix_manager_->get_index_name(tab_name, tab.indexes_[i].cols);
+        IxIndexHandle* ih = ihs_.at(index_name).get();
+
+        Record index_record(key_meta.col_tot_len);
+        std::vector<char> old_key(key_meta.col_tot_len);
+        if(old_raw != nullptr) {
+            make_secondary_key(key_meta, old_raw, old_key.data());
+        }
+        if(new_raw != nullptr) {
+            make_secondary_key(key_meta, new_raw, index_record.raw_data_);
+            if(old_raw != nullptr && memcmp(old_key.data(), index_record.raw_data_, key_meta.col_tot_len) == 0) {
+                continue;
+            }
+        }
+
+        if(old_raw != nullptr) {
+            // purge日志在叶子释放写锁之前生成
+            ih->delete_entry(old_key.data(), txn, nullptr, [&]() {
+                if(context != nullptr) {
+                    context->log_mgr_->make_purge_redolog(txn->get_transaction_id(), old_key.data(), key_meta.col_tot_len, index_name);
+                }
+            });
+        }
+        if(new_raw != nullptr) {
+            ((RecordHdr*)index_record.record_)->trx_id_ = txn->get_transaction_id();
+            // insert日志同样在叶子释放写锁之前生成
+            ih->insert_entry(index_record.raw_data_, index_record.record_, txn, [&](const Rid& rid) {
+                if(context != nullptr) {
+                    RmRecord insert_record(index_record.data_length_ + sizeof(RecordHdr), index_record.record_);
+                    context->log_mgr_->make_insert_redolog(txn->get_transaction_id(), index_record.raw_data_, key_meta.col_tot_len, insert_record, rid, index_name, true);
+                }
+            });
+        }
+    }
+}
+
+/**
+ * @description: 打开二级索引文件，二级索引使用index_id作为PageId中的table_id
+ */
+void SmManager::open_secondary_index(const TabMeta& tab, const IndexMeta& index) {
+    auto index_name = ix_manager_->get_index_name(tab.name_, index.cols);
+    assert(ihs_.count(index_name) == 0);
+    ihs_.emplace(index_name, ix_manager_->open_index_file(index_name, tab.get_secondary_index_tab_meta(index)));
+}
@@ -111,4 +111,18 @@ class SmManager {
     void drop_index(const std::string& tab_name, const std::vector<std::string>& col_names, Context* context);
     
     void drop_index(const std::string& tab_name, const std::vector<ColMeta>& col_names, Context* context);
+
+    // 根据名称获取索引句柄：name为表名时返回主键索引，为索引文件名时返回二级索引，不存在时返回nullptr
+    IxIndexHandle* get_index_handle(const std::string& name);
+
+    std::unordered_map<int, IxIndexHandle*> get_table_id_index_map();
+
+    // 从表记录的raw_data中构造二级索引的key(二级索引字段+主键字段)，key_meta由TabMeta::get_secondary_key_meta得到
+    static void make_secondary_key(const IndexMeta& key_meta, const char* raw_data, char* key);
+
+    // 维护表上的所有二级索引：删除old_raw对应的key并插入new_raw对应的key，二者都可以为nullptr，key没有变化的索引不做修改
+    void maintain_secondary_indexes(const std::string& tab_name, const char* old_raw, const char* new_raw, Context* context);
+
+   private:
+    void open_secondary_index(const TabMeta& tab, const IndexMeta& index);
 };
\ No newline at end of file
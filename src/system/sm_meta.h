@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <iostream>
 #include <map>
+#include <sstream>
 #include <string>
 #include <vector>
 #include <assert.h>
@@ -90,11 +91,15 @@ struct ColMeta {
     }
 };
 
+// 二级索引的index_id为table_id + (n << SECONDARY_INDEX_ID_SHIFT)，n从1开始，不会与table_id冲突
+static constexpr int SECONDARY_INDEX_ID_SHIFT = 16;
+
 /* 索引元数据 */
 struct IndexMeta {
     std::string tab_name;           // 索引所属表名称
     int col_tot_len;                // 索引字段长度总和
     int col_num;                    // 索引字段数量
+    int index_id = -1;              // 索引文件的id，用于PageId和锁，主键索引的index_id与table_id相同
     std::vector<ColMeta> cols;      // 索引包含的字段
 
     IndexMeta() {}
@@ -103,11 +108,12 @@ struct IndexMeta {
         tab_name = other.tab_name;
         col_tot_len = other.col_tot_len;
         col_num = other.col_num;
+        index_id = other.index_id;
         for(auto col: other.cols) cols.emplace_back(col);
     }
 
     friend std::ostream &operator<<(std::ostream &os, const IndexMeta &index) {
-        os << index.tab_name << " " << index.col_tot_len << " " << index.col_num;
+        os << index.tab_name << " " << index.col_tot_len << " " << index.col_num << " " << index.index_id;
         for(auto& col: index.cols) {
             os << "\n" << col;
         }
@@ -116,6 +122,13 @@ struct IndexMeta {
 
     friend std::istream &operator>>(std::istream &is, IndexMeta &index) {
         is >> index.tab_name >> index.col_tot_len >> index.col_num;
+        // 旧版本的元数据文件中这一行没有index_id，此时为-1，由TabMeta按照索引的顺序补齐
+        std::string rest;
+        std::getline(is, rest);
+        std::istringstream rest_is(rest);
+        if(!(rest_is >> index.index_id)) {
+            index.index_id = -1;
+        }
         for(int i = 0; i < index.col_num; ++i) {
             ColMeta col;
             is >> col;
@@ -170,6 +183,44 @@ struct TabMeta {
         return indexes_.begin();
     }
 
+    /**
+     * @description: 二级索引中的记录只包含二级索引字段和主键字段，整条记录同时作为二级索引的key，因此key是唯一的
+     * 返回的cols中的offset仍然是字段在表记录中的偏移，用于从表记录中构造二级索引的key
+     */
+    IndexMeta get_secondary_key_meta(const IndexMeta& index) const {
+        IndexMeta key_meta(index);
+        for(auto& pcol: indexes_[0].cols) {
+            key_meta.cols.push_back(pcol);
+        }
+        key_meta.col_num += indexes_[0].col_num;
+        key_meta.col_tot_len += indexes_[0].col_tot_len;
+        return key_meta;
+    }
+
+    /* 二级索引文件使用的表元数据，字段为二级索引字段+主键字段，offset为字段在二级索引记录中的偏移 */
+    TabMeta get_secondary_index_tab_meta(const IndexMeta& index) const {
+        TabMeta index_tab;
+        index_tab.name_ = name_;
+        index_tab.table_id_ = index.index_id;
+        index_tab.cols_ = get_secondary_key_meta(index).cols;
+        int curr_offset = 0;
+        for(auto& col: index_tab.cols_) {
+            col.offset = curr_offset;
+            curr_offset += col.len;
+        }
+        index_tab.record_length_ = curr_offset;
+        return index_tab;
+    }
+
+    /* 为新建的二级索引分配index_id */
+    int next_secondary_index_id() const {
+        int max_no = 0;
+        for(auto& index: indexes_) {
+            max_no = std::max(max_no, (index.index_id - table_id_) >> SECONDARY_INDEX_ID_SHIFT);
+        }
+        return table_id_ + ((max_no + 1) << SECONDARY_INDEX_ID_SHIFT);
+    }
+
     /* 根据字段名称集合获取索引元数据 */
     std::vector<IndexMeta>::iterator get_index_meta(const std::vector<std::string>& col_names) {
         for(auto index = indexes_.begin(); index != indexes_.end(); ++index) {
@@ -220,6 +271,11 @@ struct TabMeta {
             is >> index;
             tab.indexes_.push_back(index);
         }
+        for(size_t i = 0; i < tab.indexes_.size(); ++i) {
+            if(tab.indexes_[i].index_id == -1) {
+                tab.indexes_[i].index_id = (i == 0) ? tab.table_id_ : tab.next_secondary_index_id();
+            }
+        }
         return is;
     }
 };
@@ -69,6 +69,16 @@ enum LockMode: int {
     NON_LOCK
 };
 
+/**
+ * 锁冲突时的处理策略，在配置文件的lock_wait_policy中指定
+ * NO_WAIT:    发生冲突立即回滚请求者
+ * WAIT_DIE:   请求者比所有冲突的事务都老(时间戳更小)时等待，否则回滚请求者
+ * WOUND_WAIT: 请求者回滚(wound)比它年轻的冲突事务，然后等待
+ */
+enum class LockWaitPolicy { NO_WAIT = 0, WAIT_DIE, WOUND_WAIT };
+
+class Transaction;
+
 static const std::string LockModeStr[5] = {
     "LOCK_IS",
     "LOCK_IX",
@@ -102,6 +112,11 @@ public:
     int offset_;
     Lock* next_ = nullptr;
     Lock* prev_ = nullptr;  // if the prev_ is nullptr, it is a head in the list
+    // 以下字段不写入状态节点
+    Transaction* txn_ = nullptr;                            // 申请该锁的事务，用于唤醒等待者和wound，从状态节点恢复的锁为nullptr
+    RecordLockType wait_lock_type_ = RECORD_INVALID_LOCK;   // 等待中的请求(LOCK_WAIT)或者等待中的锁升级的类型
+    LockMode wait_lock_mode_ = NON_LOCK;                    // 等待中的请求或者锁升级的模式
+    uint32_t upgrade_type_mode_ = 0;                        // 等待中的锁升级完成之后的type_mode_，0表示没有等待中的锁升级
 
     Lock() {
         offset_ = -1;
@@ -111,6 +126,24 @@ public:
         offset_ = -1;
     }
 
+    // 从空闲链表中取出的Lock需要重新初始化
+    void reset(txn_id_t trx_id) {
+        trx_id_ = trx_id;
+        type_mode_ = 0;
+        table_id_ = -1;
+        record_no_ = -1;
+        offset_ = -1;
+        next_ = nullptr;
+        prev_ = nullptr;
+        txn_ = nullptr;
+        wait_lock_type_ = RECORD_INVALID_LOCK;
+        wait_lock_mode_ = NON_LOCK;
+        upgrade_type_mode_ = 0;
+    }
+
+    // 已经授予并且没有等待中的锁升级
+    bool is_granted() { return !is_waiting() && upgrade_type_mode_ == 0; }
+
     // uint32_t mode() {return (type_mode_ & LOCK_MODE_MASK); }
     // uint32_t type() { return (type_mode_ & LOCK_TYPE_MASK); }
     bool is_waiting() { return (type_mode_ & LOCK_WAIT); }
@@ -304,6 +337,19 @@ public:
         first_request->prev_ = head;
     }
 
+    ~LockRequestQueue() {
+        delete request_queue_;
+    }
+
+    // 从空闲链表中取出的LockRequestQueue需要重新初始化，头结点随队列一起复用
+    void reset(int32_t record_no) {
+        record_no_ = record_no;
+        request_queue_->next_ = nullptr;
+        next_ = nullptr;
+    }
+
+    bool empty() const { return request_queue_->next_ == nullptr; }
+
     // Rid lock_rid_;
     int32_t record_no_;
     Lock* request_queue_ = nullptr;           // list of lock requests
@@ -44,170 +44,322 @@ LockRequestQueue* LockManager::get_record_request_queue_(const Rid& rid, LockLis
     return nullptr;
 }
 
-Lock* LockManager::check_record_lock_conflic(RecordLockType lock_type, LockMode lock_mode, LockRequestQueue* request_queue, Lock* req) {
-    Lock* iterator = nullptr;
-    
+/**
+ * @description: 找到lock_data_id对应的请求队列，表锁每张表只有一个队列，记录锁每条记录一个队列，不存在时创建
+ * 调用者需要持有shard的latch
+ */
+LockRequestQueue* LockManager::get_or_create_request_queue(LockTableShard* shard, const LockDataId& lock_data_id, int32_t record_no) {
+    LockListInBucket* lock_list = &shard->lock_table_[lock_data_id];
+    if(lock_data_id.type_ == LockDataType::TABLE) {
+        lock_list->bucket_id_ = -1;
+        if(lock_list->first_lock_queue_ == nullptr) {
+            lock_list->first_lock_queue_ = new_request_queue(-1);
+        }
+        return lock_list->first_lock_queue_;
+    }
+
+    lock_list->bucket_id_ = lock_data_id.bucket_id_;
+    LockRequestQueue* request_queue = get_record_request_queue_(Rid{.page_no = INVALID_PAGE_ID, .slot_no = -1, .record_no = record_no}, lock_list);
+    if(request_queue == nullptr) {
+        request_queue = new_request_queue(record_no);
+        request_queue->next_ = lock_list->first_lock_queue_;
+        lock_list->first_lock_queue_ = request_queue;
+    }
+    return request_queue;
+}
+
+/**
+ * @description: 记录上的锁全部释放之后回收它的请求队列，bucket中没有队列时从锁表中删除，避免锁表随着访问过的记录无限增长
+ * 调用者需要持有shard的latch
+ */
+void LockManager::release_empty_request_queue(LockTableShard* shard, const LockDataId& lock_data_id, int32_t record_no) {
+    auto iter = shard->lock_table_.find(lock_data_id);
+    if(iter == shard->lock_table_.end()) {
+        return;
+    }
+
+    LockRequestQueue** link = &iter->second.first_lock_queue_;
+    while(*link != nullptr && (*link)->record_no_ != record_no) {
+        link = &(*link)->next_;
+    }
+    if(*link == nullptr || !(*link)->empty()) {
+        return;
+    }
+
+    LockRequestQueue* request_queue = *link;
+    *link = request_queue->next_;
+    free_request_queue(request_queue);
+    if(iter->second.first_lock_queue_ == nullptr) {
+        shard->lock_table_.erase(iter);
+    }
+}
+
+/**
+ * @description: 判断holder是否和(lock_type, lock_mode)的请求冲突
+ * holder可以是已经授予的锁，也可以是等待中的请求(此时type_mode_中是请求的模式)
+ */
+bool LockManager::is_record_lock_conflict(Lock* holder, RecordLockType lock_type, LockMode lock_mode) {
     switch(lock_type) {
         case RECORD_LOCK_ORDINARY: {
             if(lock_mode == LOCK_S) {
-                // if there are other write/insert_intention locks, cannot upgrade lock
-                iterator = request_queue->request_queue_->next_;
-                while(iterator != nullptr) {
-                    if(req != nullptr && iterator->trx_id_ == req->trx_id_) {
-                        iterator = iterator->next_;
-                        continue;
-                    }
-
-                    if(iterator->is_insert_intention()) {
-                        return iterator;
-                    }
-                    else if(iterator->get_record_lock_mode(RECORD_LOCK_GAP) & (1 << LOCK_X)) {
-                        return iterator;
-                    }
-                    else if(iterator->get_record_lock_mode(RECORD_LOCK_ORDINARY) & (1 << LOCK_X)) {
-                        return iterator;
-                    }
-                    else if(iterator->get_record_lock_mode(RECORD_LOCK_REC_NOT_GAP) & (1 << LOCK_X)) {
-                        return iterator;
-                    }
-                    iterator = iterator->next_;
-                }
+                // other write/insert_intention locks conflict with the shared next_key lock
+                return holder->is_insert_intention() ||
+                       (holder->get_record_lock_mode(RECORD_LOCK_GAP) & (1 << LOCK_X)) ||
+                       (holder->get_record_lock_mode(RECORD_LOCK_ORDINARY) & (1 << LOCK_X)) ||
+                       (holder->get_record_lock_mode(RECORD_LOCK_REC_NOT_GAP) & (1 << LOCK_X));
             }
-            else {
-                // if there are other locks, cannot upgrade lock
-                iterator = request_queue->request_queue_->next_;
-                while(iterator != nullptr) {
-                    if(req != nullptr && iterator->trx_id_ == req->trx_id_) {
-                        iterator = iterator->next_;
-                        continue;
-                    }
-                    return iterator;
-                }
-            }
-        } break;
+            // any other lock conflicts with the exclusive next_key lock
+            return true;
+        }
         case RECORD_LOCK_GAP: {
             if(lock_mode == LOCK_S) {
-                // if there are other write gap/write next_key/insert_intention locks, cannot upgrade lock
-                iterator = request_queue->request_queue_->next_;
-                while(iterator != nullptr) {
-                    if(req != nullptr && iterator->trx_id_ == req->trx_id_) {
-                        iterator = iterator->next_;
-                        continue;
-                    }
-
-                    if(iterator->is_gap() && (iterator->get_record_lock_mode(RECORD_LOCK_GAP) & (1 << LOCK_X))) {
-                        return iterator;
-                    }
-                    else if(iterator->is_next_key_lock() && (iterator->get_record_lock_mode(RECORD_LOCK_ORDINARY) & (1 << LOCK_X))) {
-                        return iterator;
-                    }
-                    else if(iterator->is_insert_intention()) {
-                        return iterator;
-                    }
-                    iterator = iterator->next_;
-                }
+                // other write gap/write next_key/insert_intention locks
+                return (holder->is_gap() && (holder->get_record_lock_mode(RECORD_LOCK_GAP) & (1 << LOCK_X))) ||
+                       (holder->is_next_key_lock() && (holder->get_record_lock_mode(RECORD_LOCK_ORDINARY) & (1 << LOCK_X))) ||
+                       holder->is_insert_intention();
             }
-            else {
-                // if there are other gap/next_key/insert_intention locks, cannot upgrade lock
-                iterator = request_queue->request_queue_->next_;
-                while(iterator != nullptr) {
-                    if(req != nullptr && iterator->trx_id_ == req->trx_id_) {
-                        iterator = iterator->next_;
-                        continue;
-                    }
-
-                    if(iterator->is_gap() || iterator->is_next_key_lock() || iterator->is_insert_intention()) {
-                        return iterator;
-                    }
-                    iterator = iterator->next_;
-                }
-            }
-        } break;
+            // other gap/next_key/insert_intention locks
+            return holder->is_gap() || holder->is_next_key_lock() || holder->is_insert_intention();
+        }
         case RECORD_LOCK_REC_NOT_GAP: {
             if(lock_mode == LOCK_S) {
-                // if there are other write rec_not_gap/write next_key locks, cannot upgrade lock
-                iterator = request_queue->request_queue_->next_;
-                while(iterator != nullptr) {
-                    if(req != nullptr && iterator->trx_id_ == req->trx_id_) {
-                        iterator = iterator->next_;
-                        continue;
-                    }
-
-                    if(iterator->is_record_not_gap() && (iterator->get_record_lock_mode(RECORD_LOCK_REC_NOT_GAP) & (1 << LOCK_X))) {
-                        return iterator;
-                    }
-                    else if(iterator->is_next_key_lock() && (iterator->get_record_lock_mode(RECORD_LOCK_ORDINARY) & (1<< LOCK_X))) {
-                        return iterator;
-                    }
-                    else if(iterator->is_insert_intention()) {
-                        return iterator;
-                    }
-                    iterator = iterator->next_;
-                }
+                // other write rec_not_gap/write next_key locks
+                return (holder->is_record_not_gap() && (holder->get_record_lock_mode(RECORD_LOCK_REC_NOT_GAP) & (1 << LOCK_X))) ||
+                       (holder->is_next_key_lock() && (holder->get_record_lock_mode(RECORD_LOCK_ORDINARY) & (1 << LOCK_X))) ||
+                       holder->is_insert_intention();
             }
-            else {
-                // if there are other rec_not_gap/next_key locks, cannot upgrade lock
-                iterator = request_queue->request_queue_->next_;
-                while(iterator != nullptr) {
-                    if(req != nullptr && iterator->trx_id_ == req->trx_id_) {
-                        iterator = iterator->next_;
-                        continue;
-                    }
-
-                    if(iterator->is_next_key_lock() || iterator->is_record_not_gap()) {
-                        return iterator;
-                    }
-                    iterator = iterator->next_;
-                }
-            }
-        } break;
+            // other rec_not_gap/next_key locks
+            return holder->is_next_key_lock() || holder->is_record_not_gap();
+        }
         case RECORD_LOCK_INSERT_INTENTION: {
-            // if there are gap/next_key locks
-            iterator = request_queue->request_queue_->next_;
-            while(iterator != nullptr) {
-                if(req != nullptr && iterator->trx_id_ == req->trx_id_) {
-                        iterator = iterator->next_;
-                        continue;
-                    }
-
-                if(iterator->is_gap() || iterator->is_next_key_lock() ) {
-                    return iterator;
-                }
-                iterator = iterator->next_;
-            }
+            // other gap/next_key locks
+            return holder->is_gap() || holder->is_next_key_lock();
         }
         default: break;
     }
-    return nullptr;
+    return false;
 }
 
-Lock* LockManager::upgrade_record_lock_type_mode(RecordLockType lock_type, LockMode lock_mode, LockRequestQueue* request_queue, Lock* req, int thread_index) {
-    std::unique_lock<std::mutex> lock(latch_);
+bool LockManager::is_lock_conflict(Lock* holder, bool use_upgrade, bool is_table, RecordLockType lock_type, LockMode lock_mode) {
+    Lock upgraded;
+    if(use_upgrade && holder->upgrade_type_mode_ != 0) {
+        // 锁升级完成之后的模式包含了当前授予的模式
+        upgraded = *holder;
+        upgraded.type_mode_ = holder->upgrade_type_mode_;
+        holder = &upgraded;
+    }
+    if(is_table) {
+        return holder->is_conflict_table_mode(lock_mode);
+    }
+    return is_record_lock_conflict(holder, lock_type, lock_mode);
+}
 
-    Lock* tmp = check_record_lock_conflic(lock_type, lock_mode, request_queue, req);
-    if(tmp != nullptr) {
-        // std::cout << "transaction " << req->trx_id_ << " failed request record lock on {table_id=" << req->table_id_ << ", record_no=" << req->record_no_ << \
-        //  ", because transasction " << tmp->trx_id_ << " hold the lock\n";
-        throw TransactionAbortException(req->trx_id_, AbortReason::UPGRADE_CONFLICT);
+uint32_t LockManager::get_upgraded_type_mode(Lock* req, RecordLockType lock_type, LockMode lock_mode) {
+    if(req->is_table_lock()) {
+        return req->type_mode_ | (1U << (lock_mode + BIT_LOCK_MODE_TABLE));
     }
+
+    Lock upgraded = *req;
     switch(lock_type) {
         case RECORD_LOCK_ORDINARY: {
-            req->type_mode_ |= LOCK_ORDINARY;
-            req->set_record_lock_mode(lock_type, lock_mode);
+            upgraded.type_mode_ |= LOCK_ORDINARY;
+            upgraded.set_record_lock_mode(lock_type, lock_mode);
         } break;
         case RECORD_LOCK_GAP: {
-            req->type_mode_ |= LOCK_GAP;
-            req->set_record_lock_mode(lock_type, lock_mode);
+            upgraded.type_mode_ |= LOCK_GAP;
+            upgraded.set_record_lock_mode(lock_type, lock_mode);
         } break;
         case RECORD_LOCK_REC_NOT_GAP: {
-            req->type_mode_ |= LOCK_REC_NOT_GAP;
-            req->set_record_lock_mode(lock_type, lock_mode);
+            upgraded.type_mode_ |= LOCK_REC_NOT_GAP;
+            upgraded.set_record_lock_mode(lock_type, lock_mode);
         } break;
         case RECORD_LOCK_INSERT_INTENTION: {
-            req->type_mode_ |= LOCK_INSERT_INTENTION;
-        }
+            upgraded.type_mode_ |= LOCK_INSERT_INTENTION;
+        } break;
         default: break;
     }
+    return upgraded.type_mode_;
+}
+
+Lock* LockManager::check_record_lock_conflic(RecordLockType lock_type, LockMode lock_mode, LockRequestQueue* request_queue, Lock* req) {
+    Lock* iterator = request_queue->request_queue_->next_;
+    while(iterator != nullptr) {
+        if(req != nullptr && iterator->trx_id_ == req->trx_id_) {
+            iterator = iterator->next_;
+            continue;
+        }
+        if(is_record_lock_conflict(iterator, lock_type, lock_mode)) {
+            return iterator;
+        }
+        iterator = iterator->next_;
+    }
+    return nullptr;
+}
+
+bool LockManager::find_blockers(LockRequestQueue* request_queue, Lock* waiter, txn_id_t trx_id, bool is_table, RecordLockType lock_type,
+                                LockMode lock_mode, std::vector<Lock*>* blockers) {
+    bool blocked = false;
+    bool ahead = true;
+    for(Lock* other = request_queue->request_queue_->next_; other != nullptr; other = other->next_) {
+        if(other == waiter) {
+            ahead = false;
+            continue;
+        }
+        if(other->trx_id_ == trx_id) continue;
+        // 排在waiter之后的等待者不阻塞waiter，已经授予的锁和等待中的锁升级不论位置都会阻塞waiter
+        if(other->is_waiting() && !ahead) continue;
+        if(!is_lock_conflict(other, true, is_table, lock_type, lock_mode)) continue;
+
+        blocked = true;
+        if(blockers == nullptr) return true;
+        blockers->push_back(other);
+    }
+    return blocked;
+}
+
+bool LockManager::find_upgrade_blockers(LockRequestQueue* request_queue, Lock* req, bool is_table, RecordLockType lock_type,
+                                        LockMode lock_mode, std::vector<Lock*>* blockers) {
+    bool blocked = false;
+    for(Lock* other = request_queue->request_queue_->next_; other != nullptr; other = other->next_) {
+        if(other == req || other->trx_id_ == req->trx_id_ || other->is_waiting()) continue;
+        if(!is_lock_conflict(other, false, is_table, lock_type, lock_mode)) continue;
+
+        blocked = true;
+        if(blockers == nullptr) return true;
+        blockers->push_back(other);
+    }
+    return blocked;
+}
+
+static timestamp_t get_txn_ts(Transaction* txn) {
+    return txn->get_start_ts() != INVALID_TIMESTAMP ? txn->get_start_ts() : txn->get_transaction_id();
+}
+
+// 从状态节点恢复的锁没有对应的Transaction指针，使用事务id作为时间戳
+static timestamp_t get_lock_ts(Lock* lock) {
+    return lock->txn_ != nullptr ? get_txn_ts(lock->txn_) : lock->trx_id_;
+}
+
+void LockManager::resolve_lock_wait(Transaction* txn, txn_id_t trx_id, const std::vector<Lock*>& blockers) {
+    timestamp_t ts = get_txn_ts(txn);
+    if(wait_policy_ == LockWaitPolicy::WAIT_DIE) {
+        for(auto blocker: blockers) {
+            if(ts > get_lock_ts(blocker)) {
+                txn->set_lock_wait_victim(true);
+                throw TransactionAbortException(trx_id, AbortReason::DEADLOCK_PREVENTION);
+            }
+        }
+    }
+    else if(wait_policy_ == LockWaitPolicy::WOUND_WAIT) {
+        for(auto blocker: blockers) {
+            if(ts < get_lock_ts(blocker) && blocker->txn_ != nullptr) {
+                blocker->txn_->wound();
+            }
+        }
+    }
+}
+
+void LockManager::resolve_new_blocker(LockRequestQueue* request_queue, Lock* blocker, bool block_upgrades) {
+    if(wait_policy_ == LockWaitPolicy::NO_WAIT) {
+        return;
+    }
+
+    bool is_table = blocker->is_table_lock();
+    timestamp_t blocker_ts = get_lock_ts(blocker);
+    for(Lock* waiter = request_queue->request_queue_->next_; waiter != nullptr; waiter = waiter->next_) {
+        if(waiter == blocker || waiter->trx_id_ == blocker->trx_id_ || waiter->txn_ == nullptr) continue;
+        if(!waiter->is_waiting() && !(block_upgrades && waiter->upgrade_type_mode_ != 0)) continue;
+        if(!is_lock_conflict(blocker, true, is_table, waiter->wait_lock_type_, waiter->wait_lock_mode_)) continue;
+
+        timestamp_t waiter_ts = get_lock_ts(waiter);
+        if(wait_policy_ == LockWaitPolicy::WAIT_DIE && waiter_ts > blocker_ts) {
+            waiter->txn_->wound();
+        }
+        else if(wait_policy_ == LockWaitPolicy::WOUND_WAIT && waiter_ts < blocker_ts && blocker->txn_ != nullptr) {
+            blocker->txn_->wound();
+        }
+    }
+}
+
+void LockManager::wait_for_grant(LockRequestQueue* request_queue, Lock* lock, Transaction* txn, std::unique_lock<std::mutex>& latch) {
+    while(!lock->is_granted()) {
+        if(txn->is_wounded()) {
+            cancel_lock_wait(request_queue, lock);
+            txn->set_lock_wait_victim(true);
+            throw TransactionAbortException(txn->get_transaction_id(), AbortReason::DEADLOCK_PREVENTION);
+        }
+        // 等待期间lock不会被转移到其他队列(inherit_gap_locks只转移已经授予的锁)，因此醒来之后request_queue仍然有效
+        latch.unlock();
+        txn->wait_lock_signal();
+        latch.lock();
+    }
+}
+
+void LockManager::cancel_lock_wait(LockRequestQueue* request_queue, Lock* lock) {
+    if(lock->is_waiting()) {
+        LockDataId lock_data_id = get_lock_data_id(lock);
+        lock->prev_->next_ = lock->next_;
+        if(lock->next_ != nullptr)
+            lock->next_->prev_ = lock->prev_;
+        free_lock(lock);
+        grant_waiting_locks(request_queue);
+        if(lock_data_id.type_ == LockDataType::RECORD) {
+            release_empty_request_queue(get_shard(lock_data_id), lock_data_id, request_queue->record_no_);
+        }
+        return;
+    }
+
+    lock->upgrade_type_mode_ = 0;
+    lock->wait_lock_type_ = RECORD_INVALID_LOCK;
+    lock->wait_lock_mode_ = NON_LOCK;
+    grant_waiting_locks(request_queue);
+}
+
+void LockManager::grant_waiting_locks(LockRequestQueue* request_queue) {
+    if(wait_policy_ == LockWaitPolicy::NO_WAIT) {
+        return;
+    }
+
+    // 锁升级优先于等待中的新请求
+    for(Lock* lock = request_queue->request_queue_->next_; lock != nullptr; lock = lock->next_) {
+        if(lock->upgrade_type_mode_ == 0) continue;
+        if(find_upgrade_blockers(request_queue, lock, lock->is_table_lock(), lock->wait_lock_type_, lock->wait_lock_mode_, nullptr)) continue;
+
+        lock->type_mode_ = lock->upgrade_type_mode_;
+        lock->upgrade_type_mode_ = 0;
+        lock->txn_->signal_lock_wait();
+    }
+
+    // FIFO: 等待者只会被已经授予的锁、等待中的锁升级和排在它前面的等待者阻塞
+    for(Lock* lock = request_queue->request_queue_->next_; lock != nullptr; lock = lock->next_) {
+        if(!lock->is_waiting()) continue;
+        if(find_blockers(request_queue, lock, lock->trx_id_, lock->is_table_lock(), lock->wait_lock_type_, lock->wait_lock_mode_, nullptr)) continue;
+
+        lock->type_mode_ &= ~LOCK_WAIT;
+        lock->txn_->signal_lock_wait();
+    }
+}
+
+Lock* LockManager::upgrade_record_lock_type_mode(RecordLockType lock_type, LockMode lock_mode, LockRequestQueue* request_queue, Lock* req,
+                                                 std::unique_lock<std::mutex>& latch, int thread_index) {
+    std::vector<Lock*> blockers;
+    if(find_upgrade_blockers(request_queue, req, false, lock_type, lock_mode, wait_policy_ == LockWaitPolicy::NO_WAIT ? nullptr : &blockers)) {
+        if(wait_policy_ == LockWaitPolicy::NO_WAIT) {
+            // std::cout << "transaction " << req->trx_id_ << " failed request record lock on {table_id=" << req->table_id_ << ", record_no=" << req->record_no_ << "}\n";
+            throw TransactionAbortException(req->trx_id_, AbortReason::UPGRADE_CONFLICT);
+        }
+        resolve_lock_wait(req->txn_, req->trx_id_, blockers);
+
+        // 等待中的锁升级阻塞所有与升级之后的模式冲突的等待者
+        req->wait_lock_type_ = lock_type;
+        req->wait_lock_mode_ = lock_mode;
+        req->upgrade_type_mode_ = get_upgraded_type_mode(req, lock_type, lock_mode);
+        resolve_new_blocker(request_queue, req, false);
+        wait_for_grant(request_queue, req, req->txn_, latch);
+    }
+    else {
+        req->type_mode_ = get_upgraded_type_mode(req, lock_type, lock_mode);
+    }
 
     // @STATE:
     if(state_open_)
@@ -222,100 +374,81 @@ Lock* LockManager::request_record_lock(int table_id, const Rid& rid, Transaction
         return nullptr;
     }
 
-    std::unique_lock<std::mutex> lock(latch_);
-    
+    // 事务状态只会被事务自己的线程修改，不需要持有锁表的latch
     if(LockCheckState(txn) == false) {
         throw TransactionAbortException(txn->get_transaction_id(), AbortReason::LOCK_ON_SHIRINKING);
     }
-
-    LockDataId lock_data_id(table_id, rid.record_no, LockDataType::RECORD);
-    Lock* lock_request = new Lock(txn->get_transaction_id());
-    lock_request->table_id_ = table_id;
-    lock_request->record_no_ = rid.record_no;
-    // initiate lock's type_mode_
-    switch(lock_type) {
-        case RECORD_LOCK_ORDINARY: {
-            lock_request->type_mode_ = (LOCK_ORDINARY | (1 << (lock_mode + BIT_LOCK_MODE_ORDINARY)));
-        } break;
-        case RECORD_LOCK_GAP: {
-            lock_request->type_mode_ = (LOCK_GAP | (1 << (lock_mode + BIT_LOCK_MODE_GAP)));
-        } break;
-        case RECORD_LOCK_REC_NOT_GAP: {
-            lock_request->type_mode_ = (LOCK_REC_NOT_GAP | (1 << (lock_mode + BIT_LOCK_MODE_REC_NOT_GAP)));
-        } break;
-        case RECORD_LOCK_INSERT_INTENTION: {
-            lock_request->type_mode_ = (LOCK_INSERT_INTENTION);
-        } break;
-        default: break;
-    }
-
-    // LockRequestQueue* request_queue = &lock_table_.find(lock_data_id)->second;
-    if(lock_table_.count(lock_data_id) == 0) {
-        // no locks on the current page, intiate it in lock table and append lock directly
-        LockRequestQueue* request_queue = new LockRequestQueue(rid.record_no, lock_request);
-        lock_table_.emplace(std::piecewise_construct, std::forward_as_tuple(lock_data_id), 
-                            std::forward_as_tuple());
-        LockListInBucket* lock_list_in_page = &lock_table_.find(lock_data_id)->second;
-        lock_list_in_page->bucket_id_ = rid.record_no / BUCKET_SIZE;
-        lock_list_in_page->first_lock_queue_ = request_queue;
-
-        // @STATE
-        if(state_open_)
-            ContextManager::get_instance()->append_lock_state(lock_request, thread_index);
-
-        return lock_request;
+    // 已经被wound的事务不再申请新的锁
+    if(txn->is_wounded()) {
+        txn->set_lock_wait_victim(true);
+        throw TransactionAbortException(txn->get_transaction_id(), AbortReason::DEADLOCK_PREVENTION);
     }
 
-    LockListInBucket* lock_list_in_page = &lock_table_.find(lock_data_id)->second;
-    LockRequestQueue* request_queue = get_record_request_queue_(rid, lock_list_in_page);
+    LockDataId lock_data_id(table_id, rid.record_no, LockDataType::RECORD);
+    LockTableShard* shard = get_shard(lock_data_id);
+    std::unique_lock<std::mutex> lock(shard->latch_);
 
-    if(request_queue == nullptr) {
-        // there are locks on the current page, but no locks on the current record, append lock directly
-        request_queue = new LockRequestQueue(rid.record_no, lock_request);
-        request_queue->next_ = lock_list_in_page->first_lock_queue_;
-        lock_list_in_page->first_lock_queue_ = request_queue;
-
-        //@STATE:
-        if(state_open_)
-            ContextManager::get_instance()->append_lock_state(lock_request, thread_index);  
-        return lock_request;
-    }
+    LockRequestQueue* request_queue = get_or_create_request_queue(shard, lock_data_id, rid.record_no);
 
     Lock* req = request_queue->request_queue_->next_;
     while(req != nullptr) {
         if(req->trx_id_ == txn->get_transaction_id()) {
             if(lock_type == RECORD_LOCK_INSERT_INTENTION && req->is_insert_intention()) {
-                delete lock_request;
                 return req;
             }
             else if(req->is_contained_in_current_type(lock_type, 1 << lock_mode)) {
-                delete lock_request;
                 return req;
             }
             else {
-                delete lock_request;
-                lock.unlock();
-                return upgrade_record_lock_type_mode(lock_type, lock_mode, request_queue, req, thread_index);
+                req->txn_ = txn;
+                return upgrade_record_lock_type_mode(lock_type, lock_mode, request_queue, req, lock, thread_index);
             }
         }
         req = req->next_;
     }
 
     // no acuiqred locks of the txn, try to request lock
-    Lock* tmp = check_record_lock_conflic(lock_type, lock_mode, request_queue, nullptr);
-    if(tmp != nullptr) {
-        // std::cout << "transaction " << lock_request->trx_id_ << " failed request record lock on {table_id=" << lock_request->table_id_ << ", record_no=" << lock_request->record_no_ << \
-        //  ", because transasction " << tmp->trx_id_ << " hold the lock, record_no=" << tmp->record_no_ << "\n";
-        throw TransactionAbortException(txn->get_transaction_id(), AbortReason::DEADLOCK_PREVENTION);
+    std::vector<Lock*> blockers;
+    bool blocked = find_blockers(request_queue, nullptr, txn->get_transaction_id(), false, lock_type, lock_mode,
+                                 wait_policy_ == LockWaitPolicy::NO_WAIT ? nullptr : &blockers);
+    if(blocked) {
+        if(wait_policy_ == LockWaitPolicy::NO_WAIT) {
+            // std::cout << "transaction " << txn->get_transaction_id() << " failed request record lock on {table_id=" << table_id << ", record_no=" << rid.record_no << "}\n";
+            throw TransactionAbortException(txn->get_transaction_id(), AbortReason::DEADLOCK_PREVENTION);
+        }
+        resolve_lock_wait(txn, txn->get_transaction_id(), blockers);
     }
 
-    // no conflicts, add lock request into queue
-    lock_request->next_ = request_queue->request_queue_->next_;
-    lock_request->prev_ = request_queue->request_queue_;
-    if(request_queue->request_queue_->next_ != nullptr) {
-        request_queue->request_queue_->next_->prev_ = lock_request;
+    // add lock request into the tail of the queue, wait if there are conflicts
+    Lock* lock_request = new_lock(txn->get_transaction_id());
+    lock_request->table_id_ = table_id;
+    lock_request->record_no_ = rid.record_no;
+    lock_request->txn_ = txn;
+    lock_request->wait_lock_type_ = lock_type;
+    lock_request->wait_lock_mode_ = lock_mode;
+    // initiate lock's type_mode_
+    switch(lock_type) {
+        case RECORD_LOCK_ORDINARY: {
+            lock_request->type_mode_ = (LOCK_ORDINARY | (1 << (lock_mode + BIT_LOCK_MODE_ORDINARY)));
+        } break;
+        case RECORD_LOCK_GAP: {
+            lock_request->type_mode_ = (LOCK_GAP | (1 << (lock_mode + BIT_LOCK_MODE_GAP)));
+        } break;
+        case RECORD_LOCK_REC_NOT_GAP: {
+            lock_request->type_mode_ = (LOCK_REC_NOT_GAP | (1 << (lock_mode + BIT_LOCK_MODE_REC_NOT_GAP)));
+        } break;
+        case RECORD_LOCK_INSERT_INTENTION: {
+            lock_request->type_mode_ = (LOCK_INSERT_INTENTION);
+        } break;
+        default: break;
+    }
+    if(blocked) {
+        lock_request->type_mode_ |= LOCK_WAIT;
+    }
+    push_back_lock(request_queue, lock_request);
+    if(blocked) {
+        wait_for_grant(request_queue, lock_request, txn, lock);
     }
-    request_queue->request_queue_->next_ = lock_request;
 
     // @STATE:
     if(state_open_)
@@ -324,24 +457,23 @@ Lock* LockManager::request_record_lock(int table_id, const Rid& rid, Transaction
     return lock_request;
 }
 
-Lock* LockManager::upgrade_table_lock_mode(LockMode lock_mode, LockRequestQueue* request_queue, Lock* req, int thread_index) {
-    std::unique_lock<std::mutex> lock(latch_);
-
-    Lock* iterator = request_queue->request_queue_->next_;
-    while(iterator != nullptr) {
-        if(iterator->trx_id_ == req->trx_id_) {
-            iterator = iterator->next_;
-            continue;
-        }
-
-        if(iterator->is_conflict_table_mode(lock_mode)) {
+Lock* LockManager::upgrade_table_lock_mode(LockMode lock_mode, LockRequestQueue* request_queue, Lock* req,
+                                           std::unique_lock<std::mutex>& latch, int thread_index) {
+    std::vector<Lock*> blockers;
+    if(find_upgrade_blockers(request_queue, req, true, RECORD_INVALID_LOCK, lock_mode, wait_policy_ == LockWaitPolicy::NO_WAIT ? nullptr : &blockers)) {
+        if(wait_policy_ == LockWaitPolicy::NO_WAIT) {
             throw TransactionAbortException(req->trx_id_, AbortReason::DEADLOCK_PREVENTION);
         }
+        resolve_lock_wait(req->txn_, req->trx_id_, blockers);
 
-        iterator = iterator->next_;
+        req->wait_lock_mode_ = lock_mode;
+        req->upgrade_type_mode_ = get_upgraded_type_mode(req, RECORD_INVALID_LOCK, lock_mode);
+        resolve_new_blocker(request_queue, req, false);
+        wait_for_grant(request_queue, req, req->txn_, latch);
+    }
+    else {
+        req->type_mode_ = get_upgraded_type_mode(req, RECORD_INVALID_LOCK, lock_mode);
     }
-
-    req->type_mode_ |= 1 << lock_mode;
 
     // @STATE:
     if(state_open_)
@@ -352,87 +484,65 @@ Lock* LockManager::upgrade_table_lock_mode(LockMode lock_mode, LockRequestQueue*
 
 Lock* LockManager::request_table_lock(int table_id, Transaction* txn, LockMode lock_mode, int thread_index) {
     // std::cout << "request_table_lock: table_id: " << table_id << ", lock_mode: " << LockModeStr[lock_mode] << "trx_id: " << txn->get_transaction_id() << "\n";
-    std::unique_lock<std::mutex> lock(latch_);
-
     if(LockCheckState(txn) == false) {
         throw TransactionAbortException(txn->get_transaction_id(), AbortReason::LOCK_ON_SHIRINKING);
     }
 
-    LockDataId lock_data_id(table_id, LockDataType::TABLE);
-    Lock* lock_request = new Lock(txn->get_transaction_id());
-    lock_request->table_id_ = table_id;
-    lock_request->record_no_ = -1;
-    lock_request->type_mode_ = (LOCK_TABLE | (1U << (lock_mode + BIT_LOCK_MODE_TABLE)));
-
-    if(lock_table_.count(lock_data_id) == 0) {
-        LockRequestQueue* request_queue = new LockRequestQueue();
-        request_queue->request_queue_->next_ = lock_request;
-        lock_request->prev_ = request_queue->request_queue_;
-        lock_table_.emplace(std::piecewise_construct, std::forward_as_tuple(lock_data_id), 
-                            std::forward_as_tuple());
-        LockListInBucket* lock_list_in_page = &lock_table_.find(lock_data_id)->second;
-        lock_list_in_page->bucket_id_ = -1;
-        lock_list_in_page->first_lock_queue_ = request_queue;
-
-        //@STATE:
-        if(state_open_)
-            ContextManager::get_instance()->append_lock_state(lock_request, thread_index);
-        return lock_request;
+    // 快速路径：事务已经持有的表锁包含请求的模式时直接返回，不访问锁表
+    // 每次记录操作都会重复申请同一张表的IS/IX锁，这些请求都走这条路径；表锁的模式只会被持有者自己升级，因此读取不需要latch
+    Lock* held_lock = txn->get_table_lock(table_id);
+    if(held_lock != nullptr && held_lock->get_table_lock_mode() >= (1U << lock_mode)) {
+        return held_lock;
     }
 
-    LockListInBucket* lock_list_in_page = &lock_table_.find(lock_data_id)->second;
-    LockRequestQueue* request_queue = lock_list_in_page->first_lock_queue_;
+    if(txn->is_wounded()) {
+        txn->set_lock_wait_victim(true);
+        throw TransactionAbortException(txn->get_transaction_id(), AbortReason::DEADLOCK_PREVENTION);
+    }
 
-    if(request_queue == nullptr) {
-        LockRequestQueue* request_queue = new LockRequestQueue();
-        request_queue->request_queue_->next_ = lock_request;
-        lock_request->prev_ = request_queue->request_queue_;
-        lock_list_in_page->first_lock_queue_ = request_queue;
+    LockDataId lock_data_id(table_id, LockDataType::TABLE);
+    LockTableShard* shard = get_shard(lock_data_id);
+    std::unique_lock<std::mutex> lock(shard->latch_);
 
-        // @STATE:
-        if(state_open_)
-            ContextManager::get_instance()->append_lock_state(lock_request, thread_index);
-        return lock_request;
-    }
+    LockRequestQueue* request_queue = get_or_create_request_queue(shard, lock_data_id, -1);
 
-    Lock* req = request_queue->request_queue_->next_;
-    bool conflict = false;
-    while(req != nullptr) {
+    for(Lock* req = request_queue->request_queue_->next_; req != nullptr; req = req->next_) {
         // std::cout << "req.trx_id: " << req->trx_id_ << ", request_trx_id: " << txn->get_transaction_id() << "\n";
         if(req->trx_id_ == txn->get_transaction_id()) {
-            if(req->get_table_lock_mode() >= (1U << lock_mode)) {
-                // std::cout << "current mode contains request mode\n";
-                delete lock_request;
-                return req;
-            }
-            else {
+            if(req->get_table_lock_mode() < (1U << lock_mode)) {
                 // std::cout << "current mode need to upgrade\n";
-                delete lock_request;
-                lock.unlock();
-                return upgrade_table_lock_mode(lock_mode, request_queue, req, thread_index);
+                req->txn_ = txn;
+                upgrade_table_lock_mode(lock_mode, request_queue, req, lock, thread_index);
             }
+            txn->set_table_lock(table_id, req);
+            return req;
         }
-        else {
-            if(req->is_conflict_table_mode(lock_mode)) {
-                // std::cout << "conflict: req.trx_id=" << req->trx_id_ << ", req.table_mode:" << req->get_table_lock_mode() << "\n";
-                conflict = true;
-                break;
-            }
-        }
-        req = req->next_;
     }
 
-    if(conflict == true) {
-        delete lock_request;
-        throw TransactionAbortException(txn->get_transaction_id(), AbortReason::DEADLOCK_PREVENTION);
+    std::vector<Lock*> blockers;
+    bool blocked = find_blockers(request_queue, nullptr, txn->get_transaction_id(), true, RECORD_INVALID_LOCK, lock_mode,
+                                 wait_policy_ == LockWaitPolicy::NO_WAIT ? nullptr : &blockers);
+    if(blocked) {
+        if(wait_policy_ == LockWaitPolicy::NO_WAIT) {
+            throw TransactionAbortException(txn->get_transaction_id(), AbortReason::DEADLOCK_PREVENTION);
+        }
+        resolve_lock_wait(txn, txn->get_transaction_id(), blockers);
     }
 
-    lock_request->next_ = request_queue->request_queue_->next_;
-    lock_request->prev_ = request_queue->request_queue_;
-    if(request_queue->request_queue_->next_ != nullptr) {
-        request_queue->request_queue_->next_->prev_ = lock_request;
+    Lock* lock_request = new_lock(txn->get_transaction_id());
+    lock_request->table_id_ = table_id;
+    lock_request->record_no_ = -1;
+    lock_request->type_mode_ = (LOCK_TABLE | (1U << (lock_mode + BIT_LOCK_MODE_TABLE)));
+    lock_request->txn_ = txn;
+    lock_request->wait_lock_mode_ = lock_mode;
+    if(blocked) {
+        lock_request->type_mode_ |= LOCK_WAIT;
+    }
+    push_back_lock(request_queue, lock_request);
+    if(blocked) {
+        wait_for_grant(request_queue, lock_request, txn, lock);
     }
-    request_queue->request_queue_->next_ = lock_request;
+    txn->set_table_lock(table_id, lock_request);
 
     //@STATE:
     if(state_open_)
@@ -442,8 +552,6 @@ Lock* LockManager::request_table_lock(int table_id, Transaction* txn, LockMode l
 }
 
 bool LockManager::unlock(Transaction* txn, Lock* lock) {
-    std::unique_lock<std::mutex> latch(latch_);
-
     if(UnlockCheckState(txn) == false) {
         return false;
     }
@@ -455,20 +563,124 @@ bool LockManager::unlock(Transaction* txn, Lock* lock) {
         // std::cout << "release_table_lock: table_id: " << lock->table_id_ << ", lock_mode: " << lock->get_table_lock_mode_str() << "trx_id: " << txn->get_transaction_id() << "\n";
     // } 
 
+    // 其他事务purge记录时会把gap锁转移到下一条记录上(inherit_gap_locks)，转移时同时持有两个分区的latch，
+    // 所以持有latch之后锁所在的分区没有变化，就说明它不会再被转移
+    LockDataId lock_data_id = get_lock_data_id(lock);
+    LockTableShard* shard = get_shard(lock_data_id);
+    std::unique_lock<std::mutex> latch(shard->latch_);
+    lock_data_id = get_lock_data_id(lock);
+    while(get_shard(lock_data_id) != shard) {
+        latch.unlock();
+        shard = get_shard(lock_data_id);
+        latch = std::unique_lock<std::mutex>(shard->latch_);
+        lock_data_id = get_lock_data_id(lock);
+    }
+
     lock->prev_->next_ = lock->next_;
     if(lock->next_ != nullptr)
         lock->next_->prev_ = lock->prev_;
+
+    LockListInBucket* lock_list = &shard->lock_table_.find(lock_data_id)->second;
+    if(lock->is_table_lock()) {
+        grant_waiting_locks(lock_list->first_lock_queue_);
+        txn->erase_table_lock(lock->table_id_, lock);
+    }
+    else {
+        grant_waiting_locks(get_record_request_queue_(Rid{.page_no = INVALID_PAGE_ID, .slot_no = -1, .record_no = lock->record_no_}, lock_list));
+        release_empty_request_queue(shard, lock_data_id, lock->record_no_);
+    }
     
     // @STATE:
     // TODO:
     if(state_open_)
         ContextManager::get_instance()->erase_lock_state(lock);
 
-    delete lock;
+    free_lock(lock);
 
     return true;
 }
 
+/**
+ * @description: 记录record_no被物理删除(purge)之后，其他事务在该记录上持有的next-key锁、gap锁和插入意向锁
+ * 转移到下一条记录next_record_no上，next-key锁转换成gap锁，这样被删除记录之前的间隙仍然被保护
+ * 锁对象本身被移动，而不是重新创建，因此持有者事务lock_set中的指针仍然有效，事务结束时正常释放
+ * 两条记录可能位于锁表的不同分区，转移期间同时持有两个分区的latch
+ * 只转移已经授予的锁，等待中的请求留在原来的队列中，在删除者释放锁之后被授予
+ * @param {int32_t} record_no 被删除的记录
+ * @param {int32_t} next_record_no key顺序上的下一条记录，最后一条记录的下一条记录为leaf_end
+ * @param {Transaction*} txn 执行删除的事务，它自己的锁不转移，在事务结束时释放
+ */
+void LockManager::inherit_gap_locks(int table_id, int32_t record_no, int32_t next_record_no, Transaction* txn, int thread_index) {
+    if(node_type_ == 1) {
+        return;
+    }
+
+    LockDataId lock_data_id(table_id, record_no, LockDataType::RECORD);
+    LockDataId next_data_id(table_id, next_record_no, LockDataType::RECORD);
+    LockTableShard* shard = get_shard(lock_data_id);
+    LockTableShard* next_shard = get_shard(next_data_id);
+    std::unique_lock<std::mutex> latch(shard->latch_, std::defer_lock);
+    std::unique_lock<std::mutex> next_latch(next_shard->latch_, std::defer_lock);
+    if(shard == next_shard) {
+        latch.lock();
+    } else {
+        std::lock(latch, next_latch);
+    }
+
+    auto lock_list_iter = shard->lock_table_.find(lock_data_id);
+    if(lock_list_iter == shard->lock_table_.end()) {
+        return;
+    }
+    LockRequestQueue* request_queue = get_record_request_queue_(Rid{.page_no = INVALID_PAGE_ID, .slot_no = -1, .record_no = record_no}, &lock_list_iter->second);
+    if(request_queue == nullptr) {
+        return;
+    }
+
+    LockRequestQueue* next_queue = nullptr;
+    Lock* iterator = request_queue->request_queue_->next_;
+    while(iterator != nullptr) {
+        Lock* lock = iterator;
+        iterator = iterator->next_;
+        if(lock->trx_id_ == txn->get_transaction_id() || !lock->is_granted()) continue;
+
+        uint32_t gap_mode = lock->get_record_lock_mode(RECORD_LOCK_ORDINARY) | lock->get_record_lock_mode(RECORD_LOCK_GAP);
+        bool insert_intention = lock->is_insert_intention();
+        if(gap_mode == 0 && !insert_intention) continue;
+
+        // remove the lock from the queue of the deleted record
+        lock->prev_->next_ = lock->next_;
+        if(lock->next_ != nullptr)
+            lock->next_->prev_ = lock->prev_;
+
+        lock->type_mode_ = (insert_intention ? LOCK_INSERT_INTENTION : 0);
+        if(gap_mode != 0)
+            lock->type_mode_ |= (LOCK_GAP | (gap_mode << BIT_LOCK_MODE_GAP));
+        lock->record_no_ = next_record_no;
+
+        if(next_queue == nullptr) {
+            next_queue = get_or_create_request_queue(next_shard, next_data_id, next_record_no);
+        }
+        // gap locks are compatible with each other, append the lock to the head of the queue directly
+        push_front_lock(next_queue, lock);
+        // 继承的锁可能阻塞下一条记录上已有的等待者
+        resolve_new_blocker(next_queue, lock, true);
+
+        // @STATE:
+        if(state_open_)
+            ContextManager::get_instance()->append_lock_state(lock, thread_index);
+    }
+
+    grant_waiting_locks(request_queue);
+    release_empty_request_queue(shard, lock_data_id, record_no);
+}
+
 void LockManager::recover_lock_table(Transaction** active_txn_list, int thread_num) {
-    ContextManager::get_instance()->fetch_lock_states(&lock_table_, active_txn_list, thread_num);
-}
\ No newline at end of file
+    std::vector<Lock*> locks;
+    ContextManager::get_instance()->fetch_lock_states(&locks, active_txn_list, thread_num);
+    for(auto lock: locks) {
+        LockDataId lock_data_id = get_lock_data_id(lock);
+        LockTableShard* shard = get_shard(lock_data_id);
+        std::unique_lock<std::mutex> latch(shard->latch_);
+        push_front_lock(get_or_create_request_queue(shard, lock_data_id, lock->record_no_), lock);
+    }
+}
@@ -2,39 +2,194 @@
 
 #include <mutex>
 #include <unordered_map>
+#include <vector>
+
 #include "transaction/transaction.h"
 #include "lock.h"
 
 // static const std::string GroupLockModeStr[10] = {"NON_LOCK", "IS", "IX", "S", "X", "SIX"};
 
+/**
+ * @description: 线程本地的空闲对象链表，Lock和LockRequestQueue释放之后放回当前线程的链表中复用，避免每次加锁都new/delete
+ * 对象可以在一个线程中申请、在另一个线程中释放，链表长度超过LOCK_FREELIST_MAX_SIZE之后直接delete
+ */
+template <typename T>
+class ThreadLocalFreeList {
+public:
+    static T* allocate() {
+        std::vector<T*>& objs = get_local_list().objs_;
+        if(objs.empty()) return new T();
+        T* obj = objs.back();
+        objs.pop_back();
+        return obj;
+    }
+
+    static void deallocate(T* obj) {
+        std::vector<T*>& objs = get_local_list().objs_;
+        if(objs.size() >= LOCK_FREELIST_MAX_SIZE) {
+            delete obj;
+            return;
+        }
+        objs.push_back(obj);
+    }
+
+private:
+    struct FreeList {
+        std::vector<T*> objs_;
+        ~FreeList() {
+            for(auto obj: objs_) delete obj;
+        }
+    };
+
+    static FreeList& get_local_list() {
+        thread_local FreeList free_list;
+        return free_list;
+    }
+};
+
+/**
+ * @description: 锁表的一个分区，LockDataId按照哈希值分布到不同的分区中，每个分区使用独立的latch
+ */
+struct alignas(64) LockTableShard {
+    std::mutex latch_;
+    std::unordered_map<LockDataId, LockListInBucket> lock_table_;
+};
+
 class LockManager {
 
 public:
     LockManager() {}
 
-    ~LockManager() {}
+    ~LockManager() {
+        for(auto& shard: shards_) {
+            for(auto& [lock_data_id, lock_list]: shard.lock_table_) {
+                while(lock_list.first_lock_queue_ != nullptr) {
+                    LockRequestQueue* request_queue = lock_list.first_lock_queue_;
+                    lock_list.first_lock_queue_ = request_queue->next_;
+                    delete request_queue;
+                }
+            }
+        }
+    }
     
+    void set_wait_policy(LockWaitPolicy wait_policy) { wait_policy_ = wait_policy; }
+
+    LockWaitPolicy get_wait_policy() { return wait_policy_; }
+
     LockRequestQueue* get_record_request_queue_(const Rid& rid, LockListInBucket* lock_list);
 
     // lock request functions for record
     Lock* check_record_lock_conflic(RecordLockType lock_type, LockMode lock_mode, LockRequestQueue* request_queue, Lock* req);
 
-    Lock* upgrade_record_lock_type_mode(RecordLockType lock_type, LockMode lock_mode, LockRequestQueue* request_queue, Lock* req, int thread_index);
+    // 调用者需要持有request_queue所在分区的latch，需要等待时会暂时释放latch
+    Lock* upgrade_record_lock_type_mode(RecordLockType lock_type, LockMode lock_mode, LockRequestQueue* request_queue, Lock* req,
+                                        std::unique_lock<std::mutex>& latch, int thread_index);
 
     Lock* request_record_lock(int table_id, const Rid& rid, Transaction* txn, RecordLockType lock_type, LockMode lock_mode, int thread_index);
 
     // lock request functions for table
-    Lock* upgrade_table_lock_mode(LockMode lock_mode, LockRequestQueue* request_queue, Lock* req, int thread_index);
+    // 调用者需要持有request_queue所在分区的latch，需要等待时会暂时释放latch
+    Lock* upgrade_table_lock_mode(LockMode lock_mode, LockRequestQueue* request_queue, Lock* req,
+                                  std::unique_lock<std::mutex>& latch, int thread_index);
     
     Lock* request_table_lock(int table_id, Transaction* txn, LockMode lock_mode, int thread_index);
 
     bool unlock(Transaction* txn, Lock* lock);
 
+    // 记录被物理删除之后，其他事务在该记录上的gap锁由下一条记录继承
+    void inherit_gap_locks(int table_id, int32_t record_no, int32_t next_record_no, Transaction* txn, int thread_index);
+
     void recover_lock_table(Transaction** active_txn_list, int thread_num);
 
 private:
-    std::mutex latch_;      // 用于锁表的并发
-    std::unordered_map<LockDataId, LockListInBucket> lock_table_;   // 全局锁表
+    static LockDataId get_lock_data_id(Lock* lock) {
+        return lock->is_table_lock() ? LockDataId(lock->table_id_, LockDataType::TABLE)
+                                     : LockDataId(lock->table_id_, lock->record_no_, LockDataType::RECORD);
+    }
+
+    LockTableShard* get_shard(const LockDataId& lock_data_id) {
+        // LockDataId::Get()的低16位总是0，需要重新打散之后再取模
+        uint64_t hash = static_cast<uint64_t>(lock_data_id.Get()) * 0x9E3779B97F4A7C15ULL;
+        return &shards_[(hash >> 32) % LOCK_TABLE_SHARD_NUM];
+    }
+
+    static Lock* new_lock(txn_id_t trx_id) {
+        Lock* lock = ThreadLocalFreeList<Lock>::allocate();
+        lock->reset(trx_id);
+        return lock;
+    }
+
+    static void free_lock(Lock* lock) { ThreadLocalFreeList<Lock>::deallocate(lock); }
+
+    static LockRequestQueue* new_request_queue(int32_t record_no) {
+        LockRequestQueue* request_queue = ThreadLocalFreeList<LockRequestQueue>::allocate();
+        request_queue->reset(record_no);
+        return request_queue;
+    }
+
+    static void free_request_queue(LockRequestQueue* request_queue) {
+        ThreadLocalFreeList<LockRequestQueue>::deallocate(request_queue);
+    }
+
+    // 把lock插入到request_queue的队首
+    static void push_front_lock(LockRequestQueue* request_queue, Lock* lock) {
+        lock->prev_ = request_queue->request_queue_;
+        lock->next_ = request_queue->request_queue_->next_;
+        if(request_queue->request_queue_->next_ != nullptr) {
+            request_queue->request_queue_->next_->prev_ = lock;
+        }
+        request_queue->request_queue_->next_ = lock;
+    }
+
+    // 在shard中找到lock_data_id和record_no对应的请求队列，不存在时创建，调用者需要持有shard的latch
+    LockRequestQueue* get_or_create_request_queue(LockTableShard* shard, const LockDataId& lock_data_id, int32_t record_no);
+
+    // 记录的请求队列为空时，把它从所在的bucket中移除并回收，调用者需要持有shard的latch
+    void release_empty_request_queue(LockTableShard* shard, const LockDataId& lock_data_id, int32_t record_no);
+
+    // holder(授予的模式，或者等待中的请求的模式；use_upgrade为true时使用等待中的锁升级完成之后的模式)是否和请求冲突
+    static bool is_lock_conflict(Lock* holder, bool use_upgrade, bool is_table, RecordLockType lock_type, LockMode lock_mode);
+
+    static bool is_record_lock_conflict(Lock* holder, RecordLockType lock_type, LockMode lock_mode);
+
+    // 把锁升级对应的模式加到type_mode_上
+    static uint32_t get_upgraded_type_mode(Lock* req, RecordLockType lock_type, LockMode lock_mode);
+
+    // 找到阻塞waiter请求的锁：已经授予的锁、排在waiter之前的等待者以及等待中的锁升级，waiter为nullptr时表示新的请求
+    // blockers为nullptr时只判断是否存在
+    bool find_blockers(LockRequestQueue* request_queue, Lock* waiter, txn_id_t trx_id, bool is_table, RecordLockType lock_type,
+                       LockMode lock_mode, std::vector<Lock*>* blockers);
+
+    // 锁升级只等待已经授予的冲突锁，排在前面的等待者不阻塞锁升级
+    bool find_upgrade_blockers(LockRequestQueue* request_queue, Lock* req, bool is_table, RecordLockType lock_type,
+                               LockMode lock_mode, std::vector<Lock*>* blockers);
+
+    // 请求者txn将要等待blockers，按照wait_policy_处理：wait-die中请求者比某个blocker年轻则抛出异常，wound-wait中wound所有更年轻的blocker
+    void resolve_lock_wait(Transaction* txn, txn_id_t trx_id, const std::vector<Lock*>& blockers);
+
+    // blocker成为了队列中已有等待者的新的阻塞者(锁升级或者gap锁继承)，同样需要按照wait_policy_处理这些新的等待关系
+    void resolve_new_blocker(LockRequestQueue* request_queue, Lock* blocker, bool block_upgrades);
+
+    // 阻塞等待lock被授予，被wound时取消等待并抛出异常，返回时latch仍然被持有
+    void wait_for_grant(LockRequestQueue* request_queue, Lock* lock, Transaction* txn, std::unique_lock<std::mutex>& latch);
+
+    // 取消lock上的等待(等待中的请求或者锁升级)，被取消的请求从队列中删除
+    void cancel_lock_wait(LockRequestQueue* request_queue, Lock* lock);
+
+    // 队列中的锁被释放或者取消之后，先授予等待中的锁升级，再按照FIFO的顺序授予等待中的请求
+    void grant_waiting_locks(LockRequestQueue* request_queue);
+
+    // 把lock插入到request_queue的队尾
+    static void push_back_lock(LockRequestQueue* request_queue, Lock* lock) {
+        Lock* tail = request_queue->request_queue_;
+        while(tail->next_ != nullptr) tail = tail->next_;
+        tail->next_ = lock;
+        lock->prev_ = tail;
+        lock->next_ = nullptr;
+    }
+
+    LockTableShard shards_[LOCK_TABLE_SHARD_NUM];   // 按照LockDataId分区的锁表
+    LockWaitPolicy wait_policy_ = LockWaitPolicy::NO_WAIT;
 };
 
 /**
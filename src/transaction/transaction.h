@@ -1,9 +1,12 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
 #include <deque>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <unordered_set>
 #include <list>
 
@@ -21,6 +24,7 @@ class Transaction {
         prev_lsn_ = INVALID_LSN;
         thread_id_ = thread_id;
         is_read_only_txn_ = false;
+        start_ts_ = INVALID_TIMESTAMP;
         readview_ = std::make_shared<ReadView>();
     }
     // explicit Transaction(txn_id_t txn_id, IsolationLevel isolation_level = IsolationLevel::SERIALIZABLE)
@@ -40,9 +44,12 @@ class Transaction {
         write_set_->clear();
 
         lock_set_->clear();
+        table_lock_map_.clear();
         index_deleted_page_set_->clear();
         index_latch_page_set_->clear();
         prev_lsn_ = INVALID_LSN;
+        wounded_.store(false);
+        lock_wait_signaled_ = false;
 
         if(is_read_only_txn_) readview_->clear();
     }
@@ -61,6 +68,29 @@ class Transaction {
     inline lsn_t get_prev_lsn() { return prev_lsn_; }
     inline void set_prev_lsn(lsn_t prev_lsn) { prev_lsn_ = prev_lsn; }
 
+    // 锁等待：等待者在自己的条件变量上等待，授予锁或者wound该事务的线程负责唤醒
+    inline void wait_lock_signal() {
+        std::unique_lock<std::mutex> lock(lock_wait_latch_);
+        lock_wait_cv_.wait(lock, [this] { return lock_wait_signaled_; });
+        lock_wait_signaled_ = false;
+    }
+    inline void signal_lock_wait() {
+        std::lock_guard<std::mutex> lock(lock_wait_latch_);
+        lock_wait_signaled_ = true;
+        lock_wait_cv_.notify_one();
+    }
+
+    // wound-wait中被更老的事务wound，或者wait-die中需要回滚的等待者，在下一次申请锁或者等待锁时回滚
+    inline bool is_wounded() { return wounded_.load(); }
+    inline void wound() {
+        wounded_.store(true);
+        signal_lock_wait();
+    }
+
+    // 因为wait-die/wound-wait回滚的事务重新开始时沿用原来的时间戳，避免它一直是最年轻的事务
+    inline bool is_lock_wait_victim() { return lock_wait_victim_; }
+    inline void set_lock_wait_victim(bool victim) { lock_wait_victim_ = victim; }
+
     inline std::shared_ptr<std::deque<WriteRecord *>> get_write_set() { return write_set_; }  
     inline void append_write_record(WriteRecord* write_record) { write_set_->push_back(write_record); }
 
@@ -73,6 +103,17 @@ class Transaction {
     inline std::shared_ptr<std::unordered_set<Lock*>> get_lock_set() { return lock_set_; }
     inline void append_lock(Lock* lock) { lock_set_->emplace(lock); }
 
+    // 事务已经持有的表锁，用于表级意向锁的快速路径，只会被事务自己的线程访问
+    inline Lock* get_table_lock(int table_id) {
+        auto iter = table_lock_map_.find(table_id);
+        return iter == table_lock_map_.end() ? nullptr : iter->second;
+    }
+    inline void set_table_lock(int table_id, Lock* lock) { table_lock_map_[table_id] = lock; }
+    inline void erase_table_lock(int table_id, Lock* lock) {
+        auto iter = table_lock_map_.find(table_id);
+        if(iter != table_lock_map_.end() && iter->second == lock) table_lock_map_.erase(iter);
+    }
+
     inline void set_read_view(std::vector<txn_id_t>&& active_txn_ids, txn_id_t next_txn_id) {
         txn_id_t min_txn_id = INT32_MAX;
         for(auto txn_id: active_txn_ids) {
@@ -87,7 +128,7 @@ class Transaction {
     int64_t thread_id_;       // 当前事务对应的线程id
     lsn_t prev_lsn_;                  // 当前事务执行的最后一条操作对应的lsn，用于系统故障恢复
     txn_id_t txn_id_;                 // 事务的ID，唯一标识符
-    timestamp_t start_ts_;            // 事务的开始时间戳
+    timestamp_t start_ts_;            // 事务的开始时间戳，wait-die/wound-wait使用它判断事务的新老
 
     bool is_read_only_txn_;                             // 是否为只读事务
     
@@ -95,6 +136,13 @@ class Transaction {
 
     std::shared_ptr<std::deque<WriteRecord *>> write_set_;  // 事务包含的所有写操作
     std::shared_ptr<std::unordered_set<Lock*>> lock_set_;  // 事务申请的所有锁
+    std::unordered_map<int, Lock*> table_lock_map_;        // table_id -> 事务持有的表锁(lock_set_的子集)
+
+    std::mutex lock_wait_latch_;                // 保护lock_wait_signaled_
+    std::condition_variable lock_wait_cv_;      // 等待锁时阻塞在该条件变量上
+    bool lock_wait_signaled_ = false;
+    std::atomic<bool> wounded_{false};
+    bool lock_wait_victim_ = false;
     std::shared_ptr<std::deque<Page*>> index_latch_page_set_;          // 维护事务执行过程中加锁的索引页面
     std::shared_ptr<std::deque<Page*>> index_deleted_page_set_;    // 维护事务执行过程中删除的索引页面
 };
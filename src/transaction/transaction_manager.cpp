@@ -12,6 +12,11 @@
 void TransactionManager::begin(Transaction* txn, LogManager* log_manager) {
     txn->clear();
     txn->set_transaction_id(next_txn_id_ ++);
+    // 因为wait-die/wound-wait被回滚的事务重试时保留原来的时间戳，否则它每次重试都是最年轻的事务，可能一直被回滚
+    if(!txn->is_lock_wait_victim() || txn->get_start_ts() == INVALID_TIMESTAMP) {
+        txn->set_start_ts(txn->get_transaction_id());
+    }
+    txn->set_lock_wait_victim(false);
     txn->set_state(TransactionState::DEFAULT);
 }
 
@@ -27,6 +32,14 @@ void TransactionManager::commit(Transaction* txn, Context* context) {
     // 3. 释放事务相关资源，eg.锁集
     // 4. 把事务日志刷入磁盘中
     // 5. 更新事务状态
+
+    // 被删除的记录在释放锁之前从索引中物理删除，此时其他事务只可能持有这些记录上的gap锁
+    for(auto& item: *txn->get_write_set()) {
+        if(item->wtype_ == WType::DELETE_TUPLE) {
+            purge_record(txn, item, context);
+        }
+    }
+
     auto lock_set = txn->get_lock_set();
 
     for(auto iter = lock_set->begin(); iter != lock_set->end(); iter ++) {
@@ -35,9 +48,10 @@ void TransactionManager::commit(Transaction* txn, Context* context) {
 
     txn->set_state(TransactionState::COMMITTED);
 
-    context->log_mgr_->add_log_to_buffer(std::move(std::make_unique<CommitLogRecord>(txn->get_transaction_id())));
+    lsn_t commit_lsn = context->log_mgr_->add_log_to_buffer(std::move(std::make_unique<CommitLogRecord>(txn->get_transaction_id())));
 
-    context->log_mgr_->write_log_to_storage();
+    // group commit: 等待commit日志和它之前的日志一起被发送到存储节点
+    context->log_mgr_->flush_to_lsn(commit_lsn);
 
     // commit之后，将事务移出active_txns，txn->get_transaction_id()
     // auto it = std::find(active_txns_.begin(), active_txns_.end(), txn->get_transaction_id());
@@ -66,16 +80,23 @@ void TransactionManager::abort(Transaction * txn, Context* context) {
         IxIndexHandle* pindex_handle = sm_manager_->primary_index_.at(item->table_name_).get();
         switch(item->wtype_) {
             case WType::INSERT_TUPLE: {
-                auto rid = pindex_handle->lower_bound(item->pkey_);
-                pindex_handle->delete_record(rid, context);
+                purge_record(txn, item, context);
             } break;
+            // 记录可能已经被压缩等操作移动，根据主键在叶子的写锁下重新定位
             case WType::DELETE_TUPLE: {
-                auto rid = pindex_handle->lower_bound(item->pkey_);
-                pindex_handle->rollback_delete_record(rid, context);
+                pindex_handle->modify_record(item->pkey_, -1, [&](char* record_slot, const Rid& rid) {
+                    *(bool*)(record_slot + RECHDR_OFF_DELETE_MARK) = false;
+                });
             } break;
             case WType::UPDATE_TUPLE: {
-                auto rid = pindex_handle->lower_bound(item->pkey_);
-                pindex_handle->update_record(rid, item->record_.raw_data_, context);
+                std::unique_ptr<Record> record;
+                pindex_handle->modify_record(item->pkey_, -1, [&](char* record_slot, const Rid& rid) {
+                    record = std::make_unique<Record>(record_slot, item->record_.data_length_ + sizeof(RecordHdr));
+                    memcpy(record_slot + sizeof(RecordHdr), item->record_.raw_data_, item->record_.data_length_);
+                });
+                if(record != nullptr) {
+                    sm_manager_->maintain_secondary_indexes(item->table_name_, record->raw_data_, item->record_.raw_data_, context);
+                }
             } break;
             default:
             break;
@@ -91,8 +112,8 @@ void TransactionManager::abort(Transaction * txn, Context* context) {
 
     txn->set_state(TransactionState::ABORTED);
 
-    context->log_mgr_->add_log_to_buffer(std::move(std::make_unique<AbortLogRecord>(txn->get_transaction_id())));
-    context->log_mgr_->write_log_to_storage();
+    lsn_t abort_lsn = context->log_mgr_->add_log_to_buffer(std::move(std::make_unique<AbortLogRecord>(txn->get_transaction_id())));
+    context->log_mgr_->flush_to_lsn(abort_lsn);
 
     // abort之后，将事务移出active_txns，txn->get_transaction_id()
     // auto it = std::find(active_txns_.begin(), active_txns_.end(), txn->get_transaction_id());
@@ -101,6 +122,33 @@ void TransactionManager::abort(Transaction * txn, Context* context) {
     // }
 }
 
+/**
+ * @description: 从聚簇索引中物理删除write_record对应的记录，并生成purge日志
+ * 记录在二级索引中的key先于聚簇索引中的记录被删除
+ * 其他事务在被删除记录上的gap锁由key顺序上的下一条记录继承
+ * purge日志在叶子释放写锁之前生成，之后修改同一个叶子的操作的日志一定在它之后
+ */
+void TransactionManager::purge_record(Transaction* txn, WriteRecord* write_record, Context* context) {
+    IxIndexHandle* pindex_handle = sm_manager_->primary_index_.at(write_record->table_name_).get();
+    if(sm_manager_->db_.get_table(write_record->table_name_).indexes_.size() > 1) {
+        Rid rid;
+        auto record = pindex_handle->get_record(write_record->pkey_, &rid);
+        if(record != nullptr) {
+            sm_manager_->maintain_secondary_indexes(write_record->table_name_, record->raw_data_, nullptr, context);
+        }
+    }
+    int32_t next_record_no;
+    Rid rid = pindex_handle->delete_entry(write_record->pkey_, txn, &next_record_no, [&]() {
+        context->log_mgr_->make_purge_redolog(txn->get_transaction_id(), write_record->pkey_, write_record->pkey_len_, write_record->table_name_);
+    });
+    if(rid.page_no == INVALID_PAGE_ID) {
+        return;
+    }
+
+    int table_id = sm_manager_->db_.get_table(write_record->table_name_).table_id_;
+    lock_manager_->inherit_gap_locks(table_id, rid.record_no, next_record_no, txn, context->coro_sched_->t_id_);
+}
+
 void TransactionManager::recover_active_txn_lists(Context* context) {
     ContextManager::get_instance()->fetch_active_txns(active_transactions_, thread_num_);
 }
\ No newline at end of file